@@ -1,16 +1,19 @@
 #pragma once
 
-#include <list>
 #include <string>
-
-using STRFILTER_MAP = std::list<std::string>;
-using STRFILTER_ITR = STRFILTER_MAP::iterator;
+#include "MAhoCorasick.h"
 
 class MChattingFilter
 {
 private:
-	STRFILTER_MAP m_AbuseMap;
-	STRFILTER_MAP m_InvalidNameMap;
+	enum
+	{
+		FILTER_ABUSE		= 1 << 0,
+		FILTER_INVALID_NAME	= 1 << 1,
+	};
+
+	// Both word lists, compiled by LoadFromFile.
+	MAhoCorasick m_Words;
 
 	std::string	m_strRemoveTokSkip;
 	std::string	m_strRemoveTokInvalid;
@@ -30,14 +33,16 @@ public:
 	bool LoadFromFile(class MZFileSystem* pfs, const char* szFileName);
 	bool IsValidChatting(const char* strText);
 	bool IsValidName(const char* strText);
+	// Returns the first filtered word that occurs in szText, or nullptr if there are none. Only
+	// abuse words are looked for unless bName is set. Unlike IsValidChatting and IsValidName,
+	// this doesn't touch the last filtered string, so it can be called from any thread.
+	const char* FindFilteredWord(const char* szText, bool bName = false) const;
 	const char* GetLastFilteredStr() { return m_szLastFilterdStr; }
 	bool FindInvalidChar(const std::string& strText);
 
 protected:
 	void GetLine(char*& prfBuf, char* szType, char* szText);
 	void SkipBlock(char*& prfBuf);
-	std::string PreTranslate(const std::string& strText);
-	bool FindInvalidWord(const std::string& strWord, const std::string& strText);
 };
 
 inline MChattingFilter* MGetChattingFilter() { return MChattingFilter::GetInstance(); }
\ No newline at end of file
@@ -7,13 +7,12 @@
 #include "SafeString.h"
 #include "GlobalTypes.h"
 #include "MInetUtil.h"
+#include "MCommandProfiler.h"
 
+// Turns the command profiler on from the start, and dumps it to CmdProfile.txt on destruction.
+// Without it, the profiler can still be enabled at runtime through GetCommandProfiler.
 //#define _CMD_PROFILE
 
-#ifdef _CMD_PROFILE
-#include "MCommandProfiler.h"
-#endif
-
 class MCommandCommunicator;
 class MCommandBuilder;
 
@@ -109,9 +108,8 @@ public:
 	MCommand* MakeCmdFromSaneTunnelingBlob(const MUID& Sender, const MUID& Receiver,
 		const void* pBlob, size_t Size);
 
-#ifdef _CMD_PROFILE
 	MCommandProfiler		m_CommandProfiler;
-#endif
+	MCommandProfiler& GetCommandProfiler() { return m_CommandProfiler; }
 
 	MCommand* BlobToCommand(const void* Data, size_t Size);
 	MCommand* BlobToCommand(MCmdParamBlob * Blob);
@@ -81,7 +81,7 @@ public:
 	virtual int GetSize() = 0;
 };
 
-///  Ķ
+/// ���� �Ķ����
 class MCommandParameterInt : public MCommandParameter, public CMemPool<MCommandParameterInt> {
 public:
 	int		m_Value;
@@ -311,6 +311,47 @@ public:
 	size_t GetPayloadSize() const { return m_nSize; }
 };
 
+// A blob that points into a buffer shared with whoever else holds on to it, for replies that are
+// the same for everyone and so are encoded once up front instead of copied into every command.
+// It's meant for commands that are sent: receiving into one gives it a copy of its own.
+class MCommandParameterSharedBlob : public MCommandParameterBlob
+{
+public:
+	MCommandParameterSharedBlob(std::shared_ptr<const void> pShared_, int nSize)
+	{
+		if (nSize > MAX_BLOB_SIZE)
+			return;
+
+		pShared = std::move(pShared_);
+		m_Value = const_cast<void*>(pShared.get());
+		m_nSize = nSize;
+	}
+
+	virtual ~MCommandParameterSharedBlob() override
+	{
+		if (pShared)
+			m_Value = nullptr;
+	}
+
+	virtual MCommandParameterSharedBlob* Clone() override
+	{
+		return new MCommandParameterSharedBlob(pShared, m_nSize);
+	}
+
+	virtual int SetData(const char* pData) override
+	{
+		if (pShared)
+		{
+			m_Value = nullptr;
+			pShared.reset();
+		}
+		return MCommandParameterBlob::SetData(pData);
+	}
+
+private:
+	std::shared_ptr<const void> pShared;
+};
+
 template <typename AllocT>
 class MCommandParameterBlobCustomAlloc : public MCommandParameterBlob
 {
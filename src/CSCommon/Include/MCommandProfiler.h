@@ -1,73 +1,72 @@
 #ifndef _MCOMMANDPROFILER_H
 #define _MCOMMANDPROFILER_H
 
-#include "limits.h"
 #include "MCommandManager.h"
+#include "MProfileStats.h"
+#include <memory>
 
 struct MCommandProfileItem
 {
-	//  ʿ 
-	unsigned int		nStartTime;
-
-	// 
-	unsigned int		nTotalTime;
-	unsigned int		nMinTime;
-	unsigned int		nMaxTime;
-
-	unsigned int		nSendCount;
-	unsigned int		nRecvCount;
-	unsigned int		nSendBytes;
-	unsigned int		nRecvBytes;
-
-	MCommandProfileItem()
-	{
-		nStartTime = 0;
-		nTotalTime = 0;
-		nMinTime = UINT_MAX;
-		nMaxTime = 0;
-		nSendCount = 0;
-		nRecvCount = 0;
-		nSendBytes = 0;
-		nRecvBytes = 0;
-	}
-
+	MProfileCounter		RecvCount;
+	MProfileCounter		RecvBytes;
+	MProfileCounter		SendCount;
+	MProfileCounter		SendBytes;
+	// Allocations made by the handler, if the program counts them (see MThreadAllocCount).
+	MProfileCounter		AllocCount;
+	MProfileHistogram	HandlerTime;
 };
 
-#define MAX_COMMANDPROFILER_CMD_COUNT		65536		// 16Ʈ
+#define MAX_COMMANDPROFILER_CMD_COUNT		65536		// 16 bits
 
 class MCommand;
 
+// Per command ID counts, sizes and handler times.
+//
+// Profiling is off until SetEnabled is called, and the hooks cost a branch until then. The hooks
+// are meant to be called from the one thread that runs the communicator, but everything they
+// update can be read from any other thread at the same time, so the stats can be served live
+// while the server runs. Items are only allocated for the command IDs that are actually seen.
 class MCommandProfiler
 {
-private:
-	MCommandManager*			m_pCM;
-	unsigned int				m_nFirstTime;
-	unsigned int				m_nLastTime;
-	unsigned int				m_nTotalOnProcessTime;
-
-	unsigned int				m_nTotalSendCmdCount;
-	unsigned int				m_nTotalSendBytes;
-
-	unsigned int				m_nTotalRecvCmdCount;
-	unsigned int				m_nTotalRecvBytes;
-
-	MCommandProfileItem			m_Items[MAX_COMMANDPROFILER_CMD_COUNT];
-	void PrintTitle(FILE* fp);
-	void PrintSummary(FILE* fp);
-	void PrintCmdItems(FILE* fp);
-	void Reset();
 public:
 	MCommandProfiler();
-	virtual ~MCommandProfiler();
+	~MCommandProfiler();
+
 	void Init(MCommandManager* pCM);
-	void Analysis();
-	void OnCommandBegin(MCommand* pCmd, unsigned int nTime);
-	void OnCommandEnd(MCommand* pCmd, unsigned int nTime);
+	// Must be called before anything reads the stats from another thread.
+	void SetEnabled(bool bEnabled);
+	bool IsEnabled() const { return m_bEnabled; }
+
+	void OnCommandBegin(MCommand* pCmd);
+	void OnCommandEnd(MCommand* pCmd);
 	void OnSend(MCommand* pCmd);
 	void OnRecv(MCommand* pCmd);
-};
 
+	// Writes a table of the stats to CmdProfile.txt.
+	void Analysis();
 
+	// Returns nullptr for command IDs that haven't been seen.
+	const MCommandProfileItem* GetItem(int nCmdID) const;
+	// The name of the command, or "" if it has none.
+	const char* GetCommandName(int nCmdID) const;
+	u64 GetStartTime() const { return m_nStartTime; }
 
+	// Appends every stat in the Prometheus text format, with metric names starting with szPrefix.
+	void WritePrometheus(std::string& Out, const char* szPrefix) const;
+
+private:
+	MCommandProfileItem* GetOrCreateItem(int nCmdID);
+
+	MCommandManager*	m_pCM = nullptr;
+	bool				m_bEnabled = false;
+	u64					m_nStartTime = 0;
+
+	// Only valid between OnCommandBegin and OnCommandEnd.
+	bool				m_bInCommand = false;
+	u64					m_nBeginTime = 0;
+	u64					m_nBeginAllocs = 0;
+
+	std::unique_ptr<std::atomic<MCommandProfileItem*>[]>	m_Items;
+};
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+// Buckets values by where they are on the XY plane, in square cells of CellSize, so that finding
+// the ones near a point only has to look at a few cells. Unlike MGridMap, it doesn't need to know
+// the bounds of the map in advance: only the cells that have something in them exist.
+//
+// Each cell is a flat vector that stays allocated when it empties, since the same spots tend to
+// fill up again. Call Clear to give it all back.
+template <typename T>
+class MHashGrid
+{
+public:
+	explicit MHashGrid(float CellSize) : CellSize{ CellSize } {}
+
+	void Add(float x, float y, const T& Value)
+	{
+		Cells[GetKey(GetCellCoord(x), GetCellCoord(y))].push_back(Value);
+	}
+
+	// Must be called with the same position the value was added with.
+	void Remove(float x, float y, const T& Value)
+	{
+		auto it = Cells.find(GetKey(GetCellCoord(x), GetCellCoord(y)));
+		if (it == Cells.end())
+			return;
+
+		auto& Cell = it->second;
+		auto ValueIt = std::find(Cell.begin(), Cell.end(), Value);
+		if (ValueIt == Cell.end())
+			return;
+
+		*ValueIt = std::move(Cell.back());
+		Cell.pop_back();
+	}
+
+	void Clear() { Cells.clear(); }
+
+	// Calls Fn with every value in the cells that overlap the box. That's a superset of the ones
+	// actually in it, so the caller still has to test the distance.
+	template <typename FnType>
+	void ForEachInBox(float MinX, float MinY, float MaxX, float MaxY, FnType&& Fn) const
+	{
+		if (Cells.empty())
+			return;
+
+		const auto MinCellX = GetCellCoord(MinX), MaxCellX = GetCellCoord(MaxX);
+		const auto MinCellY = GetCellCoord(MinY), MaxCellY = GetCellCoord(MaxY);
+		for (auto y = MinCellY; y <= MaxCellY; ++y)
+		{
+			for (auto x = MinCellX; x <= MaxCellX; ++x)
+			{
+				auto it = Cells.find(GetKey(x, y));
+				if (it == Cells.end())
+					continue;
+				for (auto& Value : it->second)
+					Fn(Value);
+			}
+		}
+	}
+
+	float GetCellSize() const { return CellSize; }
+
+private:
+	i32 GetCellCoord(float x) const { return i32(std::floor(x / CellSize)); }
+	static u64 GetKey(i32 x, i32 y) { return (u64(u32(x)) << 32) | u32(y); }
+
+	float CellSize;
+	std::unordered_map<u64, std::vector<T>> Cells;
+};
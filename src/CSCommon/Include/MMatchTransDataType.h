@@ -418,6 +418,16 @@ struct ZACTOR_BASICINFO {
 	u8			anistate;
 };
 
+// An NPC in MC_QUEST_NPC_SNAPSHOT. Encoded like ZACTOR_BASICINFO, without the time, which the
+// server doesn't send, and the vertical direction, which is always zero.
+struct MTD_NPCSnapshot {
+	MUID			uidNPC;
+	short			posx, posy, posz;
+	short			velx, vely, velz;
+	short			dirx, diry;
+	u8			anistate;
+};
+
 struct ZPACKEDSHOTINFO {
 	float	fTime;
 	short	posx, posy, posz;
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include <atomic>
+#include <string>
+#include <vector>
+
+// Allocations made by the calling thread. Programs that count them increment this from their
+// global operator new while MCountAllocations is set; in the others it stays at zero.
+extern thread_local u64 MThreadAllocCount;
+// Set by MCommandProfiler::SetEnabled, so that operator new only pays for the count while the
+// profiler is there to read it.
+extern std::atomic<bool> MCountAllocations;
+
+// Microseconds from an arbitrary starting point.
+u64 MGetProfileTime();
+
+// A counter with one writing thread and any number of reading ones. Updates are a relaxed load
+// and store, so they cost the same as on a plain integer.
+class MProfileCounter
+{
+public:
+	void Add(u64 n) { Value.store(Value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed); }
+	void SetMax(u64 n)
+	{
+		if (n > Value.load(std::memory_order_relaxed))
+			Value.store(n, std::memory_order_relaxed);
+	}
+	u64 Get() const { return Value.load(std::memory_order_relaxed); }
+
+private:
+	std::atomic<u64> Value{ 0 };
+};
+
+// Histogram of durations in microseconds, with the same threading rules as MProfileCounter.
+//
+// Values below 2^LINEAR_BITS get a bucket each, and every power of two above that is split into
+// SUB_BUCKETS buckets, so the percentiles it reports are within about 6% of the true ones. Adding
+// a sample is a couple of shifts and two counter updates. Readers may see a sample in the count
+// before it's in a bucket, which only matters to the last digit of a percentile.
+class MProfileHistogram
+{
+public:
+	void Add(u64 Micros);
+
+	u64 GetCount() const { return Count.Get(); }
+	u64 GetSum() const { return Sum.Get(); }
+	u64 GetMax() const { return Max.Get(); }
+	// The value that Fraction of the samples are at or below.
+	u64 GetPercentile(double Fraction) const;
+
+private:
+	enum
+	{
+		LINEAR_BITS = 5,
+		LINEAR_COUNT = 1 << LINEAR_BITS,
+		SUB_BUCKETS = LINEAR_COUNT / 2,
+		// Anything above 2^MAX_BITS microseconds (about 12 days) goes into the last bucket.
+		MAX_BITS = 40,
+		BUCKET_COUNT = LINEAR_COUNT + (MAX_BITS - LINEAR_BITS) * SUB_BUCKETS,
+	};
+
+	static u32 GetBucket(u64 Micros);
+	static u64 GetBucketMax(u32 Bucket);
+
+	MProfileCounter Buckets[BUCKET_COUNT];
+	MProfileCounter Count;
+	MProfileCounter Sum;
+	MProfileCounter Max;
+};
+
+// Times the phases of a loop that runs on one thread. Call BeginPhase at the start of each phase,
+// which also ends the previous one, and EndTick when the iteration is done.
+class MPhaseProfiler
+{
+public:
+	// Names must outlive the profiler.
+	explicit MPhaseProfiler(std::vector<const char*> PhaseNames);
+
+	void BeginPhase(int Phase);
+	void EndTick();
+
+	size_t GetPhaseCount() const { return PhaseNames.size(); }
+	const char* GetPhaseName(int Phase) const { return PhaseNames[Phase]; }
+	const MProfileHistogram& GetPhaseTime(int Phase) const { return PhaseTimes[Phase]; }
+	const MProfileHistogram& GetTickTime() const { return TickTime; }
+
+private:
+	void EndPhase(u64 Now);
+
+	std::vector<const char*> PhaseNames;
+	std::vector<MProfileHistogram> PhaseTimes;
+	MProfileHistogram TickTime;
+	int CurrentPhase = -1;
+	u64 PhaseStart = 0;
+	u64 TickStart = 0;
+};
+
+// Writers for the Prometheus text exposition format. Labels is either empty or a list of
+// label="value" pairs without the braces.
+void MPrometheusHeader(std::string& Out, const char* Name, const char* Type, const char* Help);
+void MPrometheusValue(std::string& Out, const char* Name, const char* Labels, u64 Value);
+// Writes Hist as a summary in seconds, with the 0.5, 0.9, 0.99 and 0.999 quantiles.
+void MPrometheusSummary(std::string& Out, const char* Name, const char* Labels,
+	const MProfileHistogram& Hist);
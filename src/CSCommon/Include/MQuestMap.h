@@ -86,4 +86,9 @@ public:
 	{
 		return &m_MapsetInfo;
 	}
+
+	MQuestMapSectorMap*		GetSectorMap()
+	{
+		return &m_SectorInfo;
+	}
 };
\ No newline at end of file
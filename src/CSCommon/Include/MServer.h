@@ -5,6 +5,7 @@
 #include "MDebug.h"
 #include <list>
 #include "NetIO.h"
+#include "MWorkSignal.h"
 
 class MCommand;
 
@@ -29,6 +30,9 @@ protected:
 	void LockSafeCmdQueue() { m_csSafeCmdQueue.lock(); }
 	void UnlockSafeCmdQueue() { m_csSafeCmdQueue.unlock(); }
 
+	// Signalled whenever there's something new for Run to do, see WaitForWork.
+	MWorkSignal WorkSignal;
+
 	virtual MUID UseUID() = 0;
 
 	void AddCommObject(const MUID& uid, MCommObject* pCommObj);
@@ -82,4 +86,11 @@ public:
 	virtual void Log(unsigned int nLogLevel, const char* szLog) = 0;
 
 	void LogF(unsigned int Level, const char* Format, ...);
+
+	// Thread safe. Makes WaitForWork return. Commands that go through PostSafeQueue already
+	// do this, anything else that hands work to the main thread should call it.
+	void Wake() { WorkSignal.Wake(); }
+	// Waits for up to Timeout milliseconds for a call to Wake, so that the loop that calls Run
+	// doesn't have to poll. Doesn't wait at all if there are commands left over from the last Run.
+	void WaitForWork(u32 Timeout);
 };
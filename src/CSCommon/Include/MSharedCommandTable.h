@@ -434,6 +434,8 @@ enum Type : uint32_t
 #define MC_QUEST_OBTAIN_ZITEM				6011
 #define MC_QUEST_PING						6012
 #define MC_QUEST_PONG						6013
+#define MC_QUEST_NPC_SNAPSHOT				6014
+#define MC_QUEST_NPC_RELEASE_CONTROL		6015
 
 // Quest peer
 #define MC_QUEST_PEER_NPC_BASICINFO			6040
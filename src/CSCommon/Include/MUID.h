@@ -3,6 +3,7 @@
 #include <climits>
 #include <map>
 #include <vector>
+#include <string>
 #include "GlobalTypes.h"
 
 /// MAIET Unique ID
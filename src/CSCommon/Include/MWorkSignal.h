@@ -0,0 +1,30 @@
+#pragma once
+
+#include "MSync.h"
+
+// Lets the thread that runs a server's loop sleep until another thread hands it work, or until
+// its next tick is due, instead of polling. Used by MServer::Wake and WaitForWork.
+class MWorkSignal
+{
+public:
+	// Thread safe. Makes the Wait in progress, or the next one, return.
+	void Wake() { Event.SetEvent(); }
+
+	// Waits for up to Timeout milliseconds for a call to Wake. Doesn't wait at all if HasWork,
+	// which is for work left over from the last pass of the loop. Returns false on timeout.
+	bool Wait(u32 Timeout, bool HasWork)
+	{
+		if (HasWork)
+			return true;
+
+		// Anything that wakes it between here and the reset is picked up by the pass of the loop
+		// that follows, since the reset comes before that.
+		if (Event.Await(Timeout) != 0)
+			return false;
+		Event.ResetEvent();
+		return true;
+	}
+
+private:
+	MSignalEvent Event;
+};
@@ -25,8 +25,6 @@ MChattingFilter::MChattingFilter()
 
 MChattingFilter::~MChattingFilter()
 {
-	m_AbuseMap.clear();
-	m_InvalidNameMap.clear();
 }
 
 
@@ -35,6 +33,8 @@ bool MChattingFilter::LoadFromFile( MZFileSystem* pfs, const char* szFileName)
 	if ( szFileName == 0)
 		return false;
 
+	// If the file can't be opened, the words loaded before, if any, are kept. Until a list has
+	// been loaded, m_Words hasn't been built, and finds nothing.
 	MZFile mzf;
 	if ( !mzf.Open( szFileName, pfs)) 
 		return false;
@@ -48,7 +48,7 @@ bool MChattingFilter::LoadFromFile( MZFileSystem* pfs, const char* szFileName)
 	tembuf = buffer;
 
 
-	m_AbuseMap.clear();
+	m_Words.Clear();
 
 	while ( 1)
 	{
@@ -68,13 +68,20 @@ bool MChattingFilter::LoadFromFile( MZFileSystem* pfs, const char* szFileName)
 		SkipBlock( tembuf);
 
 
+		// An empty word would match every message.
+		const size_t nTextLen = strlen( szText);
+		if ( nTextLen == 0)
+			continue;
+
 		if ( strcmp( szType, "1") == 0)
-			m_AbuseMap.push_back( szText);
+			m_Words.Add( szText, nTextLen, FILTER_ABUSE);
 
 		else if ( strcmp( szType, "2") == 0)
-			m_InvalidNameMap.push_back( szText);
+			m_Words.Add( szText, nTextLen, FILTER_INVALID_NAME);
 	}
 
+	m_Words.Build();
+
 	mzf.Close();
 	tembuf = 0;
 	delete [] buffer;
@@ -131,17 +138,25 @@ void MChattingFilter::SkipBlock( char*& prfBuf)
 	++prfBuf;
 }
 
+const char* MChattingFilter::FindFilteredWord( const char* szText, bool bName) const
+{
+	const u32 nMask = bName ? (FILTER_ABUSE | FILTER_INVALID_NAME) : FILTER_ABUSE;
+	const u32 nIndex = m_Words.Find( szText, strlen( szText), nMask);
+	if ( nIndex == MAhoCorasick::NotFound)
+		return nullptr;
+
+	return m_Words.GetPattern( nIndex).c_str();
+}
+
 bool MChattingFilter::IsValidChatting( const char* szText)
 {
 	if ( szText == 0)
 		return false;
 
-	const std::string str = PreTranslate( szText);
-
-	for ( STRFILTER_ITR itr = m_AbuseMap.begin();  itr != m_AbuseMap.end();  itr++)
+	if ( const char* szWord = FindFilteredWord( szText))
 	{
-		if ( FindInvalidWord( (*itr).c_str(), str))
-			return false;
+		strcpy_safe( m_szLastFilterdStr, szWord);
+		return false;
 	}
 
 	return true;
@@ -152,18 +167,10 @@ bool MChattingFilter::IsValidName( const char* szText)
 	if ( szText == 0)
 		return false;
 
-	const std::string str = PreTranslate( szText);
-
-	for ( STRFILTER_ITR itr = m_AbuseMap.begin();  itr != m_AbuseMap.end();  itr++)
+	if ( const char* szWord = FindFilteredWord( szText, true))
 	{
-		if ( FindInvalidWord( (*itr).c_str(), str))
-			return false;
-	}
-
-	for ( STRFILTER_ITR itr = m_InvalidNameMap.begin();  itr != m_InvalidNameMap.end();  itr++)
-	{
-		if ( FindInvalidWord( (*itr).c_str(), str))
-			return false;
+		strcpy_safe( m_szLastFilterdStr, szWord);
+		return false;
 	}
 
 	if ( FindInvalidChar( szText))
@@ -173,27 +180,6 @@ bool MChattingFilter::IsValidName( const char* szText)
 	return true;
 }
 
-std::string MChattingFilter::PreTranslate( const std::string& strText)
-{
-	return strText;
-}
-
-bool MChattingFilter::FindInvalidWord( const std::string& strWord, const std::string& strText)
-{
-	size_t nWordLen = strWord.length(); 
-
-	int nHead = 0;
-
-	auto it = std::search(strText.begin(), strText.end(), strWord.begin(), strWord.end());
-	if (it == strText.end())
-	{
-		return false;
-	}
-
-	strcpy_safe(m_szLastFilterdStr, strWord);
-	return true;
-}
-
 bool MChattingFilter::FindInvalidChar( const std::string& strText)
 {
 	for ( int i = 0;  i < (int)strText.size();  i++)
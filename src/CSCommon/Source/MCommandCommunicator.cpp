@@ -76,8 +76,9 @@ MCommandCommunicator::~MCommandCommunicator()
 
 bool MCommandCommunicator::Create()
 {
-#ifdef _CMD_PROFILE
 	m_CommandProfiler.Init(&m_CommandManager);
+#ifdef _CMD_PROFILE
+	m_CommandProfiler.SetEnabled(true);
 #endif
 
 	OnRegisterCommand(&m_CommandManager);
@@ -153,54 +154,38 @@ void MCommandCommunicator::Run()
 		{
 			if (pCommand->m_Sender != m_This)
 			{
-				#ifdef _CMD_PROFILE
-					m_CommandProfiler.OnRecv(pCommand);
-					m_CommandProfiler.OnCommandBegin(pCommand, GetGlobalTimeMS());
-				#endif
+				m_CommandProfiler.OnRecv(pCommand);
+				m_CommandProfiler.OnCommandBegin(pCommand);
 				OnCommand(pCommand);
 
-				#ifdef _CMD_PROFILE
-					m_CommandProfiler.OnCommandEnd(pCommand, GetGlobalTimeMS());
-				#endif
+				m_CommandProfiler.OnCommandEnd(pCommand);
 			}
 			else
 			{
-				#ifdef _CMD_PROFILE
-					m_CommandProfiler.OnSend(pCommand);
-				#endif
+				m_CommandProfiler.OnSend(pCommand);
 
 				SendCommand(pCommand);
 
-				#ifdef _CMD_PROFILE
-					m_CommandProfiler.OnCommandBegin(pCommand, GetGlobalTimeMS());
-				#endif
+				m_CommandProfiler.OnCommandBegin(pCommand);
 
 				OnCommand(pCommand);
 
-				#ifdef _CMD_PROFILE
-					m_CommandProfiler.OnCommandEnd(pCommand, GetGlobalTimeMS());
-				#endif
+				m_CommandProfiler.OnCommandEnd(pCommand);
 			}
 		}
 		else if (pCommand->m_pCommandDesc->IsFlag(MCDT_LOCAL)==true ||
 			    (m_This.IsValid() && pCommand->m_Receiver==m_This))
 		{
-			#ifdef _CMD_PROFILE
-				m_CommandProfiler.OnRecv(pCommand);
-				m_CommandProfiler.OnCommandBegin(pCommand, GetGlobalTimeMS());
-			#endif
+			m_CommandProfiler.OnRecv(pCommand);
+			m_CommandProfiler.OnCommandBegin(pCommand);
 
 			OnCommand(pCommand);	// Local Command ÿ ó
 
-			#ifdef _CMD_PROFILE
-				m_CommandProfiler.OnCommandEnd(pCommand, GetGlobalTimeMS());
-			#endif
+			m_CommandProfiler.OnCommandEnd(pCommand);
 		}
 		else
 		{
-			#ifdef _CMD_PROFILE
-				m_CommandProfiler.OnSend(pCommand);
-			#endif
+			m_CommandProfiler.OnSend(pCommand);
 
 			SendCommand(pCommand);	// ׿ܿ  Receiver 
 		}
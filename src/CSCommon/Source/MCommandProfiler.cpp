@@ -2,309 +2,207 @@
 #include "MCommandProfiler.h"
 #include "MDebug.h"
 #include "MCommand.h"
+#include "MPacket.h"
 
 MCommandProfiler::MCommandProfiler()
 {
-	m_pCM = NULL;
-	Reset();
 }
 
 MCommandProfiler::~MCommandProfiler()
 {
+	if (!m_Items)
+		return;
 
+	for (int i = 0; i < MAX_COMMANDPROFILER_CMD_COUNT; i++)
+		delete m_Items[i].load(std::memory_order_relaxed);
 }
 
-void MCommandProfiler::Reset()
-{
-	 m_nTotalOnProcessTime = 0;
-	 m_nFirstTime = 0;
-	 m_nLastTime = 0;
-
-	 m_nTotalSendCmdCount = 0;
-	 m_nTotalRecvCmdCount = 0;
-	 m_nTotalSendBytes = 0;
-	 m_nTotalRecvBytes = 0;
-
-	 memset(m_Items, 0, sizeof(MCommandProfileItem) * MAX_COMMANDPROFILER_CMD_COUNT);
-}
-
-void MCommandProfiler::Analysis()
-{
-	FILE* fp = fopen("CmdProfile.txt", "wt");
-	if (fp == 0) return;
-
-	PrintTitle(fp);
-	PrintSummary(fp);
-	PrintCmdItems(fp);
-
-	fclose(fp);
-
-	Reset();
-}
-
-void MCommandProfiler::PrintTitle(FILE* fp)
+void MCommandProfiler::Init(MCommandManager* pCM)
 {
-	fputs("----------------------------------------------------------------------------------------------------------------------------------------\n", fp);
-	fputs("| Command Profile                                                                                                                      |\n", fp);
-	fputs("----------------------------------------------------------------------------------------------------------------------------------------\n", fp);
+	m_pCM = pCM;
 }
 
-static char* AddCommaToNum(int num, char *buf, int buflen)
-{ 
-	char strNum[128];
-	itoa_safe(num, strNum, 10);
-	int len = (int)strlen(strNum); 
-	char* str = strNum;
-
-	char* saved = buf;
-
-	assert(len > 0); 
-	assert(buflen >= len + ((len - 1) / 3) + 1); 
-
-	switch ((len - 1) % 3) { 
-		case 3: /* fake label to make gcc happy */ 
-			while (*str) { 
-					*buf++ = ','; 
-				case 2: *buf++ = *str++; 
-				case 1: *buf++ = *str++; 
-				case 0: *buf++ = *str++; 
-			} 
-	} 
-	*buf = '\0'; 
-
-	return saved;
-} 
-
-void MCommandProfiler::PrintSummary(FILE* fp)
+void MCommandProfiler::SetEnabled(bool bEnabled)
 {
-	//  ð
-	//  Send Ŀǵ , ʴ , bytes, , ʴ bytes
-	//  Recv Ŀǵ , ʴ , bytes, , ʴ bytes
-
-	unsigned int nTotalTimeSec = (unsigned int)(floor((m_nLastTime - m_nFirstTime) / 1000.0f));
-	if (nTotalTimeSec == 0) nTotalTimeSec=1;
-
-	unsigned int nTotalCmdCount = m_nTotalSendCmdCount + m_nTotalRecvCmdCount;
-	float fSendCmdCountRate=0.0f, fRecvCmdCountRate=0.0f;
-	if (nTotalCmdCount != 0)
+	if (bEnabled && !m_Items)
 	{
-		fSendCmdCountRate = (m_nTotalSendCmdCount / ((float)(nTotalCmdCount))) * 100.0f;
-		fRecvCmdCountRate = (m_nTotalRecvCmdCount / ((float)(nTotalCmdCount))) * 100.0f;
+		m_Items.reset(new std::atomic<MCommandProfileItem*>[MAX_COMMANDPROFILER_CMD_COUNT]);
+		for (int i = 0; i < MAX_COMMANDPROFILER_CMD_COUNT; i++)
+			m_Items[i].store(nullptr, std::memory_order_relaxed);
+		m_nStartTime = MGetProfileTime();
 	}
-
-	int nSendCmdCountPerSec = m_nTotalSendCmdCount / nTotalTimeSec;
-	int nRecvCmdCountPerSec = m_nTotalRecvCmdCount / nTotalTimeSec;
-
-	unsigned int nTotalBytes = m_nTotalSendBytes + m_nTotalRecvBytes;
-	float fSendByteRate=0.0f, fRecvByteRate=0.0f;
-	if (nTotalBytes!=0)
-	{
-		fSendByteRate = (m_nTotalSendBytes / ((float)(nTotalBytes))) * 100.0f;
-		fRecvByteRate = (m_nTotalRecvBytes / ((float)(nTotalBytes))) * 100.0f;
-	}
-
-	int nSendBytePerSec = m_nTotalSendBytes / nTotalTimeSec;
-	int nRecvBytePerSec = m_nTotalRecvBytes / nTotalTimeSec;
-
-	char szTotalSendCmdCount[128]="", szTotalRecvCmdCount[128]="";
-	char szTotalSendBytes[128]="", szTotalRecvBytes[128]="";
-
-	AddCommaToNum(m_nTotalSendCmdCount, szTotalSendCmdCount, 256);
-	AddCommaToNum(m_nTotalSendBytes, szTotalSendBytes, 256);
-	AddCommaToNum(m_nTotalRecvCmdCount, szTotalRecvCmdCount, 256);
-	AddCommaToNum(m_nTotalRecvBytes, szTotalRecvBytes, 256);
-
-	fprintf(fp, "   ð = %u\n", nTotalTimeSec);
-	fprintf(fp, "  Send> Count=%s(%4.1f%%) , Count/Sec = %d \t, Bytes = %s(%4.1f%%) , Bytes/Sec = %d\n", 
-				szTotalSendCmdCount,
-				fSendCmdCountRate, 
-				nSendCmdCountPerSec,
-				szTotalSendBytes,
-				fSendByteRate, 
-				nSendBytePerSec);
-
-	fprintf(fp, "  Recv> Count=%s(%4.1f%%) , Count/Sec = %d \t, Bytes = %s(%4.1f%%) , Bytes/Sec = %d\n", 
-				szTotalRecvCmdCount, 
-				fRecvCmdCountRate, 
-				nRecvCmdCountPerSec,
-				szTotalRecvBytes, 
-				fRecvByteRate, 
-				nRecvBytePerSec);
+	m_bEnabled = bEnabled;
+	MCountAllocations.store(bEnabled, std::memory_order_relaxed);
 }
 
-void MCommandProfiler::PrintCmdItems(FILE* fp)
+MCommandProfileItem* MCommandProfiler::GetOrCreateItem(int nCmdID)
 {
-	// send: (), byte(), byte/sec
+	if (nCmdID < 0 || nCmdID >= MAX_COMMANDPROFILER_CMD_COUNT)
+		return nullptr;
 
-	fputs("----------------------------------------------------------------------------------------------------------------------------------------\n", fp);
-	fputs("  ID     |  Size ||    ||   Count(Rate)  |  Count/Sec  |  Bytes/Sec(Rate)  |  AvgTime(Rate)  |  MinTime  |  MaxTime  |  \n", fp);
-	fputs("----------------------------------------------------------------------------------------------------------------------------------------\n", fp);
-
-	// ð()
-	unsigned int nTotalTimeSec = (unsigned int)(floor((m_nLastTime - m_nFirstTime) / 1000.0f));
-	if (nTotalTimeSec == 0) nTotalTimeSec=1;
-
-	char text[512];
-	for (int i = 0; i < MAX_COMMANDPROFILER_CMD_COUNT; i++)
+	auto* pItem = m_Items[nCmdID].load(std::memory_order_relaxed);
+	if (!pItem)
 	{
-		if ((m_Items[i].nSendCount <= 0) && (m_Items[i].nRecvCount <= 0)) continue;
-
-		int nID = i;
-		char szDesc[256] = "";
-		if (m_pCM)
-		{
-			MCommandDesc* pDesc = m_pCM->GetCommandDescByID(i);
-			if (pDesc)
-				strcpy_safe(szDesc, pDesc->GetName());
-		}
-		
-		int nAvgSize = (m_Items[i].nSendBytes + m_Items[i].nRecvBytes) / (m_Items[i].nSendCount + m_Items[i].nRecvCount);
-
-
-		float fSendCountRate=0.0f, fRecvCountRate=0.0f;
-		float fSendBytesRate=0.0f, fRecvBytesRate=0.0f;
-
-		// Count Rate
-		if (m_nTotalSendCmdCount != 0)
-			fSendCountRate = (m_Items[i].nSendCount / (float)m_nTotalSendCmdCount) * 100.0f;
-		if (m_nTotalRecvCmdCount != 0)
-			fRecvCountRate = (m_Items[i].nRecvCount / (float)m_nTotalRecvCmdCount) * 100.0f;
-
-		// Count/Sec
-		float fSendCountPerSec=0.0f, fRecvCountPerSec=0.0f;
-		fSendCountPerSec = m_Items[i].nSendCount / (float)nTotalTimeSec;
-		fRecvCountPerSec = m_Items[i].nRecvCount / (float)nTotalTimeSec;
-
-		// Bytes/Sec
-		float fSendBytesPerSec=0.0f, fRecvBytesPerSec=0.0f;
-		fSendBytesPerSec = m_Items[i].nSendBytes / (float)nTotalTimeSec;
-		fRecvBytesPerSec = m_Items[i].nRecvBytes / (float)nTotalTimeSec;
-
-		// Bytes Rate
-		if (m_nTotalSendBytes != 0)
-			fSendBytesRate = (m_Items[i].nSendBytes / (float)m_nTotalSendBytes) * 100.0f;
-		if (m_nTotalRecvBytes != 0)
-			fRecvBytesRate = (m_Items[i].nRecvBytes / (float)m_nTotalRecvBytes) * 100.0f;
-
-
-		unsigned int nAvgTime = 0;
-		unsigned int nMinTime = 0;
-		unsigned int nMaxTime = 0;
-		unsigned int nTotalTime = 0;
-		float fTimeRate = 0.0f;
-
-		if (m_Items[i].nRecvCount != 0)
-			nAvgTime = m_Items[i].nTotalTime / m_Items[i].nRecvCount;
-		nMinTime = m_Items[i].nMinTime;
-		nMaxTime = m_Items[i].nMaxTime;
-
-		nTotalTime = m_Items[i].nTotalTime / 1000;
-
-		if (m_nTotalOnProcessTime != 0)
-			fTimeRate = (m_Items[i].nTotalTime / (float)(m_nTotalOnProcessTime)) * 100.0f;
-
-
-		if (m_Items[i].nSendCount != 0)
-		{
-			sprintf_safe(text, "  %5d  |  %3d  ||  Send  || %6d(%4.1f%%)  |     %4.1f    |    %6.1f(%4.1f%%)  |                 |           |           |  %s\n",
-				nID, 
-				nAvgSize, 
-				m_Items[i].nSendCount, 
-				fSendCountRate, 
-				fSendCountPerSec,
-				fSendBytesPerSec, 
-				fSendBytesRate, 
-				szDesc);
-		}
-		else
-		{
-			sprintf_safe(text, "  %5d  |  %3d  ||   --   ||      -         |       -     |         -         |        -        |       -   |       -   |  %s\n",
-				nID, 
-				nAvgSize,
-				szDesc);
-		}
-		fputs(text, fp);
-
-		if (m_Items[i].nRecvCount != 0)
-		{
-			sprintf_safe(text, "\t\t ||  Recv  || %6d(%4.1f%%)  |     %4.1f    |    %6.1f(%4.1f%%)  |   %6u(%4.1f%%) |  %6u   |  %6u   |\n",
-				m_Items[i].nRecvCount, 
-				fRecvCountRate, 
-				fRecvCountPerSec,
-				fRecvBytesPerSec, 
-				fRecvBytesRate,
-				nAvgTime, 
-				fTimeRate, 
-				nMinTime, 
-				nMaxTime);
-		}
-		else
-		{
-			sprintf_safe(text, "\t\t ||   --   ||      -         |       -     |         -         |        -        |       -   |       -   |    \n");
-		}
-		fputs(text, fp);
-		fputs("----------------------------------------------------------------------------------------------------------------------------------------\n", fp);
+		// Readers load the pointer with acquire, so they see the item fully constructed.
+		pItem = new MCommandProfileItem;
+		m_Items[nCmdID].store(pItem, std::memory_order_release);
 	}
-
+	return pItem;
 }
 
-void MCommandProfiler::OnCommandBegin(MCommand* pCmd, unsigned int nTime)
+const MCommandProfileItem* MCommandProfiler::GetItem(int nCmdID) const
 {
-	if (m_nFirstTime == 0) m_nFirstTime = nTime;
-	m_nLastTime = nTime;
-
-	int nCmdID = pCmd->GetID();
-	if ((nCmdID <0) || (nCmdID >= MAX_COMMANDPROFILER_CMD_COUNT)) return;
-
-	m_Items[nCmdID].nStartTime = nTime;
+	if (!m_Items || nCmdID < 0 || nCmdID >= MAX_COMMANDPROFILER_CMD_COUNT)
+		return nullptr;
+	return m_Items[nCmdID].load(std::memory_order_acquire);
 }
 
-void MCommandProfiler::OnCommandEnd(MCommand* pCmd, unsigned int nTime)
+const char* MCommandProfiler::GetCommandName(int nCmdID) const
 {
-	if (m_nFirstTime == 0) m_nFirstTime = nTime;
-	m_nLastTime = nTime;
-
-	int nCmdID = pCmd->GetID();
-	if ((nCmdID <0) || (nCmdID >= MAX_COMMANDPROFILER_CMD_COUNT)) return;
-
-	unsigned int nPlayTime = nTime - m_Items[nCmdID].nStartTime;
-	m_Items[nCmdID].nTotalTime += nPlayTime;
-	if (nPlayTime > m_Items[nCmdID].nMaxTime) m_Items[nCmdID].nMaxTime = nPlayTime;
-	if (nPlayTime < m_Items[nCmdID].nMinTime) m_Items[nCmdID].nMinTime = nPlayTime;
+	if (!m_pCM)
+		return "";
+	auto* pDesc = m_pCM->GetCommandDescByID(nCmdID);
+	return pDesc ? pDesc->GetName() : "";
+}
 
+void MCommandProfiler::OnCommandBegin(MCommand* pCmd)
+{
+	m_bInCommand = m_bEnabled;
+	if (!m_bInCommand)
+		return;
 
-	m_nTotalOnProcessTime += nPlayTime;
+	m_nBeginAllocs = MThreadAllocCount;
+	m_nBeginTime = MGetProfileTime();
 }
 
-#include "MPacket.h"
+void MCommandProfiler::OnCommandEnd(MCommand* pCmd)
+{
+	// The profiler may have been turned on by the handler itself.
+	if (!m_bInCommand)
+		return;
+	m_bInCommand = false;
+
+	const auto nTime = MGetProfileTime() - m_nBeginTime;
+	const auto nAllocs = MThreadAllocCount - m_nBeginAllocs;
+
+	auto* pItem = GetOrCreateItem(pCmd->GetID());
+	if (!pItem)
+		return;
+	pItem->HandlerTime.Add(nTime);
+	pItem->AllocCount.Add(nAllocs);
+}
 
 void MCommandProfiler::OnSend(MCommand* pCmd)
 {
-	int nSize = pCmd->GetSize() + sizeof(MPacketHeader);
-	m_nTotalSendBytes += (unsigned int)nSize;
-	m_nTotalSendCmdCount++;
-
-	int nCmdID = pCmd->GetID();
-	if ((nCmdID <0) || (nCmdID >= MAX_COMMANDPROFILER_CMD_COUNT)) return;
-	m_Items[nCmdID].nSendBytes += nSize;
-	m_Items[nCmdID].nSendCount++;
+	if (!m_bEnabled)
+		return;
+
+	auto* pItem = GetOrCreateItem(pCmd->GetID());
+	if (!pItem)
+		return;
+	pItem->SendCount.Add(1);
+	pItem->SendBytes.Add(pCmd->GetSize() + sizeof(MPacketHeader));
 }
 
 void MCommandProfiler::OnRecv(MCommand* pCmd)
 {
-	int nSize = pCmd->GetSize() + sizeof(MPacketHeader);
-	m_nTotalRecvBytes += (unsigned int)nSize;
-	m_nTotalRecvCmdCount++;
+	if (!m_bEnabled)
+		return;
+
+	auto* pItem = GetOrCreateItem(pCmd->GetID());
+	if (!pItem)
+		return;
+	pItem->RecvCount.Add(1);
+	pItem->RecvBytes.Add(pCmd->GetSize() + sizeof(MPacketHeader));
+}
+
+void MCommandProfiler::Analysis()
+{
+	if (!m_Items)
+		return;
 
-	int nCmdID = pCmd->GetID();
-	if ((nCmdID <0) || (nCmdID >= MAX_COMMANDPROFILER_CMD_COUNT)) return;
-	m_Items[nCmdID].nRecvBytes += nSize;
-	m_Items[nCmdID].nRecvCount++;
+	FILE* fp = fopen("CmdProfile.txt", "wt");
+	if (fp == 0) return;
 
-}
+	const auto fSeconds = (std::max)((MGetProfileTime() - m_nStartTime) / 1e6, 1.0);
+	fprintf(fp, "Command profile over %.0f seconds. Times are in microseconds.\n\n", fSeconds);
+	fprintf(fp, "%6s %-40s %10s %10s %10s %10s %8s %8s %8s %8s %10s\n",
+		"ID", "Name", "Recv", "RecvBytes", "Send", "SendBytes",
+		"Avg", "p99", "Max", "Allocs", "Total(ms)");
 
+	for (int i = 0; i < MAX_COMMANDPROFILER_CMD_COUNT; i++)
+	{
+		auto* pItem = GetItem(i);
+		if (!pItem)
+			continue;
+
+		auto& Time = pItem->HandlerTime;
+		const auto nCount = Time.GetCount();
+		fprintf(fp, "%6d %-40s %10llu %10llu %10llu %10llu %8llu %8llu %8llu %8.1f %10llu\n",
+			i, GetCommandName(i),
+			static_cast<unsigned long long>(pItem->RecvCount.Get()),
+			static_cast<unsigned long long>(pItem->RecvBytes.Get()),
+			static_cast<unsigned long long>(pItem->SendCount.Get()),
+			static_cast<unsigned long long>(pItem->SendBytes.Get()),
+			static_cast<unsigned long long>(nCount ? Time.GetSum() / nCount : 0),
+			static_cast<unsigned long long>(Time.GetPercentile(0.99)),
+			static_cast<unsigned long long>(Time.GetMax()),
+			nCount ? double(pItem->AllocCount.Get()) / nCount : 0.0,
+			static_cast<unsigned long long>(Time.GetSum() / 1000));
+	}
 
-void MCommandProfiler::Init(MCommandManager* pCM)
+	fclose(fp);
+}
+
+void MCommandProfiler::WritePrometheus(std::string& Out, const char* szPrefix) const
 {
-	m_pCM = pCM;
-}
\ No newline at end of file
+	if (!m_Items)
+		return;
+
+	struct Counter
+	{
+		const char* Name;
+		const char* Help;
+		const MProfileCounter MCommandProfileItem::* Member;
+	};
+	const Counter Counters[] = {
+		{ "commands_received_total", "Commands received, by command.", &MCommandProfileItem::RecvCount },
+		{ "command_bytes_received_total", "Bytes received, by command.", &MCommandProfileItem::RecvBytes },
+		{ "commands_sent_total", "Commands sent, by command.", &MCommandProfileItem::SendCount },
+		{ "command_bytes_sent_total", "Bytes sent, by command.", &MCommandProfileItem::SendBytes },
+		{ "command_allocations_total", "Heap allocations made by command handlers, by command.",
+			&MCommandProfileItem::AllocCount },
+	};
+
+	char szName[128];
+	char szLabels[128];
+	auto MakeLabels = [&](int nCmdID) {
+		// Command names are identifiers with dots, so they don't need escaping.
+		sprintf_safe(szLabels, "id=\"%d\",command=\"%s\"", nCmdID, GetCommandName(nCmdID));
+	};
+
+	for (auto& c : Counters)
+	{
+		sprintf_safe(szName, "%s_%s", szPrefix, c.Name);
+		MPrometheusHeader(Out, szName, "counter", c.Help);
+		for (int i = 0; i < MAX_COMMANDPROFILER_CMD_COUNT; i++)
+		{
+			auto* pItem = GetItem(i);
+			if (!pItem)
+				continue;
+			MakeLabels(i);
+			MPrometheusValue(Out, szName, szLabels, (pItem->*c.Member).Get());
+		}
+	}
+
+	sprintf_safe(szName, "%s_command_handler_seconds", szPrefix);
+	MPrometheusHeader(Out, szName, "summary", "Time spent in command handlers, by command.");
+	for (int i = 0; i < MAX_COMMANDPROFILER_CMD_COUNT; i++)
+	{
+		auto* pItem = GetItem(i);
+		if (!pItem || pItem->HandlerTime.GetCount() == 0)
+			continue;
+		MakeLabels(i);
+		MPrometheusSummary(Out, szName, szLabels, pItem->HandlerTime);
+	}
+}
@@ -0,0 +1,137 @@
+#include "stdafx.h"
+#include "MProfileStats.h"
+#include <chrono>
+#include <cmath>
+#include <algorithm>
+
+thread_local u64 MThreadAllocCount = 0;
+std::atomic<bool> MCountAllocations{ false };
+
+u64 MGetProfileTime()
+{
+	using namespace std::chrono;
+	return u64(duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+u32 MProfileHistogram::GetBucket(u64 Micros)
+{
+	if (Micros < LINEAR_COUNT)
+		return u32(Micros);
+
+	int HighestBit = 0;
+	for (auto x = Micros; x >>= 1;)
+		++HighestBit;
+	if (HighestBit >= MAX_BITS)
+		return BUCKET_COUNT - 1;
+
+	// Shift the value down until it's in [SUB_BUCKETS, LINEAR_COUNT), and use what's left as the
+	// index within its power of two.
+	const auto Shift = HighestBit - (LINEAR_BITS - 1);
+	const auto Sub = u32(Micros >> Shift) - SUB_BUCKETS;
+	return LINEAR_COUNT + (Shift - 1) * SUB_BUCKETS + Sub;
+}
+
+u64 MProfileHistogram::GetBucketMax(u32 Bucket)
+{
+	if (Bucket < LINEAR_COUNT)
+		return Bucket;
+
+	const auto Shift = (Bucket - LINEAR_COUNT) / SUB_BUCKETS + 1;
+	const auto Sub = (Bucket - LINEAR_COUNT) % SUB_BUCKETS + SUB_BUCKETS;
+	return ((u64(Sub) + 1) << Shift) - 1;
+}
+
+void MProfileHistogram::Add(u64 Micros)
+{
+	Buckets[GetBucket(Micros)].Add(1);
+	Count.Add(1);
+	Sum.Add(Micros);
+	Max.SetMax(Micros);
+}
+
+u64 MProfileHistogram::GetPercentile(double Fraction) const
+{
+	const auto Total = GetCount();
+	if (Total == 0)
+		return 0;
+
+	const auto Target = (std::max)(u64(std::ceil(Fraction * Total)), u64(1));
+	const auto MaxValue = GetMax();
+	u64 Seen = 0;
+	for (u32 i = 0; i < BUCKET_COUNT; ++i)
+	{
+		Seen += Buckets[i].Get();
+		if (Seen >= Target)
+			return (std::min)(GetBucketMax(i), MaxValue);
+	}
+	return MaxValue;
+}
+
+MPhaseProfiler::MPhaseProfiler(std::vector<const char*> PhaseNames)
+	: PhaseNames{ std::move(PhaseNames) }, PhaseTimes(this->PhaseNames.size())
+{
+}
+
+void MPhaseProfiler::EndPhase(u64 Now)
+{
+	if (CurrentPhase >= 0)
+		PhaseTimes[CurrentPhase].Add(Now - PhaseStart);
+}
+
+void MPhaseProfiler::BeginPhase(int Phase)
+{
+	const auto Now = MGetProfileTime();
+	if (CurrentPhase < 0)
+		TickStart = Now;
+	EndPhase(Now);
+	CurrentPhase = Phase;
+	PhaseStart = Now;
+}
+
+void MPhaseProfiler::EndTick()
+{
+	if (CurrentPhase < 0)
+		return;
+
+	const auto Now = MGetProfileTime();
+	EndPhase(Now);
+	TickTime.Add(Now - TickStart);
+	CurrentPhase = -1;
+}
+
+void MPrometheusHeader(std::string& Out, const char* Name, const char* Type, const char* Help)
+{
+	char Buffer[512];
+	sprintf_safe(Buffer, "# HELP %s %s\n# TYPE %s %s\n", Name, Help, Name, Type);
+	Out += Buffer;
+}
+
+void MPrometheusValue(std::string& Out, const char* Name, const char* Labels, u64 Value)
+{
+	char Buffer[512];
+	if (Labels[0])
+		sprintf_safe(Buffer, "%s{%s} %llu\n", Name, Labels, static_cast<unsigned long long>(Value));
+	else
+		sprintf_safe(Buffer, "%s %llu\n", Name, static_cast<unsigned long long>(Value));
+	Out += Buffer;
+}
+
+void MPrometheusSummary(std::string& Out, const char* Name, const char* Labels,
+	const MProfileHistogram& Hist)
+{
+	const char* Separator = Labels[0] ? "," : "";
+	char Buffer[512];
+	for (auto Quantile : { 0.5, 0.9, 0.99, 0.999 })
+	{
+		sprintf_safe(Buffer, "%s{%s%squantile=\"%g\"} %.6f\n", Name, Labels, Separator,
+			Quantile, Hist.GetPercentile(Quantile) / 1e6);
+		Out += Buffer;
+	}
+
+	const auto* LabelOpen = Labels[0] ? "{" : "";
+	const auto* LabelClose = Labels[0] ? "}" : "";
+	sprintf_safe(Buffer, "%s_sum%s%s%s %.6f\n%s_count%s%s%s %llu\n",
+		Name, LabelOpen, Labels, LabelClose, Hist.GetSum() / 1e6,
+		Name, LabelOpen, Labels, LabelClose, static_cast<unsigned long long>(Hist.GetCount()));
+	Out += Buffer;
+}
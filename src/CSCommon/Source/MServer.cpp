@@ -116,6 +116,13 @@ void MServer::PostSafeQueue(MCommand* pNew)
 	LockSafeCmdQueue();
 		m_SafeCmdQueue.push_back(pNew);
 	UnlockSafeCmdQueue();
+
+	Wake();
+}
+
+void MServer::WaitForWork(u32 Timeout)
+{
+	WorkSignal.Wait(Timeout, m_CommandManager.GetCommandQueueCount() > 0);
 }
 
 void MServer::SendCommand(MCommand* pCommand)
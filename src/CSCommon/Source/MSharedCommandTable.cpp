@@ -981,6 +981,10 @@ void MAddSharedCommandTable(MCommandManager* CommandManager, MSharedCommandType:
 		C(MC_QUEST_REFRESH_PLAYER_STATUS, "Quest.RefreshPlayerStatus", "Refresh Player Status", MCDT_MACHINE2MACHINE);
 
 		C(MC_QUEST_NPC_ALL_CLEAR, "Quest.NPC.AllClear", "Clear All NPC", MCDT_MACHINE2MACHINE);
+		C(MC_QUEST_NPC_SNAPSHOT, "Quest.NPC.Snapshot", "Server Simulated NPC States", MCDT_MACHINE2MACHINE);
+		P(MPT_BLOB, "NPCs", MCPCBlobArraySize{ sizeof(MTD_NPCSnapshot) });
+		C(MC_QUEST_NPC_RELEASE_CONTROL, "Quest.NPC.ReleaseControl", "Stop Simulating NPCs On Server", MCDT_MACHINE2MACHINE);
+		P(MPT_BLOB, "NPCs", MCPCBlobArraySize{ sizeof(MUID) });
 
 		C(MC_QUEST_ROUND_START, "Quest.Round.Start", "Quest Start Round", MCDT_MACHINE2MACHINE);
 		P(MPT_UCHAR, "round");
@@ -190,7 +190,12 @@ void ZActor::OnUpdate(float fDelta)
 		m_pVMesh->SetVisibility(1.f);
 	}
 
-	if (IsMyControl())
+	if (IsMyControl() && CheckFlag(AF_SERVER_CONTROL))
+	{
+		// The server moves it and decides when it attacks, so only its death is left to us.
+		CheckDead(fDelta);
+	}
+	else if (IsMyControl())
 	{
 		m_TaskManager.Run(fDelta);
 		CheckDead(fDelta);
@@ -617,6 +622,34 @@ void ZActor::InputBasicInfo(ZBasicInfo* pni, BYTE anistate)
 	}
 }
 
+void ZActor::InputServerBasicInfo(ZBasicInfo* pni, BYTE anistate)
+{
+	if (IsDead())
+		return;
+
+	SetFlag(AF_SERVER_CONTROL, true);
+	SetPosition(pni->position);
+	SetVelocity(pni->velocity);
+	SetDirection(pni->direction);
+
+	// Only changes are applied, so that an attack plays once and goes back to idle by itself,
+	// rather than starting over with every snapshot sent while the server holds the NPC in it.
+	if (anistate != m_nServerAniState)
+	{
+		m_nServerAniState = anistate;
+		m_Animation.ForceAniState(anistate);
+	}
+
+	if (g_pGame)
+		m_fLastBasicInfo = g_pGame->GetTime();
+}
+
+void ZActor::ReleaseServerControl()
+{
+	SetFlag(AF_SERVER_CONTROL, false);
+	m_nServerAniState = 0;
+}
+
 bool ZActor::ProcessMotion(float fDelta)
 {
 	if (!HasVMesh()) return false;
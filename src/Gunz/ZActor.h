@@ -33,6 +33,8 @@ enum ZACTOR_FLAG
 	AF_BLAST_DAGGER = 0x20,
 
 	AF_MY_CONTROL = 0x100,
+	// Moved by the server, which sends its state in MC_QUEST_NPC_SNAPSHOT.
+	AF_SERVER_CONTROL = 0x200,
 
 	AF_SOUND_WOUNDED = 0x1000,
 };
@@ -58,6 +60,8 @@ protected:
 	ZBrain* m_pBrain;
 	ZTaskManager			m_TaskManager;
 	float					m_TempBackupTime;
+	// The last animation state the server sent, if it controls this actor.
+	BYTE					m_nServerAniState = 0;
 	float					m_fSpeed;
 	int						m_nDamageCount;
 	bool					m_bReserveStandUp;  // SUMMER-SOURCE: Reserva para levantarse después de estar en el suelo
@@ -112,6 +116,9 @@ public:
 	virtual ~ZActor() override;
 	static ZActor* CreateActor(MQUEST_NPC nNPCType, float fTC, int nQL);
 	void InputBasicInfo(ZBasicInfo* pni, BYTE anistate);
+	void InputServerBasicInfo(ZBasicInfo* pni, BYTE anistate);
+	// Goes back to being moved by its controller, from where the server left it.
+	void ReleaseServerControl();
 	void Input(AI_INPUT_SET nInput);
 	void DebugTest();
 	void SetMyControl(bool bMyControl);
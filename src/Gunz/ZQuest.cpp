@@ -211,6 +211,8 @@ bool ZQuest::OnGameCommand(MCommand* pCommand)
 		HANDLE_COMMAND(MC_QUEST_PEER_NPC_DEAD, OnPeerNPCDead);
 		HANDLE_COMMAND(MC_QUEST_ENTRUST_NPC_CONTROL, OnEntrustNPCControl);
 		HANDLE_COMMAND(MC_QUEST_PEER_NPC_BASICINFO, OnPeerNPCBasicInfo);
+		HANDLE_COMMAND(MC_QUEST_NPC_SNAPSHOT, OnNPCSnapshot);
+		HANDLE_COMMAND(MC_QUEST_NPC_RELEASE_CONTROL, OnNPCReleaseControl);
 		HANDLE_COMMAND(MC_QUEST_PEER_NPC_HPINFO, OnPeerNPCHPInfo);
 		HANDLE_COMMAND(MC_QUEST_PEER_NPC_ATTACK_MELEE, OnPeerNPCAttackMelee);
 		HANDLE_COMMAND(MC_QUEST_PEER_NPC_ATTACK_RANGE, OnPeerNPCAttackRange);
@@ -405,6 +407,50 @@ bool ZQuest::OnPeerNPCBasicInfo(MCommand* pCommand)
 	return true;
 }
 
+bool ZQuest::OnNPCSnapshot(MCommand* pCommand)
+{
+	MCommandParameter* pParam = pCommand->GetParameter(0);
+	if (pParam->GetType() != MPT_BLOB) return false;
+
+	void* pBlob = pParam->GetPointer();
+	int nCount = MGetBlobArrayCount(pBlob);
+	for (int i = 0; i < nCount; i++)
+	{
+		auto* pNode = (MTD_NPCSnapshot*)MGetBlobArrayElement(pBlob, i);
+
+		ZActor* pActor = ZGetObjectManager()->GetNPCObject(pNode->uidNPC);
+		if (!pActor) continue;
+
+		ZBasicInfo bi;
+		bi.position = rvector(pNode->posx, pNode->posy, pNode->posz);
+		bi.velocity = rvector(pNode->velx, pNode->vely, pNode->velz);
+		bi.direction = 1.f / 32000.f * rvector(pNode->dirx, pNode->diry, 0);
+
+		pActor->InputServerBasicInfo(&bi, pNode->anistate);
+	}
+
+	return true;
+}
+
+bool ZQuest::OnNPCReleaseControl(MCommand* pCommand)
+{
+	MCommandParameter* pParam = pCommand->GetParameter(0);
+	if (pParam->GetType() != MPT_BLOB) return false;
+
+	void* pBlob = pParam->GetPointer();
+	int nCount = MGetBlobArrayCount(pBlob);
+	for (int i = 0; i < nCount; i++)
+	{
+		auto* puidNPC = (MUID*)MGetBlobArrayElement(pBlob, i);
+
+		ZActor* pActor = ZGetObjectManager()->GetNPCObject(*puidNPC);
+		if (pActor)
+			pActor->ReleaseServerControl();
+	}
+
+	return true;
+}
+
 bool ZQuest::OnPeerNPCHPInfo(MCommand* pCommand)
 {
 	return true;
@@ -59,6 +59,8 @@ public:
 	bool OnPeerNPCDead(MCommand* pCommand);
 	bool OnEntrustNPCControl(MCommand* pCommand);
 	bool OnPeerNPCBasicInfo(MCommand* pCommand);
+	bool OnNPCSnapshot(MCommand* pCommand);
+	bool OnNPCReleaseControl(MCommand* pCommand);
 	bool OnPeerNPCHPInfo(MCommand* pCommand);
 	bool OnPeerNPCAttackMelee(MCommand* pCommand);
 	bool OnPeerNPCAttackRange(MCommand* pCommand);
@@ -0,0 +1,742 @@
+#include "stdafx.h"
+// MMatchUtil.h pulls in RTypes.h, which has to come before the R_OK macro from asio.hpp.
+#include "MMatchUtil.h"
+#include "LoadClient.h"
+#include "LoadWorker.h"
+#include "MCommandBuilder.h"
+#include "MPacket.h"
+#include "MMatchGlobal.h"
+#include "MMatchItem.h"
+#include "MMatchTransDataType.h"
+#include "MBlobArray.h"
+#include "BasicInfo.h"
+#include "RGVersion.h"
+#include <cmath>
+
+namespace
+{
+// How long the server makes a dead player wait before it accepts a spawn request.
+constexpr u64 RESPAWN_DELAY = 5500000;
+constexpr u64 TIMESYNC_INTERVAL = 1000000;
+// How long the master waits for the rest of the room to join before starting without them.
+constexpr u64 ROOM_FILL_TIMEOUT = 10000000;
+constexpr u64 START_RETRY_INTERVAL = 5000000;
+constexpr float WALK_RADIUS = 300;
+constexpr float WALK_SPEED = 400;
+}
+
+LoadClient::LoadClient(LoadWorker& Worker, LoadRoom& Room, int Index, u64 StartTime)
+	: Worker{ Worker }, Room{ Room }, m_nIndex{ Index },
+	m_strUserID{ Worker.Config.UserPrefix + std::to_string(Index) },
+	m_Socket{ Worker.GetIOService() },
+	m_pCommandBuilder{ std::make_unique<MCommandBuilder>(MUID(0, 0), MUID(0, 0), &Worker.CommandManager) },
+	m_nStartTime{ StartTime }
+{
+	m_pCommandBuilder->SetCheckCommandSN(false);
+
+	// Spread the clients around the circle, so that they don't all stand on the same spot.
+	m_fAngle = float(Index % 16) / 16 * 6.2831853f;
+}
+
+LoadClient::~LoadClient() = default;
+
+void LoadClient::SetState(State New)
+{
+	// Keep the progress counters in step with the states that they count.
+	auto Update = [&](std::atomic<u32>& Counter, bool Old, bool Cur) {
+		if (Old && !Cur)
+			--Counter;
+		else if (!Old && Cur)
+			++Counter;
+	};
+	auto IsConnected = [](State s) { return s >= State::Handshaking && s < State::Closed; };
+	auto IsLoggedIn = [](State s) { return s >= State::ListingChars && s < State::Closed; };
+	auto IsInStage = [](State s) { return s == State::InStage || s == State::InBattle; };
+	auto IsInBattle = [](State s) { return s == State::InBattle; };
+
+	auto& Progress = Worker.Progress;
+	Update(Progress.Connected, IsConnected(m_State), IsConnected(New));
+	Update(Progress.LoggedIn, IsLoggedIn(m_State), IsLoggedIn(New));
+	Update(Progress.InStage, IsInStage(m_State), IsInStage(New));
+	Update(Progress.InBattle, IsInBattle(m_State), IsInBattle(New));
+
+	m_State = New;
+}
+
+void LoadClient::Update(u64 Now)
+{
+	switch (m_State)
+	{
+	case State::Idle:
+		if (Now >= m_nStartTime)
+			Connect();
+		return;
+	case State::Connecting:
+	case State::Handshaking:
+	case State::Closed:
+		return;
+	default:
+		break;
+	}
+
+	if (m_State >= State::ListingChars && Now >= m_nNextTimeSync)
+	{
+		auto* pCmd = NewCommand(MC_MATCH_GAME_REQUEST_TIMESYNC);
+		pCmd->AddParameter(new MCmdParamUInt(u32(Now / 1000)));
+		Send(pCmd, MC_MATCH_GAME_RESPONSE_TIMESYNC);
+		m_nNextTimeSync = Now + TIMESYNC_INTERVAL;
+	}
+
+	if (m_State == State::WaitingForStage && Room.uidStage.IsValid())
+	{
+		auto* pCmd = NewCommand(MC_MATCH_REQUEST_STAGE_JOIN);
+		pCmd->AddParameter(new MCmdParamUID(m_uidPlayer));
+		pCmd->AddParameter(new MCmdParamUID(Room.uidStage));
+		Send(pCmd, MC_MATCH_STAGE_JOIN);
+		SetState(State::JoiningStage);
+	}
+	else if (m_State == State::InStage && IsMaster())
+	{
+		UpdateMaster(Now);
+	}
+	else if (m_State == State::InBattle)
+	{
+		if (!m_bAlive && Now >= m_nRespawnTime)
+		{
+			SendSpawn();
+			m_nRespawnTime = Now + RESPAWN_DELAY;
+		}
+
+		if (Worker.Config.BasicInfoRate > 0 && Now >= m_nNextBasicInfo)
+		{
+			SendBasicInfo(Now);
+			m_nNextBasicInfo = (std::max)(m_nNextBasicInfo + 1000000 / Worker.Config.BasicInfoRate, Now);
+		}
+
+		if (Worker.Config.ShotRate > 0 && Now >= m_nNextShot)
+		{
+			SendShot(Now);
+			m_nNextShot = (std::max)(m_nNextShot + 1000000 / Worker.Config.ShotRate, Now);
+		}
+	}
+
+	Flush();
+}
+
+void LoadClient::UpdateMaster(u64 Now)
+{
+	if (Now < m_nNextStartTry)
+		return;
+
+	// Everyone who's in the stage has to be ready, or the server won't start the game. Members
+	// that are still on their way in don't count against that, but they're waited for for a while
+	// so that the games aren't all one player short.
+	bool bAllJoined = true;
+	for (auto* pMember : Room.Members)
+	{
+		if (pMember == this || pMember->IsClosed())
+			continue;
+		if (pMember->IsInStage() && !pMember->IsReadyInStage())
+			return;
+		if (!pMember->IsInStage())
+			bAllJoined = false;
+	}
+	if (!bAllJoined && Now < m_nStageTime + ROOM_FILL_TIMEOUT)
+		return;
+
+	auto* pCmd = NewCommand(MC_MATCH_STAGE_START);
+	pCmd->AddParameter(new MCmdParamUID(m_uidPlayer));
+	pCmd->AddParameter(new MCmdParamUID(Room.uidStage));
+	pCmd->AddParameter(new MCmdParamInt(0));
+	Send(pCmd, MC_MATCH_STAGE_LAUNCH);
+	m_nNextStartTry = Now + START_RETRY_INTERVAL;
+}
+
+void LoadClient::Stop()
+{
+	m_bStopping = true;
+	Close();
+}
+
+void LoadClient::Connect()
+{
+	SetState(State::Connecting);
+	m_Socket.async_connect(Worker.Endpoint, [this](const asio::error_code& ec) {
+		if (ec)
+		{
+			OnError(ec);
+			return;
+		}
+
+		asio::error_code ignored;
+		m_Socket.set_option(asio::ip::tcp::no_delay(true), ignored);
+		SetState(State::Handshaking);
+		Read();
+	});
+}
+
+void LoadClient::Read()
+{
+	m_Socket.async_read_some(asio::buffer(m_ReadBuffer), [this](const asio::error_code& ec, size_t Size) {
+		if (ec)
+		{
+			OnError(ec);
+			return;
+		}
+
+		OnRecv(Size);
+		if (m_State != State::Closed)
+			Read();
+	});
+}
+
+void LoadClient::Flush()
+{
+	if (m_bWriting || m_SendBuffer.empty() || m_State == State::Closed)
+		return;
+
+	m_bWriting = true;
+	m_WriteBuffer.swap(m_SendBuffer);
+	m_SendBuffer.clear();
+	asio::async_write(m_Socket, asio::buffer(m_WriteBuffer), [this](const asio::error_code& ec, size_t) {
+		m_bWriting = false;
+		m_WriteBuffer.clear();
+		if (ec)
+		{
+			OnError(ec);
+			return;
+		}
+		Flush();
+	});
+}
+
+void LoadClient::OnError(const asio::error_code& ec)
+{
+	if (m_bStopping || ec == asio::error::operation_aborted || m_State == State::Closed)
+		return;
+
+	if (m_State == State::Connecting)
+		++Worker.Stats.ConnectFailures;
+	else
+		++Worker.Stats.Disconnects;
+	Close();
+}
+
+void LoadClient::Close()
+{
+	if (m_State == State::Closed)
+		return;
+
+	asio::error_code ignored;
+	m_Socket.close(ignored);
+	m_Pending.clear();
+	SetState(State::Closed);
+}
+
+void LoadClient::OnRecv(size_t Size)
+{
+	Worker.Stats.RecvBytes += Size;
+
+	if (!m_pCommandBuilder->Read(m_ReadBuffer.data(), int(Size)))
+	{
+		++Worker.Stats.ProtocolErrors;
+		Close();
+		return;
+	}
+
+	const auto Now = GetLoadTime();
+	while (auto* pCmd = m_pCommandBuilder->GetCommand())
+	{
+		++Worker.Stats.RecvCommands;
+		if (m_State != State::Closed)
+			OnCommand(pCmd, Now);
+		delete pCmd;
+	}
+
+	while (auto* pNetCmd = m_pCommandBuilder->GetNetCommand())
+	{
+		if (pNetCmd->nMsg == MSGID_REPLYCONNECT && m_State == State::Handshaking)
+			OnReplyConnect(*static_cast<MReplyConnectMsg*>(pNetCmd));
+		free(pNetCmd);
+	}
+
+	Flush();
+}
+
+void LoadClient::OnReplyConnect(const MReplyConnectMsg& Msg)
+{
+	m_uidServer = MUID(Msg.nHostHigh, Msg.nHostLow);
+	m_uidMe = MUID(Msg.nAllocHigh, Msg.nAllocLow);
+
+	MPacketCrypterKey Key;
+	MMakeSeedKey(&Key, m_uidServer, m_uidMe, Msg.nTimeStamp);
+	m_Crypter.InitKey(&Key);
+	m_pCommandBuilder->SetUID(m_uidMe, m_uidServer);
+	m_pCommandBuilder->InitCrypt(&m_Crypter, false);
+
+	auto* pCmd = NewCommand(MC_MATCH_LOGIN);
+	pCmd->AddParameter(new MCmdParamStr(m_strUserID.c_str()));
+	pCmd->AddParameter(new MCmdParamStr(Worker.Config.Password.c_str()));
+	pCmd->AddParameter(new MCmdParamInt(MCOMMAND_VERSION));
+	pCmd->AddParameter(new MCmdParamUInt(0));
+	pCmd->AddParameter(new MCmdParamUInt(RGUNZ_VERSION_MAJOR));
+	pCmd->AddParameter(new MCmdParamUInt(RGUNZ_VERSION_MINOR));
+	pCmd->AddParameter(new MCmdParamUInt(RGUNZ_VERSION_PATCH));
+	pCmd->AddParameter(new MCmdParamUInt(RGUNZ_VERSION_REVISION));
+	Send(pCmd, MC_MATCH_RESPONSE_LOGIN);
+	SetState(State::LoggingIn);
+}
+
+static void* GetBlob(MCommand* pCmd, int i)
+{
+	auto* pParam = pCmd->GetParameter(i);
+	if (!pParam || pParam->GetType() != MPT_BLOB)
+		return nullptr;
+	return pParam->GetPointer();
+}
+
+void LoadClient::OnCommand(MCommand* pCmd, u64 Now)
+{
+	auto RequestCharList = [&] {
+		auto* pEmptyMsg = MMakeBlobArray(sizeof(unsigned char), 20);
+		auto* pReq = NewCommand(MC_MATCH_REQUEST_ACCOUNT_CHARLIST);
+		pReq->AddParameter(new MCmdParamStr(""));
+		pReq->AddParameter(new MCmdParamBlob(pEmptyMsg, MGetBlobArraySize(pEmptyMsg)));
+		MEraseBlobArray(pEmptyMsg);
+		Send(pReq, MC_MATCH_RESPONSE_ACCOUNT_CHARLIST);
+		SetState(State::ListingChars);
+	};
+	auto CheckResult = [&](int nResponseID) {
+		int nResult = MERR_UNKNOWN;
+		pCmd->GetParameter(&nResult, 0, MPT_INT);
+		if (nResult == MOK)
+		{
+			Complete(nResponseID, Now);
+			return true;
+		}
+		Fail(nResponseID);
+		++Worker.Stats.RequestFailures;
+		Close();
+		return false;
+	};
+
+	switch (pCmd->GetID())
+	{
+	case MC_MATCH_RESPONSE_LOGIN:
+	{
+		int nResult = MERR_UNKNOWN;
+		pCmd->GetParameter(&nResult, 0, MPT_INT);
+		if (nResult != MOK)
+		{
+			Fail(MC_MATCH_RESPONSE_LOGIN);
+			++Worker.Stats.LoginFailures;
+			Close();
+			break;
+		}
+		Complete(MC_MATCH_RESPONSE_LOGIN, Now);
+		pCmd->GetParameter(&m_uidPlayer, 6, MPT_UID);
+		m_nNextTimeSync = Now;
+		RequestCharList();
+	}
+	break;
+	case MC_MATCH_RESPONSE_LOGIN_FAILED:
+		Fail(MC_MATCH_RESPONSE_LOGIN);
+		++Worker.Stats.LoginFailures;
+		Close();
+		break;
+	case MC_MATCH_RESPONSE_ACCOUNT_CHARLIST:
+	{
+		Complete(MC_MATCH_RESPONSE_ACCOUNT_CHARLIST, Now);
+		auto* pBlob = GetBlob(pCmd, 0);
+		if (!pBlob)
+			break;
+
+		if (MGetBlobArrayCount(pBlob) > 0)
+		{
+			auto& Info = *static_cast<const MTD_AccountCharInfo*>(MGetBlobArrayElement(pBlob, 0));
+			auto* pReq = NewCommand(MC_MATCH_REQUEST_SELECT_CHAR);
+			pReq->AddParameter(new MCmdParamUID(m_uidPlayer));
+			pReq->AddParameter(new MCmdParamUInt(u32(Info.nCharNum)));
+			Send(pReq, MC_MATCH_RESPONSE_SELECT_CHAR);
+			SetState(State::SelectingChar);
+		}
+		else if (m_State == State::ListingChars)
+		{
+			auto* pReq = NewCommand(MC_MATCH_REQUEST_CREATE_CHAR);
+			pReq->AddParameter(new MCmdParamUID(m_uidPlayer));
+			pReq->AddParameter(new MCmdParamUInt(0));
+			pReq->AddParameter(new MCmdParamStr(m_strUserID.c_str()));
+			pReq->AddParameter(new MCmdParamUInt(u32(m_nIndex % 2)));
+			pReq->AddParameter(new MCmdParamUInt(0));
+			pReq->AddParameter(new MCmdParamUInt(0));
+			pReq->AddParameter(new MCmdParamUInt(0));
+			Send(pReq, MC_MATCH_RESPONSE_CREATE_CHAR);
+			SetState(State::CreatingChar);
+		}
+		else
+		{
+			// The character was created, but still isn't listed.
+			++Worker.Stats.RequestFailures;
+			Close();
+		}
+	}
+	break;
+	case MC_MATCH_RESPONSE_CREATE_CHAR:
+		if (CheckResult(MC_MATCH_RESPONSE_CREATE_CHAR))
+		{
+			RequestCharList();
+			// Don't try to create it again if the list comes back empty.
+			SetState(State::CreatingChar);
+		}
+		break;
+	case MC_MATCH_RESPONSE_SELECT_CHAR:
+		if (CheckResult(MC_MATCH_RESPONSE_SELECT_CHAR))
+		{
+			Send(NewCommand(MC_MATCH_REQUEST_RECOMMANDED_CHANNEL), MC_MATCH_RESPONSE_RECOMMANDED_CHANNEL);
+			SetState(State::FindingChannel);
+		}
+		break;
+	case MC_MATCH_RESPONSE_RECOMMANDED_CHANNEL:
+	{
+		Complete(MC_MATCH_RESPONSE_RECOMMANDED_CHANNEL, Now);
+		MUID uidChannel;
+		pCmd->GetParameter(&uidChannel, 0, MPT_UID);
+		auto* pReq = NewCommand(MC_MATCH_CHANNEL_REQUEST_JOIN);
+		pReq->AddParameter(new MCmdParamUID(m_uidPlayer));
+		pReq->AddParameter(new MCmdParamUID(uidChannel));
+		Send(pReq, MC_MATCH_CHANNEL_RESPONSE_JOIN);
+		SetState(State::JoiningChannel);
+	}
+	break;
+	case MC_MATCH_CHANNEL_RESPONSE_JOIN:
+		if (m_State != State::JoiningChannel)
+			break;
+		Complete(MC_MATCH_CHANNEL_RESPONSE_JOIN, Now);
+		if (IsMaster())
+		{
+			char szName[64];
+			sprintf_safe(szName, "load-%d", Room.Index);
+			auto* pReq = NewCommand(MC_MATCH_STAGE_CREATE);
+			pReq->AddParameter(new MCmdParamUID(m_uidPlayer));
+			pReq->AddParameter(new MCmdParamStr(szName));
+			pReq->AddParameter(new MCmdParamBool(false));
+			pReq->AddParameter(new MCmdParamStr(""));
+			Send(pReq, MC_MATCH_STAGE_JOIN);
+			SetState(State::JoiningStage);
+		}
+		else
+		{
+			// Update sends the join as soon as the master has created the stage.
+			SetState(State::WaitingForStage);
+		}
+		break;
+	case MC_MATCH_RESPONSE_STAGE_CREATE:
+	case MC_MATCH_RESPONSE_STAGE_JOIN:
+		// A create or join that fails gets one of these instead of MC_MATCH_STAGE_JOIN.
+		CheckResult(MC_MATCH_STAGE_JOIN);
+		break;
+	case MC_MATCH_STAGE_JOIN:
+	{
+		MUID uidPlayer, uidStage;
+		pCmd->GetParameter(&uidPlayer, 0, MPT_UID);
+		pCmd->GetParameter(&uidStage, 1, MPT_UID);
+		if (uidPlayer != m_uidPlayer || m_State != State::JoiningStage)
+			break;
+
+		Complete(MC_MATCH_STAGE_JOIN, Now);
+		SetState(State::InStage);
+		m_nStageTime = Now;
+		if (IsMaster())
+		{
+			Room.uidStage = uidStage;
+			auto* pReq = NewCommand(MC_MATCH_REQUEST_STAGESETTING);
+			pReq->AddParameter(new MCmdParamUID(uidStage));
+			Send(pReq, MC_MATCH_RESPONSE_STAGESETTING);
+		}
+		else
+		{
+			SendReady();
+		}
+	}
+	break;
+	case MC_MATCH_RESPONSE_STAGESETTING:
+	{
+		Complete(MC_MATCH_RESPONSE_STAGESETTING, Now);
+		auto* pBlob = GetBlob(pCmd, 1);
+		if (IsMaster() && !m_bStageConfigured && pBlob && MGetBlobArrayCount(pBlob) == 1)
+		{
+			ConfigureStage(*static_cast<const MSTAGE_SETTING_NODE*>(MGetBlobArrayElement(pBlob, 0)));
+			m_bStageConfigured = true;
+		}
+	}
+	break;
+	case MC_MATCH_STAGE_PLAYER_STATE:
+	{
+		MUID uidPlayer;
+		int nState = MOSS_NONREADY;
+		pCmd->GetParameter(&uidPlayer, 0, MPT_UID);
+		pCmd->GetParameter(&nState, 2, MPT_INT);
+		if (uidPlayer != m_uidPlayer)
+			break;
+		Complete(MC_MATCH_STAGE_PLAYER_STATE, Now);
+		m_bReady = nState == MOSS_READY;
+	}
+	break;
+	case MC_MATCH_STAGE_LAUNCH:
+	{
+		if (m_State != State::InStage)
+			break;
+		if (Complete(MC_MATCH_STAGE_LAUNCH, Now))
+			++Worker.Stats.GamesStarted;
+
+		auto* pLoaded = NewCommand(MC_MATCH_LOADING_COMPLETE);
+		pLoaded->AddParameter(new MCmdParamUID(m_uidPlayer));
+		pLoaded->AddParameter(new MCmdParamInt(100));
+		Send(pLoaded);
+
+		auto* pEnter = NewCommand(MC_MATCH_STAGE_REQUEST_ENTERBATTLE);
+		pEnter->AddParameter(new MCmdParamUID(m_uidPlayer));
+		pEnter->AddParameter(new MCmdParamUID(Room.uidStage));
+		Send(pEnter, MC_MATCH_STAGE_ENTERBATTLE);
+	}
+	break;
+	case MC_MATCH_STAGE_ENTERBATTLE:
+	{
+		auto* pBlob = GetBlob(pCmd, 1);
+		if (!pBlob || MGetBlobArrayCount(pBlob) < 1)
+			break;
+		auto& Node = *static_cast<const MTD_PeerListNode*>(MGetBlobArrayElement(pBlob, 0));
+		if (Node.uidChar != m_uidPlayer || m_State != State::InStage)
+			break;
+
+		Complete(MC_MATCH_STAGE_ENTERBATTLE, Now);
+		SetState(State::InBattle);
+		m_bAlive = true;
+		m_nNextBasicInfo = Now;
+		m_nNextShot = Now + 1000000 / (std::max)(Worker.Config.ShotRate, 1);
+	}
+	break;
+	case MC_MATCH_GAME_DEAD:
+	{
+		MUID uidVictim;
+		pCmd->GetParameter(&uidVictim, 2, MPT_UID);
+		if (uidVictim != m_uidPlayer)
+			break;
+		m_bAlive = false;
+		m_nRespawnTime = Now + RESPAWN_DELAY;
+	}
+	break;
+	case MC_MATCH_GAME_RESPONSE_SPAWN:
+	{
+		MUID uidChar;
+		pCmd->GetParameter(&uidChar, 0, MPT_UID);
+		if (uidChar != m_uidPlayer)
+			break;
+		Complete(MC_MATCH_GAME_RESPONSE_SPAWN, Now);
+		m_bAlive = true;
+	}
+	break;
+	case MC_MATCH_STAGE_FINISH_GAME:
+		if (m_State != State::InBattle)
+			break;
+		// Back to the stage, and get ready for the next one.
+		SetState(State::InStage);
+		m_bReady = false;
+		m_nStageTime = Now;
+		if (IsMaster())
+			m_nNextStartTry = Now + START_RETRY_INTERVAL;
+		else
+			SendReady();
+		break;
+	case MC_MATCH_GAME_RESPONSE_TIMESYNC:
+		Complete(MC_MATCH_GAME_RESPONSE_TIMESYNC, Now);
+		break;
+	case MC_MATCH_P2P_COMMAND:
+		OnRelayedCommand(pCmd, Now);
+		break;
+	}
+}
+
+void LoadClient::OnRelayedCommand(MCommand* pCmd, u64 Now)
+{
+	auto* pParam = pCmd->GetParameter(1);
+	if (!pParam || pParam->GetType() != MPT_BLOB)
+		return;
+	auto& Blob = *static_cast<MCmdParamBlob*>(pParam);
+
+	MCommand Inner;
+	if (!Inner.SetData(static_cast<const char*>(Blob.GetPointer()), &Worker.CommandManager,
+		u16(Blob.GetPayloadSize())))
+	{
+		++Worker.Stats.ProtocolErrors;
+		return;
+	}
+
+	if (Inner.GetID() != MC_PEER_BASICINFO)
+		return;
+
+	auto* pInfoParam = Inner.GetParameter(0);
+	if (!pInfoParam || pInfoParam->GetType() != MPT_BLOB)
+		return;
+	auto& Info = *static_cast<const ZPACKEDBASICINFO*>(pInfoParam->GetPointer());
+
+	// The sender stamped it with its own GetLoadTime, which is the same clock as ours.
+	const auto SentTime = u64(double(Info.fTime) * 1000000);
+	if (SentTime <= Now)
+		Worker.Stats.Relay.Add(Now - SentTime);
+}
+
+MCommand* LoadClient::NewCommand(int nID)
+{
+	return new MCommand(nID, m_uidMe, m_uidServer, &Worker.CommandManager);
+}
+
+void LoadClient::Send(MCommand* pCmd, int nResponseID)
+{
+	pCmd->m_nSerialNumber = ++m_nSerial;
+
+	const auto nCmdSize = pCmd->GetSize();
+	const auto nPacketSize = int(sizeof(MPacketHeader)) + nCmdSize;
+	const auto nOffset = m_SendBuffer.size();
+	m_SendBuffer.resize(nOffset + nPacketSize);
+
+	// Same encoding as MClient::MakeCmdPacket.
+	auto* pMsg = reinterpret_cast<MCommandMsg*>(&m_SendBuffer[nOffset]);
+	pMsg->nCheckSum = 0;
+	pMsg->nSize = u16(nPacketSize);
+	pCmd->GetData(pMsg->Buffer, nCmdSize);
+	if (pCmd->m_pCommandDesc->IsFlag(MCCT_NON_ENCRYPTED))
+	{
+		pMsg->nMsg = MSGID_RAWCOMMAND;
+	}
+	else
+	{
+		pMsg->nMsg = MSGID_COMMAND;
+		m_Crypter.Encrypt(reinterpret_cast<char*>(&pMsg->nSize), sizeof(pMsg->nSize));
+		m_Crypter.Encrypt(pMsg->Buffer, nCmdSize);
+	}
+	pMsg->nCheckSum = MBuildCheckSum(pMsg, nPacketSize);
+
+	++Worker.Stats.SentCommands;
+	Worker.Stats.SentBytes += nPacketSize;
+	if (nResponseID)
+		m_Pending.push_back({ pCmd->GetID(), nResponseID, GetLoadTime() });
+
+	delete pCmd;
+}
+
+void LoadClient::SendTunnelled(MCommand* pPeerCmd)
+{
+	auto* pCmd = NewCommand(MC_MATCH_P2P_COMMAND);
+	pCmd->AddParameter(new MCmdParamUID(MUID(0, 0)));
+	MakeSaneTunnelingCommandBlob(pCmd, pPeerCmd);
+	delete pPeerCmd;
+	Send(pCmd);
+}
+
+bool LoadClient::Complete(int nResponseID, u64 Now)
+{
+	auto it = std::find_if(m_Pending.begin(), m_Pending.end(),
+		[&](const PendingRequest& r) { return r.ResponseID == nResponseID; });
+	if (it == m_Pending.end())
+		return false;
+
+	const auto Latency = Now > it->SentTime ? Now - it->SentTime : 0;
+	if (it->RequestID == MC_MATCH_GAME_REQUEST_TIMESYNC)
+		Worker.Stats.ServerLoop.Add(Latency);
+	else
+		Worker.Stats.Commands[it->RequestID].Add(Latency);
+	m_Pending.erase(it);
+	return true;
+}
+
+void LoadClient::Fail(int nResponseID)
+{
+	auto it = std::find_if(m_Pending.begin(), m_Pending.end(),
+		[&](const PendingRequest& r) { return r.ResponseID == nResponseID; });
+	if (it != m_Pending.end())
+		m_Pending.erase(it);
+}
+
+void LoadClient::SendReady()
+{
+	auto* pCmd = NewCommand(MC_MATCH_STAGE_PLAYER_STATE);
+	pCmd->AddParameter(new MCmdParamUID(m_uidPlayer));
+	pCmd->AddParameter(new MCmdParamUID(Room.uidStage));
+	pCmd->AddParameter(new MCmdParamInt(MOSS_READY));
+	Send(pCmd, MC_MATCH_STAGE_PLAYER_STATE);
+}
+
+void LoadClient::ConfigureStage(const MSTAGE_SETTING_NODE& Setting)
+{
+	auto* pBlob = MMakeBlobArray(sizeof(MSTAGE_SETTING_NODE), 1);
+	auto& Node = *static_cast<MSTAGE_SETTING_NODE*>(MGetBlobArrayElement(pBlob, 0));
+	Node = Setting;
+	Node.Netcode = Worker.Config.Netcode;
+	Node.nMaxPlayers = (std::max)(Node.nMaxPlayers, int(Room.Members.size()));
+	if (Worker.Config.GameMinutes > 0)
+		Node.nLimitTime = Worker.Config.GameMinutes;
+
+	auto* pCmd = NewCommand(MC_MATCH_STAGESETTING);
+	pCmd->AddParameter(new MCmdParamUID(m_uidPlayer));
+	pCmd->AddParameter(new MCmdParamUID(Room.uidStage));
+	pCmd->AddParameter(new MCmdParamBlob(pBlob, MGetBlobArraySize(pBlob)));
+	MEraseBlobArray(pBlob);
+	Send(pCmd);
+}
+
+void LoadClient::SendBasicInfo(u64 Now)
+{
+	const auto& Origin = Worker.Config.Origin;
+	const auto Step = WALK_SPEED / WALK_RADIUS / (std::max)(Worker.Config.BasicInfoRate, 1);
+	m_fAngle = std::fmod(m_fAngle + Step, 6.2831853f);
+	const auto c = std::cos(m_fAngle), s = std::sin(m_fAngle);
+
+	ZPACKEDBASICINFO pbi{};
+	pbi.fTime = float(double(Now) / 1000000);
+	pbi.posx = short(Origin[0] + c * WALK_RADIUS);
+	pbi.posy = short(Origin[1] + s * WALK_RADIUS);
+	pbi.posz = short(Origin[2]);
+	pbi.velx = short(-s * WALK_SPEED);
+	pbi.vely = short(c * WALK_SPEED);
+	pbi.velz = 0;
+	pbi.dirx = short(-s * 32000);
+	pbi.diry = short(c * 32000);
+	pbi.dirz = 0;
+	pbi.selweapon = MMCIP_PRIMARY;
+
+	auto* pPeerCmd = NewCommand(MC_PEER_BASICINFO);
+	pPeerCmd->AddParameter(new MCmdParamBlob(&pbi, sizeof(pbi)));
+	SendTunnelled(pPeerCmd);
+}
+
+void LoadClient::SendShot(u64 Now)
+{
+	const auto& Origin = Worker.Config.Origin;
+	const auto c = std::cos(m_fAngle), s = std::sin(m_fAngle);
+
+	// Shoot across the circle, towards the other clients.
+	ZPACKEDSHOTINFO psi{};
+	psi.fTime = float(double(Now) / 1000000);
+	psi.posx = short(Origin[0] + c * WALK_RADIUS);
+	psi.posy = short(Origin[1] + s * WALK_RADIUS);
+	psi.posz = short(Origin[2] + 150);
+	psi.tox = short(Origin[0] - c * WALK_RADIUS);
+	psi.toy = short(Origin[1] - s * WALK_RADIUS);
+	psi.toz = short(Origin[2] + 150);
+	psi.sel_type = MMCIP_PRIMARY;
+
+	auto* pPeerCmd = NewCommand(MC_PEER_SHOT);
+	pPeerCmd->AddParameter(new MCmdParamBlob(&psi, sizeof(psi)));
+	SendTunnelled(pPeerCmd);
+}
+
+void LoadClient::SendSpawn()
+{
+	const auto& Origin = Worker.Config.Origin;
+	auto* pCmd = NewCommand(MC_MATCH_GAME_REQUEST_SPAWN);
+	pCmd->AddParameter(new MCmdParamUID(m_uidPlayer));
+	pCmd->AddParameter(new MCmdParamPos(Origin[0], Origin[1], Origin[2]));
+	pCmd->AddParameter(new MCmdParamDir(1, 0, 0));
+	Send(pCmd, MC_MATCH_GAME_RESPONSE_SPAWN);
+}
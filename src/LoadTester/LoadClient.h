@@ -0,0 +1,164 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include "MUID.h"
+#include "MPacketCrypter.h"
+#include "MMatchStageSetting.h"
+#include <string>
+#include <vector>
+#include <array>
+#include <memory>
+
+#define ASIO_STANDALONE
+#include "asio.hpp"
+
+class MCommand;
+class MCommandBuilder;
+class LoadWorker;
+class LoadClient;
+
+struct LoadConfig
+{
+	std::string Address = "127.0.0.1";
+	u16 Port = 6000;
+	int ClientCount = 100;
+	// 0 means one per hardware thread.
+	int ThreadCount = 0;
+	// How many clients start connecting per second.
+	int RampPerSecond = 200;
+	// Clients log in as <UserPrefix><index>, all with the same password. The accounts have to exist
+	// already; each one gets a character named after it if it doesn't have one.
+	std::string UserPrefix = "loadtest";
+	std::string Password = "loadtest";
+	// Clients per stage, including the one that creates it.
+	int RoomSize = 8;
+	NetcodeType Netcode = NetcodeType::ServerBased;
+	// Game length in minutes, or 0 to keep the stage's default.
+	int GameMinutes = 0;
+	int DurationSeconds = 60;
+	int ReportInterval = 5;
+	// Tunnelled commands each client sends per second while in a battle.
+	int BasicInfoRate = 20;
+	int ShotRate = 2;
+	// Clients walk in circles around this point.
+	float Origin[3] = { 0, 0, 0 };
+};
+
+// Clients that play in the same stage. The first member creates the stage and starts the games;
+// the others join once it exists. All members of a room run on the same worker.
+struct LoadRoom
+{
+	int Index = 0;
+	MUID uidStage;
+	std::vector<LoadClient*> Members;
+};
+
+// One simulated player. It logs in, picks a character, joins a channel and a stage, and plays
+// the games its room starts, sending movement and shots at the configured rates and timing
+// every request it makes. Only ever touched by its worker's thread.
+class LoadClient
+{
+public:
+	LoadClient(LoadWorker& Worker, LoadRoom& Room, int Index, u64 StartTime);
+	~LoadClient();
+
+	// Called every worker tick.
+	void Update(u64 Now);
+	void Stop();
+
+	bool IsMaster() const { return Room.Members.front() == this; }
+	bool IsReadyInStage() const { return m_State == State::InStage && m_bReady; }
+	bool IsInStage() const { return m_State == State::InStage; }
+	bool IsClosed() const { return m_State == State::Closed; }
+
+private:
+	enum class State
+	{
+		Idle,
+		Connecting,
+		Handshaking,
+		LoggingIn,
+		ListingChars,
+		CreatingChar,
+		SelectingChar,
+		FindingChannel,
+		JoiningChannel,
+		WaitingForStage,
+		JoiningStage,
+		InStage,
+		InBattle,
+		Closed,
+	};
+
+	struct PendingRequest
+	{
+		int RequestID;
+		int ResponseID;
+		u64 SentTime;
+	};
+
+	void SetState(State New);
+	void Connect();
+	void Read();
+	void Flush();
+	void OnRecv(size_t Size);
+	void OnError(const asio::error_code& ec);
+	void Close();
+
+	void OnReplyConnect(const struct MReplyConnectMsg& Msg);
+	void OnCommand(MCommand* pCmd, u64 Now);
+	void OnRelayedCommand(MCommand* pCmd, u64 Now);
+
+	MCommand* NewCommand(int nID);
+	// Sends and deletes pCmd. If nResponseID is set, the time until a command with that ID comes
+	// back is recorded under pCmd's ID.
+	void Send(MCommand* pCmd, int nResponseID = 0);
+	// Wraps pPeerCmd in an MC_MATCH_P2P_COMMAND to every other player in the battle and deletes it.
+	void SendTunnelled(MCommand* pPeerCmd);
+	// Records the latency of the oldest request waiting for nResponseID. Returns false if there
+	// wasn't one.
+	bool Complete(int nResponseID, u64 Now);
+	// Drops the oldest request waiting for nResponseID without recording it.
+	void Fail(int nResponseID);
+
+	void SendReady();
+	void SendBasicInfo(u64 Now);
+	void SendShot(u64 Now);
+	void SendSpawn();
+	void UpdateMaster(u64 Now);
+	void ConfigureStage(const MSTAGE_SETTING_NODE& Setting);
+
+	LoadWorker& Worker;
+	LoadRoom& Room;
+	const int m_nIndex;
+	std::string m_strUserID;
+
+	State m_State = State::Idle;
+	asio::ip::tcp::socket m_Socket;
+	std::array<char, 4096> m_ReadBuffer;
+	// Commands are appended to m_SendBuffer while m_WriteBuffer is being written.
+	std::vector<char> m_SendBuffer;
+	std::vector<char> m_WriteBuffer;
+	bool m_bWriting = false;
+	bool m_bStopping = false;
+
+	std::unique_ptr<MCommandBuilder> m_pCommandBuilder;
+	MPacketCrypter m_Crypter;
+	MUID m_uidServer;
+	MUID m_uidMe;
+	MUID m_uidPlayer;
+	u8 m_nSerial = 0;
+	std::vector<PendingRequest> m_Pending;
+
+	u64 m_nStartTime;
+	u64 m_nNextTimeSync = 0;
+	u64 m_nStageTime = 0;
+	u64 m_nNextStartTry = 0;
+	bool m_bReady = false;
+	bool m_bStageConfigured = false;
+	bool m_bAlive = true;
+	u64 m_nRespawnTime = 0;
+	u64 m_nNextBasicInfo = 0;
+	u64 m_nNextShot = 0;
+	float m_fAngle = 0;
+};
@@ -0,0 +1,87 @@
+#include "stdafx.h"
+#include "LoadStats.h"
+#include <algorithm>
+#include <cmath>
+
+static int HighestBit(u64 x)
+{
+	int Bit = 0;
+	while (x >>= 1)
+		++Bit;
+	return Bit;
+}
+
+u32 LatencyHistogram::GetBucket(u64 Micros)
+{
+	if (Micros < LINEAR_COUNT)
+		return u32(Micros);
+
+	// Shift the value down until it's in [SUB_BUCKETS, LINEAR_COUNT), and use what's left as the
+	// index within its power of two.
+	const auto Shift = HighestBit(Micros) - (LINEAR_BITS - 1);
+	const auto Sub = u32(Micros >> Shift) - SUB_BUCKETS;
+	return LINEAR_COUNT + (Shift - 1) * SUB_BUCKETS + Sub;
+}
+
+u64 LatencyHistogram::GetBucketMax(u32 Bucket)
+{
+	if (Bucket < LINEAR_COUNT)
+		return Bucket;
+
+	const auto Shift = (Bucket - LINEAR_COUNT) / SUB_BUCKETS + 1;
+	const auto Sub = (Bucket - LINEAR_COUNT) % SUB_BUCKETS + SUB_BUCKETS;
+	return ((u64(Sub) + 1) << Shift) - 1;
+}
+
+void LatencyHistogram::Add(u64 Micros)
+{
+	++Buckets[GetBucket(Micros)];
+	++Count;
+	Sum += Micros;
+	Max = (std::max)(Max, Micros);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& Other)
+{
+	for (size_t i = 0; i < Buckets.size(); ++i)
+		Buckets[i] += Other.Buckets[i];
+	Count += Other.Count;
+	Sum += Other.Sum;
+	Max = (std::max)(Max, Other.Max);
+}
+
+u64 LatencyHistogram::GetPercentile(double Fraction) const
+{
+	if (Count == 0)
+		return 0;
+
+	const auto Target = (std::max)(u64(std::ceil(Fraction * Count)), u64(1));
+	u64 Seen = 0;
+	for (u32 i = 0; i < Buckets.size(); ++i)
+	{
+		Seen += Buckets[i];
+		if (Seen >= Target)
+			return (std::min)(GetBucketMax(i), Max);
+	}
+	return Max;
+}
+
+void LoadStats::Merge(const LoadStats& Other)
+{
+	for (auto& Pair : Other.Commands)
+		Commands[Pair.first].Merge(Pair.second);
+	ServerLoop.Merge(Other.ServerLoop);
+	Relay.Merge(Other.Relay);
+
+	SentCommands += Other.SentCommands;
+	RecvCommands += Other.RecvCommands;
+	SentBytes += Other.SentBytes;
+	RecvBytes += Other.RecvBytes;
+
+	ConnectFailures += Other.ConnectFailures;
+	LoginFailures += Other.LoginFailures;
+	RequestFailures += Other.RequestFailures;
+	Disconnects += Other.Disconnects;
+	ProtocolErrors += Other.ProtocolErrors;
+	GamesStarted += Other.GamesStarted;
+}
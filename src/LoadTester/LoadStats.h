@@ -0,0 +1,81 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include <array>
+#include <map>
+#include <atomic>
+
+// Latency histogram in microseconds. Buckets are a fixed fraction of their value wide, so every
+// percentile it reports is within about 3% of the true one, from a few microseconds up to hours,
+// and adding a sample is a couple of shifts and an increment.
+class LatencyHistogram
+{
+public:
+	void Add(u64 Micros);
+	void Merge(const LatencyHistogram& Other);
+
+	u64 GetCount() const { return Count; }
+	u64 GetMax() const { return Max; }
+	double GetMean() const { return Count ? double(Sum) / Count : 0; }
+	// Returns the latency that Fraction of the samples are at or below.
+	u64 GetPercentile(double Fraction) const;
+
+private:
+	enum
+	{
+		// Values below 2^LINEAR_BITS get a bucket each. Above that, every power of two is split
+		// into 2^(LINEAR_BITS - 1) buckets.
+		LINEAR_BITS = 6,
+		LINEAR_COUNT = 1 << LINEAR_BITS,
+		SUB_BUCKETS = LINEAR_COUNT / 2,
+		BUCKET_COUNT = LINEAR_COUNT + (64 - LINEAR_BITS) * SUB_BUCKETS,
+	};
+
+	static u32 GetBucket(u64 Micros);
+	// The largest value that falls into Bucket.
+	static u64 GetBucketMax(u32 Bucket);
+
+	std::array<u32, BUCKET_COUNT> Buckets{};
+	u64 Count = 0;
+	u64 Sum = 0;
+	u64 Max = 0;
+};
+
+// Everything one worker measured. Workers keep their own and they're merged for the report, so
+// nothing here is shared between threads.
+struct LoadStats
+{
+	// Request to response, by the command ID of the request.
+	std::map<int, LatencyHistogram> Commands;
+	// MC_MATCH_GAME_REQUEST_TIMESYNC round trips. The server answers these straight from its
+	// command loop without touching the database, so on a local server they're a measure of how
+	// long commands wait for the next server tick.
+	LatencyHistogram ServerLoop;
+	// Tunnelled BasicInfo, from the sending client to every other client in the battle.
+	LatencyHistogram Relay;
+
+	u64 SentCommands = 0;
+	u64 RecvCommands = 0;
+	u64 SentBytes = 0;
+	u64 RecvBytes = 0;
+
+	u64 ConnectFailures = 0;
+	u64 LoginFailures = 0;
+	u64 RequestFailures = 0;
+	u64 Disconnects = 0;
+	u64 ProtocolErrors = 0;
+	u64 GamesStarted = 0;
+
+	void Merge(const LoadStats& Other);
+};
+
+// Counters the main thread reads while the workers run, for the periodic progress line.
+struct LoadProgress
+{
+	std::atomic<u32> Connected{ 0 };
+	std::atomic<u32> LoggedIn{ 0 };
+	std::atomic<u32> InStage{ 0 };
+	std::atomic<u32> InBattle{ 0 };
+	std::atomic<u64> SentCommands{ 0 };
+	std::atomic<u64> RecvCommands{ 0 };
+};
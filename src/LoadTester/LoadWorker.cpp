@@ -0,0 +1,87 @@
+#include "stdafx.h"
+#include "LoadWorker.h"
+#include <chrono>
+
+u64 GetLoadTime()
+{
+	using namespace std::chrono;
+	static const auto Epoch = steady_clock::now();
+	return u64(duration_cast<microseconds>(steady_clock::now() - Epoch).count());
+}
+
+LoadWorker::LoadWorker(const LoadConfig& Config, MCommandManager& CommandManager, LoadProgress& Progress)
+	: Config{ Config }, CommandManager{ CommandManager }, Progress{ Progress },
+	Endpoint{ asio::ip::address::from_string(Config.Address), Config.Port },
+	Timer{ IOService }
+{
+}
+
+LoadWorker::~LoadWorker()
+{
+	Stop();
+}
+
+void LoadWorker::AddRoom(int RoomIndex, int FirstClient, int ClientCount)
+{
+	Rooms.emplace_back(std::make_unique<LoadRoom>());
+	auto& Room = *Rooms.back();
+	Room.Index = RoomIndex;
+
+	// Clients are started in order of their index, at Config.RampPerSecond, counting from when
+	// the test started rather than from when this worker got to them.
+	const auto Ramp = (std::max)(Config.RampPerSecond, 1);
+	for (int i = FirstClient; i < FirstClient + ClientCount; ++i)
+	{
+		const auto StartTime = u64(i) * 1000000 / Ramp;
+		Clients.emplace_back(std::make_unique<LoadClient>(*this, Room, i, StartTime));
+		Room.Members.push_back(Clients.back().get());
+	}
+}
+
+void LoadWorker::Start()
+{
+	Thread = std::thread{ [this] { Run(); } };
+}
+
+void LoadWorker::Stop()
+{
+	if (!Thread.joinable())
+		return;
+
+	IOService.post([this] {
+		Timer.cancel();
+		for (auto& Client : Clients)
+			Client->Stop();
+		IOService.stop();
+	});
+	Thread.join();
+}
+
+void LoadWorker::Run()
+{
+	ScheduleTick();
+	IOService.run();
+}
+
+void LoadWorker::ScheduleTick()
+{
+	Timer.expires_from_now(std::chrono::milliseconds(TICK_MILLISECONDS));
+	Timer.async_wait([this](const asio::error_code& ec) {
+		if (ec)
+			return;
+		OnTick();
+		ScheduleTick();
+	});
+}
+
+void LoadWorker::OnTick()
+{
+	const auto Now = GetLoadTime();
+	for (auto& Client : Clients)
+		Client->Update(Now);
+
+	Progress.SentCommands += Stats.SentCommands - ReportedSent;
+	Progress.RecvCommands += Stats.RecvCommands - ReportedRecv;
+	ReportedSent = Stats.SentCommands;
+	ReportedRecv = Stats.RecvCommands;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "LoadClient.h"
+#include "LoadStats.h"
+#include <thread>
+#include <atomic>
+
+class MCommandManager;
+
+// Microseconds since the load tester started.
+u64 GetLoadTime();
+
+// A thread with its own io_service that runs a set of rooms and their clients. Clients are only
+// touched from this thread, so neither they nor Stats need any locking.
+class LoadWorker
+{
+public:
+	LoadWorker(const LoadConfig& Config, MCommandManager& CommandManager, LoadProgress& Progress);
+	~LoadWorker();
+
+	// Adds a room with clients FirstClient to FirstClient + ClientCount - 1. Must be called before
+	// Start.
+	void AddRoom(int RoomIndex, int FirstClient, int ClientCount);
+
+	void Start();
+	// Disconnects every client and joins the thread.
+	void Stop();
+
+	asio::io_service& GetIOService() { return IOService; }
+
+	const LoadConfig& Config;
+	MCommandManager& CommandManager;
+	LoadProgress& Progress;
+	asio::ip::tcp::endpoint Endpoint;
+	// Only safe to read from other threads after Stop.
+	LoadStats Stats;
+
+private:
+	enum { TICK_MILLISECONDS = 10 };
+
+	void Run();
+	void ScheduleTick();
+	void OnTick();
+
+	asio::io_service IOService;
+	asio::steady_timer Timer;
+	std::thread Thread;
+	std::vector<std::unique_ptr<LoadRoom>> Rooms;
+	std::vector<std::unique_ptr<LoadClient>> Clients;
+
+	// What has already been added to Progress.
+	u64 ReportedSent = 0;
+	u64 ReportedRecv = 0;
+};
@@ -0,0 +1,227 @@
+#include "stdafx.h"
+#include "LoadWorker.h"
+#include "MCommandManager.h"
+#include <cstdio>
+#include <chrono>
+
+static void PrintUsage()
+{
+	printf("Usage: LoadTester [options]\n"
+		"  --host <address>        MatchServer address (127.0.0.1)\n"
+		"  --port <port>           MatchServer port (6000)\n"
+		"  --clients <n>           Number of clients (100)\n"
+		"  --threads <n>           Worker threads, 0 for one per core (0)\n"
+		"  --ramp <n>              Clients started per second (200)\n"
+		"  --user <prefix>         Account names are <prefix><index> (loadtest)\n"
+		"  --password <password>   Password of every account (loadtest)\n"
+		"  --room-size <n>         Clients per stage (8)\n"
+		"  --netcode <type>        server, antilead or lead (server)\n"
+		"  --game-minutes <n>      Game time limit, 0 for the default (0)\n"
+		"  --duration <seconds>    How long to run for (60)\n"
+		"  --report <seconds>      Progress line interval (5)\n"
+		"  --basicinfo-rate <n>    BasicInfo sent per client per second in battle (20)\n"
+		"  --shot-rate <n>         Shots sent per client per second in battle (2)\n"
+		"  --origin <x,y,z>        Point the clients walk around (0,0,0)\n");
+}
+
+static bool ParseArgs(int argc, char** argv, LoadConfig& Config)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		const std::string Key = argv[i];
+		if (Key == "--help" || Key == "-h")
+			return false;
+		if (i + 1 >= argc)
+		{
+			printf("Missing value for %s\n", Key.c_str());
+			return false;
+		}
+
+		const char* Value = argv[++i];
+		if (Key == "--host")
+			Config.Address = Value;
+		else if (Key == "--port")
+			Config.Port = u16(atoi(Value));
+		else if (Key == "--clients")
+			Config.ClientCount = atoi(Value);
+		else if (Key == "--threads")
+			Config.ThreadCount = atoi(Value);
+		else if (Key == "--ramp")
+			Config.RampPerSecond = atoi(Value);
+		else if (Key == "--user")
+			Config.UserPrefix = Value;
+		else if (Key == "--password")
+			Config.Password = Value;
+		else if (Key == "--room-size")
+			Config.RoomSize = atoi(Value);
+		else if (Key == "--netcode")
+		{
+			if (!strcmp(Value, "server"))
+				Config.Netcode = NetcodeType::ServerBased;
+			else if (!strcmp(Value, "antilead"))
+				Config.Netcode = NetcodeType::P2PAntilead;
+			else if (!strcmp(Value, "lead"))
+				Config.Netcode = NetcodeType::P2PLead;
+			else
+			{
+				printf("Unknown netcode %s\n", Value);
+				return false;
+			}
+		}
+		else if (Key == "--game-minutes")
+			Config.GameMinutes = atoi(Value);
+		else if (Key == "--duration")
+			Config.DurationSeconds = atoi(Value);
+		else if (Key == "--report")
+			Config.ReportInterval = atoi(Value);
+		else if (Key == "--basicinfo-rate")
+			Config.BasicInfoRate = atoi(Value);
+		else if (Key == "--shot-rate")
+			Config.ShotRate = atoi(Value);
+		else if (Key == "--origin")
+		{
+			if (sscanf(Value, "%f,%f,%f", &Config.Origin[0], &Config.Origin[1], &Config.Origin[2]) != 3)
+			{
+				printf("Invalid origin %s\n", Value);
+				return false;
+			}
+		}
+		else
+		{
+			printf("Unknown option %s\n", Key.c_str());
+			return false;
+		}
+	}
+
+	if (Config.ClientCount <= 0 || Config.RoomSize <= 0 || Config.DurationSeconds <= 0)
+	{
+		printf("--clients, --room-size and --duration must be positive\n");
+		return false;
+	}
+
+	return true;
+}
+
+static void PrintHistogram(const char* szName, const LatencyHistogram& Hist)
+{
+	auto ms = [](u64 Micros) { return Micros / 1000.0; };
+	printf("%-40s %9llu %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f\n", szName,
+		static_cast<unsigned long long>(Hist.GetCount()), Hist.GetMean() / 1000,
+		ms(Hist.GetPercentile(0.5)), ms(Hist.GetPercentile(0.9)), ms(Hist.GetPercentile(0.99)),
+		ms(Hist.GetPercentile(0.999)), ms(Hist.GetMax()));
+}
+
+static void PrintReport(const LoadStats& Stats, MCommandManager& CommandManager, double Seconds)
+{
+	printf("\n%-40s %9s %9s %9s %9s %9s %9s %9s\n", "Latency (ms)",
+		"count", "mean", "p50", "p90", "p99", "p99.9", "max");
+	for (auto& Pair : Stats.Commands)
+	{
+		char szName[64];
+		auto* pDesc = CommandManager.GetCommandDescByID(Pair.first);
+		if (pDesc && pDesc->GetName()[0])
+			strcpy_safe(szName, pDesc->GetName());
+		else
+			sprintf_safe(szName, "%d", Pair.first);
+		PrintHistogram(szName, Pair.second);
+	}
+	PrintHistogram("Server loop (timesync round trip)", Stats.ServerLoop);
+	PrintHistogram("Relay (BasicInfo, client to client)", Stats.Relay);
+
+	auto PerSecond = [&](u64 Value) { return Seconds > 0 ? Value / Seconds : 0; };
+	printf("\nSent %llu commands (%.0f/s), %.2f MB (%.2f MB/s)\n",
+		static_cast<unsigned long long>(Stats.SentCommands), PerSecond(Stats.SentCommands),
+		Stats.SentBytes / 1e6, PerSecond(Stats.SentBytes) / 1e6);
+	printf("Received %llu commands (%.0f/s), %.2f MB (%.2f MB/s)\n",
+		static_cast<unsigned long long>(Stats.RecvCommands), PerSecond(Stats.RecvCommands),
+		Stats.RecvBytes / 1e6, PerSecond(Stats.RecvBytes) / 1e6);
+	printf("Games started: %llu\n", static_cast<unsigned long long>(Stats.GamesStarted));
+	printf("Connect failures: %llu, login failures: %llu, request failures: %llu, "
+		"disconnects: %llu, protocol errors: %llu\n",
+		static_cast<unsigned long long>(Stats.ConnectFailures),
+		static_cast<unsigned long long>(Stats.LoginFailures),
+		static_cast<unsigned long long>(Stats.RequestFailures),
+		static_cast<unsigned long long>(Stats.Disconnects),
+		static_cast<unsigned long long>(Stats.ProtocolErrors));
+}
+
+int main(int argc, char** argv)
+{
+	LoadConfig Config;
+	if (!ParseArgs(argc, argv, Config))
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	auto ThreadCount = Config.ThreadCount;
+	if (ThreadCount <= 0)
+		ThreadCount = (std::max)(int(std::thread::hardware_concurrency()), 1);
+
+	// Shared by every client. Nothing changes it after this, and command creation only reads it.
+	MCommandManager CommandManager;
+	MAddSharedCommandTable(&CommandManager, MSharedCommandType::Client);
+
+	LoadProgress Progress;
+	std::vector<std::unique_ptr<LoadWorker>> Workers;
+	try
+	{
+		for (int i = 0; i < ThreadCount; ++i)
+			Workers.emplace_back(std::make_unique<LoadWorker>(Config, CommandManager, Progress));
+	}
+	catch (const std::exception& e)
+	{
+		printf("Invalid address %s: %s\n", Config.Address.c_str(), e.what());
+		return 1;
+	}
+
+	// Rooms are dealt out to the workers in turn, so that the clients of each worker are spread
+	// evenly over the ramp.
+	const auto RoomCount = (Config.ClientCount + Config.RoomSize - 1) / Config.RoomSize;
+	for (int Room = 0; Room < RoomCount; ++Room)
+	{
+		const auto First = Room * Config.RoomSize;
+		const auto Count = (std::min)(Config.RoomSize, Config.ClientCount - First);
+		Workers[Room % ThreadCount]->AddRoom(Room, First, Count);
+	}
+
+	printf("Running %d clients in %d rooms on %d threads against %s:%d for %d seconds\n",
+		Config.ClientCount, RoomCount, ThreadCount, Config.Address.c_str(), Config.Port,
+		Config.DurationSeconds);
+
+	GetLoadTime();
+	for (auto& Worker : Workers)
+		Worker->Start();
+
+	const auto StartTime = std::chrono::steady_clock::now();
+	const auto EndTime = StartTime + std::chrono::seconds(Config.DurationSeconds);
+	const auto ReportInterval = std::chrono::seconds((std::max)(Config.ReportInterval, 1));
+	u64 LastSent = 0, LastRecv = 0;
+	auto NextReport = StartTime + ReportInterval;
+	while (std::chrono::steady_clock::now() < EndTime)
+	{
+		std::this_thread::sleep_until((std::min)(NextReport, EndTime));
+		if (std::chrono::steady_clock::now() < NextReport)
+			continue;
+
+		const u64 Sent = Progress.SentCommands, Recv = Progress.RecvCommands;
+		const auto Interval = double(ReportInterval.count());
+		printf("connected %u, logged in %u, in stage %u, in battle %u, sent %.0f/s, received %.0f/s\n",
+			Progress.Connected.load(), Progress.LoggedIn.load(), Progress.InStage.load(),
+			Progress.InBattle.load(), (Sent - LastSent) / Interval, (Recv - LastRecv) / Interval);
+		LastSent = Sent;
+		LastRecv = Recv;
+		NextReport += ReportInterval;
+	}
+
+	LoadStats Total;
+	for (auto& Worker : Workers)
+	{
+		Worker->Stop();
+		Total.Merge(Worker->Stats);
+	}
+
+	const auto Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+	PrintReport(Total, CommandManager, Seconds);
+	return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <map>
+#include <list>
+#include <vector>
+#include <algorithm>
+
+#include "MDebug.h"
+#include "MUID.h"
+#include "MSharedCommandTable.h"
+#include "MCommand.h"
+#include "MCommandParameter.h"
+#include "MCommandCommunicator.h"
+#include "MErrorTable.h"
+
+#include "SafeString.h"
+#include "GlobalTypes.h"
+
+#include <cassert>
+#define ASSERT assert
+#ifdef _ASSERT
+#undef _ASSERT
+#endif
+#define _ASSERT assert
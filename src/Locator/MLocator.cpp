@@ -9,7 +9,6 @@
 #include "MSharedCommandTable.h"
 #include "MBlobArray.h"
 #include "MLocatorConfig.h"
-#include "MLocatorUDP.h"
 #include "MCommandCommunicator.h"
 #include "MErrorTable.h"
 #include "MCommandBuilder.h"
@@ -36,7 +35,7 @@ MLocator::MLocator()
 {
 	auto time = GetGlobalTimeMS();
 	m_dwLastServerStatusUpdatedTime = time;
-	m_dwLastUDPManagerUpdateTime = time;
+	m_dwLastFloodFilterUpdateTime = time;
 	m_dwLastLocatorStatusUpdatedTime = time;
 
 	m_This = GetLocatorConfig()->GetLocatorUID();
@@ -76,9 +75,9 @@ bool MLocator::Create()
 		return false;
 	}
 
-	if( !InitUDPManager() )
+	if( !InitFloodFilter() )
 	{
-		mlog( "MLocator::Create - UDP Manager  ʱȭ .\n" );
+		mlog( "MLocator::Create - Flood filter  ʱȭ .\n" );
 		return false;
 	}
 
@@ -175,41 +174,27 @@ bool MLocator::InitServerStatusMgr()
 	return false;
 }
 
-bool MLocator::InitUDPManager()
+bool MLocator::InitFloodFilter()
 {
-	bool bRet = true;
-	m_pRecvUDPManager = new MUDPManager;
-	if( (0 == m_pRecvUDPManager) && (bRet) ) bRet = false;
-	m_pSendUDPManager = new MUDPManager;
-	if( (0 == m_pSendUDPManager) && (bRet) ) bRet = false;
-	m_pBlockUDPManager = new MUDPManager;
-	if( (0 == m_pBlockUDPManager) && (bRet) ) bRet = false;
-
-	if( !bRet )
-	{
-		delete m_pRecvUDPManager;
-		delete m_pSendUDPManager;
-		delete m_pBlockUDPManager;
-
-		m_pRecvUDPManager = 0;
-		m_pSendUDPManager = 0;
-		m_pBlockUDPManager = 0;
-
+	if( 0 != m_pFloodFilter )
 		return false;
-	}
 
-	InitMemPool( MLocatorUDPInfo );
+	m_pFloodFilter = new MLocatorFloodFilter( GetLocatorConfig()->GetMaxFreeUseCountPerLiveTime(),
+		GetLocatorConfig()->GetUpdateUDPManagerElapsedTime(),
+		GetLocatorConfig()->GetBlockTime(),
+		GetGlobalTimeMS() );
 
 	return true;
 }
 
 void MLocator::Destroy()
 {
+	Stop();
 #ifdef LOCATOR_FREESTANDING
 	ReleaseDBMgr();
 #endif
 	ReleaseSafeUDP();
-	ReleaseUDPManager();
+	ReleaseFloodFilter();
 	ReleaseServerStatusMgr();
 	ReleaseServerStatusInfoBlob();
 }
@@ -259,32 +244,13 @@ void MLocator::ReleaseServerStatusInfoBlob()
 }
 
 
-void MLocator::ReleaseUDPManager()
+void MLocator::ReleaseFloodFilter()
 {
-	if( 0 != m_pRecvUDPManager )
+	if( 0 != m_pFloodFilter )
 	{
-		m_pRecvUDPManager->SafeDestroy();
-		delete m_pRecvUDPManager;
-		m_pRecvUDPManager = 0;
+		delete m_pFloodFilter;
+		m_pFloodFilter = 0;
 	}
-
-	if( 0 != m_pSendUDPManager )
-	{
-		m_pSendUDPManager->SafeDestroy();
-		delete m_pSendUDPManager;
-		m_pSendUDPManager = 0;
-	}
-
-	if( 0 != m_pBlockUDPManager )
-	{
-		m_pBlockUDPManager->SafeDestroy();
-		delete m_pBlockUDPManager;
-		m_pBlockUDPManager = 0;
-	}
-
-	ReleaseMemPool( MLocatorUDPInfo );
-
-	UninitMemPool( MLocatorUDPInfo );
 }
 
 void MLocator::ReleaseCommand()
@@ -298,30 +264,17 @@ bool MLocator::GetServerStatus()
 #ifdef LOCATOR_FREESTANDING
 	return GetLocatorDBMgr()->GetServerStatus(GetServerStatusMgr());
 #else
-	auto& ServerStatusMgr = *GetServerStatusMgr();
-	auto& MatchServer = *MGetMatchServer();
-	auto& Config = *MGetServerConfig();
+	// The match server's state belongs to its own thread, so this only goes by what it's
+	// published with SetServerStatus.
+	auto pStatus = m_ServerStatus.Get();
+	if (!pStatus)
+		return false;
 
+	auto& ServerStatusMgr = *GetServerStatusMgr();
 	if (ServerStatusMgr.GetSize() < 1)
-	{
-		ServerStatusMgr.Insert(MServerStatus());
-
-		auto& Status = ServerStatusMgr[0];
-
-		Status.SetID(Config.GetServerID());
-		Status.SetType(4);
-		Status.SetMaxPlayer(Config.GetMaxUser());
-		Status.SetLastUpdatedTime("right meow");
-		Status.SetIPString("");
-		Status.SetIP(0);
-		Status.SetPort(Config.GetPort());
-		Status.SetServerName(Config.GetServerName());
-		Status.SetOpenState(true);
-		Status.SetLiveStatus(true);
-	}
+		ServerStatusMgr.Insert(*pStatus);
 
-	auto& Status = ServerStatusMgr[0];
-	Status.SetCurPlayer(MatchServer.GetObjects()->size());
+	ServerStatusMgr[0].SetCurPlayer(pStatus->GetCurPlayer());
 
 	return true;
 #endif
@@ -376,6 +329,8 @@ void MLocator::GetDBServerStatus(u64 dwEventTime, const bool bIsWithoutDelayUpda
 		{
 			m_nLastGetServerStatusCount = -1;
 		}
+
+		BuildServerStatusInfoListPacket();
 	}
 	else
 	{
@@ -391,77 +346,31 @@ bool MLocator::IsElapedServerStatusUpdatedTime(u64 dwEventTime)
 }
 
 
-bool MLocator::IsLiveBlockUDP(const MLocatorUDPInfo* pBlkRecvUDPInfo, u64 dwEventTime)
-{
-	if( 0 == pBlkRecvUDPInfo ) return false;
-
-	if( GetLocatorConfig()->GetBlockTime() > (dwEventTime - pBlkRecvUDPInfo->GetUseStartTime()) )
-		return true;
-
-	return false;
-}
-
-
 bool MLocator::IsBlocker(u32 dwIPKey, u64 dwEventTime)
 {
-	MUDPManager& rfBlkUDPMgr = GetBlockUDPManager();
-
-	rfBlkUDPMgr.Lock();
-
-	MLocatorUDPInfo* pBlkRecvUDPInfo = rfBlkUDPMgr.Find( dwIPKey );
-	if( 0 != pBlkRecvUDPInfo )
+	switch( m_pFloodFilter->Check(dwIPKey, dwEventTime) )
 	{
-		if (!IsLiveBlockUDP(pBlkRecvUDPInfo, dwEventTime))
-		{
-			rfBlkUDPMgr.Delete( dwIPKey );
-			rfBlkUDPMgr.Unlock();
-			return false;
-		}
-
-		pBlkRecvUDPInfo->IncreaseUseCount();
+	case MLocatorFloodFilter::FLOOD_ALLOW:
+		return false;
 
-		if( IsOverflowedNormalUseCount(pBlkRecvUDPInfo) )
+	case MLocatorFloodFilter::FLOOD_BLOCK_NEW:
 		{
-			pBlkRecvUDPInfo->SetUseStartTime( dwEventTime );
-			pBlkRecvUDPInfo->SetUseCount( 1 );
-		}
+			GetLocatorStatistics().IncreaseBlockCount();
 
-#ifdef _DEBUG
-		mlog( "MLocator::IsBlocker - Block! time. dwIP:%u, UseCount:%d, LimitUseCount:%d, DbgInfo:%s\n",
-			dwIPKey, 
-			pBlkRecvUDPInfo->GetUseCount(), 
-			GetLocatorConfig()->GetMaxFreeUseCountPerLiveTime(), 
-			rfBlkUDPMgr.m_strExDbgInfo.c_str() );
-#endif
+			char szLog[ 128 ] = {0,};
+			sprintf_safe( szLog, "Block. dwIP:%u, time:%s\n",
+				dwIPKey, MGetStrLocalTime().c_str() );
+			GetLogManager().SafeInsertLog( szLog );
+		}
+		return true;
 
-		rfBlkUDPMgr.Unlock();
+	default:
+		IncreaseThrottledCount();
 		return true;
 	}
-
-	rfBlkUDPMgr.Unlock();
-
-	return false;
 }// IsBlocker
 
 
-bool MLocator::IsDuplicatedUDP(u32 dwIPKey, MUDPManager& rfCheckUDPManager, u64 dwEventTime)
-{
-	rfCheckUDPManager.Lock();
-
-	MLocatorUDPInfo* pRecvUDPInfo = rfCheckUDPManager.Find( dwIPKey );
-	if( 0 != pRecvUDPInfo )
-	{
-		pRecvUDPInfo->IncreaseUseCount();
-		rfCheckUDPManager.Unlock();
-		return false;
-	}
-
-	rfCheckUDPManager.Unlock();
-
-	return true;
-}
-
-
 bool MLocator::UDPSocketRecvEvent(u32 dwIP, u16 wRawPort, char* pPacket, u32 dwSize)
 {
 	if( NULL == GetMainLocator() ) return false;
@@ -478,12 +387,6 @@ bool MLocator::UDPSocketRecvEvent(u32 dwIP, u16 wRawPort, char* pPacket, u32 dwS
 	if( 400 < GetMainLocator()->GetRecvCount() ) 
 		return true;
 #endif
-	
-	if( !pLocator->IsDuplicatedUDP(dwIP, pLocator->GetRecvUDPManager(), dwEventTime) ) 
-	{
-		GetMainLocator()->IncreaseDuplicatedCount();
-		return false;
-	}
 
 	MPacketHeader* pPacketHeader = (MPacketHeader*)pPacket;
 	
@@ -527,13 +430,7 @@ void MLocator::ParseUDPPacket( char* pData, MPacketHeader* pPacketHeader, u32 dw
 
 				if( MC_REQUEST_SERVER_LIST_INFO == pCmd->GetID() )
 				{
-					if( !GetRecvUDPManager().SafeInsert(dwIP, nPort, GetGlobalTimeMS()) )
-					{
-						char szLog[ 1024 ] = {0,};
-						sprintf_safe(szLog, "fail to insert new IP(%u,%d) Time:%s\n",
-							dwIP, nPort, MGetStrLocalTime().c_str() );
-						GetLogManager().SafeInsertLog( szLog );
-					}
+					ResponseServerStatusInfoList( dwIP, nPort );
 				}
 				else
 				{
@@ -544,7 +441,7 @@ void MLocator::ParseUDPPacket( char* pData, MPacketHeader* pPacketHeader, u32 dw
 						pCmd->GetID(), MGetStrLocalTime().c_str(), dwIP );
 					GetLogManager().SafeInsertLog( szLog );
 
-					GetBlockUDPManager().SafeInsert( dwIP, nPort, GetGlobalTimeMS() );
+					m_pFloodFilter->Block( dwIP, GetGlobalTimeMS() );
 					GetLocatorStatistics().IncreaseBlockCount();
 				}
 
@@ -560,7 +457,7 @@ void MLocator::ParseUDPPacket( char* pData, MPacketHeader* pPacketHeader, u32 dw
 				MGetStrLocalTime().c_str(), dwIP );
 			GetLogManager().SafeInsertLog( szLog );
 
-			GetBlockUDPManager().SafeInsert( dwIP, nPort, GetGlobalTimeMS() );
+			m_pFloodFilter->Block( dwIP, GetGlobalTimeMS() );
 			GetLocatorStatistics().IncreaseBlockCount();
 
 			unsigned short nCheckSum = MBuildCheckSum(pPacketHeader, pPacketHeader->nSize);
@@ -589,8 +486,7 @@ void MLocator::Run()
 {
 	const auto dwEventTime = GetGlobalTimeMS();
 	GetDBServerStatus( dwEventTime );
-	FlushRecvQueue( dwEventTime );
-	UpdateUDPManager( dwEventTime );
+	UpdateFloodFilter( dwEventTime );
 #ifdef LOCATOR_FREESTANDING
 	UpdateLocatorStatus( dwEventTime );
 	UpdateLocatorLog( dwEventTime );
@@ -599,53 +495,79 @@ void MLocator::Run()
 }
 
 
-void MLocator::ResponseServerStatusInfoList( u32 dwIP, int nPort )
+constexpr u32 MLocator::RunInterval;
+
+bool MLocator::Start()
 {
-	if( 0 < m_nLastGetServerStatusCount )
-	{
-		MCommand* pCmd = CreateCommand( MC_RESPONSE_SERVER_LIST_INFO, MUID(0, 0) );
-		if( 0 != pCmd )
-		{
-			pCmd->AddParameter( new MCommandParameterBlob(m_vpServerStatusInfoBlob, m_nServerStatusInfoBlobSize) );
-			SendCommandByUDP( dwIP, nPort, pCmd );
-			delete pCmd;
-		}
-	}
+	return m_Thread.Start(RunInterval, [this] { Run(); });
 }
 
 
-void MLocator::ResponseBlockCountryCodeIP( u32 dwIP, int nPort, const string& strCountryCode, const string& strRoutingURL )
+void MLocator::Stop()
 {
-	MCommand* pCmd = CreateCommand( MC_RESPONSE_BLOCK_COUNTRY_CODE_IP, MUID(0, 0) );
-	if( 0 != pCmd )
+	m_Thread.Stop();
+}
+
+
+void MLocator::SetServerStatus(const MServerStatus& Status)
+{
+	m_ServerStatus.Set(Status);
+}
+
+
+// Called by Run whenever the server status blob changes. Every request gets the
+// same bytes, so they're encoded once here instead of once per request.
+void MLocator::BuildServerStatusInfoListPacket()
+{
+	std::shared_ptr<const MServerStatusInfoListPacket> pNewPacket;
+
+	if( (0 < m_nLastGetServerStatusCount) && (0 != m_vpServerStatusInfoBlob) )
 	{
-		pCmd->AddParameter( new MCommandParameterString(strCountryCode.c_str()) );
-		pCmd->AddParameter( new MCommandParameterString(strRoutingURL.c_str()) );
-		SendCommandByUDP( dwIP, nPort, pCmd );
+		MCommand* pCmd = CreateCommand( MC_RESPONSE_SERVER_LIST_INFO, MUID(0, 0) );
+		pCmd->AddParameter( new MCommandParameterBlob(m_vpServerStatusInfoBlob, m_nServerStatusInfoBlobSize) );
+
+		const int nPacketSize = CalcPacketSize( pCmd );
+		auto pPacket = std::make_shared<MServerStatusInfoListPacket>();
+		pPacket->pData.reset( new char[ nPacketSize ] );
+		pPacket->nSize = static_cast<u32>( nPacketSize );
+
+		if( nPacketSize == MakeCmdPacket(pPacket->pData.get(), nPacketSize, pCmd) )
+			pNewPacket = std::move( pPacket );
+		else
+			ASSERT( 0 && "Failed to make the server list packet." );
+
 		delete pCmd;
 	}
+
+	std::atomic_store( &m_pServerStatusInfoListPacket, pNewPacket );
 }
 
 
-bool MLocator::IsLiveUDP( const MLocatorUDPInfo* pRecvUDPInfo, u64 dwEventTime )
+// Called on the socket thread.
+void MLocator::ResponseServerStatusInfoList( u32 dwIP, int nPort )
 {
-	if( 0 == pRecvUDPInfo ) return false;
-
-	if( GetLocatorConfig()->GetUDPLiveTime() > (dwEventTime - pRecvUDPInfo->GetUseStartTime()) )
-		return true;
+	auto pPacket = std::atomic_load( &m_pServerStatusInfoListPacket );
+	if( !pPacket )
+		return;
 
-	return false;
+	// The send queue holds a reference to the packet until it's been sent, so a refresh in the
+	// meantime doesn't free the buffer under it.
+	std::shared_ptr<const char> pData( pPacket, pPacket->pData.get() );
+	if( m_pSafeUDP->Send(dwIP, nPort, std::move(pData), pPacket->nSize) )
+		IncreaseSendCount();
 }
 
 
-bool MLocator::IsOverflowedNormalUseCount( const MLocatorUDPInfo* pRecvUDPInfo )
+void MLocator::ResponseBlockCountryCodeIP( u32 dwIP, int nPort, const string& strCountryCode, const string& strRoutingURL )
 {
-	if( 0 == pRecvUDPInfo ) return false;
-
-	if( GetLocatorConfig()->GetMaxFreeUseCountPerLiveTime() > pRecvUDPInfo->GetTotalUseCount() )
-		return false;
-	
-	return true;
+	MCommand* pCmd = CreateCommand( MC_RESPONSE_BLOCK_COUNTRY_CODE_IP, MUID(0, 0) );
+	if( 0 != pCmd )
+	{
+		pCmd->AddParameter( new MCommandParameterString(strCountryCode.c_str()) );
+		pCmd->AddParameter( new MCommandParameterString(strRoutingURL.c_str()) );
+		SendCommandByUDP( dwIP, nPort, pCmd );
+		delete pCmd;
+	}
 }
 
 
@@ -713,14 +635,14 @@ void MLocator::OnRegisterCommand(MCommandManager* pCommandManager)
 }
 
 
-void MLocator::UpdateUDPManager(u64 dwEventTime )
+void MLocator::UpdateFloodFilter(u64 dwEventTime )
 {
-	if( GetLocatorConfig()->GetUpdateUDPManagerElapsedTime() < (dwEventTime - GetLastUDPManagerUpdateTime()) )
+	// Sweeping walks the whole table, so once a second is plenty.
+	if( 1000 < (dwEventTime - GetLastFloodFilterUpdateTime()) )
 	{
-		GetSendUDPManager().SafeClearElapsedLiveTimeUDP( GetLocatorConfig()->GetUpdateUDPManagerElapsedTime(), dwEventTime );
-		GetBlockUDPManager().SafeClearElapsedLiveTimeUDP( GetLocatorConfig()->GetBlockTime(), dwEventTime );
+		m_nBlockedIPCount = m_pFloodFilter->Sweep( dwEventTime );
 
-		UpdateLastUDPManagerUpdateTime( dwEventTime );
+		UpdateLastFloodFilterUpdateTime( dwEventTime );
 	}
 }
 
@@ -758,66 +680,6 @@ void MLocator::UpdateLogManager()
 }
 
 
-void MLocator::FlushRecvQueue(u64 dwEventTime)
-{
-	MUDPManager& RecvUDPMgr = GetRecvUDPManager();
-	MUDPManager& SendUDPMgr = GetSendUDPManager();
-
-	MLocatorUDPInfo* pRecvUDPInfo;
-	MLocatorUDPInfo* pSendUDPInfo;
-
-	string	strCountryCode;
-	string	strRoutingURL;
-	string	strComment;
-
-    RecvUDPMgr.Lock();
-	while( 0 != (pRecvUDPInfo = RecvUDPMgr.SafePopFirst()) )
-	{
-		if( !SendUDPMgr.Insert(pRecvUDPInfo->GetIP(), pRecvUDPInfo) )
-		{
-			pSendUDPInfo = SendUDPMgr.Find( pRecvUDPInfo->GetIP() );
-			if( 0 != pSendUDPInfo )
-				pSendUDPInfo->IncreaseUseCount( pRecvUDPInfo->GetUseCount() );
-			delete pRecvUDPInfo;
-		}
-	}
-	RecvUDPMgr.Unlock();
-
-	for( SendUDPMgr.SetBegin(); 0 != (pSendUDPInfo = SendUDPMgr.GetCurPosUDP()); )
-	{
-		if( 0 < pSendUDPInfo->GetUseCount() )
-		{
-			if( IsOverflowedNormalUseCount(pSendUDPInfo) )
-			{
-				if( !IsBlocker(pSendUDPInfo->GetIP(), dwEventTime) )
-				{
-					pSendUDPInfo->SetUseCount( 0 );
-
-					if( !GetBlockUDPManager().SafeInsert(pSendUDPInfo->GetIP(), pSendUDPInfo->GetPort(), dwEventTime) )
-					{
-						mlog( "fail to block udp(%s) time:%s\n", 
-							pSendUDPInfo->GetStrIP().c_str(), MGetStrLocalTime().c_str() );
-					}
-
-					GetLocatorStatistics().IncreaseBlockCount();
-					mlog( "Block. IP(%s), time:%s\n", pSendUDPInfo->GetStrIP().c_str(), MGetStrLocalTime().c_str() );
-				}
-				SendUDPMgr.MoveNext();
-				continue;
-			}
-
-			ResponseServerStatusInfoList(pSendUDPInfo->GetIP(), pSendUDPInfo->GetPort());
-
-			pSendUDPInfo->IncreaseUsedCount( pSendUDPInfo->GetUseCount() );
-			pSendUDPInfo->SetUseCount( 0 );
-			IncreaseSendCount();
-
-			
-		}
-		SendUDPMgr.MoveNext();
-	}
-}
-
 MCommand* MLocator::CreateCommand(int nCmdID, const MUID& TargetUID)
 {
 	return new MCommand(m_CommandManager.GetCommandDescByID(nCmdID), TargetUID, m_This);
@@ -828,21 +690,13 @@ void MLocator::DumpLocatorStatusInfo()
 	mlog( "\n======================================================\n" );
 	mlog( "Locator Status Info.\n" );
 
-	mlog( "Recv UDP Manager Status Info\n" );
-	GetRecvUDPManager().Lock();
-	GetRecvUDPManager().DumpStatusInfo();
-	GetRecvUDPManager().Unlock();
-
-	mlog( "Send UDP Manager Status Info\n" );
-	GetSendUDPManager().Lock();
-	GetSendUDPManager().DumpStatusInfo();
-	GetSendUDPManager().Unlock();
-
-	mlog( "Block UDP Manager Status Info\n" );
-	GetBlockUDPManager().Lock();
-	GetBlockUDPManager().DumpStatusInfo();
-	GetBlockUDPManager().DumpUDPInfo();
-	GetBlockUDPManager().Unlock();
+	mlog( "Recv count : %u\n", GetRecvCount() );
+	mlog( "Send count : %u\n", GetSendCount() );
+	mlog( "Throttled count : %u\n", GetThrottledCount() );
+
+	mlog( "Flood filter Status Info\n" );
+	mlog( "Slots : %u\n", m_pFloodFilter->GetSlotCount() );
+	mlog( "Blocked IPs : %u\n", m_nBlockedIPCount.load() );
 	mlog( "======================================================\n\n" );
 }
 
@@ -859,8 +713,8 @@ void MLocator::UpdateLocatorStatus(u64 dwEventTime)
 		if( !m_pDBMgr->UpdateLocaterStatus( GetLocatorConfig()->GetLocatorID(), 
 			GetRecvCount(), 
 			GetSendCount(), 
-			static_cast<u32>(GetBlockUDPManager().size()), 
-			GetDuplicatedCount() ) )
+			m_nBlockedIPCount, 
+			GetThrottledCount() ) )
 		{
 			mlog( "fail to update locator status.\n" );
 		}
@@ -868,7 +722,7 @@ void MLocator::UpdateLocatorStatus(u64 dwEventTime)
 
 		ResetRecvCount();
 		ResetSendCount();
-		ResetDuplicatedCount();
+		ResetThrottledCount();
 
 		UpdateLastLocatorStatusUpdatedTime( dwEventTime );
 	}
@@ -878,9 +732,6 @@ void MLocator::UpdateLocatorStatus(u64 dwEventTime)
 
 void MLocator::InitDebug()
 {
-	GetRecvUDPManager().m_strExDbgInfo = "Name:RecvUDPManager";
-	GetSendUDPManager().m_strExDbgInfo = "Name:SendUDPManager";
-	GetBlockUDPManager().m_strExDbgInfo = "Name:BlockUDPManager";
 }
 
 
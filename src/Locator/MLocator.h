@@ -3,14 +3,17 @@
 #include "MUID.h"
 #include "MCommandManager.h"
 #include "MSync.h"
+#include "MLocatorFloodFilter.h"
+#include "MLocatorThread.h"
+#include "MServerStatus.h"
+#include <atomic>
+#include <memory>
 
 class MCommand;
 class MCommandManager;
 class MLocatorDBMgr;
 class MSafeUDP;
 class MServerStatusMgr;
-class MLocatorUDPInfo;
-class MUDPManager;
 class MCountryFilter;
 
 struct MPacketHeader;
@@ -25,13 +28,11 @@ public:
 	void Destroy();
 
 	bool IsBlocker(const u32 dwIPKey, const u64 dwEventTime);
-	bool IsDuplicatedUDP(const u32 dwIPKey,
-		MUDPManager& rfCheckUDPManager,
-		const u64 dwEventTime);
 
 	void IncreaseRecvCount() { ++m_nRecvCount; }
 	void IncreaseSendCount() { ++m_nSendCount; }
-	void IncreaseDuplicatedCount() { ++m_nDuplicatedCount; }
+	// Requests dropped because their IP was already blocked by the flood filter.
+	void IncreaseThrottledCount() { ++m_nThrottledCount; }
 
 	auto* GetServerStatusMgr() { return m_pServerStatusMgr; }
 	auto* GetServerStatusMgr() const { return m_pServerStatusMgr; }
@@ -40,6 +41,19 @@ public:
 
 	void Run();
 
+	// Calls Run on a thread of its own every RunInterval milliseconds until Stop, so that a slow
+	// status refresh doesn't hold up whoever owns the locator. Run mustn't be called from anywhere
+	// else in the meantime.
+	bool Start();
+	void Stop();
+	bool IsRunning() const { return m_Thread.IsRunning(); }
+
+	static constexpr u32 RunInterval = 100;
+
+	// Sets the status the locator hands out for the match server it's embedded in. Can be called
+	// from any thread; the locator picks it up on its next status refresh.
+	void SetServerStatus(const MServerStatus& Status);
+
 public:
 	MCommandManager* GetCommandManager() { return &m_CommandManager; }
 	MCommand* GetCommandSafe() { return m_CommandManager.GetCommand(); }
@@ -56,38 +70,34 @@ private:
 	bool InitDBMgr();
 	bool InitSafeUDP();
 	bool InitServerStatusMgr();
-	bool InitUDPManager();
+	bool InitFloodFilter();
 
 	MLocatorDBMgr* GetLocatorDBMgr() { return m_pDBMgr; }
 
 	bool GetServerStatus();
 	void GetDBServerStatus(u64 dwEventTime, const bool bIsWithoutDelayUpdate = false);
 	auto GetUpdatedServerStatusTime() { return m_dwLastServerStatusUpdatedTime; }
-	auto GetLastUDPManagerUpdateTime() { return m_dwLastUDPManagerUpdateTime; }
+	auto GetLastFloodFilterUpdateTime() { return m_dwLastFloodFilterUpdateTime; }
 	auto GetLastLocatorStatusUpdatedTime() { return m_dwLastLocatorStatusUpdatedTime; }
 
-	MUDPManager& GetRecvUDPManager() { return *m_pRecvUDPManager; }
-	MUDPManager& GetSendUDPManager() { return *m_pSendUDPManager; }
-	MUDPManager& GetBlockUDPManager() { return *m_pBlockUDPManager; }
-
-	auto GetRecvCount() const { return m_nRecvCount; }
-	auto GetSendCount() const { return m_nSendCount; }
-	auto GetDuplicatedCount() const { return m_nDuplicatedCount; }
+	u32 GetRecvCount() const { return m_nRecvCount; }
+	u32 GetSendCount() const { return m_nSendCount; }
+	u32 GetThrottledCount() const { return m_nThrottledCount; }
 
 	void ResetRecvCount() { m_nRecvCount = 0; }
 	void ResetSendCount() { m_nSendCount = 0; }
-	void ResetDuplicatedCount() { m_nDuplicatedCount = 0; }
+	void ResetThrottledCount() { m_nThrottledCount = 0; }
 
 	void ReleaseDBMgr();
 	void ReleaseSafeUDP();
 	void ReleaseServerStatusMgr();
 	void ReleaseServerStatusInfoBlob();
-	void ReleaseUDPManager();
+	void ReleaseFloodFilter();
 	void ReleaseCommand();
 
 	bool IsElapedServerStatusUpdatedTime(u64 dwEventTime);
 	void UpdateLastServerStatusUpdatedTime(u64 dwTime) { m_dwLastServerStatusUpdatedTime = dwTime; }
-	void UpdateLastUDPManagerUpdateTime(u64 dwTime) { m_dwLastUDPManagerUpdateTime = dwTime; }
+	void UpdateLastFloodFilterUpdateTime(u64 dwTime) { m_dwLastFloodFilterUpdateTime = dwTime; }
 	void UpdateLastLocatorStatusUpdatedTime(u64 dwTime) { m_dwLastLocatorStatusUpdatedTime = dwTime; }
 
 	void ParseUDPPacket(char* pData,
@@ -99,21 +109,17 @@ private:
 	void CommandQueueLock() { m_csCommandQueueLock.lock(); }
 	void CommandQueueUnlock() { m_csCommandQueueLock.unlock(); }
 
+	void BuildServerStatusInfoListPacket();
 	void ResponseServerStatusInfoList(u32 dwIP, int nPort);
 	void ResponseBlockCountryCodeIP(u32 dwIP,
 		int nPort,
 		const std::string& strCountryCode,
 		const std::string& strRoutingURL);
 
-	bool IsLiveUDP(const MLocatorUDPInfo* pRecvUDPInfo, u64 dwEventTime);
-	bool IsLiveBlockUDP(const MLocatorUDPInfo* pBlkRecvUDPInfo, u64 dwEventTime);
-	bool IsOverflowedNormalUseCount(const MLocatorUDPInfo* pRecvUDPInfo);
-
 	const int	MakeCmdPacket(char* pOutPacket, const int nMaxSize, MCommand* pCmd);
 	void		SendCommandByUDP(u32 dwIP, int nPort, MCommand* pCmd);
 
-	void UpdateUDPManager(u64 dwEventTime);
-	void FlushRecvQueue(u64 dwEventTime);
+	void UpdateFloodFilter(u64 dwEventTime);
 	void UpdateLocatorStatus(u64 dwEventTime);
 	void UpdateLocatorLog(u64 dwEventTime);
 	void UpdateCountryCodeFilter(u64 dwEventTime);
@@ -138,18 +144,32 @@ private:
 
 	MCriticalSection m_csCommandQueueLock{};
 
-	MUDPManager* m_pRecvUDPManager{};
-	MUDPManager* m_pSendUDPManager{};
-	MUDPManager* m_pBlockUDPManager{};
-	u64 m_dwLastUDPManagerUpdateTime{};
+	// Checked on the socket thread for every packet, swept by Run.
+	MLocatorFloodFilter* m_pFloodFilter{};
+	u64 m_dwLastFloodFilterUpdateTime{};
+	std::atomic<u32> m_nBlockedIPCount{};
 
-	u32 m_nRecvCount{};
-	u32 m_nSendCount{};
-	u32 m_nDuplicatedCount{};
+	std::atomic<u32> m_nRecvCount{};
+	std::atomic<u32> m_nSendCount{};
+	std::atomic<u32> m_nThrottledCount{};
 
 	MLocatorDBMgr*	m_pDBMgr{};
 
 	void*		m_vpServerStatusInfoBlob{};
 	int			m_nLastGetServerStatusCount{};
 	int			m_nServerStatusInfoBlobSize{};
-};
\ No newline at end of file
+
+	// MC_RESPONSE_SERVER_LIST_INFO, encoded once per server status refresh by Run and sent as is
+	// by the socket thread. Swapped with std::atomic_store/atomic_load.
+	struct MServerStatusInfoListPacket
+	{
+		std::unique_ptr<char[]> pData;
+		u32 nSize;
+	};
+	std::shared_ptr<const MServerStatusInfoListPacket> m_pServerStatusInfoListPacket;
+
+	// The match server's status from SetServerStatus.
+	MLocatorSnapshot<MServerStatus> m_ServerStatus;
+
+	MLocatorThread m_Thread;
+};
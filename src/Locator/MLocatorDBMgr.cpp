@@ -135,16 +135,19 @@ bool MLocatorDBMgr::UpdateLocaterStatus( const int nLocatorID,
 										 const DWORD nRecvCount, 
 										 const DWORD nSendCount, 
 										 const DWORD nBlockCount, 
-										 const DWORD nDuplicatedCount )
+										 const DWORD nThrottledCount )
 {
 	if( !CheckOpen() )
 		return false;
 
+	// The last column used to hold the number of repeated requests from an IP whose previous
+	// request was still queued. Requests are no longer queued, so it now holds the number of
+	// requests refused because the IP was already blocked.
 	CString strQuery;
 	try
 	{
 		strQuery.Format( "{CALL spUpdateLocatorStatus (%d, %u, %u, %u, %u)}",
-			nLocatorID, nRecvCount, nSendCount, nBlockCount, nDuplicatedCount );
+			nLocatorID, nRecvCount, nSendCount, nBlockCount, nThrottledCount );
 		GetDB()->ExecuteSQL( strQuery );
 	}
 	catch( CDBException* e )
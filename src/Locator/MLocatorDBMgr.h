@@ -27,7 +27,7 @@ public:
 		const u32 nRecvCount,
 		const u32 nSendCount,
 		const u32 nBlockCount,
-		const u32 nDuplicatedCount);
+		const u32 nThrottledCount);
 
 	bool InsertLocatorLog(const int nLocatorID, const std::map<std::string, u32>& CountryStatistics);
 
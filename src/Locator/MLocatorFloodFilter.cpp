@@ -0,0 +1,168 @@
+#include "stdafx.h"
+#include "MLocatorFloodFilter.h"
+#include "MHash.h"
+#include <algorithm>
+
+MLocatorFloodFilter::MLocatorFloodFilter(u32 nBurst, u32 dwWindow, u32 dwBlockTime, u64 dwStartTime)
+	: m_pSlots{ new std::atomic<u64>[SLOT_COUNT]() }, m_dwStartTime{ dwStartTime }
+{
+	nBurst = (std::max)(nBurst, 1u);
+
+	// Keep every distance we compare within the positive range of an i32.
+	const u64 nMaxTicks = u64(1) << 28;
+
+	m_nEmissionInterval = static_cast<u32>((std::min)(
+		(std::max)(u64(dwWindow) * TICKS_PER_MS / nBurst, u64(1)), nMaxTicks));
+	m_nTolerance = static_cast<u32>((std::min)(u64(nBurst - 1) * m_nEmissionInterval, nMaxTicks));
+	m_nBlockTicks = static_cast<u32>((std::min)(
+		(std::max)(u64(dwBlockTime) * TICKS_PER_MS, u64(1)), nMaxTicks));
+}
+
+std::atomic<u64>* MLocatorFloodFilter::GetGroup(u32 dwIP)
+{
+	const auto nGroup = HashMix64(dwIP) & (SLOT_COUNT / WAYS - 1);
+	return &m_pSlots[nGroup * WAYS];
+}
+
+bool MLocatorFloodFilter::Claim(std::atomic<u64>* pGroup, u32 dwIP, u32 nTAT, u32 nNow)
+{
+	// Prefer an empty slot, then the bucket that's closest to being full again.
+	std::atomic<u64>* pVictim = nullptr;
+	u64 nVictimState = 0;
+	i32 nVictimAhead = 0;
+	for (int i = 0; i < WAYS; ++i)
+	{
+		const auto nState = pGroup[i].load(std::memory_order_relaxed);
+		if (nState == 0)
+		{
+			pVictim = &pGroup[i];
+			nVictimState = 0;
+			break;
+		}
+
+		const auto nAhead = i32(GetTAT(nState) - nNow);
+		if (!pVictim || nAhead < nVictimAhead)
+		{
+			pVictim = &pGroup[i];
+			nVictimState = nState;
+			nVictimAhead = nAhead;
+		}
+	}
+
+	return pVictim->compare_exchange_strong(nVictimState, Pack(dwIP, nTAT),
+		std::memory_order_relaxed);
+}
+
+MLocatorFloodFilter::RESULT MLocatorFloodFilter::Check(u32 dwIP, u64 dwEventTime)
+{
+	if (dwIP == 0)
+		return FLOOD_ALLOW;
+
+	const auto nNow = ToTick(dwEventTime);
+	auto* pGroup = GetGroup(dwIP);
+
+	while (true)
+	{
+		std::atomic<u64>* pSlot = nullptr;
+		u64 nState = 0;
+		for (int i = 0; i < WAYS; ++i)
+		{
+			nState = pGroup[i].load(std::memory_order_relaxed);
+			if (GetIP(nState) == dwIP)
+			{
+				pSlot = &pGroup[i];
+				break;
+			}
+		}
+
+		if (!pSlot)
+		{
+			// Nothing heard from this IP lately, so its bucket is full, minus this request.
+			if (Claim(pGroup, dwIP, nNow + m_nEmissionInterval, nNow))
+				return FLOOD_ALLOW;
+			continue;
+		}
+
+		while (GetIP(nState) == dwIP)
+		{
+			const auto nTAT = GetTAT(nState);
+			const auto nAhead = i32(nTAT - nNow);
+
+			if (nAhead > i32(m_nTolerance + m_nEmissionInterval))
+				return FLOOD_BLOCKED;
+
+			RESULT Result;
+			u32 nNewTAT;
+			if (nAhead > i32(m_nTolerance))
+			{
+				// Push the TAT far enough ahead that every request is refused for the block time.
+				Result = FLOOD_BLOCK_NEW;
+				nNewTAT = nNow + m_nTolerance + m_nEmissionInterval + m_nBlockTicks;
+			}
+			else
+			{
+				Result = FLOOD_ALLOW;
+				nNewTAT = (nAhead < 0 ? nNow : nTAT) + m_nEmissionInterval;
+			}
+
+			if (pSlot->compare_exchange_weak(nState, Pack(dwIP, nNewTAT), std::memory_order_relaxed))
+				return Result;
+		}
+
+		// The slot was handed to another IP under us; look again.
+	}
+}
+
+void MLocatorFloodFilter::Block(u32 dwIP, u64 dwEventTime)
+{
+	if (dwIP == 0)
+		return;
+
+	const auto nNow = ToTick(dwEventTime);
+	const auto nBlockedTAT = nNow + m_nTolerance + m_nEmissionInterval + m_nBlockTicks;
+	auto* pGroup = GetGroup(dwIP);
+
+	while (true)
+	{
+		for (int i = 0; i < WAYS; ++i)
+		{
+			auto nState = pGroup[i].load(std::memory_order_relaxed);
+			while (GetIP(nState) == dwIP)
+			{
+				if (pGroup[i].compare_exchange_weak(nState, Pack(dwIP, nBlockedTAT),
+					std::memory_order_relaxed))
+					return;
+			}
+		}
+
+		if (Claim(pGroup, dwIP, nBlockedTAT, nNow))
+			return;
+	}
+}
+
+u32 MLocatorFloodFilter::Sweep(u64 dwEventTime)
+{
+	const auto nNow = ToTick(dwEventTime);
+	u32 nBlocked = 0;
+
+	for (u32 i = 0; i < SLOT_COUNT; ++i)
+	{
+		auto nState = m_pSlots[i].load(std::memory_order_relaxed);
+		if (nState == 0)
+			continue;
+
+		const auto nAhead = i32(GetTAT(nState) - nNow);
+		if (nAhead <= 0)
+		{
+			// A full bucket is the same as no bucket. If the IP sent something in the meantime
+			// the exchange fails, which is fine.
+			m_pSlots[i].compare_exchange_strong(nState, 0, std::memory_order_relaxed);
+		}
+		else if (nAhead > i32(m_nTolerance + m_nEmissionInterval))
+		{
+			++nBlocked;
+		}
+	}
+
+	return nBlocked;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include <atomic>
+#include <memory>
+
+// Per-IP request rate limiter for the locator's UDP socket.
+//
+// Every IP gets a token bucket that holds nBurst requests and refills at nBurst requests
+// per dwWindow ms. An IP that overflows its bucket is blocked for dwBlockTime ms.
+//
+// Buckets are stored as their "theoretical arrival time" (the GCRA form of a token bucket),
+// so the whole state of an IP fits in one 64-bit word together with the IP, and a check is
+// a single compare-and-swap without any lock. The table has a fixed number of slots and
+// never allocates after construction. An IP can live in any of 8 neighbouring slots; when
+// all of them are in use by other IPs, the bucket closest to being full again is evicted.
+//
+// Sweep must be called every so often (say, once a second) to free the slots of buckets
+// that have refilled completely, and to keep the 32-bit times from wrapping around.
+class MLocatorFloodFilter
+{
+public:
+	enum RESULT
+	{
+		FLOOD_ALLOW,		// Within the IP's rate
+		FLOOD_BLOCK_NEW,	// The IP just overflowed its bucket and is blocked from now on
+		FLOOD_BLOCKED,		// The IP was already blocked
+	};
+
+	MLocatorFloodFilter(u32 nBurst, u32 dwWindow, u32 dwBlockTime, u64 dwStartTime);
+
+	RESULT Check(u32 dwIP, u64 dwEventTime);
+
+	// Blocks dwIP for the block time regardless of its current rate.
+	void Block(u32 dwIP, u64 dwEventTime);
+
+	// Frees the slots of idle IPs, and returns how many IPs are currently blocked.
+	u32 Sweep(u64 dwEventTime);
+
+	u32 GetSlotCount() const { return SLOT_COUNT; }
+
+private:
+	enum
+	{
+		SLOT_COUNT_LOG2	= 16,
+		SLOT_COUNT		= 1 << SLOT_COUNT_LOG2,
+		WAYS			= 8,	// Neighbouring slots an IP may occupy
+		TICKS_PER_MS	= 16,	// Fine enough to express a few thousand requests per second
+	};
+
+	// Slots hold (IP << 32) | TAT, with TAT in ticks since m_dwStartTime. 0 means empty,
+	// which is never a valid state since 0.0.0.0 doesn't send packets.
+	static u64 Pack(u32 dwIP, u32 nTAT) { return (u64(dwIP) << 32) | nTAT; }
+	static u32 GetIP(u64 nState) { return u32(nState >> 32); }
+	static u32 GetTAT(u64 nState) { return u32(nState); }
+
+	u32 ToTick(u64 dwEventTime) const { return u32((dwEventTime - m_dwStartTime) * TICKS_PER_MS); }
+	std::atomic<u64>* GetGroup(u32 dwIP);
+	bool Claim(std::atomic<u64>* pGroup, u32 dwIP, u32 nTAT, u32 nNow);
+
+	std::unique_ptr<std::atomic<u64>[]> m_pSlots;
+	u64 m_dwStartTime;
+	u32 m_nEmissionInterval;	// Ticks for the bucket to regain one request
+	u32 m_nTolerance;			// How far TAT may be ahead of now and still allow a request
+	u32 m_nBlockTicks;
+};
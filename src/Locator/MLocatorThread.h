@@ -0,0 +1,83 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Calls a function on a thread of its own every Interval milliseconds until Stop. The wait
+// between calls is on a condition variable, so Stop only waits for the call in progress, if
+// there is one, and not for the rest of the interval.
+//
+// MLocator runs its status refresh on one of these, so that a slow database never holds up the
+// match server it's embedded in.
+class MLocatorThread
+{
+public:
+	~MLocatorThread() { Stop(); }
+
+	// Returns false if it's already running.
+	bool Start(u32 Interval, std::function<void()> Fn)
+	{
+		if (IsRunning())
+			return false;
+
+		bStopping = false;
+		Thread = std::thread{ [this, Interval, Fn = std::move(Fn)] {
+			std::unique_lock<std::mutex> Lock{ Mutex };
+			while (!bStopping)
+			{
+				Lock.unlock();
+				Fn();
+				Lock.lock();
+
+				Condition.wait_for(Lock, std::chrono::milliseconds(Interval),
+					[&] { return bStopping; });
+			}
+		} };
+		return true;
+	}
+
+	void Stop()
+	{
+		if (!IsRunning())
+			return;
+
+		{
+			std::lock_guard<std::mutex> Lock{ Mutex };
+			bStopping = true;
+		}
+		Condition.notify_one();
+		Thread.join();
+	}
+
+	bool IsRunning() const { return Thread.joinable(); }
+
+private:
+	std::thread Thread;
+	std::mutex Mutex;
+	std::condition_variable Condition;
+	bool bStopping{};
+};
+
+// A value that one thread publishes and another reads whenever it likes, without either of them
+// waiting on the other. Each Set swaps in a new copy with std::atomic_store, and readers keep the
+// copy they got from Get for as long as they hold on to it.
+template <typename T>
+class MLocatorSnapshot
+{
+public:
+	void Set(const T& Value)
+	{
+		std::atomic_store(&Ptr, std::shared_ptr<const T>(std::make_shared<T>(Value)));
+	}
+
+	// Null until the first Set.
+	std::shared_ptr<const T> Get() const { return std::atomic_load(&Ptr); }
+
+private:
+	std::shared_ptr<const T> Ptr;
+};
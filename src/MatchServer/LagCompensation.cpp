@@ -62,6 +62,25 @@ bool LagCompManager::Create()
 			Log("Loaded map %s", Map.szMapName);
 	}
 
+	// The quest sectors aren't in g_MapDesc. They're only needed for the NPC simulation.
+	if (MGetServerConfig()->IsNPCSimulationEnabled())
+	{
+		for (auto& Pair : *MGetMatchServer()->GetQuest()->GetMapCatalogue()->GetSectorMap())
+		{
+			auto* szTitle = Pair.second->szTitle;
+			if (Maps.find(szTitle) != Maps.end())
+				continue;
+
+			char Path[128];
+			sprintf_safe(Path, "maps/%s/%s.rs", szTitle, szTitle);
+			ret = Maps[szTitle].Open(Path, RBspObject::ROpenMode::Runtime, nullptr, nullptr, true);
+			if (!ret)
+				Log("Failed to load quest map %s!", szTitle);
+			else
+				Log("Loaded quest map %s", szTitle);
+		}
+	}
+
 	//for (int AniIdx = 0; AniIdx < ZC_STATE_LOWER_END; AniIdx++)
 	//{
 	//	auto& AniItem = g_AnimationInfoTableLower[AniIdx];
@@ -107,41 +126,12 @@ bool LagCompManager::LoadAnimations(const char* filename, int Index)
 
 	GetPath(filename, Path);
 
-	char *buffer;
-	MZFile mzf;
-
-	if (g_pFileSystem) {
-		if (!mzf.Open(filename, g_pFileSystem)) {
-			if (!mzf.Open(filename))
-			{
-				Log("mzf.Open failed with g_pFileSystem!");
-				return false;
-			}
-		}
-	}
-	else {
-		if (!mzf.Open(filename))
-		{
-			Log("mzf.Open failed without g_pFileSystem!");
-			return false;
-		}
-	}
-
-	buffer = new char[mzf.GetLength() + 1];
-	buffer[mzf.GetLength()] = 0;
-
-	mzf.Read(buffer, mzf.GetLength());
-
-	if (!XmlDoc.LoadFromMemory(buffer))
+	if (!XmlDoc.LoadFromFile(filename, g_pFileSystem) && !XmlDoc.LoadFromFile(filename))
 	{
-		Log("XmlDoc.LoadFromMemory failed!");
+		Log("XmlDoc.LoadFromFile failed for %s!", filename);
 		return false;
 	}
 
-	delete[] buffer;
-
-	mzf.Close();
-
 	//-------->
 
 	DocNode = XmlDoc.GetDocumentElement();
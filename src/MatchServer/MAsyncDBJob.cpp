@@ -5,6 +5,7 @@
 #include "MBlobArray.h"
 #include "MMatchConfig.h"
 #include "MMatchQuestGameLog.h"
+#include "MMatchAntiHack.h"
 
 #include <algorithm>
 using std::max;
@@ -118,23 +119,6 @@ void MAsyncDBJob_GetCharInfo::Run(void* pContext)
 
 
 
-void MAsyncDBJob_UpdateCharClanContPoint::Run(void* pContext)
-{
-	auto* pDBMgr = static_cast<IDatabase*>(pContext);
-
-
-	if (!pDBMgr->UpdateCharClanContPoint(m_nCID, m_nCLID, m_nAddedContPoint))
-	{
-		SetResult(MASYNC_RESULT_FAILED);
-		return;
-	}
-
-
-	SetResult(MASYNC_RESULT_SUCCEED);
-}
-
-
-
 void MAsyncDBJob_GetAccountCharInfo::Run(void* pContext)
 {
 	auto* pDBMgr = static_cast<IDatabase*>(pContext);
@@ -564,3 +548,51 @@ void MAsyncDBJob_ResetAccountBlock::Run( void* pContext )
 
 	SetResult( MASYNC_RESULT_SUCCEED );
 }
+
+
+bool MAsyncDBJob_DeleteCharItems::Input( const u32 nCID, std::vector<u32> vecCIIDList )
+{
+	m_nCID			= nCID;
+	m_vecCIIDList	= std::move(vecCIIDList);
+
+	return true;
+}
+
+
+void MAsyncDBJob_DeleteCharItems::Run( void* pContext )
+{
+	auto* pDBMgr = static_cast<IDatabase*>( pContext );
+
+	for (auto nCIID : m_vecCIIDList)
+	{
+		if( !pDBMgr->DeleteCharItem(m_nCID, nCIID) )
+			m_vecFailedCIIDList.push_back(nCIID);
+	}
+
+	SetResult( m_vecFailedCIIDList.empty() ? MASYNC_RESULT_SUCCEED : MASYNC_RESULT_FAILED );
+}
+
+
+bool MAsyncDBJob_UpdateCharClanContPoints::Input( std::vector<MMatchClanContPointBatch::Entry> vecContPoints )
+{
+	m_vecContPoints = std::move(vecContPoints);
+
+	return true;
+}
+
+
+void MAsyncDBJob_UpdateCharClanContPoints::Run( void* pContext )
+{
+	auto* pDBMgr = static_cast<IDatabase*>( pContext );
+
+	MMatchClanContPointBatch::Write(*pDBMgr, m_vecContPoints, m_vecFailedList);
+
+	SetResult( m_vecFailedList.empty() ? MASYNC_RESULT_SUCCEED : MASYNC_RESULT_FAILED );
+}
+
+void MAsyncDBJob_ReloadClientFileList::Run( void* pContext )
+{
+	m_Result = MMatchAntiHack::InitClientFileList();
+
+	SetResult( m_Result.bLoaded ? MASYNC_RESULT_SUCCEED : MASYNC_RESULT_FAILED );
+}
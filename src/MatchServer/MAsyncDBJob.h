@@ -6,6 +6,8 @@
 #include "MQuestItem.h"
 #include "MMatchGlobal.h"
 #include "IDatabase.h"
+#include "MMatchClanContPointBatch.h"
+#include "MMatchClientFileList.h"
 
 class MCommand;
 class MMatchCharInfo;
@@ -15,7 +17,6 @@ enum MASYNCJOB {
 	MASYNCJOB_GETACCOUNTCHARLIST,
 	MASYNCJOB_GETACCOUNTCHARINFO,
 	MASYNCJOB_GETCHARINFO,
-	MASYNCJOB_UPDATCHARCLANCONTPOINT,
 	MASYNCJOB_FRIENDLIST,
 	MASYNCJOB_GETLOGININFO,
 	MASYNCJOB_CREATECHAR,
@@ -36,6 +37,9 @@ enum MASYNCJOB {
 	MASYNCJOB_PROBABILITYEVENTPERTIME,
 	MASYNCJOB_INSERTBLOCKLOG,
 	MASYNCJOB_RESETACCOUNTBLOCK,
+	MASYNCJOB_DELETECHARITEMS,
+	MASYNCJOB_UPDATECHARCLANCONTPOINTS,
+	MASYNCJOB_RELOADCLIENTFILELIST,
 
 	MASYNCJOB_MAX,
 };
@@ -110,26 +114,6 @@ public:
 	virtual void Run(void* pContext);
 };
 
-class MAsyncDBJob_UpdateCharClanContPoint : public MAsyncJob {
-protected:
-	int					m_nCID;
-	int					m_nCLID;
-	int					m_nAddedContPoint;
-public:
-	MAsyncDBJob_UpdateCharClanContPoint(int nCID, int nCLID, int nAddedContPoint)
-		: MAsyncJob(MASYNCJOB_UPDATCHARCLANCONTPOINT)
-	{
-		m_nCID = nCID;
-		m_nCLID = nCLID;
-		m_nAddedContPoint = nAddedContPoint;
-	}
-	virtual ~MAsyncDBJob_UpdateCharClanContPoint()	{}
-
-	virtual void Run(void* pContext);
-
-};
-
-
 class MAsyncDBJob_GetAccountCharInfo : public MAsyncJob {
 protected:
 	MUID			m_uid;
@@ -436,4 +420,67 @@ private :
 	u32	m_dwAID;
 	u8	m_btBlockType;
 };
-	
\ No newline at end of file
+
+
+// Deletes the rent items of one character that ran out on the same tick, in one go, instead of
+// holding up the main thread with a query per item.
+class MAsyncDBJob_DeleteCharItems : public MAsyncJob
+{
+public :
+	MAsyncDBJob_DeleteCharItems() : MAsyncJob( MASYNCJOB_DELETECHARITEMS )
+	{
+	}
+
+	bool Input( const u32 nCID, std::vector<u32> vecCIIDList );
+
+	virtual void Run( void* pContext );
+
+	u32 GetCID() const { return m_nCID; }
+	const auto& GetFailedCIIDList() const { return m_vecFailedCIIDList; }
+
+private :
+	u32	m_nCID;
+	std::vector<u32> m_vecCIIDList;
+	std::vector<u32> m_vecFailedCIIDList;
+};
+
+
+// Writes the clan contribution points MMatchClanMap has been collecting since the last flush.
+class MAsyncDBJob_UpdateCharClanContPoints : public MAsyncJob
+{
+public :
+	MAsyncDBJob_UpdateCharClanContPoints() : MAsyncJob( MASYNCJOB_UPDATECHARCLANCONTPOINTS )
+	{
+	}
+
+	bool Input( std::vector<MMatchClanContPointBatch::Entry> vecContPoints );
+
+	virtual void Run( void* pContext );
+
+	const auto& GetFailedList() const { return m_vecFailedList; }
+
+private :
+	std::vector<MMatchClanContPointBatch::Entry> m_vecContPoints;
+	std::vector<MMatchClanContPointBatch::Entry> m_vecFailedList;
+};
+
+
+// Reloads filelistcrc.txt on an async proxy thread, so that the server doesn't wait on the disk,
+// and hands the result back to the admin who asked for it. Doesn't use the database.
+class MAsyncDBJob_ReloadClientFileList : public MAsyncJob
+{
+public :
+	MAsyncDBJob_ReloadClientFileList( const MUID& uidAdmin )
+		: MAsyncJob( MASYNCJOB_RELOADCLIENTFILELIST ), m_uidAdmin( uidAdmin )
+	{
+	}
+
+	virtual void Run( void* pContext );
+
+	const MUID& GetAdminUID() const { return m_uidAdmin; }
+	const MClientFileListReloadResult& GetReloadResult() const { return m_Result; }
+
+private :
+	MUID						m_uidAdmin;
+	MClientFileListReloadResult	m_Result;
+};
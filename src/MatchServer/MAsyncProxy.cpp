@@ -146,6 +146,9 @@ void MAsyncProxy::OnRun(IDatabase* Database)
 					ResultQueue.Lock();
 						ResultQueue.AddUnsafe(pJob);
 					ResultQueue.Unlock();
+
+					if (OnJobDone)
+						OnJobDone();
 				}
 
 				if (WaitQueue.GetCount() > 0) {
@@ -114,6 +114,8 @@ protected:
 	MCriticalSection m_csThreads; // Proteger acceso a threads
 	bool m_bDestroyed; // Flag para evitar múltiples llamadas a Destroy()
 
+	std::function<void()> OnJobDone;
+
 	void OnRun(IDatabase* Database);
 
 public:
@@ -129,6 +131,9 @@ public:
 	MAsyncProxy(MAsyncProxy&&) = delete;
 	MAsyncProxy& operator=(MAsyncProxy&&) = delete;
 
+	// Called from the worker threads whenever a job's result is ready. Must be set before Create.
+	void SetJobDoneCallback(std::function<void()> Callback) { OnJobDone = std::move(Callback); }
+
 	bool Create(int ThreadCount);
 	bool Create(int ThreadCount, function_view<IDatabase*()> GetDatabase);
 	void Destroy();
@@ -17,6 +17,7 @@
 #include "MMatchConfig.h"
 #include "MMatchEventFactory.h"
 #include "MMatchLocale.h"
+#include "MServerStatus.h"
 #pragma comment(lib, "comsupp.lib")
 
 #if defined(_DEBUG) && defined(MFC)
@@ -289,8 +290,35 @@ void MBMatchServer::InitLocator()
 		Locator.reset();
 		return;
 	}
-	else
-		Log(LOG_ALL, "Locator created!");
+
+	// The locator runs on its own thread, and only sees what's published here.
+	UpdateLocatorStatus();
+	Locator->Start();
+	Log(LOG_ALL, "Locator created!");
+}
+
+void MBMatchServer::UpdateLocatorStatus()
+{
+	const auto PlayerCount = int(GetObjects()->size());
+	if (PlayerCount == LocatorPlayerCount)
+		return;
+	LocatorPlayerCount = PlayerCount;
+
+	auto& Config = *MGetServerConfig();
+
+	MServerStatus Status;
+	Status.SetID(Config.GetServerID());
+	Status.SetType(4);
+	Status.SetMaxPlayer(Config.GetMaxUser());
+	Status.SetCurPlayer(PlayerCount);
+	Status.SetLastUpdatedTime("right meow");
+	Status.SetIPString("");
+	Status.SetIP(0);
+	Status.SetPort(Config.GetPort());
+	Status.SetServerName(Config.GetServerName());
+	Status.SetOpenState(true);
+	Status.SetLiveStatus(true);
+	Locator->SetServerStatus(Status);
 }
 
 bool MBMatchServer::IsKeeper( const MUID& uidKeeper )
@@ -358,7 +386,7 @@ void MBMatchServer::WriteServerInfoLog()
 void MBMatchServer::OnRun()
 {
 	if (Locator)
-		Locator->Run();
+		UpdateLocatorStatus();
 
 	MMatchServer::OnRun();
 }
@@ -99,7 +99,11 @@ public:
 private:
 	void InitConsoleCommands();
 
+	// Publishes the status the locator hands out, when it's changed.
+	void UpdateLocatorStatus();
+
 	std::unique_ptr<MLocator> Locator;
+	int LocatorPlayerCount = -1;
 
 	struct ConsoleCommand
 	{
@@ -3,6 +3,7 @@
 #include "MMatchConfig.h"
 #include "MMatchItem.h"
 #include "MMatchAntiHack.h"
+#include "MMatchShop.h"
 #include "MMatchEventFactory.h"
 #include "MBMatchServerConfigReloader.h"
 
@@ -44,8 +45,14 @@ bool MBMatchServerHashmapTxtReloadObj::OnReload()
 
 bool MBMatchServerFileListCrcReloadObj::OnReload()
 {
-	MMatchAntiHack::ClearClientFileList();
-	MMatchAntiHack::InitClientFileList();
+	// Swaps the new list in whole, so logins are never checked against an empty one. Waits for
+	// a reload an admin started, if one is running.
+	if( !MMatchAntiHack::InitClientFileList().bLoaded )
+	{
+		mlog( "MBMatchServerFileListCrcReloadObj::OnReload - fail to reload %s\n",
+			GetFileName().c_str() );
+		return false;
+	}
 
 	mlog( "MBMatchServerFileListCrcReloadObj::OnReload - success reload %s\n",
 		GetFileName().c_str() );
@@ -53,6 +60,22 @@ bool MBMatchServerFileListCrcReloadObj::OnReload()
 	return true;
 }
 
+bool MBMatchServerShopXmlReloadObj::OnReload()
+{
+	// Builds a new catalog and swaps it in, so shop lists and purchases that come in meanwhile
+	// still see the old one whole.
+	if( MGetMatchShop()->Create(GetFileName().c_str()) )
+		mlog( "MBMatchServerShopXmlReloadObj::OnReload - success reload %s\n", GetFileName().c_str() );
+	else
+	{
+		mlog( "MBMatchServerShopXmlReloadObj::OnReload - fail to reload %s\n",
+			GetFileName().c_str() );
+		return false;
+	}
+
+	return true;
+}
+
 
 bool MBMatchServerEventXmlReloadObj::OnReload()
 {
@@ -148,6 +171,9 @@ bool MBMatchServerConfigReloader::InitReloadObjMap()
 	if( !InsertReloadMap(string("filelistcrc.txt"), new MBMatchServerFileListCrcReloadObj) )
 		return false;
 
+	if( !InsertReloadMap(string("shop.xml"), new MBMatchServerShopXmlReloadObj) )
+		return false;
+
 	if( !InsertReloadMap(string("event.xml"), new MBMatchServerEventXmlReloadObj) )
 		return false;
 
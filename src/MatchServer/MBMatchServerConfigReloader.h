@@ -96,6 +96,13 @@ private :
 };
 
 
+class MBMatchServerShopXmlReloadObj : public MBMatchServerReloadObj
+{
+private :
+	bool OnReload();
+};
+
+
 class MBMatchServerEventXmlReloadObj : public MBMatchServerReloadObj
 {
 private :
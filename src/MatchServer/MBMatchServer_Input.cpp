@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "MBMatchServer.h"
 #include "MMatchConfig.h"
+#include <algorithm>
 
 static std::string Line;
 static std::vector<std::string> Splits;
@@ -373,6 +374,71 @@ void MBMatchServer::InitConsoleCommands()
 		ResponseMySimpleCharInfo(MUID(*UID));
 	});
 
+	AddConsoleCommand("stats", 0, 1,
+		"Lists the tick phases and command handlers that take the most time.",
+		"stats [0/1]",
+		"With an argument, turns command profiling off or on instead.\n"
+		"Profiling is on from the start if stats_port is set in server.ini.",
+		[&] {
+		auto& Profiler = GetCommandProfiler();
+		if (NumArguments == 1)
+		{
+			Profiler.SetEnabled(atoi(Splits[1].c_str()) != 0);
+			MLog("Set command profiling to %s.\n", Profiler.IsEnabled() ? "true" : "false");
+			return;
+		}
+
+		auto PrintTimes = [&](const char* Name, const MProfileHistogram& Time, const char* Extra) {
+			const auto Count = Time.GetCount();
+			MLog("%-40s %10llu %8llu %8llu %8llu %10llu%s\n", Name,
+				static_cast<unsigned long long>(Count),
+				static_cast<unsigned long long>(Count ? Time.GetSum() / Count : 0),
+				static_cast<unsigned long long>(Time.GetPercentile(0.99)),
+				static_cast<unsigned long long>(Time.GetMax()),
+				static_cast<unsigned long long>(Time.GetSum() / 1000),
+				Extra);
+		};
+		auto PrintHeader = [&](const char* Name) {
+			MLog("%-40s %10s %8s %8s %8s %10s\n", Name,
+				"Count", "Avg(us)", "p99(us)", "Max(us)", "Total(ms)");
+		};
+
+		auto& Ticks = GetTickProfiler();
+		PrintHeader("Phase");
+		PrintTimes("tick", Ticks.GetTickTime(), "");
+		for (int i = 0; i < int(Ticks.GetPhaseCount()); ++i)
+			PrintTimes(Ticks.GetPhaseName(i), Ticks.GetPhaseTime(i), "");
+
+		if (!Profiler.IsEnabled())
+		{
+			MLog("Command profiling is off.\n");
+			return;
+		}
+
+		std::vector<int> IDs;
+		for (int i = 0; i < MAX_COMMANDPROFILER_CMD_COUNT; ++i)
+		{
+			auto* Item = Profiler.GetItem(i);
+			if (Item && Item->HandlerTime.GetCount() != 0)
+				IDs.push_back(i);
+		}
+		auto TotalTime = [&](int ID) { return Profiler.GetItem(ID)->HandlerTime.GetSum(); };
+		const auto NumShown = (std::min)(IDs.size(), size_t(20));
+		std::partial_sort(IDs.begin(), IDs.begin() + NumShown, IDs.end(),
+			[&](int a, int b) { return TotalTime(a) > TotalTime(b); });
+
+		MLog("\n");
+		PrintHeader("Command");
+		for (size_t i = 0; i < NumShown; ++i)
+		{
+			auto* Item = Profiler.GetItem(IDs[i]);
+			char Allocs[64];
+			sprintf_safe(Allocs, ", %.1f allocs",
+				double(Item->AllocCount.Get()) / Item->HandlerTime.GetCount());
+			PrintTimes(Profiler.GetCommandName(IDs[i]), Item->HandlerTime, Allocs);
+		}
+	});
+
 	AddConsoleCommand("quit", 0, 0, "", "", "", [] { exit(0); });
 	AddConsoleCommand("exit", 0, 0, "", "", "", [] { exit(0); });
 }
@@ -2,7 +2,6 @@
 #include "MMatchServer.h"
 
 #include "MLadderMgr.h"
-#include "MLadderPicker.h"
 #include "MMatchGlobal.h"
 #include "MThread.h"
 #include "MSharedCommandTable.h"
@@ -20,6 +19,14 @@ MLadderGroupMap* MLadderMgr::GetWaitGroupContainer(MLADDERTYPE nLadderType)
 	return &m_WaitingMaps[(int)nLadderType];
 }
 
+int MLadderMgr::GetClanPoint(MLadderGroup* pGroup)
+{
+	MMatchClan* pClan = MMatchServer::GetInstance()->GetClanMap()->GetClan(pGroup->GetCLID());
+	if (pClan)
+		return pClan->GetClanInfoEx()->nPoint;
+	return DEFAULT_CLAN_POINT;
+}
+
 MLadderGroup* MLadderMgr::CreateLadderGroup()
 {
 	return new MLadderGroup(MMatchServer::GetInstance()->GetTickTime());
@@ -55,6 +62,15 @@ void MLadderMgr::AddGroup(MLADDERTYPE nLadderType, MLadderGroup* pGroup)
 	pGroupMap->Add(pGroup);
 	m_GroupList.push_back(pGroup);
 
+	MLadderTicket Ticket;
+	Ticket.nGroupID = pGroup->GetID();
+	Ticket.nCLID = pGroup->GetCLID();
+	Ticket.nCharLevel = pGroup->GetCharLevel();
+	Ticket.nContPoint = pGroup->GetContPoint();
+	Ticket.nClanPoint = GetClanPoint(pGroup);
+	Ticket.nTickCount = pGroup->GetTickCount();
+	m_Pickers[nLadderType].AddTicket(Ticket);
+
 	// Ladder  ã ˸(for UI)
 	for (list<MUID>::iterator i=pGroup->GetPlayerListBegin(); i!= pGroup->GetPlayerListEnd(); i++)
 	{
@@ -132,6 +148,7 @@ void MLadderMgr::CancelChallenge(int nGroupID, const char* pszCancelName)
 		MMatchServer::GetInstance()->RouteToListener(pObj, pCmd);
 	}
 	pGroupMap->Remove(pGroup->GetID());
+	m_Pickers[pGroup->GetLadderType()].RemoveTicket(pGroup->GetID());
 	RemoveFromGroupList(pGroup);
 	delete pGroup;
 }
@@ -141,8 +158,7 @@ int MLadderMgr::MakeMatch(MLADDERTYPE nLadderType)
 	MLadderGroupMap* pWaitGroupMap = GetWaitGroupContainer(nLadderType);
 	if (pWaitGroupMap == NULL) return 0;
 
-	MTime time;
-	MLadderPicker	ladderPicker;
+	MLadderPicker& ladderPicker = m_Pickers[nLadderType];
 
 	for (MLadderGroupMap::iterator i=pWaitGroupMap->begin();
 		 i!=pWaitGroupMap->end(); i++) 
@@ -157,29 +173,17 @@ int MLadderMgr::MakeMatch(MLADDERTYPE nLadderType)
 #endif
 */
 
-		//ladderPicker.AddTicket( pGroup, time.MakeNumber(0,pGroup->GetScore()) );
-		
-		int nClanPoint = DEFAULT_CLAN_POINT;
-		MMatchClan* pClan = MMatchServer::GetInstance()->GetClanMap()->GetClan(pGroup->GetCLID());
-		if (pClan)
-		{
-			nClanPoint = pClan->GetClanInfoEx()->nPoint;
-		}
-
-		const int MAX_RANDOM_ARG = 100;
-
-		ladderPicker.AddTicket(pGroup, nClanPoint, pGroup->GetTickCount(), time.MakeNumber(0, MAX_RANDOM_ARG));
+		// Clan points change as the clan plays other matches while this group waits.
+		ladderPicker.UpdateTicket(pGroup->GetID(), GetClanPoint(pGroup), pGroup->GetTickCount());
 	}
 
-	ladderPicker.Shuffle();
+	m_Matches.clear();
+	ladderPicker.PickMatches(m_Stat, m_Matches);
 
 	int nLaunchCount = 0;
-	while(true) {
-		int nGroupA = 0;
-		int nGroupB = 0;
-		if (ladderPicker.PickMatch(&nGroupA, &nGroupB) == false)
-			break;
-		LaunchLadder(nLadderType, nGroupA, nGroupB);
+	for (auto& Match : m_Matches)
+	{
+		LaunchLadder(nLadderType, Match.first, Match.second);
 		nLaunchCount++;
 	}
 	return nLaunchCount;
@@ -249,6 +253,8 @@ void MLadderMgr::LaunchLadder(MLADDERTYPE nLadderType, int nGroupA, int nGroupB)
 
 	pGroupMap->Remove(nGroupA);
 	pGroupMap->Remove(nGroupB);
+	m_Pickers[nLadderType].RemoveTicket(nGroupA);
+	m_Pickers[nLadderType].RemoveTicket(nGroupB);
 
 	RemoveFromGroupList(pGroupA);
 	RemoveFromGroupList(pGroupB);
@@ -262,28 +268,14 @@ void MLadderMgr::LaunchLadder(MLADDERTYPE nLadderType, int nGroupA, int nGroupB)
 	pServer->LadderGameLaunch(pGroupA, pGroupB);
 }
 
-#define MTIME_LADDER_DEFAULT_TICKINTERVAL		10000			// ⺻ƽ 10
+// The wait-time thresholds in MLadderPicker::EvaluateTicket are counted in ticks of this length.
+// The picker no longer compares every pair of groups, so the interval doesn't need to stretch
+// with the number of players online.
+#define MTIME_LADDER_TICKINTERVAL		5000
 
 u32 MLadderMgr::GetTickInterval()
 {
-	u32 nDefaultTickInterval = MTIME_LADDER_DEFAULT_TICKINTERVAL;
-
-	//   ƽð  Ѵ.
-	int nObjSize = (int)MMatchServer::GetInstance()->GetObjects()->size();
-	
-	if (nObjSize < 50)
-	{
-		nDefaultTickInterval = 5000;		// 50̸ 5
-	}
-	else if ((nObjSize>=50) && (nObjSize < 150))
-	{
-		nDefaultTickInterval = 7000;		// 150 ̸ 7
-	}
-	else if ((nObjSize>=150) && (nObjSize < 300))
-	{
-		nDefaultTickInterval = 9000;		// 300 ̸ 9
-	}
-	return nDefaultTickInterval;
+	return MTIME_LADDER_TICKINTERVAL;
 }
 
 
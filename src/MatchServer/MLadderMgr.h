@@ -3,6 +3,7 @@
 #include "MMatchGlobal.h"
 #include "MLadderGroup.h"
 #include "MLadderStatistics.h"
+#include "MLadderPicker.h"
 #include <vector>
 
 class MMatchObject;
@@ -14,6 +15,8 @@ protected:
 	u64		m_nLastTick;
 
 	MLadderGroupMap		m_WaitingMaps[MLADDERTYPE_MAX];
+	MLadderPicker		m_Pickers[MLADDERTYPE_MAX];	// Tickets of the groups in m_WaitingMaps
+	std::vector<std::pair<int, int>>	m_Matches;	// Scratch list for MakeMatch
 	list<MLadderGroup*>	m_GroupList;
 
 	MLadderStatistics	m_Stat;
@@ -22,6 +25,7 @@ protected:
 	void SetLastTick(u64 nTick)	{ m_nLastTick = nTick; }
 
 	inline MLadderGroupMap* GetWaitGroupContainer(MLADDERTYPE nLadderType);
+	int GetClanPoint(MLadderGroup* pGroup);
 
 	void AddGroup(MLADDERTYPE nLadderType, MLadderGroup* pGroup);
 	int MakeMatch(MLADDERTYPE nLadderType);
@@ -3,73 +3,329 @@
 
 #pragma once
 
-#include <list>
-#include <queue>
+#include "GlobalTypes.h"
 #include <algorithm>
-using namespace std;
+#include <cstdlib>
+#include <vector>
+#include <unordered_map>
+#include <utility>
 
+class MLadderStatistics;
 
+struct MLadderTicket
+{
+	int		nGroupID;
+	int		nCLID;
+	int		nCharLevel;		// Average character level of the group
+	int		nContPoint;		// Average clan contribution points of the group
+	int		nClanPoint;
+	int		nTickCount;		// Number of matchmaking ticks the group has waited through
+};
+
+// Pairs up waiting ladder groups of one ladder type.
+//
+// Tickets stay in the picker between ticks; MLadderMgr adds one when a group starts waiting and
+// removes it when the group is matched or cancels. Every PickMatches call files the tickets into
+// a grid of buckets by character level and clan points, the two things EvaluateTicket weighs
+// the most, and then goes through them from the longest waiting down, looking for an opponent
+// in the buckets nearest to the ticket's own first. Among the opponents that pass the rules in
+// EvaluateTicket, it takes the one with the highest total rate, like the old pairwise picker
+// did. The thresholds widen with the number of ticks a group has waited, but a ticket looks at
+// no more than MAX_CANDIDATES opponents, so a tick is O(n log n) in the number of waiting groups
+// instead of O(n^2).
+//
+// StatisticsType only needs the three Get*VictoriesRate functions of MLadderStatistics, so that
+// matchmaking can be simulated without a server.
+template <typename StatisticsType>
+class TLadderPicker {
+public:
+	enum {
+		LEVEL_BUCKET_SIZE		= 4,
+		LEVEL_BUCKET_COUNT		= 25,	// Levels 0 to 99
+		CLANPOINT_BUCKET_SIZE	= 100,
+		CLANPOINT_BUCKET_COUNT	= 40,	// Clan points 0 to 3999
+		BUCKET_COUNT			= LEVEL_BUCKET_COUNT * CLANPOINT_BUCKET_COUNT,
+		MAX_CANDIDATES			= 64,
+		MAX_EVALUATION_TICK		= 5,	// A group that has waited this many ticks is matched with anyone.
+	};
 
-class MLadderTicket {
-private: 
-	int		m_nGroupID;
-	int		m_nScore;
-	int		m_nRandomArg;
+	// Returns false if the group already has a ticket.
+	bool AddTicket(const MLadderTicket& Ticket);
+	bool RemoveTicket(int nGroupID);
+	// Refreshes the parts of a ticket that change while the group waits.
+	void UpdateTicket(int nGroupID, int nClanPoint, int nTickCount);
 
-	// ߰
-	int		m_nCharLevel;		// ĳ  
-	int		m_nClanPoint;		// Ŭ Ʈ
-	int		m_nContPoint;		// Ŭ ⿩ 
+	// Appends the pairs of group IDs that should play each other to poutMatches, and removes
+	// their tickets.
+	void PickMatches(StatisticsType& Stat, std::vector<std::pair<int, int>>& poutMatches);
 
-	int		m_nTickCount;
-public:
-	//  ׼Ǹ  
-	MLadderTicket(int nGroupID, int nScore, int nRandomArg) 
+	size_t GetTicketCount() const	{ return m_Tickets.size(); }
+
+	// Whether A and B are close enough to be matched after waiting nTickCount ticks. poutTotalRate
+	// is set to the weighted historical victory rate of the side with more levels and points.
+	static bool EvaluateTicket(StatisticsType& Stat, const MLadderTicket& A, const MLadderTicket& B,
+		float* poutTotalRate);
+
+private:
+	static int GetLevelBucket(int nCharLevel);
+	static int GetClanPointBucket(int nClanPoint);
+
+	std::vector<MLadderTicket>		m_Tickets;
+	std::unordered_map<int, size_t>	m_TicketIndex;	// Group ID -> index into m_Tickets
+
+	// Scratch space for PickMatches, kept around so that a tick doesn't allocate.
+	std::vector<u32>	m_Bucket;			// Ticket index -> bucket
+	std::vector<u32>	m_BucketStart;		// BUCKET_COUNT + 1 offsets into m_ByBucket
+	std::vector<u32>	m_BucketEnd;		// End of the unmatched tickets of each bucket
+	std::vector<u32>	m_ByBucket;			// Ticket indices, grouped by bucket
+	std::vector<u32>	m_BucketPos;		// Ticket index -> position in m_ByBucket
+	std::vector<u32>	m_ByWait;			// Ticket indices, longest waiting first
+	std::vector<bool>	m_Matched;
+};
+
+using MLadderPicker = TLadderPicker<MLadderStatistics>;
+
+template <typename StatisticsType>
+bool TLadderPicker<StatisticsType>::AddTicket(const MLadderTicket& Ticket)
+{
+	if (!m_TicketIndex.emplace(Ticket.nGroupID, m_Tickets.size()).second)
+		return false;
+
+	m_Tickets.push_back(Ticket);
+	return true;
+}
+
+template <typename StatisticsType>
+bool TLadderPicker<StatisticsType>::RemoveTicket(int nGroupID)
+{
+	auto it = m_TicketIndex.find(nGroupID);
+	if (it == m_TicketIndex.end())
+		return false;
+
+	const auto nIndex = it->second;
+	m_TicketIndex.erase(it);
+
+	if (nIndex != m_Tickets.size() - 1)
 	{
-		m_nGroupID = nGroupID;
-		m_nScore = nScore;
-		m_nRandomArg = nRandomArg;
+		m_Tickets[nIndex] = m_Tickets.back();
+		m_TicketIndex[m_Tickets[nIndex].nGroupID] = nIndex;
+	}
+	m_Tickets.pop_back();
+	return true;
+}
+
+template <typename StatisticsType>
+void TLadderPicker<StatisticsType>::UpdateTicket(int nGroupID, int nClanPoint, int nTickCount)
+{
+	auto it = m_TicketIndex.find(nGroupID);
+	if (it == m_TicketIndex.end())
+		return;
+
+	auto& Ticket = m_Tickets[it->second];
+	Ticket.nClanPoint = nClanPoint;
+	Ticket.nTickCount = nTickCount;
+}
+
+template <typename StatisticsType>
+int TLadderPicker<StatisticsType>::GetLevelBucket(int nCharLevel)
+{
+	return (std::max)(0, (std::min)(nCharLevel / int(LEVEL_BUCKET_SIZE), int(LEVEL_BUCKET_COUNT) - 1));
+}
+
+template <typename StatisticsType>
+int TLadderPicker<StatisticsType>::GetClanPointBucket(int nClanPoint)
+{
+	return (std::max)(0, (std::min)(nClanPoint / int(CLANPOINT_BUCKET_SIZE), int(CLANPOINT_BUCKET_COUNT) - 1));
+}
+
+template <typename StatisticsType>
+bool TLadderPicker<StatisticsType>::EvaluateTicket(StatisticsType& Stat, const MLadderTicket& A,
+	const MLadderTicket& B, float* poutTotalRate)
+{
+	int nLevelDiff = abs(A.nCharLevel - B.nCharLevel);
+	int nClanPointDiff = abs(A.nClanPoint - B.nClanPoint);
+	int nContPointDiff = abs(A.nContPoint - B.nContPoint);
+
+	// The tick count starts at 1 once the group has been through a tick.
+	int nTickCount = (std::min)(A.nTickCount, B.nTickCount) - 1;
+
+	float fLevelRate = Stat.GetLevelVictoriesRate(nLevelDiff);
+	float fClanPointRate = Stat.GetClanPointVictoriesRate(nClanPointDiff);
+	float fContPointRate = Stat.GetContPointVictoriesRate(nContPointDiff);
+
+	float fTotalRate = fLevelRate * 0.6f + fClanPointRate * 0.3f + fContPointRate * 0.1f;
+	*poutTotalRate = fTotalRate;
+
+	if (nTickCount >= MAX_EVALUATION_TICK) return true;
+
+	const float LADDER_EVALUATION_TOTALPOINT_RATE[MAX_EVALUATION_TICK] =
+				{ 0.60f, 0.65f, 0.70f, 0.75f, 0.8f };
+
+	const int	LADDER_EVALUATION_LEVEL_DIFF[MAX_EVALUATION_TICK] =
+				{ 5, 8, 15, 20, 28 };
 
-		m_nCharLevel = 0;
-		m_nClanPoint = 0;
-		m_nContPoint = 0;
+	const int	LADDER_EVALUATION_CLANPOINT_DIFF[MAX_EVALUATION_TICK] =
+				{ 30, 60, 100, 150, 300 };
 
-		m_nTickCount = 0;
+	const int	LADDER_EVALUATION_CONTPOINT_DIFF[MAX_EVALUATION_TICK] =
+				{ 30, 60, 100, 150, 200 };
+
+	nTickCount = (std::max)(0, nTickCount);
+
+	// Close enough in level
+	if (nLevelDiff <= LADDER_EVALUATION_LEVEL_DIFF[nTickCount])
+		return true;
+
+	// Close enough overall
+	if (fTotalRate <= LADDER_EVALUATION_TOTALPOINT_RATE[nTickCount])
+		return true;
+
+	// From the third tick on, close clan points are enough
+	if ((nTickCount >= 2) && (nClanPointDiff <= LADDER_EVALUATION_CLANPOINT_DIFF[nTickCount]))
+		return true;
+
+	// From the fourth tick on, close contribution points are enough
+	if ((nTickCount >= 3) && (nContPointDiff <= LADDER_EVALUATION_CONTPOINT_DIFF[nTickCount]))
+		return true;
+
+	return false;
+}
+
+template <typename StatisticsType>
+void TLadderPicker<StatisticsType>::PickMatches(StatisticsType& Stat,
+	std::vector<std::pair<int, int>>& poutMatches)
+{
+	const auto nCount = m_Tickets.size();
+	if (nCount < 2)
+		return;
+
+	// Counting sort into buckets. The clan points may have changed since the last tick, so the
+	// buckets are redone every time.
+	m_Bucket.resize(nCount);
+	m_BucketStart.assign(BUCKET_COUNT + 1, 0);
+	for (u32 i = 0; i < nCount; i++)
+	{
+		auto& Ticket = m_Tickets[i];
+		m_Bucket[i] = GetLevelBucket(Ticket.nCharLevel) * CLANPOINT_BUCKET_COUNT +
+			GetClanPointBucket(Ticket.nClanPoint);
+		++m_BucketStart[m_Bucket[i] + 1];
 	}
+	for (int i = 0; i < BUCKET_COUNT; i++)
+		m_BucketStart[i + 1] += m_BucketStart[i];
 
-	MLadderTicket(int nGroupID, int nCharLevel, int nContPoint, int nClanPoint, int nTickCount, int nRandomArg)
+	m_ByBucket.resize(nCount);
+	m_BucketPos.resize(nCount);
+	m_BucketEnd.assign(m_BucketStart.begin(), m_BucketStart.end() - 1);
+	for (u32 i = 0; i < nCount; i++)
 	{
-		m_nGroupID = nGroupID;
-		m_nCharLevel = nCharLevel;
-		m_nContPoint = nContPoint;
-		m_nClanPoint = nClanPoint;
-		m_nTickCount = nTickCount;
-
-		m_nScore = 0;
-		m_nRandomArg = nRandomArg;
+		auto& nPos = m_BucketEnd[m_Bucket[i]];
+		m_ByBucket[nPos] = i;
+		m_BucketPos[i] = nPos++;
 	}
-	int GetGroupID()	{ return m_nGroupID; }
-	int GetEvaluation()	{ return m_nScore + m_nRandomArg; }
 
-	int GetCharLevel()	{ return m_nCharLevel; }
-	int GetClanPoint()	{ return m_nClanPoint; }
-	int GetContPoint()	{ return m_nContPoint; }
-	int GetTickCount()	{ return m_nTickCount; }
-};
+	// Matched tickets are swapped out of the live part of their bucket, so that the search
+	// never walks past them.
+	auto RemoveFromBucket = [&](u32 nIndex) {
+		auto& nEnd = m_BucketEnd[m_Bucket[nIndex]];
+		const auto nLast = m_ByBucket[--nEnd];
+		const auto nPos = m_BucketPos[nIndex];
+		m_ByBucket[nPos] = nLast;
+		m_BucketPos[nLast] = nPos;
+		m_ByBucket[nEnd] = nIndex;
+		m_BucketPos[nIndex] = nEnd;
+	};
 
-class MLadderPicker {
-protected:
-	list<MLadderTicket*>		m_LadderMatchList;
+	m_ByWait.resize(nCount);
+	for (u32 i = 0; i < nCount; i++)
+		m_ByWait[i] = i;
+	std::stable_sort(m_ByWait.begin(), m_ByWait.end(), [&](u32 a, u32 b) {
+		return m_Tickets[a].nTickCount > m_Tickets[b].nTickCount;
+	});
 
-	bool Evaluate(MLadderTicket* pTicket, list<MLadderTicket*>::iterator* poutItorMatchedTicket);
-	bool EvaluateTicket(MLadderTicket* pTicketA, MLadderTicket* pTicketB, float* poutTotalRate);
-public:
-	void AddTicket(MLadderGroup* pGroup, int nRandomArg);	//  ׼Ǹ  
-	void AddTicket(MLadderGroup* pGroup, int nClanPoint, int nTickCount, int nRandomArg);
+	m_Matched.assign(nCount, false);
 
-	bool PickMatch(int* pGroupA, int* pGroupB);
-	void Shuffle();
-};
+	const auto nFirstMatch = poutMatches.size();
+	u32 nUnmatched = u32(nCount);
+	for (auto nIndex : m_ByWait)
+	{
+		if (nUnmatched < 2)
+			break;
+		if (m_Matched[nIndex])
+			continue;
+
+		auto& Ticket = m_Tickets[nIndex];
+		const int nLevel = m_Bucket[nIndex] / CLANPOINT_BUCKET_COUNT;
+		const int nClan = m_Bucket[nIndex] % CLANPOINT_BUCKET_COUNT;
+
+		int nBest = -1;
+		float fBestRate = 0;
+		int nExamined = 0;
+
+		auto Examine = [&](int nCurLevel, int nCurClan) {
+			if (nCurLevel < 0 || nCurLevel >= LEVEL_BUCKET_COUNT ||
+				nCurClan < 0 || nCurClan >= CLANPOINT_BUCKET_COUNT)
+				return;
+
+			const auto nCur = nCurLevel * CLANPOINT_BUCKET_COUNT + nCurClan;
+			for (auto j = m_BucketStart[nCur]; j < m_BucketEnd[nCur] && nExamined < MAX_CANDIDATES; j++)
+			{
+				const auto nOther = m_ByBucket[j];
+				if (nOther == nIndex)
+					continue;
+
+				auto& Other = m_Tickets[nOther];
+				// Clan members can't play each other.
+				if (Ticket.nCLID != 0 && Ticket.nCLID == Other.nCLID)
+					continue;
+
+				nExamined++;
+
+				float fRate;
+				if (EvaluateTicket(Stat, Ticket, Other, &fRate) && (nBest < 0 || fRate > fBestRate))
+				{
+					nBest = nOther;
+					fBestRate = fRate;
+				}
+			}
+		};
+
+		// Walk the square rings of buckets around the ticket's own, so that the candidates
+		// closest in level and clan points are looked at first.
+		const int nMaxDist = (std::max)(int(LEVEL_BUCKET_COUNT), int(CLANPOINT_BUCKET_COUNT));
+		for (int nDist = 0; nDist < nMaxDist && nExamined < MAX_CANDIDATES; nDist++)
+		{
+			for (int nCurLevel = nLevel - nDist; nCurLevel <= nLevel + nDist; nCurLevel++)
+			{
+				if (nCurLevel == nLevel - nDist || nCurLevel == nLevel + nDist)
+				{
+					for (int nCurClan = nClan - nDist; nCurClan <= nClan + nDist; nCurClan++)
+						Examine(nCurLevel, nCurClan);
+				}
+				else
+				{
+					Examine(nCurLevel, nClan - nDist);
+					Examine(nCurLevel, nClan + nDist);
+				}
+			}
+		}
+
+		if (nBest < 0)
+			continue;
+
+		m_Matched[nIndex] = true;
+		m_Matched[nBest] = true;
+		nUnmatched -= 2;
+		RemoveFromBucket(nIndex);
+		RemoveFromBucket(nBest);
+		poutMatches.emplace_back(Ticket.nGroupID, m_Tickets[nBest].nGroupID);
+	}
+
+	for (auto i = nFirstMatch; i < poutMatches.size(); i++)
+	{
+		RemoveTicket(poutMatches[i].first);
+		RemoveTicket(poutMatches[i].second);
+	}
+}
 
 
-#endif
\ No newline at end of file
+#endif
@@ -2,35 +2,45 @@
 #include "MMatchConfig.h"
 #include "MMatchAntiHack.h"
 
-std::list<unsigned int>	MMatchAntiHack::m_clientFileListCRC;
+static constexpr char ClientFileListName[] = "filelistcrc.txt";
 
-void MMatchAntiHack::InitClientFileList()
-{
-	FILE* fp = fopen("filelistcrc.txt", "r");
-	if (fp == NULL) return;
+MMatchClientFileList	MMatchAntiHack::m_ClientFileList;
 
-	char str[256];
+void MMatchAntiHack::ClearClientFileList()
+{
+	m_ClientFileList.Clear();
+}
 
-	while (fgets(str, 256, fp) != NULL)
+MClientFileListReloadResult MMatchAntiHack::InitClientFileList()
+{
+	auto Result = m_ClientFileList.Reload(ClientFileListName);
+	if (!Result.bLoaded)
 	{
-		unsigned int crc;
-		sscanf(str, "%u", &crc);
-		m_clientFileListCRC.push_back(crc);
+		mlog("MMatchAntiHack::InitClientFileList - couldn't open %s\n", ClientFileListName);
+		return Result;
 	}
 
-	fclose(fp);
-
-	mlog("Inited client file list (%d)\n", (int)m_clientFileListCRC.size());
+	mlog("Inited client file list (%d, version %u). %d of the %d in the last one were never matched\n",
+		Result.nCount, Result.nVersion, Result.nUnused, Result.nPrevCount);
+	return Result;
 }
 
 bool MMatchAntiHack::CheckClientFileListCRC( unsigned int crc, const MUID& uidUser )
 {
-	bool bFound = m_clientFileListCRC.end() != find(m_clientFileListCRC.begin(),m_clientFileListCRC.end(),crc);
-	return bFound;
+	return m_ClientFileList.Check(crc);
+}
+
+void MMatchAntiHack::GetClientFileListHits(std::vector<MClientFileCRCHits>& Out)
+{
+	m_ClientFileList.GetHits(Out);
 }
 
+size_t MMatchAntiHack::GetFielCRCSize()
+{
+	return m_ClientFileList.GetSize();
+}
 
-size_t MMatchAntiHack::GetFielCRCSize() 
-{ 
-	return m_clientFileListCRC.size(); 
-}
\ No newline at end of file
+u32 MMatchAntiHack::GetClientFileListVersion()
+{
+	return m_ClientFileList.GetVersion();
+}
@@ -1,8 +1,10 @@
 #pragma once
 
 #include "MUID.h"
+#include "GlobalTypes.h"
+#include "MMatchClientFileList.h"
 
-#include <list>
+#include <vector>
 #include <string>
 
 struct MMatchObjectAntiHackInfo {
@@ -12,18 +14,26 @@ struct MMatchObjectAntiHackInfo {
 };
 
 
+// Keeps the list of client file list CRCs that are allowed to log in, read from filelistcrc.txt.
+// See MMatchClientFileList.
 class MMatchAntiHack
 {
 private:
-	static std::list<unsigned int>	m_clientFileListCRC;
+	static MMatchClientFileList		m_ClientFileList;
 
 public:
 	MMatchAntiHack() {}
 	~MMatchAntiHack() {}
 
 	static size_t			GetFielCRCSize();
+	static u32				GetClientFileListVersion();
 
-	static void				ClearClientFileList() { m_clientFileListCRC.clear(); }
-	static void				InitClientFileList();
+	static void				ClearClientFileList();
+	// Reads the list and swaps it in before returning. Safe to call from any thread, see
+	// MAsyncDBJob_ReloadClientFileList for reloading it without waiting on the disk.
+	static MClientFileListReloadResult	InitClientFileList();
+	// Thread safe.
 	static bool				CheckClientFileListCRC(unsigned int crc, const MUID& uidUser);
-};
+	// The current list and how many checks each CRC has matched.
+	static void				GetClientFileListHits(std::vector<MClientFileCRCHits>& Out);
+};
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "MSmartRefreshImpl.h"
 #include "MDebug.h"
 #include "MMatchUtil.h"
+#include "MMatchTransDataType.h"
+#include "MAsyncDBJob.h"
 
 #define MTICK_CLAN_RUN							500
 #define MTICK_CLAN_DBREFRESH_PERIOD_LIMIT		7200000			// (1000*60*120) - 2 hours
@@ -30,6 +32,10 @@ void MMatchClan::Clear()
 	m_Members.clear();
 
 	m_nEmptyPeriod = 0;
+
+	m_pMemberListBlob.reset();
+	m_nMemberListBlobSize = 0;
+	m_nMemberListChecksum = 0;
 }
 
 void MMatchClan::InitClanInfoFromDB()
@@ -78,6 +84,7 @@ void MMatchClan::InitClanInfoEx(const int nLevel, const int nTotalPoint, const i
 void MMatchClan::AddObject(const MUID& uid, MMatchObject* pObj)
 {
 	m_Members.Insert(uid, pObj);
+	m_pMemberListBlob.reset();
 }
 
 void MMatchClan::RemoveObject(const MUID& uid)
@@ -86,6 +93,7 @@ void MMatchClan::RemoveObject(const MUID& uid)
 	if (itor != m_Members.end())
 	{
 		m_Members.erase(itor);
+		m_pMemberListBlob.reset();
 	}
 }
 
@@ -109,6 +117,41 @@ void MMatchClan::SyncPlayerList(MMatchObject* pObj, int nCategory)
 	m_SmartRefresh.SyncClient(pObj->GetRefreshClientClanMemberImplement());
 }
 
+std::shared_ptr<const void> MMatchClan::GetMemberListBlob(int* poutSize)
+{
+	MRefreshCategory* pCategory = m_SmartRefresh.GetCategory(0);
+	const u32 nChecksum = pCategory ? pCategory->GetChecksum() : 0;
+
+	if (!m_pMemberListBlob || (nChecksum != m_nMemberListChecksum))
+	{
+		const int nNodeCount = GetMemberCount();
+		auto pBlob = MMakeBlobArrayPtr(sizeof(MTD_ClanMemberListNode), nNodeCount);
+
+		int nArrayIndex = 0;
+		for (auto itor = GetMemberBegin(); itor != GetMemberEnd(); ++itor)
+		{
+			MMatchObject* pScanObj = itor->second;
+
+			auto* pNode = (MTD_ClanMemberListNode*)MGetBlobArrayElement(pBlob.get(), nArrayIndex++);
+			memset(pNode, 0, sizeof(MTD_ClanMemberListNode));
+
+			if (IsEnabledObject(pScanObj))
+			{
+				CopyClanMemberListNodeForTrans(pNode, pScanObj);
+			}
+
+			if (nArrayIndex >= nNodeCount) break;
+		}
+
+		m_nMemberListBlobSize = MGetBlobArraySize(pBlob.get());
+		m_pMemberListBlob = std::shared_ptr<void>(std::move(pBlob));
+		m_nMemberListChecksum = nChecksum;
+	}
+
+	*poutSize = m_nMemberListBlobSize;
+	return m_pMemberListBlob;
+}
+
 void MMatchClan::InsertMatchedClanID(int nCLID)
 {
 	m_MatchedClanList.push_back(nCLID);
@@ -141,6 +184,8 @@ MMatchClanMap::~MMatchClanMap()
 
 void MMatchClanMap::Destroy()
 {
+	FlushContPoints(true);
+
 	for (iterator itor = begin(); itor != end(); ++itor)
 	{
 		MMatchClan* pClan = (*itor).second;
@@ -164,7 +209,7 @@ void MMatchClanMap::CreateClan(int nCLID, const char* szClanName)
 	pNewClan->Create(nCLID, szClanName);
 
 	insert(value_type(nCLID, pNewClan));
-	m_ClanNameMap.insert(map<std::string, MMatchClan*>::value_type(string(szClanName), pNewClan));
+	m_ClanNameMap.emplace(StringView(pNewClan->GetName()), pNewClan);
 }
 
 void MMatchClanMap::DestroyClan(int nCLID, MMatchClanMap::iterator* pNextItor)
@@ -174,8 +219,8 @@ void MMatchClanMap::DestroyClan(int nCLID, MMatchClanMap::iterator* pNextItor)
 	{
 		MMatchClan* pClan = (*itor).second;
 
-		map<std::string, MMatchClan*>::iterator itorClanNameMap = m_ClanNameMap.find(string(pClan->GetName()));
-		if (itorClanNameMap != m_ClanNameMap.end())
+		auto itorClanNameMap = m_ClanNameMap.find(StringView(pClan->GetName()));
+		if ((itorClanNameMap != m_ClanNameMap.end()) && (itorClanNameMap->second == pClan))
 		{
 			m_ClanNameMap.erase(itorClanNameMap);
 		}
@@ -236,6 +281,9 @@ void MMatchClanMap::Tick(u64 nClock)
 {
 	if (!CheckTick(nClock)) return;
 
+	if (m_ContPoints.IsFlushDue(nClock))
+		FlushContPoints(false);
+
 	// Update Clans
 	for (MMatchClanMap::iterator iClan = begin(); iClan != end();)
 	{
@@ -267,11 +315,41 @@ MMatchClan* MMatchClanMap::GetClan(const int nCLID)
 
 MMatchClan* MMatchClanMap::GetClan(const char* szClanName)
 {
-	map<string, MMatchClan*>::iterator itor = m_ClanNameMap.find(string(szClanName));
+	auto itor = m_ClanNameMap.find(StringView(szClanName));
 	if (itor != m_ClanNameMap.end())
 	{
 		return (*itor).second;
 	}
 
 	return NULL;
-}
\ No newline at end of file
+}
+
+void MMatchClanMap::AddContPoint(int nCID, int nCLID, int nAddedContPoint)
+{
+	m_ContPoints.Add(MMatchServer::GetInstance()->GetGlobalClockCount(), nCID, nCLID, nAddedContPoint);
+}
+
+void MMatchClanMap::FlushContPoints(bool bSync)
+{
+	if (m_ContPoints.IsEmpty()) return;
+
+	std::vector<MMatchClanContPointBatch::Entry> vecContPoints;
+	vecContPoints.reserve(m_ContPoints.GetCount());
+	m_ContPoints.Take(vecContPoints);
+
+	if (bSync)
+	{
+		std::vector<MMatchClanContPointBatch::Entry> vecFailed;
+		MMatchClanContPointBatch::Write(*MMatchServer::GetInstance()->GetDBMgr(), vecContPoints, vecFailed);
+		for (auto& ContPoint : vecFailed)
+		{
+			mlog("DB Query(UpdateCharClanContPoint) Failed (CID %d, CLID %d, %d points)\n",
+				ContPoint.nCID, ContPoint.nCLID, ContPoint.nAddedContPoint);
+		}
+		return;
+	}
+
+	auto* pNewJob = new MAsyncDBJob_UpdateCharClanContPoints;
+	pNewJob->Input(std::move(vecContPoints));
+	MMatchServer::GetInstance()->PostAsyncJob(pNewJob);
+}
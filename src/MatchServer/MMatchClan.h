@@ -3,8 +3,13 @@
 #include "MMatchGlobal.h"
 #include "MUID.h"
 #include "MSmartRefresh.h"
+#include "MHash.h"
+#include "StringView.h"
+#include "MMatchClanContPointBatch.h"
 #include <string>
 #include <list>
+#include <memory>
+#include <unordered_map>
 
 class MMatchObject;
 
@@ -38,6 +43,13 @@ private:
 
 	u32	m_nEmptyPeriod;
 
+	// The online members, encoded as MC_MATCH_CLAN_RESPONSE_MEMBER_LIST sends them. Every member
+	// who has the list open asks for it after every change, so it's built once per change and
+	// shared by all of them instead of once per member.
+	std::shared_ptr<const void>	m_pMemberListBlob;
+	int							m_nMemberListBlobSize;
+	u32							m_nMemberListChecksum;
+
 	void	Clear();
 	void InitClanInfoEx(const int nLevel, const int nTotalPoint, const int nPoint, const int nRanking,
 		                const int nWins, const int nLosses, const int nTotalMemberCount, const char* szMaster,
@@ -53,6 +65,10 @@ public:
 	
 	void Tick(u64 nClock);
 	void SyncPlayerList(MMatchObject* pObj, int nCategory);
+	// Never null. Rebuilt if anyone joined or left since the last call, or if the checksum of the
+	// member list refresh category has changed since, so it can lag behind the members by one
+	// refresh period at most.
+	std::shared_ptr<const void> GetMemberListBlob(int* poutSize);
 	void InitClanInfoFromDB();
 	bool CheckLifePeriod();
 
@@ -85,10 +101,19 @@ class MMatchClanMap : public std::map<int, MMatchClan*>
 {
 private:
 	u64	m_nLastTick;
-	std::map<std::string, MMatchClan*>	m_ClanNameMap;
+	// Case-insensitive, like the DB and every other comparison of clan names. The keys point at
+	// the names the clans hold, so a clan has to be taken out before it's deleted.
+	std::unordered_map<StringView, MMatchClan*, CaseInsensitiveStringHasher, CaseInsensitiveComparer>
+		m_ClanNameMap;
+
+	MMatchClanContPointBatch	m_ContPoints;
+
 	void CreateClan(int nCLID, const char* szClanName);
 	void DestroyClan(int nCLID, MMatchClanMap::iterator* pNextItor);
 	bool CheckTick(u64 nClock);
+	// Writes the pending contribution points through an async job, or right away if bSync is set,
+	// for when the async proxy is about to go away.
+	void FlushContPoints(bool bSync);
 public:
 	MMatchClanMap();
 	virtual ~MMatchClanMap();
@@ -106,4 +131,8 @@ public:
 	void RemoveObject(const MUID& uid, MMatchObject* pObj);
 	MMatchClan* GetClan(const int nCLID);
 	MMatchClan* GetClan(const char* szClanName);
+
+	// Queues contribution points to be written to the DB with the next flush, which happens once
+	// they've waited MMatchClanContPointBatch::FlushPeriod. The ones on the member's MMatchObject should already be updated.
+	void AddContPoint(int nCID, int nCLID, int nAddedContPoint);
 };
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include "MOpenHashMap.h"
+#include <vector>
+
+// Clan contribution points that have been given out but not written to the DB yet, summed per
+// member and clan, so that a member who wins several clan battles between two flushes costs one
+// write instead of one per battle.
+//
+// Points wait here for up to FlushPeriod before they're due, so a crash loses at most that much,
+// along with whatever the async proxy hadn't written yet. The ones on the members' MMatchObjects
+// are already up to date, so nothing in game is off until the next login.
+class MMatchClanContPointBatch
+{
+public:
+	struct Entry
+	{
+		int nCID;
+		int nCLID;
+		int nAddedContPoint;
+	};
+
+	// In milliseconds.
+	static constexpr u64 FlushPeriod = 10000;
+
+	void Add(u64 nClock, int nCID, int nCLID, int nAddedContPoint);
+	// True once the oldest pending points have waited FlushPeriod.
+	bool IsFlushDue(u64 nClock) const { return !Entries.empty() && nClock - nFirstAddClock >= FlushPeriod; }
+	// Appends everything that's pending to Out, in the order each member first got points, and
+	// empties the batch.
+	void Take(std::vector<Entry>& Out);
+
+	bool IsEmpty() const { return Entries.empty(); }
+	size_t GetCount() const { return Entries.size(); }
+
+	// Writes each entry with DB.UpdateCharClanContPoint, and appends the ones that failed to
+	// Failed. DBType is IDatabase, except in the tests.
+	template <typename DBType>
+	static void Write(DBType& DB, const std::vector<Entry>& Entries, std::vector<Entry>& Failed);
+
+private:
+	static u64 GetKey(int nCID, int nCLID) { return (u64(u32(nCID)) << 32) | u32(nCLID); }
+
+	std::vector<Entry> Entries;
+	// From GetKey to the index in Entries.
+	MOpenHashMap<u64, u32> Index;
+	// When the first of the pending points were added.
+	u64 nFirstAddClock = 0;
+};
+
+inline void MMatchClanContPointBatch::Add(u64 nClock, int nCID, int nCLID, int nAddedContPoint)
+{
+	if (Entries.empty())
+		nFirstAddClock = nClock;
+
+	auto Inserted = Index.insert(GetKey(nCID, nCLID), u32(Entries.size()));
+	if (Inserted.second)
+		Entries.push_back({ nCID, nCLID, nAddedContPoint });
+	else
+		Entries[*Inserted.first].nAddedContPoint += nAddedContPoint;
+}
+
+inline void MMatchClanContPointBatch::Take(std::vector<Entry>& Out)
+{
+	Out.insert(Out.end(), Entries.begin(), Entries.end());
+	Entries.clear();
+	Index.clear();
+}
+
+template <typename DBType>
+void MMatchClanContPointBatch::Write(DBType& DB, const std::vector<Entry>& Entries,
+	std::vector<Entry>& Failed)
+{
+	for (auto& ContPoint : Entries)
+	{
+		if (!DB.UpdateCharClanContPoint(ContPoint.nCID, ContPoint.nCLID, ContPoint.nAddedContPoint))
+			Failed.push_back(ContPoint);
+	}
+}
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include <cstdio>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <mutex>
+
+struct MClientFileCRCHits {
+	u32			CRC;
+	u32			Hits;
+};
+
+struct MClientFileListReloadResult {
+	// False if the file couldn't be read, in which case the current list stays.
+	bool		bLoaded = false;
+	u32			nVersion = 0;
+	int			nCount = 0;
+	// How many of the CRCs in the list that was replaced never matched a check, out of nPrevCount.
+	int			nUnused = 0;
+	int			nPrevCount = 0;
+};
+
+// The CRCs of the client file lists that are allowed to log in.
+//
+// The list is a sorted vector that's built in full before it replaces the old one, with an atomic
+// shared_ptr swap, so it can be reloaded while other threads are checking logins against it. Each
+// version gets a number, and each CRC counts how many checks it matched, carried over from the
+// previous versions, so that the ones no client reports anymore can be found and taken out.
+//
+// Reloads are serialized, whichever thread they come from, so that each one carries the hits
+// over from the one before it and the versions go up in the order the lists were swapped in.
+class MMatchClientFileList
+{
+public:
+	MClientFileListReloadResult Reload(const char* szFileName);
+	void Clear();
+
+	// Thread safe.
+	bool Check(u32 crc);
+	// The current list and how many checks each CRC has matched.
+	void GetHits(std::vector<MClientFileCRCHits>& Out);
+	size_t GetSize() { return std::atomic_load(&m_pList)->CRCs.size(); }
+	u32 GetVersion() { return std::atomic_load(&m_pList)->Version; }
+
+private:
+	struct MList {
+		u32								Version = 0;
+		std::vector<u32>				CRCs;
+		// Parallel to CRCs.
+		std::unique_ptr<std::atomic<u32>[]>	Hits;
+	};
+
+	static std::shared_ptr<MList> Load(const char* szFileName);
+
+	std::shared_ptr<const MList>	m_pList = std::make_shared<MList>();
+	// Only touched with m_ReloadMutex held.
+	u32								m_nNextVersion = 1;
+	std::mutex						m_ReloadMutex;
+};
+
+inline std::shared_ptr<MMatchClientFileList::MList> MMatchClientFileList::Load(const char* szFileName)
+{
+	FILE* fp = fopen(szFileName, "r");
+	if (fp == NULL) return nullptr;
+
+	auto pList = std::make_shared<MList>();
+
+	char str[256];
+
+	while (fgets(str, 256, fp) != NULL)
+	{
+		unsigned int crc;
+		if (sscanf(str, "%u", &crc) == 1)
+			pList->CRCs.push_back(crc);
+	}
+
+	fclose(fp);
+
+	auto& CRCs = pList->CRCs;
+	std::sort(CRCs.begin(), CRCs.end());
+	CRCs.erase(std::unique(CRCs.begin(), CRCs.end()), CRCs.end());
+	CRCs.shrink_to_fit();
+
+	pList->Hits = std::make_unique<std::atomic<u32>[]>(CRCs.size());
+
+	return pList;
+}
+
+inline MClientFileListReloadResult MMatchClientFileList::Reload(const char* szFileName)
+{
+	MClientFileListReloadResult Result;
+
+	// Read the file outside the lock, so that a reload waiting on another only waits for the swap.
+	auto pList = Load(szFileName);
+	if (!pList)
+		return Result;
+
+	std::lock_guard<std::mutex> Lock{ m_ReloadMutex };
+
+	auto pOld = std::atomic_load(&m_pList);
+
+	// Carry the hits over for the CRCs that are in both. Checks that land on the old list while
+	// this runs are lost, which doesn't matter for telling used entries from unused ones.
+	size_t j = 0;
+	for (size_t i = 0; i < pOld->CRCs.size(); i++)
+	{
+		auto nHits = pOld->Hits[i].load(std::memory_order_relaxed);
+		if (nHits == 0)
+			Result.nUnused++;
+
+		while (j < pList->CRCs.size() && pList->CRCs[j] < pOld->CRCs[i])
+			j++;
+		if (j < pList->CRCs.size() && pList->CRCs[j] == pOld->CRCs[i])
+			pList->Hits[j].store(nHits, std::memory_order_relaxed);
+	}
+
+	pList->Version = m_nNextVersion++;
+
+	Result.bLoaded = true;
+	Result.nVersion = pList->Version;
+	Result.nCount = static_cast<int>(pList->CRCs.size());
+	Result.nPrevCount = static_cast<int>(pOld->CRCs.size());
+
+	std::atomic_store(&m_pList, std::shared_ptr<const MList>(std::move(pList)));
+	return Result;
+}
+
+inline void MMatchClientFileList::Clear()
+{
+	auto pList = std::make_shared<MList>();
+
+	std::lock_guard<std::mutex> Lock{ m_ReloadMutex };
+	pList->Version = m_nNextVersion++;
+	std::atomic_store(&m_pList, std::shared_ptr<const MList>(std::move(pList)));
+}
+
+inline bool MMatchClientFileList::Check(u32 crc)
+{
+	auto pList = std::atomic_load(&m_pList);
+	auto it = std::lower_bound(pList->CRCs.begin(), pList->CRCs.end(), crc);
+	if (it == pList->CRCs.end() || *it != crc)
+		return false;
+
+	pList->Hits[it - pList->CRCs.begin()].fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+inline void MMatchClientFileList::GetHits(std::vector<MClientFileCRCHits>& Out)
+{
+	auto pList = std::atomic_load(&m_pList);
+	Out.clear();
+	Out.reserve(pList->CRCs.size());
+	for (size_t i = 0; i < pList->CRCs.size(); i++)
+		Out.push_back({ pList->CRCs[i], pList->Hits[i].load(std::memory_order_relaxed) });
+}
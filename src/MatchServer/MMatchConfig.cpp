@@ -148,6 +148,13 @@ bool MMatchConfig::Create()
 
 	GameDirectory = ini.GetString("SERVER", "game_dir", "").str();
 	bIsMasterServer = ini.GetInt<bool>("SERVER", "is_master_server", true);
+	StageThreadCount = ini.GetInt("SERVER", "stage_threads", -1);
+	StatsPort = ini.GetInt("SERVER", "stats_port", 0);
+	bNPCSimulation = ini.GetInt<bool>("SERVER", "npc_simulation", false);
+	if (ini.GetInt<bool>("SERVER", "log_drop_on_overflow", false))
+		LogOptions.Overflow = MLogOverflow::Drop;
+	LogOptions.RotateSize = u64((std::max)(0, ini.GetInt("SERVER", "log_rotate_size_mb", 0))) * 1024 * 1024;
+	LogOptions.RotateDaily = ini.GetInt<bool>("SERVER", "log_rotate_daily", false);
 
 	if (!SetEnum(ini, DBType, "DB", "database_type"))
 		return false;
@@ -8,6 +8,7 @@
 #include "MMatchGlobal.h"
 #include "IDatabase.h"
 #include "MDatabase.h"
+#include "MLogWriter.h"
 
 bool GetDBConnDetails(const struct IniParser& ini, MDatabase::ConnectionDetails& Output);
 
@@ -57,6 +58,10 @@ private:
 
 	std::string GameDirectory = "";
 	bool bIsMasterServer = true;
+	int StageThreadCount = -1;
+	int StatsPort = 0;
+	bool bNPCSimulation = false;
+	MLogOptions LogOptions;
 	DatabaseType DBType = DatabaseType::SQLite;
 
 	bool				m_bIsComplete;
@@ -117,6 +122,17 @@ public:
 
 	const char* GetGameDirectory() const { return GameDirectory.c_str(); }
 	bool HasGameData() const { return !GameDirectory.empty(); }
+	// Worker threads that simulate stages besides the main thread. Negative means one less than
+	// the number of cores.
+	int GetStageThreadCount() const { return StageThreadCount; }
+	// Port on 127.0.0.1 to serve the command and tick profiles on, or 0 to not profile at all.
+	int GetStatsPort() const { return StatsPort; }
+	// Whether the server moves the melee quest NPCs itself in stages with server-based netcode,
+	// rather than leaving them to a controlling client. Needs game data.
+	bool IsNPCSimulationEnabled() const { return bNPCSimulation; }
+	// How the log file is written: whether lines are dropped when the writer can't keep up, and
+	// when the file is rotated.
+	const MLogOptions& GetLogOptions() const { return LogOptions; }
 
 	bool IsMasterServer() const { return bIsMasterServer; }
 	auto GetPort() const { return 6000; }
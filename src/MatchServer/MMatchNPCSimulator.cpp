@@ -0,0 +1,340 @@
+#include "stdafx.h"
+#include "MMatchNPCSimulator.h"
+#include "MMatchServer.h"
+#include "MMatchStage.h"
+#include "MMatchObject.h"
+#include "MMatchTransDataType.h"
+#include "MSharedCommandTable.h"
+#include "MBlobArray.h"
+#include "RDummyList.h"
+#include "RNavigationMesh.h"
+#include "MMath.h"
+#include "StringView.h"
+#include <algorithm>
+
+using namespace RealSpace2;
+
+// The ZA_ANIM_STATE values the snapshots use.
+enum
+{
+	NPC_ANI_IDLE = 1,
+	NPC_ANI_WALK = 2,
+	NPC_ANI_ATTACK_MELEE = 4,
+};
+
+// Same as the clients use for their own movement in ZModule_Movable and ZGame::GetFloor.
+static float GetCollUpHeight(const MQuestNPCInfo& Info)
+{
+	return (std::max)(120.0f, Info.fCollHeight - Info.fCollRadius * 1.7142857142857143f);
+}
+static constexpr float FloorProbeUp = 120.0f;
+
+static v3 Flattened(const v3& v)
+{
+	v3 Ret{ v.x, v.y, 0 };
+	Normalize(Ret);
+	return Ret;
+}
+
+static float DistanceSq2D(const v3& a, const v3& b)
+{
+	return (a.x - b.x) * (a.x - b.x) + (a.y - b.y) * (a.y - b.y);
+}
+
+static short ToShort(float x)
+{
+	return short((std::max)(-32767.f, (std::min)(32767.f, x)));
+}
+
+void MMatchNPCSimulator::Create(MMatchStage* pStage)
+{
+	Stage = pStage;
+}
+
+void MMatchNPCSimulator::Destroy()
+{
+	// The game is over, so there's nobody to hand the NPCs back to.
+	Clear();
+	SetMap(nullptr);
+	Stage = nullptr;
+}
+
+void MMatchNPCSimulator::SetMap(RBspObject* pMap)
+{
+	if (pMap == Map)
+		return;
+
+	// Otherwise the NPCs would stand still on the clients, which only move them while the server
+	// sends snapshots.
+	ReleaseControl();
+	Clear();
+	Map = pMap;
+	LoadSpawnPoints();
+}
+
+bool MMatchNPCSimulator::IsSimulatable(const MQuestNPCInfo& Info)
+{
+	return Info.nNPCAttackTypes == NPC_ATTACK_MELEE && Info.nSkills == 0 && !Info.bFriendly;
+}
+
+void MMatchNPCSimulator::LoadSpawnPoints()
+{
+	for (auto& Points : SpawnPoints)
+		Points.clear();
+
+	if (!Map)
+		return;
+
+	// Named and ordered the same way ZMapSpawnManager reads them.
+	static const char* const Prefixes[MNST_END] = {
+		"spawn_npc_melee", "spawn_npc_range", "spawn_npc_boss" };
+	for (auto& Dummy : *Map->GetDummyList())
+	{
+		for (int i = 0; i < MNST_END; ++i)
+		{
+			if (istarts_with(Dummy.Name, Prefixes[i]))
+			{
+				SpawnPoints[i].push_back(Dummy.Position);
+				break;
+			}
+		}
+	}
+}
+
+bool MMatchNPCSimulator::Add(const MUID& uidNPC, MQUEST_NPC nType, int nSpawnPositionIndex)
+{
+	if (!Map || Map->GetNavigationMesh()->GetNodeCount() == 0)
+		return false;
+
+	auto* pInfo = MMatchServer::GetInstance()->GetQuest()->GetNPCInfo(nType);
+	if (!pInfo || !IsSimulatable(*pInfo))
+		return false;
+
+	auto& Points = SpawnPoints[pInfo->GetSpawnType()];
+	if (Points.empty())
+		return false;
+
+	NPC Npc;
+	Npc.UID = uidNPC;
+	Npc.Info = pInfo;
+	Npc.Position = Points[nSpawnPositionIndex % Points.size()];
+	Npc.Direction = { 1, 0, 0 };
+	Npc.Velocity = { 0, 0, 0 };
+	Npc.AniState = NPC_ANI_IDLE;
+	NPCs.push_back(std::move(Npc));
+	return true;
+}
+
+void MMatchNPCSimulator::Remove(const MUID& uidNPC)
+{
+	auto it = std::find_if(NPCs.begin(), NPCs.end(), [&](auto& Npc) { return Npc.UID == uidNPC; });
+	if (it == NPCs.end())
+		return;
+
+	std::swap(*it, NPCs.back());
+	NPCs.pop_back();
+}
+
+void MMatchNPCSimulator::Clear()
+{
+	NPCs.clear();
+}
+
+void MMatchNPCSimulator::FindPath(NPC& Npc, const v3& Goal, u64 nTime)
+{
+	auto* Nav = Map->GetNavigationMesh();
+	Npc.Path.clear();
+	Npc.PathIndex = 0;
+	if (Nav->BuildNavigationPath(Npc.Position, Goal))
+	{
+		auto& Waypoints = Nav->GetWaypointList();
+		Npc.Path.assign(Waypoints.begin(), Waypoints.end());
+	}
+	// Head straight for it if there's no path, like the clients do.
+	if (Npc.Path.empty())
+		Npc.Path.push_back(Goal);
+
+	// Smarter NPCs look again sooner, with the same times the clients use.
+	auto& AIValue = *MMatchServer::GetInstance()->GetQuest()->GetNPCCatalogue()->GetGlobalAIValue();
+	auto Intelligence = (std::max)(1, (std::min)(int(Npc.Info->nIntelligence), NPC_INTELLIGENCE_STEPS));
+	Npc.NextPathTime = nTime + u64(AIValue.m_fPathFindingUpdateTime[Intelligence - 1] * 1000);
+}
+
+void MMatchNPCSimulator::StartAttack(NPC& Npc, const v3& TargetPos, u64 nTime)
+{
+	auto Dir = Flattened(TargetPos - Npc.Position);
+	if (MagnitudeSq(Dir) > 0)
+		Npc.Direction = Dir;
+	Npc.Velocity = { 0, 0, 0 };
+	Npc.AniState = NPC_ANI_ATTACK_MELEE;
+	Npc.AttackEndTime = nTime + MeleeAttackTime;
+	// Always leave a snapshot between two attacks, so that the clients see the second one start.
+	Npc.NextAttackTime = nTime + (std::max)(u64(Npc.Info->fAttackCoolTime * 1000),
+		MeleeAttackTime + SnapshotInterval);
+
+	// The clients wind the attack up before it hits, like they do for the NPCs they control.
+	auto* pServer = MMatchServer::GetInstance();
+	auto* pCmd = pServer->CreateCommand(MC_QUEST_PEER_NPC_ATTACK_MELEE, MUID(0, 0));
+	pCmd->AddParameter(new MCmdParamUID(Npc.UID));
+	pServer->RouteToBattle(Stage->GetUID(), pCmd);
+}
+
+void MMatchNPCSimulator::Run(u64 nTime)
+{
+	if (!Map || NPCs.empty())
+	{
+		LastRunTime = nTime;
+		return;
+	}
+
+	// A long hitch shouldn't send everything through the walls at once.
+	const auto fDelta = (std::min)((nTime - LastRunTime) / 1000.f, 0.1f);
+	LastRunTime = nTime;
+
+	Targets.clear();
+	for (auto* pObj : Stage->GetObjectList())
+	{
+		if (!pObj->GetEnterBattle() || !pObj->IsAlive())
+			continue;
+		if (IsAdminGrade(pObj) && pObj->CheckPlayerFlags(MTD_PlayerFlags_AdminHide))
+			continue;
+		Targets.push_back({ pObj->GetUID(), pObj->GetPosition() });
+	}
+
+	Movers.clear();
+	Sweeps.clear();
+	for (auto& Npc : NPCs)
+	{
+		auto& Info = *Npc.Info;
+		if (nTime < Npc.AttackEndTime)
+			continue;
+
+		Npc.Velocity = { 0, 0, 0 };
+		Npc.AniState = NPC_ANI_IDLE;
+
+		const Target* pTarget = nullptr;
+		float BestDistSq = FLT_MAX;
+		for (auto& Tar : Targets)
+		{
+			auto DistSq = MagnitudeSq(Tar.Position - Npc.Position);
+			if (DistSq < BestDistSq)
+			{
+				BestDistSq = DistSq;
+				pTarget = &Tar;
+			}
+		}
+		if (!pTarget)
+			continue;
+
+		const auto AttackRange = Info.fAttackRange + Info.fCollRadius;
+		if (BestDistSq <= AttackRange * AttackRange)
+		{
+			if (nTime >= Npc.NextAttackTime)
+				StartAttack(Npc, pTarget->Position, nTime);
+			else
+			{
+				auto Dir = Flattened(pTarget->Position - Npc.Position);
+				if (MagnitudeSq(Dir) > 0)
+					Npc.Direction = Dir;
+			}
+			continue;
+		}
+
+		if (nTime >= Npc.NextPathTime || Npc.PathIndex >= Npc.Path.size())
+			FindPath(Npc, pTarget->Position, nTime);
+
+		const auto Step = Info.fSpeed * fDelta;
+		while (Npc.PathIndex < Npc.Path.size() &&
+			DistanceSq2D(Npc.Path[Npc.PathIndex], Npc.Position) <= Step * Step)
+			++Npc.PathIndex;
+
+		const auto& Waypoint = Npc.PathIndex < Npc.Path.size() ? Npc.Path[Npc.PathIndex] : pTarget->Position;
+		auto Dir = Flattened(Waypoint - Npc.Position);
+		if (MagnitudeSq(Dir) == 0)
+			continue;
+
+		Npc.Direction = Dir;
+		Npc.AniState = NPC_ANI_WALK;
+
+		const v3 Up{ 0, 0, GetCollUpHeight(Info) };
+		Movers.push_back(&Npc);
+		Sweeps.push_back({ Npc.Position + Up, Npc.Position + Up + Dir * Step, Info.fCollRadius, 60 });
+	}
+
+	if (!Movers.empty())
+	{
+		// Everyone's moves are checked against the map in one batch, and then everyone's dropped
+		// onto the floor in another.
+		Results.resize(Movers.size());
+		Map->CheckWalls(Query, Sweeps.data(), Sweeps.size(), Results.data());
+
+		Probes.clear();
+		for (size_t i = 0; i < Movers.size(); ++i)
+		{
+			auto Pos = Results[i] - v3{ 0, 0, GetCollUpHeight(*Movers[i]->Info) };
+			Probes.push_back({ Pos + v3{ 0, 0, FloorProbeUp }, Movers[i]->Info->fCollRadius - 1.1f, 58.f });
+		}
+		Floors.resize(Movers.size());
+		Map->GetFloors(Query, Probes.data(), Probes.size(), Floors.data());
+
+		for (size_t i = 0; i < Movers.size(); ++i)
+		{
+			auto& Npc = *Movers[i];
+			auto NewPos = Probes[i].Origin - v3{ 0, 0, FloorProbeUp };
+			// Nothing under it means it's off the map's collision, so keep it at the height
+			// the path had it at.
+			if (Floors[i].z > Probes[i].Origin.z - 5000)
+				NewPos.z = Floors[i].z;
+
+			if (fDelta > 0)
+				Npc.Velocity = (NewPos - Npc.Position) / fDelta;
+			Npc.Position = NewPos;
+		}
+	}
+
+	if (nTime - LastSnapshotTime >= SnapshotInterval)
+	{
+		LastSnapshotTime = nTime;
+		SendSnapshot();
+	}
+}
+
+void MMatchNPCSimulator::ReleaseControl()
+{
+	if (!Stage || NPCs.empty())
+		return;
+
+	auto Blob = MMakeBlobArrayPtr(sizeof(MUID), int(NPCs.size()));
+	for (size_t i = 0; i < NPCs.size(); ++i)
+		*static_cast<MUID*>(MGetBlobArrayElement(Blob.get(), int(i))) = NPCs[i].UID;
+
+	auto* pServer = MMatchServer::GetInstance();
+	auto* pCmd = pServer->CreateCommand(MC_QUEST_NPC_RELEASE_CONTROL, MUID(0, 0));
+	pCmd->AddParameter(new MCommandParameterBlob(Blob.get(), MGetBlobArraySize(Blob.get())));
+	pServer->RouteToBattle(Stage->GetUID(), pCmd);
+}
+
+void MMatchNPCSimulator::SendSnapshot()
+{
+	auto Blob = MMakeBlobArrayPtr(sizeof(MTD_NPCSnapshot), int(NPCs.size()));
+	for (size_t i = 0; i < NPCs.size(); ++i)
+	{
+		auto& Npc = NPCs[i];
+		auto& Node = *static_cast<MTD_NPCSnapshot*>(MGetBlobArrayElement(Blob.get(), int(i)));
+		Node.uidNPC = Npc.UID;
+		Node.posx = ToShort(Npc.Position.x);
+		Node.posy = ToShort(Npc.Position.y);
+		Node.posz = ToShort(Npc.Position.z);
+		Node.velx = ToShort(Npc.Velocity.x);
+		Node.vely = ToShort(Npc.Velocity.y);
+		Node.velz = ToShort(Npc.Velocity.z);
+		Node.dirx = ToShort(Npc.Direction.x * 32000);
+		Node.diry = ToShort(Npc.Direction.y * 32000);
+		Node.anistate = Npc.AniState;
+	}
+
+	auto* pServer = MMatchServer::GetInstance();
+	auto* pCmd = pServer->CreateCommand(MC_QUEST_NPC_SNAPSHOT, MUID(0, 0));
+	pCmd->AddParameter(new MCommandParameterBlob(Blob.get(), MGetBlobArraySize(Blob.get())));
+	pServer->RouteToBattle(Stage->GetUID(), pCmd);
+}
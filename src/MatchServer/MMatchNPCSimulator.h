@@ -0,0 +1,94 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include "MUID.h"
+#include "MQuestNPC.h"
+#include "RBspObject.h"
+#include <vector>
+
+class MMatchStage;
+
+// Moves quest NPCs on the server, in stages with server-based netcode, so that their controlling
+// client doesn't have to run their AI and relay their movement to everyone else.
+//
+// Only NPCs that do nothing but walk up to players and hit them are simulated, see
+// IsSimulatable. Each one chases the closest living player along the map's navigation mesh,
+// is kept out of walls and on the floor with the map's collision, and attacks when it's in range.
+// Everyone in the battle gets the state of every NPC in one MC_QUEST_NPC_SNAPSHOT command every
+// SnapshotInterval, and an MC_QUEST_PEER_NPC_ATTACK_MELEE command for each attack, as if the NPC
+// were controlled by a peer. The controller still decides when the NPC dies. When the simulation
+// stops with NPCs still alive, MC_QUEST_NPC_RELEASE_CONTROL hands them back to their controllers.
+//
+// The navigation meshes keep the state of the last search in them, so Run must only be called
+// from the main thread.
+class MMatchNPCSimulator
+{
+public:
+	void Create(MMatchStage* pStage);
+	void Destroy();
+
+	// Sets the map the NPCs are on, or nullptr to stop simulating. When it changes, every NPC is
+	// handed back to its controlling client, since they don't carry over from one map to another.
+	void SetMap(RealSpace2::RBspObject* pMap);
+	bool IsActive() const { return Map != nullptr; }
+
+	static bool IsSimulatable(const MQuestNPCInfo& Info);
+
+	// Starts simulating the NPC at the spawn point the clients put it at. Returns false if the
+	// simulation isn't active, the NPC can't be simulated or the map has nowhere to put it.
+	bool Add(const MUID& uidNPC, MQUEST_NPC nType, int nSpawnPositionIndex);
+	void Remove(const MUID& uidNPC);
+	// Forgets every NPC without telling the clients, for when they're gone anyway.
+	void Clear();
+
+	void Run(u64 nTime);
+
+	static constexpr u64 SnapshotInterval = 100;
+	// How long an NPC stands still after it starts an attack.
+	static constexpr u64 MeleeAttackTime = 1000;
+
+private:
+	struct NPC
+	{
+		MUID UID;
+		const MQuestNPCInfo* Info;
+		v3 Position;
+		v3 Direction;
+		v3 Velocity;
+		u8 AniState;
+		// Waypoints to the target, from the last path search.
+		std::vector<v3> Path;
+		size_t PathIndex = 0;
+		u64 NextPathTime = 0;
+		u64 NextAttackTime = 0;
+		u64 AttackEndTime = 0;
+	};
+
+	struct Target
+	{
+		MUID UID;
+		v3 Position;
+	};
+
+	void LoadSpawnPoints();
+	void FindPath(NPC& Npc, const v3& Goal, u64 nTime);
+	void StartAttack(NPC& Npc, const v3& TargetPos, u64 nTime);
+	void SendSnapshot();
+	void ReleaseControl();
+
+	MMatchStage* Stage = nullptr;
+	RealSpace2::RBspObject* Map = nullptr;
+	// The spawn points of the map for each MQuestNPCSpawnType, in the order the clients index them.
+	std::vector<v3> SpawnPoints[MNST_END];
+	std::vector<NPC> NPCs;
+	std::vector<Target> Targets;
+	u64 LastRunTime = 0;
+	u64 LastSnapshotTime = 0;
+
+	std::vector<NPC*> Movers;
+	std::vector<RealSpace2::RWALLSWEEP> Sweeps;
+	std::vector<RealSpace2::RFLOORPROBE> Probes;
+	std::vector<v3> Results;
+	std::vector<v3> Floors;
+	RealSpace2::RCollisionQuery Query;
+};
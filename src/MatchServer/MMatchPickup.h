@@ -0,0 +1,43 @@
+#pragma once
+
+#include "MHashGrid.h"
+#include "MUtil.h"
+#include "RMath.h"
+#include <vector>
+
+// The squared distance from Point to the closest point on the segment from a to b.
+inline float MDistanceSqToSegment(const v3& Point, const v3& a, const v3& b)
+{
+	const auto ab = b - a;
+	const auto LengthSq = RealSpace2::MagnitudeSq(ab);
+	if (LengthSq == 0)
+		return RealSpace2::MagnitudeSq(Point - a);
+
+	const auto t = (std::max)(0.f, (std::min)(1.f, RealSpace2::DotProduct(Point - a, ab) / LengthSq));
+	return RealSpace2::MagnitudeSq(Point - (a + ab * t));
+}
+
+// Where to start the path a player took since the last tick. Anyone who moved further than
+// MaxSweep has respawned or teleported, rather than run past everything in between, so only
+// where they are now counts.
+inline const v3& MGetPickupSweepStart(const v3& Last, const v3& Now, float MaxSweep)
+{
+	return RealSpace2::MagnitudeSq(Now - Last) <= MaxSweep * MaxSweep ? Last : Now;
+}
+
+// Appends to Out the values in Grid that are within Radius of the path from From to To, so that
+// nobody runs through an item between two ticks without picking it up. GetPosition returns a
+// pointer to where a value is, or null if it's gone.
+template <typename T, typename PositionFnType>
+void MFindPickups(const MHashGrid<T>& Grid, const v3& From, const v3& To, float Radius,
+	PositionFnType&& GetPosition, std::vector<T>& Out)
+{
+	Grid.ForEachInBox(
+		(std::min)(From.x, To.x) - Radius, (std::min)(From.y, To.y) - Radius,
+		(std::max)(From.x, To.x) + Radius, (std::max)(From.y, To.y) + Radius,
+		[&](const T& Value) {
+			const v3* Position = GetPosition(Value);
+			if (Position && MDistanceSqToSegment(*Position, From, To) < Radius * Radius)
+				Out.push_back(Value);
+		});
+}
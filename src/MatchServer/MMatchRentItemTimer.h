@@ -0,0 +1,89 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include "MUID.h"
+#include <vector>
+#include <algorithm>
+
+// When the rent items of the players who are online run out, in a min-heap ordered by expiration
+// time, so that the server only looks at the items that are due instead of going through every
+// item of every player.
+//
+// Entries aren't taken out when the item or the player goes away, so whoever pops them has to
+// check that they're still there. Compact throws out the ones that aren't, and should be called
+// whenever NeedsCompaction says so, to keep players who log in and out from piling them up.
+class MMatchRentItemTimer
+{
+public:
+	struct Entry
+	{
+		u64 ExpireTime;
+		MUID uidPlayer;
+		MUID uidItem;
+	};
+
+	void Add(u64 ExpireTime, const MUID& uidPlayer, const MUID& uidItem);
+	// Appends every entry that's due by Now to Out, and takes them out of the heap.
+	void PopDue(u64 Now, std::vector<Entry>& Out);
+
+	// Entries that came due while the player couldn't lose the item, e.g. during a battle. They
+	// wait here until TakeDeferred is called for the player.
+	void Defer(const Entry& Due) { Deferred.push_back(Due); }
+	void TakeDeferred(const MUID& uidPlayer, std::vector<Entry>& Out);
+
+	bool NeedsCompaction() const { return Heap.size() + Deferred.size() > CompactionThreshold; }
+	// Keeps only the entries that IsLive(const Entry&) returns true for.
+	template <typename FnType>
+	void Compact(FnType&& IsLive);
+
+	size_t GetCount() const { return Heap.size() + Deferred.size(); }
+
+private:
+	static bool Later(const Entry& a, const Entry& b) { return a.ExpireTime > b.ExpireTime; }
+
+	std::vector<Entry> Heap;
+	std::vector<Entry> Deferred;
+	size_t CompactionThreshold = 1024;
+};
+
+inline void MMatchRentItemTimer::Add(u64 ExpireTime, const MUID& uidPlayer, const MUID& uidItem)
+{
+	Heap.push_back({ ExpireTime, uidPlayer, uidItem });
+	std::push_heap(Heap.begin(), Heap.end(), Later);
+}
+
+inline void MMatchRentItemTimer::PopDue(u64 Now, std::vector<Entry>& Out)
+{
+	while (!Heap.empty() && Heap.front().ExpireTime <= Now)
+	{
+		std::pop_heap(Heap.begin(), Heap.end(), Later);
+		Out.push_back(Heap.back());
+		Heap.pop_back();
+	}
+}
+
+inline void MMatchRentItemTimer::TakeDeferred(const MUID& uidPlayer, std::vector<Entry>& Out)
+{
+	auto it = std::partition(Deferred.begin(), Deferred.end(),
+		[&](const Entry& Due) { return Due.uidPlayer != uidPlayer; });
+	Out.insert(Out.end(), it, Deferred.end());
+	Deferred.erase(it, Deferred.end());
+}
+
+template <typename FnType>
+void MMatchRentItemTimer::Compact(FnType&& IsLive)
+{
+	auto Filter = [&](std::vector<Entry>& Entries) {
+		size_t Kept = 0;
+		for (auto& Item : Entries)
+			if (IsLive(static_cast<const Entry&>(Item)))
+				Entries[Kept++] = Item;
+		Entries.resize(Kept);
+	};
+	Filter(Heap);
+	Filter(Deferred);
+	std::make_heap(Heap.begin(), Heap.end(), Later);
+
+	// Twice what's live, so that the cost is spread over at least as many adds as it keeps.
+	CompactionThreshold = (std::max)(size_t(1024), GetCount() * 2);
+}
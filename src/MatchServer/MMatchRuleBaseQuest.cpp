@@ -4,6 +4,7 @@
 #include "MBlobArray.h"
 #include "MQuestFormula.h"
 #include "MQuestLevelGenerator.h"
+#include "MMatchConfig.h"
 
 
 const int NPC_ASSIGN_DELAY = 5000;
@@ -28,6 +29,7 @@ void MMatchRuleBaseQuest::OnBegin()
 {
 	m_PlayerManager.Create(m_pStage);
 	m_NPCManager.Create(m_pStage, &m_PlayerManager);
+	m_NPCSimulator.Create(m_pStage);
 m_nFirstPlayerCount = (int)m_pStage->GetObjCount();
 	m_nNPCSpawnCount=0;
 
@@ -39,6 +41,7 @@ m_nFirstPlayerCount = (int)m_pStage->GetObjCount();
 
 void MMatchRuleBaseQuest::OnEnd()
 {
+	m_NPCSimulator.Destroy();
 	m_NPCManager.Destroy();
 	m_PlayerManager.Destroy();
 }
@@ -49,6 +52,9 @@ bool MMatchRuleBaseQuest::OnRun()
 	{
 		SendClientLatencyPing();
 		ReAssignNPC();
+
+		UpdateNPCSimulatorMap();
+		m_NPCSimulator.Run(GetGlobalTimeMS());
 	}
 
 	return MMatchRule::OnRun();
@@ -144,6 +150,8 @@ void MMatchRuleBaseQuest::OnRequestNPCDead(MUID& uidSender, MUID& uidKiller, MUI
 		MQuestDropItem DropItem;
 		if (m_NPCManager.DestroyNPCObject(uidNPC, DropItem))
 		{
+			m_NPCSimulator.Remove(uidNPC);
+
 			MCommand* pNew = MMatchServer::GetInstance()->CreateCommand(MC_QUEST_NPC_DEAD, uidSender);
 			pNew->AddParameter(new MCmdParamUID(uidKiller));
 			pNew->AddParameter(new MCmdParamUID(uidNPC));
@@ -237,6 +245,7 @@ void MMatchRuleBaseQuest::RefreshPlayerStatus()
 void MMatchRuleBaseQuest::ClearAllNPC()
 {
 	m_NPCManager.ClearNPC();
+	m_NPCSimulator.Clear();
 	m_nNPCSpawnCount = 0;
 
 	MCommand* pCmd = MMatchServer::GetInstance()->CreateCommand(MC_QUEST_NPC_ALL_CLEAR, MUID(0,0));
@@ -274,6 +283,10 @@ MMatchNPCObject* MMatchRuleBaseQuest::SpawnNPC(MQUEST_NPC nNPC, int nPosIndex)
 	if (pNPCObject)
 	{
 		m_nNPCSpawnCount++;
+
+		// The clients get the index as a byte too.
+		if (m_NPCSimulator.IsActive())
+			m_NPCSimulator.Add(pNPCObject->GetUID(), nNPC, (unsigned char)nPosIndex);
 	}
 
 	return pNPCObject;
@@ -414,6 +427,22 @@ void MMatchRuleBaseQuest::ReAssignNPC()
 }
 
 
+void MMatchRuleBaseQuest::UpdateNPCSimulatorMap()
+{
+	// The simulation chases players by the positions in their basic info, which the server only
+	// keeps with server-based netcode.
+	RealSpace2::RBspObject* pMap = nullptr;
+	if (MGetServerConfig()->IsNPCSimulationEnabled() &&
+		m_pStage->GetStageSetting()->GetNetcode() == NetcodeType::ServerBased)
+	{
+		const char* szMapName = GetNPCMapName();
+		if (szMapName)
+			pMap = MMatchServer::GetInstance()->LagComp.GetBspObject(szMapName);
+	}
+
+	m_NPCSimulator.SetMap(pMap);
+}
+
 void MMatchRuleBaseQuest::SendClientLatencyPing()
 {
 	auto nowTime = MMatchServer::GetInstance()->GetGlobalClockCount();
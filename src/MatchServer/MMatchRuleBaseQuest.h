@@ -5,6 +5,7 @@
 #include "MMatchNPCObject.h"
 #include "MQuestPlayer.h"
 #include "MMatchQuestRound.h"
+#include "MMatchNPCSimulator.h"
 
 
 class MMatchQuestGameLogInfoManager;
@@ -24,6 +25,8 @@ protected:
 	u64							m_nLastNPCAssignCheckTime;	///<  NPC Ҵ üũ  ð
 	u64							m_nLastPingTime;			///<  Ŭ̾Ʈ   ð
 
+	MMatchNPCSimulator			m_NPCSimulator;				///< Moves the NPCs on the server, if it's enabled
+
 protected:
 	virtual void OnBegin();								///< ü  ۽ ȣ
 	virtual void OnEnd();								///< ü   ȣ
@@ -61,6 +64,10 @@ protected:
 
 	void ReAssignNPC();
 	void SendClientLatencyPing();
+
+	/// The map the NPCs are on, for the NPC simulation.
+	virtual const char* GetNPCMapName() { return m_pStage->GetMapName(); }
+	void UpdateNPCSimulatorMap();
 public:
 	// Ŀǵ ó  Լ
 
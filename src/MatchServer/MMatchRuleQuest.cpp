@@ -194,6 +194,14 @@ bool MMatchRuleQuest::OnRun()
 	return true;
 }
 
+const char* MMatchRuleQuest::GetNPCMapName()
+{
+	if (!m_pQuestLevel || !m_pQuestLevel->GetDynamicInfo()->pCurrSector)
+		return nullptr;
+
+	return m_pQuestLevel->GetDynamicInfo()->pCurrSector->szTitle;
+}
+
 void MMatchRuleQuest::CombatProcess()
 {
 	switch (m_nCombatState)
@@ -99,6 +99,7 @@ protected:
 	MQuestCombatState		m_nCombatState;			///< ͳ  
 
 	virtual void ProcessNPCSpawn();				///< NPC ۾
+	virtual const char* GetNPCMapName();		///< The map of the current sector
 	virtual bool CheckNPCSpawnEnable();			///< NPC   
 	virtual void RouteGameInfo();				///< Ŭ̾Ʈ   ش.
 	virtual void RouteStageGameInfo();			///<   ٲ   ش.
@@ -2,181 +2,6 @@
 #include "MServer.h"
 #include "MMatchSchedule.h"
 
-MMatchDayOfMonth::MMatchDayOfMonth()
-{
-	Init();
-}
-
-MMatchDayOfMonth::~MMatchDayOfMonth()
-{
-}
-
-void MMatchDayOfMonth::Init()
-{
-	m_cDayOfMonth[ 0 ] = 31;
-	
-	struct tm t;
-	MMatchGetLocalTime(&t);
-	if( 0 != (t.tm_year % 4) )
-		m_cDayOfMonth[ 1 ] = 28;
-	else
-		m_cDayOfMonth[ 1 ] = 29;
-
-	m_cDayOfMonth[ 2 ] = 31;
-	m_cDayOfMonth[ 3 ] = 30;
-	m_cDayOfMonth[ 4 ] = 31;
-	m_cDayOfMonth[ 5 ] = 30;
-	m_cDayOfMonth[ 6 ] = 31;
-	m_cDayOfMonth[ 7 ] = 31;
-	m_cDayOfMonth[ 8 ] = 30;
-	m_cDayOfMonth[ 9 ] = 31;
-	m_cDayOfMonth[ 10 ] = 30;
-	m_cDayOfMonth[ 11 ] = 31;
-}
-
-///////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-MMatchScheduleData::MMatchScheduleData(void) : m_cYear( 0 ), m_cMonth( 0 ), m_cDay( 0 ), m_cHour( 0 ), m_cMin( 0 ), 
-	m_pCmd( 0 ), m_nType( -1 ), m_bIsNeedDelete( false ), // ,nID( 0 ),
-	m_cNextYear( 0 ), m_cNextMonth( 0 ), m_cNextDay( 0 ), m_cNextHour( 0 ), m_cNextMin( 0 ), m_nCount( 0 )
-{
-}
-
-MMatchScheduleData::~MMatchScheduleData(void)
-{
-}
-
-void MMatchScheduleData::CorrectTime()
-{
-	struct tm tmLocalTime;
-	MMatchGetLocalTime(&tmLocalTime);
-
-	// д  ð  ʰ ð ū ˻.
-	if( tmLocalTime.tm_sec > m_nErrorTime ) return;
-
-	//  ð  Ŵ.
-	++m_cMin;
-
-	if( 59 < m_cMin ){
-		m_cMin -= 60;
-		++m_cHour;
-	}
-
-	if( 23 < m_cHour ){
-		m_cHour -= 24;
-		++m_cDay;
-	}
-
-	// ̹  ϱ ִ ˾ƿ; ... 
-	if( GetMaxDay() < m_cDay ){
-		m_cDay -= GetMaxDay();
-		m_cYear += 1;
-	}
-	//
-}
-
-// return if same, then 0, less -1, greater 1.
-int	MMatchScheduleData::CompareCurrentTime()
-{
-	struct tm tmLocalTime;
-	MMatchGetLocalTime(&tmLocalTime);
-	
-	if( (tmLocalTime.tm_year - 100) > GetYear() )
-		return -1;
-	else if( (tmLocalTime.tm_year - 100) < GetYear() )
-		return 1;
-
-	if(	(tmLocalTime.tm_mon + 1) > GetMonth() )
-		return -1;
-	else if( (tmLocalTime.tm_mon + 1) < GetMonth() )
-		return 1;
-
-	if(	tmLocalTime.tm_mday > GetDay() )
-		return -1;
-	else if( tmLocalTime.tm_mday < GetDay() )
-		return 1;
-
-	if(	tmLocalTime.tm_hour > GetHour() ) 
-		return -1;
-	else if( tmLocalTime.tm_hour < GetHour() ) 
-		return 1;
-
-	if( tmLocalTime.tm_min > GetMin()	) 
-		return -1;
-	else if( tmLocalTime.tm_min < GetMin() ) 
-		return 1;
-
-	return 0;
-}
-
-bool MMatchScheduleData::SetTimes( const unsigned char cYear,
-								   const unsigned char cMonth, 
-								   const unsigned char cDay, 
-								   const unsigned char cHour, 
-								   const unsigned char cMin )
-{
-	if( 04 > cYear )	return false;
-	if( 12 < cMonth )	return false;
-	if( 31 < cDay )		return false;
-	if( 23 < cHour )	return false;
-	if( 59 < cMin )		return false;
-
-	SetYear( cYear );
-	SetMonth( cMonth );
-	SetDay( cDay );
-	SetHour( cHour );
-	SetMin( cMin );
-
-	return true;
-}
-
-bool MMatchScheduleData::SetNextTimes( const unsigned char cNextYear,
-									   const unsigned char cNextMonth, 
-									   const unsigned char cNextDay, 
-									   const unsigned char cNextHour, 
-									   const unsigned char cNextMin )
-{
-	if( 12 < cNextMonth )	return false;
-	if( 31 < cNextDay )		return false;
-	if( 23 < cNextHour )	return false;
-	if( 59 < cNextMin )		return false;
-
-	SetNextYear( cNextYear );
-	SetNextMonth( cNextMonth );
-	SetNextDay( cNextDay );
-	SetNextHour( cNextHour );
-	SetNextMin( cNextMin );
-
-	return true;
-}
-
-void MMatchScheduleData::ResetTime()
-{
-	m_cMin += m_cNextMin;
-	if( 59 < m_cMin ){
-        m_cMin -= 60;
-		++m_cHour;
-	}
-
-	m_cHour += m_cNextHour;
-	if( 23 < m_cHour ){
-		m_cHour -= 24;
-		++m_cDay;
-	}
-
-	m_cDay += m_cNextDay;
-	if( GetMaxDay() < m_cDay ){
-		m_cDay -= GetMaxDay();
-		++m_cMonth;
-	}
-
-	m_cMonth += m_cNextMonth;
-	if( 12 < m_cMonth ){
-		m_cMonth -= 12;	
-		++m_cYear;
-	}
-}
-
 void MMatchScheduleData::Release()
 {
 	if( 0 != m_pCmd ){
@@ -185,84 +10,10 @@ void MMatchScheduleData::Release()
 	}
 }
 
-/////////////////////////////////////////////////////
-// ð ٽ .
-void MMatchRepeatScheduleImpl::Reset( MMatchScheduleData* pScheduleData )
-{
-	pScheduleData->ResetTime();
-}
-// ð  .
-void MMatchRepeatScheduleImpl::CorrectTime( MMatchScheduleData* pScheduleData )
-{
-	pScheduleData->CorrectTime();
-	//  ص  ð   ִ ̹Ƿ 쿡 .
-	if( 0 > pScheduleData->CompareCurrentTime() ){
-		pScheduleData->SetDeleteState( true );
-		return;
-	}
-
-	struct tm tmLocalTime;
-	MMatchGetLocalTime(&tmLocalTime);
-	pScheduleData->SetTimes( tmLocalTime.tm_year - 100, 
-							 tmLocalTime.tm_mon + 1, 
-							 tmLocalTime.tm_mday, 
-							 tmLocalTime.tm_hour, 
-							 tmLocalTime.tm_min );
-}
-
-// ð ٽ .
-void MMatchCountScheduleImpl::Reset( MMatchScheduleData* pScheduleData )
-{
-	// countŸ  count 0̵Ǹ  Ǿ Ѵ.
-	pScheduleData->DecreaseCount();
-	if( 0 == pScheduleData->GetCount() ) 
-		pScheduleData->SetDeleteState( true );
-
-	pScheduleData->ResetTime();
-}
-// ð  .
-void MMatchCountScheduleImpl::CorrectTime( MMatchScheduleData* pScheduleData )
-{
-	pScheduleData->CorrectTime();
-	//  ص  ð  īƮ ϳ ҽŴ.
-	if( 0 > pScheduleData->CompareCurrentTime() ){
-		pScheduleData->DecreaseCount();
-		if( 0 == pScheduleData->GetCount() )
-			pScheduleData->SetDeleteState( true );
-		return;
-	}
-
-	//  ð .
-	struct tm tmLocalTime;
-	MMatchGetLocalTime(&tmLocalTime);
-	pScheduleData->SetTimes( tmLocalTime.tm_year - 100, 
-							 tmLocalTime.tm_mon + 1, 
-							 tmLocalTime.tm_mday, 
-							 tmLocalTime.tm_hour, 
-							 tmLocalTime.tm_min );
-}
-
-
-void MMatchOnceScheduleImpl::Reset( MMatchScheduleData* pScheduleData )
-{
-	pScheduleData->SetDeleteState( true );
-}
-
-void MMatchOnceScheduleImpl::CorrectTime( MMatchScheduleData* pScheduleData )
-{
-	tm tmLocalTime;
-	MMatchGetLocalTime(&tmLocalTime);
-	pScheduleData->SetTimes( tmLocalTime.tm_year - 100, 
-							 tmLocalTime.tm_mon + 1, 
-							 tmLocalTime.tm_mday, 
-							 tmLocalTime.tm_hour, 
-							 tmLocalTime.tm_min );
-}
-
 /////////////////////////////////////////////////////
 
 MMatchScheduleMgr::MMatchScheduleMgr( MServer* pServer ) : m_pServer( pServer ), m_nIndex( 0 ),
-	m_tmUpdateTerm( 0 )
+	m_tmUpdateTerm( 0 ), m_Timer( MMatchGetScheduleTime() )
 {
 }
 
@@ -273,9 +24,7 @@ MMatchScheduleMgr::~MMatchScheduleMgr()
 //  Ʈ  ð .
 const time_t MMatchScheduleMgr::CalculateElapseUpdateTime()
 {
-	time_t tmCurTime;
-	time( &tmCurTime );
-	return ( tmCurTime - m_tmLastUpdateTime );
+	return ( MMatchGetScheduleTime() - m_tmLastUpdateTime );
 }
 
 bool MMatchScheduleMgr::Init()
@@ -289,7 +38,9 @@ bool MMatchScheduleMgr::Init()
 
 bool MMatchScheduleMgr::IsUpdate()
 {
-	if( CalculateElapseUpdateTime() > m_tmUpdateTerm ) return true;
+	const time_t tmElapsed = CalculateElapseUpdateTime();
+	// Negative if the local time was set back.
+	if( tmElapsed > m_tmUpdateTerm || tmElapsed < 0 ) return true;
 
 	return false;
 }
@@ -320,113 +71,35 @@ bool MMatchScheduleMgr::CheckData( MMatchScheduleData* pScheduleData ) const
 	return true;
 }
 
-// first	: ߱. 2004. 11. 08
-// last		: ߱. 2004. 11. 08
-// ð Ͽ 츸 true ȯ.
-bool MMatchScheduleMgr::CompareTime( MMatchScheduleData* pScheduleData )
-{
-	bool bIsEqual = true;
-
-	const int nCompareResult = pScheduleData->CompareCurrentTime();
-
-	//  ð .
-	if( 0 < nCompareResult )
-		return false;
-	else if( 0 == nCompareResult )
-		return true;
-	else if( 0 > nCompareResult )
-		bIsEqual = false;
-
-	// ð ٸ  .
-	if( !bIsEqual ){
-		pScheduleData->GetImpl()->CorrectTime( pScheduleData );
-
-		bIsEqual = true;
-
-		//  ð  ٽ .
-		if( 0 != pScheduleData->CompareCurrentTime() )
-			bIsEqual = false;
-	}
-	
-	return bIsEqual;
-}
-
 void MMatchScheduleMgr::SetLastUpdateTime()
 {
 	// set start time.
-	time( &m_tmLastUpdateTime );
+	m_tmLastUpdateTime = MMatchGetScheduleTime();
 }
 
-// first	: ߱. 2004. 11. 08
-// last		: ߱. 2004. 11. 08
-//  Ʈ Ʈ .
 void MMatchScheduleMgr::Update()
 {
 	if( !IsUpdate() ) return;
 
-	UpdateStaticSchedule();
-	UpdateDynamicSchedule();
+	m_Timer.Update( MMatchGetScheduleTime(), m_vecStaticSchedule, m_lstDynamicSchedule,
+		[&]( MMatchScheduleData* pScheduleData ){
+			MCommand* pCmd = pScheduleData->GetCommand()->Clone();
+			if( 0 != pCmd ){
+				m_pServer->GetCommandManager()->Post( pCmd );
+			}
+		},
+		[&]( MMatchScheduleData* pScheduleData ){
+			RemoveDynamicSchedule( pScheduleData );
+		} );
 
 	SetLastUpdateTime();
 }
 
-// first	: ߱. 2004. 11. 08
-// last		: ߱. 2004. 11. 08
-//      Ʈ.
-void MMatchScheduleMgr::UpdateStaticSchedule()
-{
-	MCommand* pCmd = 0;
-	ScheduleVecIter it, end;
-
-	end = m_vecStaticSchedule.end();
-	for( it = m_vecStaticSchedule.begin(); it != end; ++it ){
-		//  ðΰ?
-		if( !CompareTime((*it)) ) continue;
-
-		pCmd = (*it)->GetCommand()->Clone();
-		if( 0 != pCmd ){
-			m_pServer->GetCommandManager()->Post( pCmd );
-		}
-
-		// Ȥ  ΰ?
-		//   IsNeedDelete() true ڸ Ʈ  ʾ Ǵ° .
-		if( (*it)->IsNeedDelete() ) continue;
-
-		(*it)->GetImpl()->Reset( (*it) );
-	}
-}
-
-// first	: ߱. 2004. 11. 08
-// last		: ߱. 2004. 11. 08
-//   Ʈ.
-void MMatchScheduleMgr::UpdateDynamicSchedule()
+void MMatchScheduleMgr::RemoveDynamicSchedule( MMatchScheduleData* pScheduleData )
 {
-	MCommand* pCmd = 0;
-	ScheduleLstIter it, end;
-
-	end = m_lstDynamicSchedule.end();
-	for( it = m_lstDynamicSchedule.begin(); it != end; ){
-		if( !CompareTime((*it)) ) {
-			++it;
-			continue;
-		}
-
-		pCmd = (*it)->GetCommand()->Clone();
-		if( 0 != pCmd ){
-			m_pServer->GetCommandManager()->Post( pCmd );
-		}
-
-		(*it)->GetImpl()->Reset( (*it) );
-
-		// ̹  ΰ?
-		if( (*it)->IsNeedDelete() ){
-			delete *it;
-			m_lstDynamicSchedule.erase( it++ );
-			continue;
-		}
-
-		++it;
-	}
+	m_Timer.Cancel( pScheduleData );
+	m_lstDynamicSchedule.erase( pScheduleData->m_itDynamic );
+	MMatchScheduleReleaser()( pScheduleData );
 }
 
 // first	: ߱. 2004. 11. 08
@@ -441,7 +114,9 @@ bool MMatchScheduleMgr::AddDynamicSchedule( MMatchScheduleData* pNewSchedule )
 
 	if( 0 == pNewSchedule->GetImpl() ) return false;
 
-	m_lstDynamicSchedule.push_back( pNewSchedule );
+	pNewSchedule->SetDynamic( true );
+	pNewSchedule->m_itDynamic = m_lstDynamicSchedule.insert( m_lstDynamicSchedule.end(), pNewSchedule );
+	m_Timer.Schedule( pNewSchedule, MMatchGetScheduleTime() );
 
 	return true;
 }
@@ -459,6 +134,7 @@ bool MMatchScheduleMgr::AddStaticSchedule( MMatchScheduleData* pNewSchedule )
 	if( 0 == pNewSchedule->GetImpl() ) return false;
 
 	m_vecStaticSchedule.push_back( pNewSchedule );
+	m_Timer.Schedule( pNewSchedule, MMatchGetScheduleTime() );
 
 	return true;
 }
@@ -571,6 +247,7 @@ MMatchScheduleData* MMatchScheduleMgr::MakeOnceScheduleData( const unsigned char
 //  Ʈ .
 void MMatchScheduleMgr::Release()
 {
+	m_Timer.Clear();
 	ReleaseStaticSchedule();
 	ReleaseDynamicSchedule();
 	m_ScheduleImplPrototype.Release();
@@ -641,26 +318,6 @@ void MMatchScheduleMgr::MMatchScheduleImplPrototype::Release()
 	m_ScheduleImplVec.clear();
 }
 
-//////////////////////////////////////////////////////////////////////
-int MMatchGetLocalTime(tm *ptm)
-{
-	*ptm = *localtime(&unmove(time(0)));
-	return 0;
-}
-
-char GetMaxDay( const int iMonth )
-{
-	return MMatchDayOfMonth::GetInst().GetMaxDay( iMonth );
-}
-
-char GetMaxDay()
-{
-	tm Time;
-	MMatchGetLocalTime(&Time);
-	return GetMaxDay( Time.tm_mon + 1 );
-}
-
-
 bool AddDynamicSchedule( MMatchScheduleMgr* pScheduleMgr, const int nType, MCommand* pCmd, const int nYear, const int nMonth, const int nDay, const int nHour, const int nMin, const int nCount )
 {
 	if( 0 == pScheduleMgr ) return false;
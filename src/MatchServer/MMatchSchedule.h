@@ -2,6 +2,8 @@
 
 #include <vector>
 #include <list>
+#include <ctime>
+#include "MTimerWheel.h"
 
 using std::vector;
 using std::list;
@@ -27,6 +29,8 @@ class MMatchDayOfMonth
 {
 public :
 	MMatchDayOfMonth();
+	// For a year other than the current one, e.g. 2024.
+	explicit MMatchDayOfMonth( const int nYear );
 	~MMatchDayOfMonth();
 
 	static MMatchDayOfMonth& GetInst()
@@ -44,7 +48,7 @@ public :
 		return m_cDayOfMonth[ iMonth - 1 ];
 	}
 private :
-	void Init();
+	void Init( const int nYear );
 
 private :
 	enum MONTH_NUM
@@ -55,7 +59,8 @@ private :
 	char m_cDayOfMonth[ MONTH_NUM::MonthNum ];
 };
 
-class MMatchScheduleData
+// Filed in MMatchScheduleMgr's timer wheel, under the time it's next due.
+class MMatchScheduleData : public MTimerWheelNode
 {
 public:
 	//   1:repeat, 2:Count, 3:Once Ǿ.
@@ -76,6 +81,7 @@ public:
 	inline bool					IsNeedDelete()	{ return m_bIsNeedDelete; }
 	inline MMatchScheduleImpl*	GetImpl()		{ return m_pImpl; }
 	inline int					GetErrorTime()	{ return m_nErrorTime; }
+	inline bool					IsDynamic()		{ return m_bIsDynamic; }
 
 	inline int GetCount() { return m_nCount; }
 
@@ -99,6 +105,7 @@ public:
 	inline void SetImpl( MMatchScheduleImpl* pImpl )	{ m_pImpl = pImpl; }
 	inline void SetDeleteState( const bool bState )		{ m_bIsNeedDelete = bState; }
 	inline void SetErrorTime( const int nErrorTime )	{ m_nErrorTime = nErrorTime; }
+	inline void SetDynamic( const bool bDynamic )		{ m_bIsDynamic = bDynamic; }
 
 	inline void SetCount( const int nStartCount ) { m_nCount = nStartCount; }
 
@@ -132,6 +139,11 @@ public:
 	void Release();
 
 private :
+	friend class MMatchScheduleMgr;
+	// Where it is in MMatchScheduleMgr's list of dynamic schedules, if it's in there.
+	bool					m_bIsDynamic = false;
+	list<MMatchScheduleData*>::iterator	m_itDynamic;
+
 	// int				nID;
 	int					m_nType;			//  Ÿ( REPAT, COUNT, ONCE ).
 	MCommand*			m_pCmd;				//  Ȱȭ Ǿ  .
@@ -216,6 +228,142 @@ typedef list< MMatchScheduleData* >	ScheduleLst;
 typedef ScheduleLst::iterator	ScheduleLstIter;
 
 
+// Keeps MMatchScheduleMgr's schedules in a timer wheel, keyed by the time they're next due in
+// seconds, and runs the ones that are due. It never reads the clock itself: the time comes in
+// with each call, from MMatchGetScheduleTime. MMatchSetScheduleClock can point that at another
+// clock, so that the schedules can be tested without waiting for them.
+class MMatchScheduleTimer
+{
+public :
+	explicit MMatchScheduleTimer( const time_t tmNow ) : m_TimerWheel( static_cast<u64>(tmNow) ) {}
+
+	// The first time at which CompareCurrentTime stops returning 1.
+	static time_t GetDueTime( MMatchScheduleData* pScheduleData )
+	{
+		tm tmDue{};
+		tmDue.tm_year	= pScheduleData->GetYear() + 100;
+		tmDue.tm_mon	= pScheduleData->GetMonth() - 1;
+		tmDue.tm_mday	= pScheduleData->GetDay();
+		tmDue.tm_hour	= pScheduleData->GetHour();
+		tmDue.tm_min	= pScheduleData->GetMin();
+		tmDue.tm_isdst	= -1;
+
+		// CompareCurrentTime compares field by field, so a day or month that's out of range is
+		// due from the start of whatever comes after it, not from wherever mktime would roll it
+		// over to. How long the month is depends on the schedule's year, not the current one.
+		const int nMaxDay = MMatchDayOfMonth( 2000 + pScheduleData->GetYear() )
+			.GetMaxDay( pScheduleData->GetMonth() );
+		if( 0 == pScheduleData->GetMonth() ){
+			tmDue.tm_mon = 0;
+			tmDue.tm_mday = 1;
+			tmDue.tm_hour = tmDue.tm_min = 0;
+		}
+		else if( 0 == pScheduleData->GetDay() ){
+			tmDue.tm_mday = 1;
+			tmDue.tm_hour = tmDue.tm_min = 0;
+		}
+		else if( nMaxDay < pScheduleData->GetDay() ){
+			++tmDue.tm_mon;
+			tmDue.tm_mday = 1;
+			tmDue.tm_hour = tmDue.tm_min = 0;
+		}
+
+		return mktime( &tmDue );
+	}
+
+	void Schedule( MMatchScheduleData* pScheduleData, const time_t tmNow )
+	{
+		// Not due by the time it was supposed to be means the local time jumped, or it's late and
+		// waiting to be corrected. Either way, look again on the next update.
+		const time_t tmDue = GetDueTime( pScheduleData );
+		m_TimerWheel.Schedule( *pScheduleData, static_cast<u64>(tmDue > tmNow ? tmDue : tmNow + 1) );
+	}
+
+	void Cancel( MMatchScheduleData* pScheduleData ) { m_TimerWheel.Cancel( *pScheduleData ); }
+	void Clear() { m_TimerWheel.Clear(); }
+
+	// Handles the schedules that are due at tmNow, and returns how many there were. Run is called
+	// with each one whose time has come, and Remove with each dynamic one that's done, for the
+	// caller to delete. StaticSchedules and DynamicSchedules are all the schedules there are, which
+	// are filed again if the local time was set back.
+	template <typename StaticRange, typename DynamicRange, typename RunFnType, typename RemoveFnType>
+	size_t Update( const time_t tmNow, const StaticRange& StaticSchedules,
+		const DynamicRange& DynamicSchedules, RunFnType&& Run, RemoveFnType&& Remove )
+	{
+		// The local time was set back, so the wheel is ahead of it. File everything again from now.
+		if( static_cast<u64>(tmNow) + 1 < m_TimerWheel.GetNextTick() ){
+			m_TimerWheel.Reset( static_cast<u64>(tmNow) );
+
+			for( auto* pScheduleData : StaticSchedules ){
+				if( !pScheduleData->IsNeedDelete() )
+					Schedule( pScheduleData, tmNow );
+			}
+			for( auto* pScheduleData : DynamicSchedules )
+				Schedule( pScheduleData, tmNow );
+		}
+
+		// Take them all out before handling any, since the ones that are handled can be due again
+		// right away, and they shouldn't run twice in one update.
+		m_DueSchedules.clear();
+		m_TimerWheel.Advance( static_cast<u64>(tmNow), [&]( MTimerWheelNode& Node ) {
+			m_DueSchedules.push_back( static_cast<MMatchScheduleData*>(&Node) );
+		} );
+
+		for( auto* pScheduleData : m_DueSchedules )
+			UpdateSchedule( pScheduleData, tmNow, Run, Remove );
+
+		return m_DueSchedules.size();
+	}
+
+private :
+	// True if it's time to run it. One that's late is corrected first, see CorrectTime.
+	static bool CompareTime( MMatchScheduleData* pScheduleData )
+	{
+		const int nCompareResult = pScheduleData->CompareCurrentTime();
+		if( 0 < nCompareResult )
+			return false;
+		else if( 0 == nCompareResult )
+			return true;
+
+		pScheduleData->GetImpl()->CorrectTime( pScheduleData );
+
+		return 0 == pScheduleData->CompareCurrentTime();
+	}
+
+	template <typename RunFnType, typename RemoveFnType>
+	void UpdateSchedule( MMatchScheduleData* pScheduleData, const time_t tmNow,
+		RunFnType& Run, RemoveFnType& Remove )
+	{
+		// CompareTime is still the one that decides, since it also corrects schedules that are
+		// late. The wheel only saves looking at the ones that can't be due yet.
+		if( !CompareTime(pScheduleData) ){
+			if( !pScheduleData->IsNeedDelete() )
+				Schedule( pScheduleData, tmNow );
+			else if( pScheduleData->IsDynamic() )
+				Remove( pScheduleData );
+			return;
+		}
+
+		Run( pScheduleData );
+
+		// Static schedules that are done stay in the list, but never run again.
+		if( !pScheduleData->IsDynamic() && pScheduleData->IsNeedDelete() ) return;
+
+		pScheduleData->GetImpl()->Reset( pScheduleData );
+
+		if( pScheduleData->IsNeedDelete() ){
+			if( pScheduleData->IsDynamic() )
+				Remove( pScheduleData );
+			return;
+		}
+
+		Schedule( pScheduleData, tmNow );
+	}
+
+	MTimerWheel						m_TimerWheel;
+	vector< MMatchScheduleData* >	m_DueSchedules;
+};
+
 class MMatchScheduleMgr
 {
 public :
@@ -267,13 +415,10 @@ private :
 	const time_t CalculateElapseUpdateTime();
 	//   ˻.
 	bool CheckData( MMatchScheduleData* pScheduleData ) const;
-	// Ʈ Ǿ ϴ ð ˻.
-	bool CompareTime( MMatchScheduleData* pScheduleData );
 	// Ʈ  ˻.
 	bool IsUpdate();
 
-	void UpdateStaticSchedule();
-	void UpdateDynamicSchedule();
+	void RemoveDynamicSchedule( MMatchScheduleData* pScheduleData );
 
 	void SetLastUpdateTime();
 
@@ -325,11 +470,19 @@ private :
 
 	MMatchScheduleImplPrototype	m_ScheduleImplPrototype;
 
+	// Every schedule, keyed by the time it's next due, so that Update only looks at the ones that
+	// are due.
+	MMatchScheduleTimer				m_Timer;
+
 	vector< MMatchScheduleData* >	m_vecStaticSchedule;	// ý  ϵǴ . ýۼ .
 	list< MMatchScheduleData* >		m_lstDynamicSchedule;	// .
 };
 
 int MMatchGetLocalTime(tm *ptm);
+// The current time the schedules go by. time(0), unless a different clock was set, e.g. to test
+// the schedules without waiting for them.
+time_t MMatchGetScheduleTime();
+void MMatchSetScheduleClock( time_t (*pfnClock)() );
 char GetMaxDay( const int iMonth );
 char GetMaxDay();
 bool AddDynamicSchedule( MMatchScheduleMgr* pScheduleMgr, const int nType, MCommand* pCmd, const int nYear, const int nMonth, const int nDay, const int nHour, const int nMin, const int nCount );
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "MMatchSchedule.h"
+#include <ctime>
+
+MMatchDayOfMonth::MMatchDayOfMonth()
+{
+	struct tm t;
+	MMatchGetLocalTime(&t);
+	Init( t.tm_year + 1900 );
+}
+
+MMatchDayOfMonth::MMatchDayOfMonth( const int nYear )
+{
+	Init( nYear );
+}
+
+MMatchDayOfMonth::~MMatchDayOfMonth()
+{
+}
+
+void MMatchDayOfMonth::Init( const int nYear )
+{
+	m_cDayOfMonth[ 0 ] = 31;
+	
+	if( 0 != (nYear % 4) || (0 == (nYear % 100) && 0 != (nYear % 400)) )
+		m_cDayOfMonth[ 1 ] = 28;
+	else
+		m_cDayOfMonth[ 1 ] = 29;
+
+	m_cDayOfMonth[ 2 ] = 31;
+	m_cDayOfMonth[ 3 ] = 30;
+	m_cDayOfMonth[ 4 ] = 31;
+	m_cDayOfMonth[ 5 ] = 30;
+	m_cDayOfMonth[ 6 ] = 31;
+	m_cDayOfMonth[ 7 ] = 31;
+	m_cDayOfMonth[ 8 ] = 30;
+	m_cDayOfMonth[ 9 ] = 31;
+	m_cDayOfMonth[ 10 ] = 30;
+	m_cDayOfMonth[ 11 ] = 31;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+MMatchScheduleData::MMatchScheduleData(void) : m_cYear( 0 ), m_cMonth( 0 ), m_cDay( 0 ), m_cHour( 0 ), m_cMin( 0 ), 
+	m_pCmd( 0 ), m_nType( -1 ), m_bIsNeedDelete( false ), // ,nID( 0 ),
+	m_cNextYear( 0 ), m_cNextMonth( 0 ), m_cNextDay( 0 ), m_cNextHour( 0 ), m_cNextMin( 0 ), m_nCount( 0 )
+{
+}
+
+MMatchScheduleData::~MMatchScheduleData(void)
+{
+}
+
+void MMatchScheduleData::CorrectTime()
+{
+	struct tm tmLocalTime;
+	MMatchGetLocalTime(&tmLocalTime);
+
+	// д  ð  ʰ ð ū ˻.
+	if( tmLocalTime.tm_sec > m_nErrorTime ) return;
+
+	//  ð  Ŵ.
+	++m_cMin;
+
+	if( 59 < m_cMin ){
+		m_cMin -= 60;
+		++m_cHour;
+	}
+
+	if( 23 < m_cHour ){
+		m_cHour -= 24;
+		++m_cDay;
+	}
+
+	// ̹  ϱ ִ ˾ƿ; ... 
+	if( GetMaxDay() < m_cDay ){
+		m_cDay -= GetMaxDay();
+		m_cYear += 1;
+	}
+	//
+}
+
+// return if same, then 0, less -1, greater 1.
+int	MMatchScheduleData::CompareCurrentTime()
+{
+	struct tm tmLocalTime;
+	MMatchGetLocalTime(&tmLocalTime);
+	
+	if( (tmLocalTime.tm_year - 100) > GetYear() )
+		return -1;
+	else if( (tmLocalTime.tm_year - 100) < GetYear() )
+		return 1;
+
+	if(	(tmLocalTime.tm_mon + 1) > GetMonth() )
+		return -1;
+	else if( (tmLocalTime.tm_mon + 1) < GetMonth() )
+		return 1;
+
+	if(	tmLocalTime.tm_mday > GetDay() )
+		return -1;
+	else if( tmLocalTime.tm_mday < GetDay() )
+		return 1;
+
+	if(	tmLocalTime.tm_hour > GetHour() ) 
+		return -1;
+	else if( tmLocalTime.tm_hour < GetHour() ) 
+		return 1;
+
+	if( tmLocalTime.tm_min > GetMin()	) 
+		return -1;
+	else if( tmLocalTime.tm_min < GetMin() ) 
+		return 1;
+
+	return 0;
+}
+
+bool MMatchScheduleData::SetTimes( const unsigned char cYear,
+								   const unsigned char cMonth, 
+								   const unsigned char cDay, 
+								   const unsigned char cHour, 
+								   const unsigned char cMin )
+{
+	if( 04 > cYear )	return false;
+	if( 12 < cMonth )	return false;
+	if( 31 < cDay )		return false;
+	if( 23 < cHour )	return false;
+	if( 59 < cMin )		return false;
+
+	SetYear( cYear );
+	SetMonth( cMonth );
+	SetDay( cDay );
+	SetHour( cHour );
+	SetMin( cMin );
+
+	return true;
+}
+
+bool MMatchScheduleData::SetNextTimes( const unsigned char cNextYear,
+									   const unsigned char cNextMonth, 
+									   const unsigned char cNextDay, 
+									   const unsigned char cNextHour, 
+									   const unsigned char cNextMin )
+{
+	if( 12 < cNextMonth )	return false;
+	if( 31 < cNextDay )		return false;
+	if( 23 < cNextHour )	return false;
+	if( 59 < cNextMin )		return false;
+
+	SetNextYear( cNextYear );
+	SetNextMonth( cNextMonth );
+	SetNextDay( cNextDay );
+	SetNextHour( cNextHour );
+	SetNextMin( cNextMin );
+
+	return true;
+}
+
+void MMatchScheduleData::ResetTime()
+{
+	m_cMin += m_cNextMin;
+	if( 59 < m_cMin ){
+        m_cMin -= 60;
+		++m_cHour;
+	}
+
+	m_cHour += m_cNextHour;
+	if( 23 < m_cHour ){
+		m_cHour -= 24;
+		++m_cDay;
+	}
+
+	m_cDay += m_cNextDay;
+	if( GetMaxDay() < m_cDay ){
+		m_cDay -= GetMaxDay();
+		++m_cMonth;
+	}
+
+	m_cMonth += m_cNextMonth;
+	if( 12 < m_cMonth ){
+		m_cMonth -= 12;	
+		++m_cYear;
+	}
+}
+
+/////////////////////////////////////////////////////
+// ð ٽ .
+void MMatchRepeatScheduleImpl::Reset( MMatchScheduleData* pScheduleData )
+{
+	pScheduleData->ResetTime();
+}
+// ð  .
+void MMatchRepeatScheduleImpl::CorrectTime( MMatchScheduleData* pScheduleData )
+{
+	pScheduleData->CorrectTime();
+	//  ص  ð   ִ ̹Ƿ 쿡 .
+	if( 0 > pScheduleData->CompareCurrentTime() ){
+		pScheduleData->SetDeleteState( true );
+		return;
+	}
+
+	struct tm tmLocalTime;
+	MMatchGetLocalTime(&tmLocalTime);
+	pScheduleData->SetTimes( tmLocalTime.tm_year - 100, 
+							 tmLocalTime.tm_mon + 1, 
+							 tmLocalTime.tm_mday, 
+							 tmLocalTime.tm_hour, 
+							 tmLocalTime.tm_min );
+}
+
+// ð ٽ .
+void MMatchCountScheduleImpl::Reset( MMatchScheduleData* pScheduleData )
+{
+	// countŸ  count 0̵Ǹ  Ǿ Ѵ.
+	pScheduleData->DecreaseCount();
+	if( 0 == pScheduleData->GetCount() ) 
+		pScheduleData->SetDeleteState( true );
+
+	pScheduleData->ResetTime();
+}
+// ð  .
+void MMatchCountScheduleImpl::CorrectTime( MMatchScheduleData* pScheduleData )
+{
+	pScheduleData->CorrectTime();
+	//  ص  ð  īƮ ϳ ҽŴ.
+	if( 0 > pScheduleData->CompareCurrentTime() ){
+		pScheduleData->DecreaseCount();
+		if( 0 == pScheduleData->GetCount() )
+			pScheduleData->SetDeleteState( true );
+		return;
+	}
+
+	//  ð .
+	struct tm tmLocalTime;
+	MMatchGetLocalTime(&tmLocalTime);
+	pScheduleData->SetTimes( tmLocalTime.tm_year - 100, 
+							 tmLocalTime.tm_mon + 1, 
+							 tmLocalTime.tm_mday, 
+							 tmLocalTime.tm_hour, 
+							 tmLocalTime.tm_min );
+}
+
+
+void MMatchOnceScheduleImpl::Reset( MMatchScheduleData* pScheduleData )
+{
+	pScheduleData->SetDeleteState( true );
+}
+
+void MMatchOnceScheduleImpl::CorrectTime( MMatchScheduleData* pScheduleData )
+{
+	tm tmLocalTime;
+	MMatchGetLocalTime(&tmLocalTime);
+	pScheduleData->SetTimes( tmLocalTime.tm_year - 100, 
+							 tmLocalTime.tm_mon + 1, 
+							 tmLocalTime.tm_mday, 
+							 tmLocalTime.tm_hour, 
+							 tmLocalTime.tm_min );
+}
+
+//////////////////////////////////////////////////////////////////////
+static time_t (*ScheduleClock)() = [] { return time(0); };
+
+time_t MMatchGetScheduleTime()
+{
+	return ScheduleClock();
+}
+
+void MMatchSetScheduleClock( time_t (*pfnClock)() )
+{
+	ScheduleClock = pfnClock;
+}
+
+int MMatchGetLocalTime(tm *ptm)
+{
+	const time_t tmNow = MMatchGetScheduleTime();
+	*ptm = *localtime(&tmNow);
+	return 0;
+}
+
+char GetMaxDay( const int iMonth )
+{
+	return MMatchDayOfMonth::GetInst().GetMaxDay( iMonth );
+}
+
+char GetMaxDay()
+{
+	tm Time;
+	MMatchGetLocalTime(&Time);
+	return GetMaxDay( Time.tm_mon + 1 );
+}
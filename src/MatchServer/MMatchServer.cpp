@@ -38,6 +38,7 @@
 #include "MMatchLocale.h"
 #include "MMatchEvent.h"
 #include "MMatchEventManager.h"
+#include "MChattingFilter.h"
 #include "MMatchEventFactory.h"
 #include "HitRegistration.h"
 #include "MUtil.h"
@@ -47,7 +48,10 @@
 #include "MPickInfo.h"
 #include "reinterpret.h"
 #include "GunGame.h"
+#include "MMatchTickDelay.h"
 #include <regex>
+#include <future>
+#include <functional>
 
 #define DEFAULT_REQUEST_UID_SIZE		4200000000
 #define DEFAULT_REQUEST_UID_SPARE_SIZE	10000
@@ -65,6 +69,7 @@
 #define FILENAME_WORLDITEM_DESC			"worlditem.xml"
 #define FILENAME_MONSTERGROUP_DESC		"monstergroup.xml"
 #define FILENAME_CHANNELRULE			"channelrule.xml"
+#define FILENAME_ABUSE					"abuse.txt"
 
 MMatchServer* MMatchServer::m_pInstance = NULL;
 
@@ -248,9 +253,12 @@ IDatabase* MakeDatabaseFromConfig()
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-MMatchServer::MMatchServer() : m_pScheduler(0)
+MMatchServer::MMatchServer() : m_pScheduler(0),
+	TickProfiler{ { "commands", "scheduler", "objects", "stages", "channels", "clans", "ladders",
+		"pings", "cleanup", "async_jobs", "logs", "shutdown" } }
 {
 	_ASSERT(m_pInstance == NULL);
+	_ASSERT(TickProfiler.GetPhaseCount() == TICK_PHASE_COUNT);
 	m_pInstance = this;
 	m_nTickTime = 0;
 
@@ -276,6 +284,7 @@ bool MMatchServer::LoadInitFile()
 		LOG(LOG_ALL, "Load Config File Failed");
 		return false;
 	}
+	SetLogOptions(MGetServerConfig()->GetLogOptions());
 
 	if (!InitLocale()) {
 		LOG(LOG_ALL, "Locale ���� ����.");
@@ -297,84 +306,71 @@ bool MMatchServer::LoadInitFile()
 		LOG(LOG_ALL, szText);
 	}
 
-	if (!MMatchFormula::Create())
-	{
-		LOG(LOG_ALL, "Open Formula Table FAILED");
-		return false;
-	}
-	if (!MQuestFormula::Create())
-	{
-		LOG(LOG_ALL, "Open Quest Formula Table FAILED");
-		return false;
-	}
-
-	if (!MGetMatchWorldItemDescMgr()->ReadXml(FILENAME_WORLDITEM_DESC))
-	{
-		Log(LOG_ALL, "Read World Item Desc Failed");
-		return false;
-	}
+	// Runs every task on its own thread and waits for all of them, so that the independent
+	// descriptor files are read in parallel. Logs the message of every task that failed.
+	using LoadTask = std::pair<const char*, std::function<bool()>>;
+	auto RunLoadTasks = [&](std::vector<LoadTask>& Tasks) {
+		std::vector<std::future<bool>> Results;
+		for (auto& Task : Tasks)
+			Results.push_back(std::async(std::launch::async, Task.second));
 
+		bool Success = true;
+		for (size_t i = 0; i < Tasks.size(); ++i)
+		{
+			if (!Results[i].get())
+			{
+				Log(LOG_ALL, Tasks[i].first);
+				Success = false;
+			}
+		}
+		return Success;
+	};
+
+	std::vector<LoadTask> Tasks{
+		{ "Open Formula Table FAILED", [] { return MMatchFormula::Create(); } },
+		{ "Open Quest Formula Table FAILED", [] { return MQuestFormula::Create(); } },
+		{ "Read World Item Desc Failed", [] {
+			return MGetMatchWorldItemDescMgr()->ReadXml(FILENAME_WORLDITEM_DESC); } },
+		{ "Read Item Descriptor Failed", [] {
+			return MGetMatchItemDescMgr()->ReadXml(FILENAME_ITEM_DESC); } },
+		{ "Load Shutdown Notify Failed", [this] {
+			return m_MatchShutdown.LoadXML_ShutdownNotify(FILENAME_SHUTDOWN_NOTIFY); } },
+		{ "Load ChannelRule.xml Failed", [] {
+			return MGetChannelRuleMgr()->ReadXml(FILENAME_CHANNELRULE); } },
+		{ "Load GunGame.xml Failed.\n", [] { return MGetGunGame()->ReadXML("gungame.xml"); } },
+	};
 #ifdef _QUEST_ITEM
-	if (!GetQuestItemDescMgr().ReadXml(QUEST_ITEM_FILE_NAME))
-	{
-		Log(LOG_ALL, "Load quest item xml file failed.");
-		return false;
-	}
-	if (!MSacrificeQItemTable::GetInst().ReadXML(SACRIFICE_TABLE_XML))
-	{
-		Log(LOG_ALL, "Load sacrifice quest item table failed.");
-		return false;
-	}
+	Tasks.push_back({ "Load quest item xml file failed.", [] {
+		return GetQuestItemDescMgr().ReadXml(QUEST_ITEM_FILE_NAME); } });
+	Tasks.push_back({ "Load sacrifice quest item table failed.", [] {
+		return MSacrificeQItemTable::GetInst().ReadXML(SACRIFICE_TABLE_XML); } });
 #endif
-	if ((MGetServerConfig()->GetServerMode() == MSM_CLAN) || (MGetServerConfig()->GetServerMode() == MSM_TEST))
-	{
-		GetLadderMgr()->Init();
-	}
-
-	if (!MGetMapsWorldItemSpawnInfo()->Read())
-	{
-		Log(LOG_ALL, "Read World Item Spawn Failed");
+	if (!RunLoadTasks(Tasks))
 		return false;
-	}
 
-	if (!MGetMatchItemDescMgr()->ReadXml(FILENAME_ITEM_DESC))
-	{
-		Log(LOG_ALL, "Read Item Descriptor Failed");
+	// These refer to the descriptors loaded above.
+	Tasks = {
+		{ "Read World Item Spawn Failed", [] { return MGetMapsWorldItemSpawnInfo()->Read(); } },
+		{ "Read Quest Desc Failed", [this] { return GetQuest()->Create(); } },
+		{ "Read Shop Item Failed", [] { return MGetMatchShop()->Create(FILENAME_SHOP); } },
+	};
+	if (!RunLoadTasks(Tasks))
 		return false;
-	}
 
-	if (!GetQuest()->Create())
+	if ((MGetServerConfig()->GetServerMode() == MSM_CLAN) || (MGetServerConfig()->GetServerMode() == MSM_TEST))
 	{
-		Log(LOG_ALL, "Read Quest Desc Failed");
-		return false;
+		GetLadderMgr()->Init();
 	}
 
-	if (!MGetMatchShop()->Create(FILENAME_SHOP))
-	{
-		Log(LOG_ALL, "Read Shop Item Failed");
-		return false;
-	}
+	// Optional, since the clients filter their own chat too.
+	if (!MGetChattingFilter()->LoadFromFile(nullptr, FILENAME_ABUSE))
+		Log(LOG_PROG, "Couldn't load " FILENAME_ABUSE ", chat won't be filtered by the server\n");
+
 	if (!LoadChannelPreset())
 	{
 		Log(LOG_ALL, "Load Channel preset Failed");
 		return false;
 	}
-	if (!m_MatchShutdown.LoadXML_ShutdownNotify(FILENAME_SHUTDOWN_NOTIFY))
-	{
-		Log(LOG_ALL, "Load Shutdown Notify Failed");
-		return false;
-	}
-	if (!MGetChannelRuleMgr()->ReadXml(FILENAME_CHANNELRULE))
-	{
-		Log(LOG_ALL, "Load ChannelRule.xml Failed");
-		return false;
-	}
-
-	if (!MGetGunGame()->ReadXML("gungame.xml"))
-	{
-		Log(LOG_ALL, "Load GunGame.xml Failed.\n");
-		return false;
-	}
 
 	u32 nItemChecksum = MGetMZFileChecksum(FILENAME_ITEM_DESC);
 	SetItemFileChecksum(nItemChecksum);
@@ -485,6 +481,7 @@ bool MMatchServer::Create(int nPort)
 
 	if (!InitDB()) return false;
 
+	m_AsyncProxy.SetJobDoneCallback([this] { Wake(); });
 	if (!m_AsyncProxy.Create(DEFAULT_ASYNCPROXY_THREADPOOL)) {
 		LOG(LOG_ALL, "Match Server AsyncProxy Create FAILED");
 		return false;
@@ -520,6 +517,22 @@ bool MMatchServer::Create(int nPort)
 
 	LagComp.Create();
 
+	auto StageThreads = MGetServerConfig()->GetStageThreadCount();
+	if (StageThreads < 0)
+		StageThreads = (std::max)(static_cast<int>(std::thread::hardware_concurrency()), 1) - 1;
+	StageSim.Create(StageThreads);
+	LOG(LOG_PROG, "Simulating stages on %d worker thread(s)", StageThreads);
+
+	const auto StatsPort = MGetServerConfig()->GetStatsPort();
+	if (StatsPort != 0)
+	{
+		GetCommandProfiler().SetEnabled(true);
+		if (StatsServer.Create(StatsPort, [this](std::string& Out) { WriteStats(Out); }))
+			LOG(LOG_PROG, "Serving stats on 127.0.0.1:%d", StatsPort);
+		else
+			LOG(LOG_ALL, "Stats server create FAILED (Port:%d)", StatsPort);
+	}
+
 	return true;
 }
 
@@ -527,6 +540,9 @@ void MMatchServer::Destroy()
 {
 	m_bCreated = false;
 
+	StatsServer.Destroy();
+	StageSim.Destroy();
+
 	OnDestroy();
 
 	GetQuest()->Destroy();
@@ -574,6 +590,8 @@ void MMatchServer::OnRegisterCommand(MCommandManager* pCommandManager)
 
 void MMatchServer::OnPrepareRun()
 {
+	TickProfiler.BeginPhase(TICK_PHASE_COMMANDS);
+
 	MServer::OnPrepareRun();
 
 	MGetServerStatusSingleton()->AddCmdCount(m_CommandManager.GetCommandQueueCount());
@@ -593,6 +611,7 @@ MCommandParameterBlob* MakeBlobArrayParameter(uint32_t NumBlobs)
 void MMatchServer::OnRun(void)
 {
 	MGetServerStatusSingleton()->SetRunStatus(100);
+	TickProfiler.BeginPhase(TICK_PHASE_SCHEDULER);
 
 	SetTickTime(GetGlobalTimeMS());
 
@@ -602,6 +621,7 @@ void MMatchServer::OnRun(void)
 	MPremiumIPCache()->Update();
 
 	MGetServerStatusSingleton()->SetRunStatus(101);
+	TickProfiler.BeginPhase(TICK_PHASE_OBJECTS);
 
 	// Update Objects
 	auto nGlobalClock = GetGlobalClockCount();
@@ -643,9 +663,17 @@ void MMatchServer::OnRun(void)
 		i++;
 	}
 
+	UpdateRentItems();
+
 	MGetServerStatusSingleton()->SetRunStatus(102);
+	TickProfiler.BeginPhase(TICK_PHASE_STAGES);
 
 	// Update Stages
+	StageBatch.clear();
+	for (auto* Stage : MakePairValueAdapter(m_StageMap))
+		StageBatch.push_back(Stage);
+	StageSim.Run(StageBatch, nGlobalClock);
+
 	for (MMatchStageMap::iterator iStage = m_StageMap.begin(); iStage != m_StageMap.end();) {
 		MMatchStage* pStage = (*iStage).second;
 
@@ -661,16 +689,19 @@ void MMatchServer::OnRun(void)
 	}
 
 	MGetServerStatusSingleton()->SetRunStatus(103);
+	TickProfiler.BeginPhase(TICK_PHASE_CHANNELS);
 
 	// Update Channels
 	m_ChannelMap.Update(nGlobalClock);
 
 	MGetServerStatusSingleton()->SetRunStatus(104);
+	TickProfiler.BeginPhase(TICK_PHASE_CLANS);
 
 	// Update Clans
 	m_ClanMap.Tick(nGlobalClock);
 
 	MGetServerStatusSingleton()->SetRunStatus(105);
+	TickProfiler.BeginPhase(TICK_PHASE_LADDERS);
 
 	// Update Ladders
 	if ((MGetServerConfig()->GetServerMode() == MSM_CLAN) || (MGetServerConfig()->GetServerMode() == MSM_TEST))
@@ -679,6 +710,7 @@ void MMatchServer::OnRun(void)
 	}
 
 	MGetServerStatusSingleton()->SetRunStatus(106);
+	TickProfiler.BeginPhase(TICK_PHASE_PINGS);
 
 	// Ping all ingame players every half second
 	if (nGlobalClock - LastPingTime > 500)
@@ -718,6 +750,8 @@ void MMatchServer::OnRun(void)
 		LastPingTime = nGlobalClock;
 	}
 
+	TickProfiler.BeginPhase(TICK_PHASE_CLEANUP);
+
 	// Garbage Session Cleaning
 #define MINTERVAL_GARBAGE_SESSION_PING	(5 * 60 * 1000)	// 3 min
 	static auto tmLastGarbageSessionCleaning = nGlobalClock;
@@ -753,11 +787,13 @@ void MMatchServer::OnRun(void)
 	MGetServerStatusSingleton()->SetRunStatus(107);
 
 	MGetServerStatusSingleton()->SetRunStatus(108);
+	TickProfiler.BeginPhase(TICK_PHASE_ASYNC_JOBS);
 
 	// Process Async Jobs
 	ProcessAsyncJob();
 
 	MGetServerStatusSingleton()->SetRunStatus(109);
+	TickProfiler.BeginPhase(TICK_PHASE_LOGS);
 
 	// Update Logs
 	UpdateServerLog();
@@ -766,11 +802,36 @@ void MMatchServer::OnRun(void)
 	MGetServerStatusSingleton()->SetRunStatus(110);
 
 	MGetServerStatusSingleton()->SetRunStatus(111);
+	TickProfiler.BeginPhase(TICK_PHASE_SHUTDOWN);
 
 	// Shutdown...
 	m_MatchShutdown.OnRun(nGlobalClock);
 
 	MGetServerStatusSingleton()->SetRunStatus(112);
+	TickProfiler.EndTick();
+}
+
+u32 MMatchServer::GetNextTickDelay() const
+{
+	return MGetNextTickDelay(MakePairValueAdapter(m_StageMap));
+}
+
+void MMatchServer::WriteStats(std::string& Out) const
+{
+	m_CommandProfiler.WritePrometheus(Out, "matchserver");
+
+	MPrometheusHeader(Out, "matchserver_tick_seconds", "summary",
+		"Time taken by a whole server tick.");
+	MPrometheusSummary(Out, "matchserver_tick_seconds", "", TickProfiler.GetTickTime());
+
+	MPrometheusHeader(Out, "matchserver_tick_phase_seconds", "summary",
+		"Time taken by each phase of a server tick.");
+	char Labels[64];
+	for (int i = 0; i < int(TickProfiler.GetPhaseCount()); ++i)
+	{
+		sprintf_safe(Labels, "phase=\"%s\"", TickProfiler.GetPhaseName(i));
+		MPrometheusSummary(Out, "matchserver_tick_phase_seconds", Labels, TickProfiler.GetPhaseTime(i));
+	}
 }
 
 void MMatchServer::UpdateServerLog()
@@ -1994,6 +2055,8 @@ void MMatchServer::OnUserWhisper(const MUID& uidComm, char* pszSenderName, char*
 	MMatchObject* pObj = GetPlayerByCommUID(uidComm);
 	if (pObj == NULL) return;
 
+	if (!CheckChatFilter(pObj, pszMessage)) return;
+
 	MMatchObject* pTargetObj = GetPlayerByName(pszTargetName);
 	if (pTargetObj == NULL) {
 		NotifyMessage(pObj->GetUID(), MATCHNOTIFY_GENERAL_USER_NOTFOUND);
@@ -2219,6 +2282,15 @@ bool StageFinish(MMatchServer* pServer, const MUID& uidPlayer, char* pszChat)
 }
 #endif
 
+bool MMatchServer::CheckChatFilter(MMatchObject* pObj, const char* pszChat)
+{
+	if (!MGetChattingFilter()->FindFilteredWord(pszChat))
+		return true;
+
+	RouteResponseToListener(pObj, MC_MATCH_RESPONSE_RESULT, MERR_CANNOT_ABUSE);
+	return false;
+}
+
 void MMatchServer::OnChatRoomChat(const MUID& uidComm, const char* pszMessage)
 {
 	MMatchObject* pPlayer = GetObject(uidComm);
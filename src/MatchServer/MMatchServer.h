@@ -24,6 +24,10 @@
 #include <queue>
 #include <unordered_map>
 #include "LagCompensation.h"
+#include "StageSimulator.h"
+#include "MMatchStatsServer.h"
+#include "MProfileStats.h"
+#include "MMatchRentItemTimer.h"
 #include "SQLiteDatabase.h"
 #include "MSSQLDatabase.h"
 
@@ -176,6 +180,8 @@ public:
 	void RouteToBattleExcept(const MUID& uidStage, MCommand* pCommand, const MUID& uidExceptedPlayer);
 	void RouteToClan(const int nCLID, MCommand* pCommand);
 	void RouteResponseToListener(MObject* pObject, const int nCmdID, int nResult);
+	// Returns false, and tells the sender why, if the message contains a filtered word.
+	bool CheckChatFilter(MMatchObject* pObj, const char* pszChat);
 
 	u32 GetStageListChecksum(MUID& uidChannel, int nStageCursor, int nStageCount);
 	void StageList(const MUID& uidPlayer, int nStageStartIndex, bool bCacheUpdate);
@@ -214,6 +220,35 @@ public:
 	void AnnounceErrorMsg(MObject* pObj, const int nErrorCode);
 
 	LagCompManager LagComp;
+	StageSimulator StageSim;
+
+	// The parts of a server tick that TickProfiler times: the command dispatch in
+	// MCommandCommunicator::Run, then each section of OnRun.
+	enum TickPhase
+	{
+		TICK_PHASE_COMMANDS,
+		TICK_PHASE_SCHEDULER,
+		TICK_PHASE_OBJECTS,
+		TICK_PHASE_STAGES,
+		TICK_PHASE_CHANNELS,
+		TICK_PHASE_CLANS,
+		TICK_PHASE_LADDERS,
+		TICK_PHASE_PINGS,
+		TICK_PHASE_CLEANUP,
+		TICK_PHASE_ASYNC_JOBS,
+		TICK_PHASE_LOGS,
+		TICK_PHASE_SHUTDOWN,
+		TICK_PHASE_COUNT,
+	};
+	const MPhaseProfiler& GetTickProfiler() const { return TickProfiler; }
+
+	// Appends the command profile and the tick timings in the Prometheus text format. Can be
+	// called from any thread.
+	void WriteStats(std::string& Out) const;
+
+	// How long the loop that calls Run can wait for a Wake before the next tick is due, in
+	// milliseconds. See MGetNextTickDelay.
+	u32 GetNextTickDelay() const;
 
 protected:
 	friend MVoteDiscuss;
@@ -282,6 +317,8 @@ protected:
 	void OnAsyncGetFriendList(MAsyncJob* pJobInput);
 	void OnAsyncGetLoginInfo(MAsyncJob* pJobInput);
 	void OnAsyncWinTheClanGame(MAsyncJob* pJobInput);
+	void OnAsyncUpdateCharClanContPoints(MAsyncJob* pJobInput);
+	void OnAsyncReloadClientFileList(MAsyncJob* pJobInput);
 	void OnAsyncUpdateCharInfoData(MAsyncJob* pJobInput);
 	void OnAsyncCharFinalize(MAsyncJob* pJobInput);
 	void OnAsyncBringAccountItem(MAsyncJob* pJobResult);
@@ -293,6 +330,7 @@ protected:
 	void OnAsyncUpdateIPtoCoutryList(MAsyncJob* pJobResult);
 	void OnAsyncUpdateBlockCountryCodeList(MAsyncJob* pJobResult);
 	void OnAsyncUpdateCustomIPList(MAsyncJob* pJobResult);
+	void OnAsyncDeleteCharItems(MAsyncJob* pJobResult);
 
 	bool InitScheduler();
 	bool InitLocale();
@@ -457,6 +495,13 @@ protected:
 		int nLegalItemLevelDiff = 0);
 	bool RemoveCharItem(MMatchObject* pObject, MUID& uidItem);
 
+	// Rent items
+	void ScheduleRentItems(MMatchObject* pObj);
+	void ScheduleRentItem(MMatchObject* pObj, MUID& uidItem);
+	void UpdateRentItems();
+	void ExpireDeferredRentItems(MMatchObject* pObj);
+	void ExpireRentItems(MMatchObject* pObj, const std::vector<MUID>& vecItemUIDList);
+
 	// Friends
 	void OnFriendAdd(const MUID& uidPlayer, const char* pszName);
 	void OnFriendRemove(const MUID& uidPlayer, const char* pszName);
@@ -509,6 +554,7 @@ protected:
 	void OnAdminRequestBanPlayer(const MUID& uidAdmin, const char* szPlayer);
 	void OnAdminRequestUpdateAccountUGrade(const MUID& uidAdmin, const char* szPlayer);
 	void OnAdminPingToAll(const MUID& uidAdmin);
+	void OnAdminReloadClientHash(const MUID& uidAdmin);
 	void OnAdminRequestSwitchLadderGame(const MUID& uidAdmin, const bool bEnabled);
 	void OnAdminHide(const MUID& uidAdmin);
 	void OnAdminResetAllHackingBlock(const MUID& uidAdmin);
@@ -641,7 +687,6 @@ protected:
 	int ValidateChannelJoin(const MUID& uidPlayer, const MUID& uidChannel);
 	int ValidateEquipItem(MMatchObject* pObj, MMatchItem* pItem, const MMatchCharItemParts parts);
 	int ValidateChallengeLadderGame(MMatchObject** ppMemberObject, int nMemberCount);
-	void CheckExpiredItems(MMatchObject* pObj);
 	void ResponseExpiredItemIDList(MMatchObject* pObj,
 		std::vector<u32>& vecExpiredItemIDList);
 
@@ -679,6 +724,8 @@ protected:
 	char				m_szDefaultChannelRuleName[CHANNELRULE_LEN];
 
 	MMatchStageMap		m_StageMap;
+	// Scratch list of the stages handed to StageSim every tick.
+	std::vector<MMatchStage*> StageBatch;
 	MMatchClanMap		m_ClanMap;
 	MAgentObjectMap		m_AgentMap;
 
@@ -687,6 +734,8 @@ protected:
 
 	MAsyncProxy			m_AsyncProxy;
 	MMatchAdmin			m_Admin;
+	// Whether an MAsyncDBJob_ReloadClientFileList is on its way, so that admins can't queue more.
+	bool				m_bReloadingClientFileList{};
 	MMatchShutdown		m_MatchShutdown;
 	MMatchChatRoomMgr	m_ChatRoomMgr;
 	MLadderMgr			m_LadderMgr;
@@ -698,11 +747,19 @@ protected:
 
 	MMatchEventManager		m_CustomEventManager;
 
+	MMatchRentItemTimer RentItemTimer;
+	// Scratch list of the entries RentItemTimer hands back every tick.
+	std::vector<MMatchRentItemTimer::Entry> RentItemDue;
+
 	u64 LastPingTime{};
+
+	MPhaseProfiler TickProfiler;
+	MMatchStatsServer StatsServer;
 };
 
 void CopyCharInfoForTrans(MTD_CharInfo* pDest, MMatchCharInfo* pSrc, MMatchObject* pSrcObject);
 void CopyCharInfoDetailForTrans(MTD_CharInfo_Detail* pDest, MMatchCharInfo* pSrcCharInfo, MMatchObject* pSrcObject);
+void CopyClanMemberListNodeForTrans(MTD_ClanMemberListNode* pDest, MMatchObject* pSrcObject);
 
 inline MMatchServer* MGetMatchServer()
 {
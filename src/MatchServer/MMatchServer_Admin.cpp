@@ -156,6 +156,46 @@ void MMatchServer::OnAdminPingToAll(const MUID& uidAdmin)
 	RouteToAllConnection(pNew);
 }
 
+void MMatchServer::OnAdminReloadClientHash(const MUID& uidAdmin)
+{
+	MMatchObject* pObj = GetObject(uidAdmin);
+	if (pObj == NULL) return;
+
+	if (!IsAdminGrade(pObj))
+	{
+		return;
+	}
+
+	if (m_bReloadingClientFileList)
+	{
+		Announce(pObj, "The client file list is already being reloaded.");
+		return;
+	}
+
+	m_bReloadingClientFileList = true;
+	PostAsyncJob(new MAsyncDBJob_ReloadClientFileList(uidAdmin));
+}
+
+void MMatchServer::OnAsyncReloadClientFileList(MAsyncJob* pJobInput)
+{
+	auto* pJob = static_cast<MAsyncDBJob_ReloadClientFileList*>(pJobInput);
+	m_bReloadingClientFileList = false;
+
+	// The admin may have left meanwhile.
+	MMatchObject* pObj = GetObject(pJob->GetAdminUID());
+	if (pObj == NULL) return;
+
+	auto& Result = pJob->GetReloadResult();
+	char szMsg[256];
+	if (Result.bLoaded)
+		sprintf_safe(szMsg, "Reloaded the client file list: %d CRCs, version %u.",
+			Result.nCount, Result.nVersion);
+	else
+		sprintf_safe(szMsg, "Couldn't reload the client file list, keeping version %u.",
+			MMatchAntiHack::GetClientFileListVersion());
+	Announce(pObj, szMsg);
+}
+
 
 void MMatchServer::OnAdminRequestSwitchLadderGame(const MUID& uidAdmin, const bool bEnabled)
 {
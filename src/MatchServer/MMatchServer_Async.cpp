@@ -129,6 +129,24 @@ void MMatchServer::ProcessAsyncJob()
 				OnAsyncUpdateCustomIPList( pJob );
 			}
 			break;
+
+		case MASYNCJOB_DELETECHARITEMS :
+			{
+				OnAsyncDeleteCharItems( pJob );
+			}
+			break;
+
+		case MASYNCJOB_UPDATECHARCLANCONTPOINTS :
+			{
+				OnAsyncUpdateCharClanContPoints( pJob );
+			}
+			break;
+
+		case MASYNCJOB_RELOADCLIENTFILELIST :
+			{
+				OnAsyncReloadClientFileList( pJob );
+			}
+			break;
 		};
 
 		delete pJob;
@@ -412,6 +430,8 @@ void MMatchServer::OnAsyncBringAccountItem(MAsyncJob* pJobResult)
 		// Ʈ  ߰
 		MUID uidNew = MMatchItemMap::UseUID();
 		pObj->GetCharInfo()->m_ItemList.CreateItem(uidNew, nNewCIID, nNewItemID, bIsRentItem, nRentMinutePeriodRemainder);
+		if (bIsRentItem)
+			ScheduleRentItem(pObj, uidNew);
 
 		nRet = MOK;
 	}		
@@ -426,6 +446,18 @@ void MMatchServer::OnAsyncBringAccountItem(MAsyncJob* pJobResult)
 
 }
 
+void MMatchServer::OnAsyncDeleteCharItems(MAsyncJob* pJobResult)
+{
+	auto* pJob = static_cast<MAsyncDBJob_DeleteCharItems*>(pJobResult);
+	if (pJob->GetResult() == MASYNC_RESULT_SUCCEED)
+		return;
+
+	// The items are already gone from memory. Whatever is left in the DB has run out, so it's
+	// expired again the next time the character is loaded.
+	for (auto nCIID : pJob->GetFailedCIIDList())
+		mlog("Async DB Query(OnAsyncDeleteCharItems) Failed (CID %u, CIID %u)\n", pJob->GetCID(), nCIID);
+}
+
 void MMatchServer::OnAsyncInsertConnLog(MAsyncJob* pJobResult)
 {
 	if (pJobResult->GetResult() != MASYNC_RESULT_SUCCEED) {
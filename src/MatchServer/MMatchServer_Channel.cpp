@@ -204,6 +204,7 @@ bool MMatchServer::ChannelChat(const MUID& uidPlayer, const MUID& uidChannel, ch
 	if ((pObj == NULL) || (pObj->GetCharInfo() == NULL)) return false;
 
 	if (pObj->GetAccountInfo()->m_nUGrade == MMUG_CHAT_LIMITED) return false;
+	if (!CheckChatFilter(pObj, pszChat)) return false;
 
 	int nGrade = (int) pObj->GetAccountInfo()->m_nUGrade;
 
@@ -229,7 +229,7 @@ bool MMatchServer::CharInitialize(const MUID& uidPlayer)
 		pCharInfo->m_EquipedItem.Clear();
 	}
 
-	CheckExpiredItems(pObj);
+	ScheduleRentItems(pObj);
 
 
 	// if player belonges to a clan
@@ -260,56 +260,140 @@ bool MMatchServer::CharInitialize(const MUID& uidPlayer)
 	return true;
 }
 
-void MMatchServer::CheckExpiredItems(MMatchObject* pObj)
+// When a rent item runs out, on the same clock that CreateItem stamps it with.
+static u64 GetRentItemExpireTime(MMatchItem* pItem)
+{
+	auto nRemainder = (std::max)(pItem->GetRentMinutePeriodRemainder(), 0);
+	return pItem->GetRentItemRegTime() + u64(nRemainder) * 60 * 1000;
+}
+
+void MMatchServer::ScheduleRentItems(MMatchObject* pObj)
 {
 	MMatchCharInfo*	pCharInfo = pObj->GetCharInfo();
 	if (!pCharInfo->m_ItemList.HasRentItem()) return;
 
-	vector<u32> vecExpiredItemIDList;
-	vector<MUID> vecExpiredItemUIDList;				// ����� ������ UID
+	const auto nNow = GetTickTime();
+	vector<MUID> vecExpiredItemUIDList;
+	for (auto* pItem : MakePairValueAdapter(pCharInfo->m_ItemList))
+	{
+		if (!pItem->IsRentItem()) continue;
+
+		const auto nExpireTime = GetRentItemExpireTime(pItem);
+		if (nExpireTime <= nNow)
+			vecExpiredItemUIDList.push_back(pItem->GetUID());
+		else
+			RentItemTimer.Add(nExpireTime, pObj->GetUID(), pItem->GetUID());
+	}
+
+	if (!vecExpiredItemUIDList.empty())
+		ExpireRentItems(pObj, vecExpiredItemUIDList);
+}
+
+void MMatchServer::ScheduleRentItem(MMatchObject* pObj, MUID& uidItem)
+{
+	MMatchItem* pItem = pObj->GetCharInfo()->m_ItemList.GetItem(uidItem);
+	if (!pItem || !pItem->IsRentItem()) return;
 
-	// �Ⱓ ���� �������� �ִ��� üũ�ϰ� ������ ������ �����ϰ� �����Ѵ�.
-	for (MMatchItemMap::iterator itor = pCharInfo->m_ItemList.begin(); itor != pCharInfo->m_ItemList.end(); ++itor)
+	RentItemTimer.Add(GetRentItemExpireTime(pItem), pObj->GetUID(), uidItem);
+}
+
+void MMatchServer::UpdateRentItems()
+{
+	RentItemDue.clear();
+	RentItemTimer.PopDue(GetTickTime(), RentItemDue);
+
+	// Grouped by player, so that each one gets a single DB job and command for all of theirs.
+	std::stable_sort(RentItemDue.begin(), RentItemDue.end(),
+		[](auto& a, auto& b) { return a.uidPlayer < b.uidPlayer; });
+
+	vector<MUID> vecItemUIDList;
+	for (auto it = RentItemDue.begin(); it != RentItemDue.end();)
 	{
-		MMatchItem* pCheckItem = (*itor).second;
-		if (pCheckItem->IsRentItem())
-		{
-			// �ν��Ͻ� �����ǰ����� ���� �ð�
-			auto nPassTime = MGetTimeDistance(static_cast<unsigned long int>(pCheckItem->GetRentItemRegTime()), static_cast<unsigned long int>(GetTickTime()));
-			int nPassMinuteTime = static_cast<int>(nPassTime / (1000 * 60));
+		const auto uidPlayer = it->uidPlayer;
+		auto itEnd = std::find_if(it, RentItemDue.end(),
+			[&](auto& Due) { return Due.uidPlayer != uidPlayer; });
 
-			if ((pCheckItem->GetRentMinutePeriodRemainder()-nPassMinuteTime) <= 0)
+		MMatchObject* pObj = GetObject(uidPlayer);
+		if (IsEnabledObject(pObj))
+		{
+			// Don't take anything away in the middle of a round. They go when the player
+			// leaves the battle.
+			if (pObj->GetPlace() == MMP_BATTLE)
 			{
-				// ������̸� �����.
-				MMatchCharItemParts nCheckParts = MMCIP_END;
-				if (pCharInfo->m_EquipedItem.IsEquipedItem(pCheckItem, nCheckParts))
-				{
-					ResponseTakeoffItem(pObj->GetUID(), nCheckParts);
-				}
-
-				// ������ ����
-				int nExpiredItemID = pCheckItem->GetDescID();
-				if (nExpiredItemID != 0)
-				{
-					vecExpiredItemUIDList.push_back(pCheckItem->GetUID());
-					vecExpiredItemIDList.push_back(nExpiredItemID);
-				}
+				for (; it != itEnd; ++it)
+					RentItemTimer.Defer(*it);
+			}
+			else
+			{
+				vecItemUIDList.clear();
+				for (; it != itEnd; ++it)
+					vecItemUIDList.push_back(it->uidItem);
+				ExpireRentItems(pObj, vecItemUIDList);
 			}
 		}
+
+		it = itEnd;
 	}
 
-	// ����� �������� ������ ����
-	if (!vecExpiredItemIDList.empty())
+	if (RentItemTimer.NeedsCompaction())
+	{
+		RentItemTimer.Compact([&](auto& Entry) {
+			MMatchObject* pObj = GetObject(Entry.uidPlayer);
+			MUID uidItem = Entry.uidItem;
+			return IsEnabledObject(pObj) && pObj->GetCharInfo()->m_ItemList.GetItem(uidItem) != nullptr;
+		});
+	}
+}
+
+void MMatchServer::ExpireDeferredRentItems(MMatchObject* pObj)
+{
+	vector<MMatchRentItemTimer::Entry> vecDue;
+	RentItemTimer.TakeDeferred(pObj->GetUID(), vecDue);
+	if (vecDue.empty()) return;
+
+	vector<MUID> vecItemUIDList;
+	for (auto& Due : vecDue)
+		vecItemUIDList.push_back(Due.uidItem);
+	ExpireRentItems(pObj, vecItemUIDList);
+}
+
+void MMatchServer::ExpireRentItems(MMatchObject* pObj, const vector<MUID>& vecItemUIDList)
+{
+	MMatchCharInfo*	pCharInfo = pObj->GetCharInfo();
+
+	vector<u32> vecExpiredItemIDList;
+	vector<u32> vecExpiredCIIDList;
+	for (auto uidItem : vecItemUIDList)
 	{
-		int nExpiredItemUIDListCount = (int)vecExpiredItemUIDList.size();
-		for (int i = 0; i < nExpiredItemUIDListCount; i++)
+		// Entries aren't taken out of RentItemTimer when an item goes away some other way.
+		MMatchItem* pItem = pCharInfo->m_ItemList.GetItem(uidItem);
+		if (!pItem || !pItem->IsRentItem()) continue;
+
+		int nExpiredItemID = pItem->GetDescID();
+		if (nExpiredItemID == 0) continue;
+
+		MMatchCharItemParts nCheckParts = MMCIP_END;
+		if (pCharInfo->m_EquipedItem.IsEquipedItem(pItem, nCheckParts))
 		{
-			// ������ ���⼭ �������� �����.
-			RemoveCharItem(pObj, vecExpiredItemUIDList[i]);
+			ResponseTakeoffItem(pObj->GetUID(), nCheckParts);
+
+			// Still on if it was too heavy to take off.
+			if (pCharInfo->m_EquipedItem.IsEquipedItem(pItem, nCheckParts))
+				pCharInfo->m_EquipedItem.Remove(nCheckParts);
 		}
 
-		ResponseExpiredItemIDList(pObj, vecExpiredItemIDList);
+		vecExpiredItemIDList.push_back(nExpiredItemID);
+		vecExpiredCIIDList.push_back(pItem->GetCIID());
+		pCharInfo->m_ItemList.RemoveItem(uidItem);
 	}
+
+	if (vecExpiredItemIDList.empty()) return;
+
+	auto* pJob = new MAsyncDBJob_DeleteCharItems;
+	pJob->Input(pCharInfo->m_nCID, std::move(vecExpiredCIIDList));
+	PostAsyncJob(pJob);
+
+	ResponseExpiredItemIDList(pObj, vecExpiredItemIDList);
 }
 
 void MMatchServer::ResponseExpiredItemIDList(MMatchObject* pObj, vector<u32>& vecExpiredItemIDList)
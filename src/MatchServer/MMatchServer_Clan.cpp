@@ -807,25 +807,9 @@ void MMatchServer::ResponseClanMemberList(const MUID& uidChar)
 
 	MCommand* pNew = new MCommand(m_CommandManager.GetCommandDescByID(MC_MATCH_CLAN_RESPONSE_MEMBER_LIST), MUID(0,0), m_This);
 
-	void* pMemberArray = MMakeBlobArray(sizeof(MTD_ClanMemberListNode), nNodeCount);
-
-	int nArrayIndex=0;
-	for (auto itor= pClan->GetMemberBegin(); itor != pClan->GetMemberEnd(); ++itor)
-	{
-		MMatchObject* pScanObj = itor->second;
-
-		MTD_ClanMemberListNode* pNode = (MTD_ClanMemberListNode*)MGetBlobArrayElement(pMemberArray, nArrayIndex++);
-
-		if (IsEnabledObject(pScanObj))
-		{
-			CopyClanMemberListNodeForTrans(pNode, pScanObj);		
-		}
-
-		if (nArrayIndex >= nNodeCount) break;
-	}
-
-	pNew->AddParameter(new MCommandParameterBlob(pMemberArray, MGetBlobArraySize(pMemberArray)));
-	MEraseBlobArray(pMemberArray);
+	int nBlobSize = 0;
+	auto pMemberArray = pClan->GetMemberListBlob(&nBlobSize);
+	pNew->AddParameter(new MCommandParameterSharedBlob(std::move(pMemberArray), nBlobSize));
 	RouteToListener(pObject, pNew);
 }
 
@@ -1039,13 +1023,20 @@ void MMatchServer::SaveClanPoint(MMatchClan* pWinnerClan, MMatchClan* pLoserClan
 			int nCID = pObject->GetCharInfo()->m_nCID;
 			pObject->GetCharInfo()->m_ClanInfo.m_nContPoint += nAddedWinnerPoint;
 
-			MAsyncDBJob_UpdateCharClanContPoint* pJob=new MAsyncDBJob_UpdateCharClanContPoint(nCID, nWinnerCLID, nAddedWinnerPoint);
-			PostAsyncJob(pJob);
+			m_ClanMap.AddContPoint(nCID, nWinnerCLID, nAddedWinnerPoint);
 		}
 	}
 
 	
 }
 
+void MMatchServer::OnAsyncUpdateCharClanContPoints(MAsyncJob* pJobInput)
+{
+	auto* pJob = static_cast<MAsyncDBJob_UpdateCharClanContPoints*>(pJobInput);
 
-
+	for (auto& ContPoint : pJob->GetFailedList())
+	{
+		mlog("DB Query(UpdateCharClanContPoint) Failed (CID %d, CLID %d, %d points)\n",
+			ContPoint.nCID, ContPoint.nCLID, ContPoint.nAddedContPoint);
+	}
+}
@@ -43,6 +43,8 @@ bool MMatchServer::InsertCharItem(const MUID& uidPlayer, const u32 nItemID, bool
 	int nRentMinutePeriodRemainder = nRentPeriodHour * 60;
 	MUID uidNew = MMatchItemMap::UseUID();
 	pObject->GetCharInfo()->m_ItemList.CreateItem(uidNew, nNewCIID, nItemID, bRentItem, nRentMinutePeriodRemainder);
+	if (bRentItem)
+		ScheduleRentItem(pObject, uidNew);
 
 	return true;
 }
@@ -273,33 +275,9 @@ void MMatchServer::ResponseShopItemList(const MUID& uidPlayer, const int nFirstI
 	MMatchObject* pObj = GetObject(uidPlayer);
 	if (pObj == NULL) return;
 
-	int nRealItemCount = 0;
-	if ((nItemCount <= 0) || (nItemCount > MGetMatchShop()->GetCount())) nRealItemCount = MGetMatchShop()->GetCount();
-	else nRealItemCount = nItemCount;
-
-
 	MCommand* pNew = CreateCommand(MC_MATCH_RESPONSE_SHOP_ITEMLIST, MUID(0,0));
-	void* pItemArray = MMakeBlobArray(sizeof(u32), nRealItemCount);
-	int nIndex=0;
-
-	for (int i = nFirstItemIndex; i < nFirstItemIndex+nRealItemCount; i++)
-	{
-		u32* pnItemID = (u32*)MGetBlobArrayElement(pItemArray, nIndex++);
-		ShopItemNode* pSINode = MGetMatchShop()->GetSellItem(i);
-
-		if (pSINode != NULL)
-		{
-			*pnItemID = pSINode->nItemID;
-		}
-		else
-		{
-			*pnItemID = 0;
-		}
-
-	}
-
-	pNew->AddParameter(new MCommandParameterBlob(pItemArray, MGetBlobArraySize(pItemArray)));
-	MEraseBlobArray(pItemArray);
+	pNew->AddParameter(MMakeShopItemListParameter(MGetMatchShop()->GetCatalog(),
+		nFirstItemIndex, nItemCount));
 
 	RouteToListener(pObj, pNew);	
 
@@ -792,6 +792,7 @@ bool MMatchServer::OnCommand(MCommand* pCommand)
 	break;
 	case MC_ADMIN_RELOAD_CLIENT_HASH:
 	{
+		OnAdminReloadClientHash(pCommand->GetSenderUID());
 	}
 	break;
 	case MC_ADMIN_PING_TO_ALL:
@@ -363,7 +363,7 @@ bool MMatchServer::StageLeaveBattle(const MUID& uidPlayer, const MUID& uidStage,
 		RouteToListener(pObj, pNewCmd);
 	}
 
-	CheckExpiredItems(pObj);
+	ExpireDeferredRentItems(pObj);
 
 	PostLeaveBattle(uidPlayer, uidStage);
 
@@ -387,6 +387,7 @@ bool MMatchServer::StageChat(const MUID& uidPlayer, const MUID& uidStage, char*
 	if ((pObj == NULL) || (pObj->GetCharInfo() == NULL)) return false;
 
 	if (pObj->GetAccountInfo()->m_nUGrade == MMUG_CHAT_LIMITED) return false;
+	if (!CheckChatFilter(pObj, pszChat)) return false;
 
 	MCommand* pCmd = new MCommand(m_CommandManager.GetCommandDescByID(MC_MATCH_STAGE_CHAT), MUID(0,0), m_This);
 	pCmd->AddParameter(new MCommandParameterUID(uidPlayer));
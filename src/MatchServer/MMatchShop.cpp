@@ -2,9 +2,9 @@
 #include "MMatchShop.h"
 #include "MMatchConfig.h"
 
-MMatchShop::MMatchShop()
+MMatchShop::MMatchShop() : m_nNextVersion(1)
 {
-
+	Clear();
 }
 MMatchShop::~MMatchShop()
 {
@@ -12,7 +12,15 @@ MMatchShop::~MMatchShop()
 }
 bool MMatchShop::Create(const char* szDescFileName)
 {
-	return ReadXml(szDescFileName);
+	auto pCatalog = std::make_shared<MMatchShopCatalog>();
+	if (!ReadXml(szDescFileName, *pCatalog))
+		return false;
+
+	SetCatalog(std::move(pCatalog));
+
+	auto pNew = GetCatalog();
+	mlog("Read shop catalog from %s (%d items, version %u)\n",
+		szDescFileName, pNew->GetCount(), pNew->Version);
 
 	return true;
 }
@@ -24,7 +32,7 @@ void MMatchShop::Destroy()
 }
 
 
-bool MMatchShop::ReadXml(const char* szFileName)
+bool MMatchShop::ReadXml(const char* szFileName, MMatchShopCatalog& Catalog)
 {
 	MXmlDocument	xmlDocument;
 
@@ -51,7 +59,7 @@ bool MMatchShop::ReadXml(const char* szFileName)
 
 		if (!strcmp(szTagName, MTOK_SELL))
 		{
-			ParseSellItem(chrElement);
+			ParseSellItem(chrElement, Catalog);
 		}
 	}
 
@@ -60,17 +68,17 @@ bool MMatchShop::ReadXml(const char* szFileName)
 	return true;
 }
 
-void MMatchShop::ParseSellItem(MXmlElement& element)
+void MMatchShop::ParseSellItem(MXmlElement& element, MMatchShopCatalog& Catalog)
 {
-	ShopItemNode* pNewItemNode = new ShopItemNode();
+	ShopItemNode NewItemNode;
 
 	int nDescID = 0;
 
 	element.GetAttribute(&nDescID, MTOK_SELL_ITEMID);
-	element.GetAttribute(&pNewItemNode->nRentPeriodHour, MTOK_SELL_RENT_PERIOD_HOUR, 0);
+	element.GetAttribute(&NewItemNode.nRentPeriodHour, MTOK_SELL_RENT_PERIOD_HOUR, 0);
 
-	pNewItemNode->nItemID = nDescID;
-	pNewItemNode->bIsRentItem = (pNewItemNode->nRentPeriodHour > 0);
+	NewItemNode.nItemID = nDescID;
+	NewItemNode.bIsRentItem = (NewItemNode.nRentPeriodHour > 0);
 	
 
 	MMatchItemDesc* pItemDesc = MGetMatchItemDescMgr()->GetItemDesc(nDescID);
@@ -79,19 +87,16 @@ void MMatchShop::ParseSellItem(MXmlElement& element)
 		// ĳ  
 		if (pItemDesc->IsCashItem()) 
 		{
-			delete pNewItemNode;
 			return;
 		}
 
-		m_ItemNodeVector.push_back(pNewItemNode);
-		m_ItemNodeMap.insert(map<unsigned int, ShopItemNode*>::value_type(pNewItemNode->nItemID, pNewItemNode));
+		Catalog.Items.push_back(NewItemNode);
 	}
 #ifdef _QUEST_ITEM
 	else
 	{
 		if ( QuestTestServer() == false )
 		{
-			delete pNewItemNode;
 			return;
 		}
 
@@ -99,27 +104,23 @@ void MMatchShop::ParseSellItem(MXmlElement& element)
 		MQuestItemDesc* pQuestItemDesc = GetQuestItemDescMgr().FindQItemDesc( nDescID );
 		if( 0 == pQuestItemDesc )
 		{
-			delete pNewItemNode;
 			return;
 		}
 
-		m_ItemNodeVector.push_back( pNewItemNode );
-		m_ItemNodeMap.insert( map<unsigned int, ShopItemNode*>::value_type(pNewItemNode->nItemID, pNewItemNode) );
+		Catalog.Items.push_back( NewItemNode );
 	}
 #endif
 }
 
 void MMatchShop::Clear()
 {
-	int nVectorSize = (int)m_ItemNodeVector.size();
-	for (int i = 0; i < nVectorSize; i++)
-	{
-		ShopItemNode* pNode = m_ItemNodeVector[i];
-		delete pNode;
-	}
+	SetCatalog(std::make_shared<MMatchShopCatalog>());
+}
 
-	m_ItemNodeVector.clear();
-	m_ItemNodeMap.clear();
+void MMatchShop::SetCatalog(std::shared_ptr<MMatchShopCatalog> pCatalog)
+{
+	pCatalog->Build(m_nNextVersion++);
+	std::atomic_store(&m_pCatalog, std::shared_ptr<const MMatchShopCatalog>(std::move(pCatalog)));
 }
 
 
@@ -128,21 +129,3 @@ MMatchShop* MMatchShop::GetInstance()
 	static MMatchShop g_stMatchShop;
 	return &g_stMatchShop;
 }
-
-bool MMatchShop::IsSellItem(const u32 nItemID)
-{
-	map<unsigned int, ShopItemNode*>::iterator itor = m_ItemNodeMap.find(nItemID);
-	if (itor != m_ItemNodeMap.end())
-	{
-		return true;
-	}
-
-	return false;
-}
-
-ShopItemNode* MMatchShop::GetSellItem(int nListIndex)
-{
-	if ((nListIndex < 0) || (nListIndex >= GetCount())) return NULL;
-
-	return m_ItemNodeVector[nListIndex];
-}
\ No newline at end of file
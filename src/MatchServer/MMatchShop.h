@@ -3,39 +3,40 @@
 
 #include "MXml.h"
 #include "MUID.h"
-#include <map>
 #include <vector>
+#include <memory>
 #include <algorithm>
+#include "MBlobArray.h"
 #include "MMatchItem.h"
 #include "MQuestItem.h"
-
-struct ShopItemNode
-{
-	unsigned int	nItemID;
-	bool			bIsRentItem;
-	int				nRentPeriodHour;
-	ShopItemNode() : nItemID(0), bIsRentItem(false), nRentPeriodHour(0) {}
-};
+#include "MMatchShopCatalog.h"
 
 class MMatchShop
 {
 private:
 protected:
-	std::vector<ShopItemNode*>					m_ItemNodeVector;
-	std::map<unsigned int, ShopItemNode*>		m_ItemNodeMap;
+	std::shared_ptr<const MMatchShopCatalog>	m_pCatalog;
+	u32											m_nNextVersion;
 
-	void ParseSellItem(MXmlElement& element);
-	bool ReadXml(const char* szFileName);
+	void ParseSellItem(MXmlElement& element, MMatchShopCatalog& Catalog);
+	bool ReadXml(const char* szFileName, MMatchShopCatalog& Catalog);
+	// Builds pCatalog as the next version and swaps it in.
+	void SetCatalog(std::shared_ptr<MMatchShopCatalog> pCatalog);
 public:
+	// Create, Destroy and Clear are only called on the main thread, which is where shop.xml is
+	// loaded and reloaded, so they don't race on m_nNextVersion. The catalog they swap in can be
+	// read from anywhere.
 	MMatchShop();
 	virtual ~MMatchShop();
+	// Leaves the current catalog alone if the file can't be read, so it can be used to reload.
 	bool Create(const char* szDescFileName);
 	void Destroy();
 
 	void Clear();
-	int GetCount() { return static_cast< int >( m_ItemNodeVector.size() ); }
-	bool IsSellItem(const u32 nItemID);
-	ShopItemNode* GetSellItem(int nListIndex);
+	int GetCount() { return GetCatalog()->GetCount(); }
+	bool IsSellItem(const u32 nItemID) { return GetCatalog()->IsSellItem(nItemID); }
+	// Never null.
+	std::shared_ptr<const MMatchShopCatalog> GetCatalog() const { return std::atomic_load(&m_pCatalog); }
 
 	static MMatchShop* GetInstance();
 };
@@ -0,0 +1,75 @@
+#include "MMatchShopCatalog.h"
+#include "MCommandParameter.h"
+#include <algorithm>
+#include <cstring>
+
+void MMatchShopCatalog::Build(u32 nVersion)
+{
+	Version = nVersion;
+
+	Items.shrink_to_fit();
+
+	SortedItemIDs.reserve(Items.size());
+	for (auto& Item : Items)
+		SortedItemIDs.push_back(Item.nItemID);
+	std::sort(SortedItemIDs.begin(), SortedItemIDs.end());
+	SortedItemIDs.erase(std::unique(SortedItemIDs.begin(), SortedItemIDs.end()), SortedItemIDs.end());
+	SortedItemIDs.shrink_to_fit();
+
+	ItemListBlob = MMakeBlobArrayPtr(sizeof(u32), GetCount());
+	for (int i = 0; i < GetCount(); i++)
+	{
+		const u32 nItemID = Items[i].nItemID;
+		memcpy(MGetBlobArrayElement(ItemListBlob.get(), i), &nItemID, sizeof(nItemID));
+	}
+	ItemListBlobSize = MGetBlobArraySize(ItemListBlob.get());
+}
+
+bool MMatchShopCatalog::IsSellItem(u32 nItemID) const
+{
+	return std::binary_search(SortedItemIDs.begin(), SortedItemIDs.end(), nItemID);
+}
+
+const ShopItemNode* MMatchShopCatalog::GetSellItem(int nListIndex) const
+{
+	if ((nListIndex < 0) || (nListIndex >= GetCount())) return NULL;
+
+	return &Items[nListIndex];
+}
+
+MCommandParameterBlob* MMakeShopItemListParameter(
+	const std::shared_ptr<const MMatchShopCatalog>& pCatalog, int nFirstItemIndex, int nItemCount)
+{
+	int nRealItemCount = 0;
+	if ((nItemCount <= 0) || (nItemCount > pCatalog->GetCount())) nRealItemCount = pCatalog->GetCount();
+	else nRealItemCount = nItemCount;
+
+	if ((nFirstItemIndex == 0) && (nRealItemCount == pCatalog->GetCount()))
+	{
+		return new MCommandParameterSharedBlob(
+			std::shared_ptr<const void>(pCatalog, pCatalog->ItemListBlob.get()),
+			pCatalog->ItemListBlobSize);
+	}
+
+	void* pItemArray = MMakeBlobArray(sizeof(u32), nRealItemCount);
+	int nIndex=0;
+
+	for (int i = nFirstItemIndex; i < nFirstItemIndex+nRealItemCount; i++)
+	{
+		u32* pnItemID = (u32*)MGetBlobArrayElement(pItemArray, nIndex++);
+		const ShopItemNode* pSINode = pCatalog->GetSellItem(i);
+
+		if (pSINode != NULL)
+		{
+			*pnItemID = pSINode->nItemID;
+		}
+		else
+		{
+			*pnItemID = 0;
+		}
+	}
+
+	auto* pParam = new MCommandParameterBlob(pItemArray, MGetBlobArraySize(pItemArray));
+	MEraseBlobArray(pItemArray);
+	return pParam;
+}
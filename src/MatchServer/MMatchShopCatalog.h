@@ -0,0 +1,45 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include "MBlobArray.h"
+#include <memory>
+#include <vector>
+
+class MCommandParameterBlob;
+
+struct ShopItemNode
+{
+	unsigned int	nItemID;
+	bool			bIsRentItem;
+	int				nRentPeriodHour;
+	ShopItemNode() : nItemID(0), bIsRentItem(false), nRentPeriodHour(0) {}
+};
+
+// What the shop sells, as of the last time shop.xml was read. It doesn't change once it's built:
+// reading the file again builds a new one and swaps it in, so anything still holding on to the
+// old one, like a reply that hasn't been sent yet, keeps seeing it as it was.
+struct MMatchShopCatalog
+{
+	u32 Version = 0;
+	// In the order shop.xml lists them, which is the order the client shows them in.
+	std::vector<ShopItemNode> Items;
+	// The IDs of Items, sorted and without duplicates.
+	std::vector<u32> SortedItemIDs;
+	// The IDs of Items, encoded as the blob array MC_MATCH_RESPONSE_SHOP_ITEMLIST sends when the
+	// whole list is asked for, which is what the client always does.
+	BlobPtr ItemListBlob;
+	int ItemListBlobSize = 0;
+
+	// Fills in everything else from Items. Called once, before the catalog is shared.
+	void Build(u32 nVersion);
+
+	int GetCount() const { return static_cast<int>(Items.size()); }
+	bool IsSellItem(u32 nItemID) const;
+	const ShopItemNode* GetSellItem(int nListIndex) const;
+};
+
+// The item list parameter of MC_MATCH_RESPONSE_SHOP_ITEMLIST, for nItemCount items from
+// nFirstItemIndex on, or all of them if nItemCount is out of range. The whole list shares the
+// catalog's blob instead of taking a copy, and keeps the catalog alive until it's been sent.
+MCommandParameterBlob* MMakeShopItemListParameter(
+	const std::shared_ptr<const MMatchShopCatalog>& pCatalog, int nFirstItemIndex, int nItemCount);
@@ -20,7 +20,7 @@
 #include "MMatchRuleWeaponDrop.h"
 #include "MErrorTable.h"
 
-MMatchStage::MMatchStage() : MovingWeaponMgr(*this), m_WorldItemManager(this)
+MMatchStage::MMatchStage() : MovingWeaponMgr(*this), MoveValidator(*this), m_WorldItemManager(this)
 {
 	m_pRule = NULL;
 	m_nIndex = 0;
@@ -289,6 +289,31 @@ void MMatchStage::ResetTeams()
 	}
 }
 
+void MMatchStage::Simulate(u64 nClock)
+{
+	if (nClock - LastPhysicsTick < 10)
+		return;
+
+	MovingWeaponMgr.Update((nClock - LastPhysicsTick) / 1000.0f);
+	LastPhysicsTick = nClock;
+
+	if (GetState() == STAGE_STATE_RUN && BspObject &&
+		GetStageSetting()->GetNetcode() == NetcodeType::ServerBased)
+		MoveValidator.Update();
+}
+
+bool MMatchStage::CanSimulateConcurrently() const
+{
+	return !BspObject || BspObject->SupportsConcurrentQueries();
+}
+
+void MMatchStage::RunDeferred()
+{
+	for (auto& Fn : Deferred)
+		Fn();
+	Deferred.clear();
+}
+
 void MMatchStage::Tick(u64 nClock)
 {
 	switch (GetState())
@@ -324,11 +349,10 @@ void MMatchStage::Tick(u64 nClock)
 		break;
 	}
 
-	if (nClock - LastPhysicsTick >= 10)
+	if (nClock - LastWorldItemTick >= 10)
 	{
-		MovingWeaponMgr.Update((nClock - LastPhysicsTick) / 1000.0f);
-		LastPhysicsTick = nClock;
 		UpdateWorldItems();
+		LastWorldItemTick = nClock;
 	}
 
 	m_VoteMgr.Tick(nClock);
@@ -719,6 +743,7 @@ void MMatchStage::OnStartGame()
 	m_nStartTime = MMatchServer::GetInstance()->GetTickTime();
 
 	m_WorldItemManager.OnStageBegin(&m_StageSetting);
+	MoveValidator.Clear();
 
 	if (GetStageType() == MST_NORMAL)
 		MMatchServer::GetInstance()->StageLaunch(GetUID());
@@ -727,6 +752,7 @@ void MMatchStage::OnStartGame()
 void MMatchStage::OnFinishGame()
 {
 	m_WorldItemManager.OnStageEnd();
+	MoveValidator.Clear();
 
 	if (m_pRule)
 	{
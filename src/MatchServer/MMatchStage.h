@@ -1,5 +1,7 @@
 #pragma once
 #include <list>
+#include <vector>
+#include <functional>
 #include "MMatchItem.h"
 #include "MMatchTransDataType.h"
 #include "MUID.h"
@@ -11,6 +13,7 @@
 #include "MMatchGlobal.h"
 #include "MUtil.h"
 #include "MovingWeaponManager.h"
+#include "MovementValidator.h"
 
 #define MTICK_STAGE			100
 
@@ -93,6 +96,8 @@ private:
 	char					m_szFirstMasterName[MATCHOBJECT_NAME_LENGTH];
 
 	u64 LastPhysicsTick = 0;
+	u64 LastWorldItemTick = 0;
+	std::vector<std::function<void()>> Deferred;
 
 	void SetMasterUID(const MUID& uid)	{ m_StageSetting.SetMasterUID(uid);}
 	MMatchRule* CreateRule(MMATCH_GAMETYPE nGameType);
@@ -109,6 +114,7 @@ protected:
 public:
 	RealSpace2::RBspObject* BspObject = nullptr;
 	MovingWeaponManager MovingWeaponMgr;
+	MovementValidator MoveValidator;
 	MMatchWorldItemManager	m_WorldItemManager;
 
 	struct Bot
@@ -180,6 +186,18 @@ public:
 	bool CheckTick(u64 nClock);
 	void Tick(u64 nClock);
 
+	// The part of the tick that only touches this stage, i.e. moving weapons and movement
+	// validation. Runs on a StageSimulator worker thread, concurrently with other stages.
+	void Simulate(u64 nClock);
+	// False if Simulate has to run on the main thread, because the map's collision queries
+	// can't run concurrently with those of other stages on the same map.
+	bool CanSimulateConcurrently() const;
+	// Queues Fn to run on the main thread once every stage has been simulated. Anything that
+	// Simulate does outside of the stage, like sending commands, has to go through here.
+	template <typename T>
+	void Defer(T&& Fn) { Deferred.emplace_back(std::forward<T>(Fn)); }
+	void RunDeferred();
+
 	MMatchStageSetting* GetStageSetting() { return &m_StageSetting; }
 
 	MMatchRule* GetRule()			{ return m_pRule; }
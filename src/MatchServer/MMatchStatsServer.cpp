@@ -0,0 +1,122 @@
+#include "stdafx.h"
+#include "MMatchStatsServer.h"
+#include "MDebug.h"
+#include <chrono>
+#ifndef _WIN32
+#include <csignal>
+#endif
+
+bool MMatchStatsServer::Create(int Port, std::function<void(std::string&)> WriteStats)
+{
+	if (!MSocket::Startup())
+		return false;
+
+#ifndef _WIN32
+	// A scraper that hangs up halfway through a response would otherwise kill the process on the
+	// next send. The game sockets go through asio, which doesn't raise it in the first place.
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	auto Socket = MSocket::socket(MSocket::AF::INET, MSocket::SOCK::STREAM, 0);
+	if (Socket == MSocket::InvalidSocket)
+		return false;
+
+	// Only reachable from this machine, since nothing here is authenticated.
+	MSocket::sockaddr_in Address{};
+	Address.sin_family = MSocket::AF::INET;
+	Address.sin_addr.s_addr = MSocket::htonl(0x7F000001);
+	Address.sin_port = MSocket::htons(Port);
+
+	if (MSocket::bind(Socket, reinterpret_cast<MSocket::sockaddr*>(&Address), sizeof(Address))
+			== MSocket::SocketError ||
+		MSocket::listen(Socket, 16) == MSocket::SocketError)
+	{
+		char ErrorString[256];
+		MSocket::GetErrorString(MSocket::GetLastError(), ErrorString);
+		MLog("MMatchStatsServer::Create -- Couldn't listen on port %d: %s\n", Port, ErrorString);
+		MSocket::closesocket(Socket);
+		return false;
+	}
+
+	ListenSocket = Socket;
+	this->WriteStats = std::move(WriteStats);
+	Stopping = false;
+	Thread = std::thread{ [this] { ThreadProc(); } };
+	return true;
+}
+
+void MMatchStatsServer::Destroy()
+{
+	if (!Thread.joinable())
+		return;
+
+	Stopping = true;
+	// Wakes the accept call. Linux does that on shutdown, Windows only on close.
+	MSocket::shutdown(ListenSocket, MSocket::SD::BOTH);
+#ifdef _WIN32
+	MSocket::closesocket(ListenSocket);
+#endif
+	Thread.join();
+#ifndef _WIN32
+	MSocket::closesocket(ListenSocket);
+#endif
+	ListenSocket = MSocket::InvalidSocket;
+}
+
+void MMatchStatsServer::ThreadProc()
+{
+	while (!Stopping)
+	{
+		auto Socket = MSocket::accept(ListenSocket, nullptr, nullptr);
+		if (Socket == MSocket::InvalidSocket)
+		{
+			// Out of descriptors or the like. Don't spin on it.
+			if (!Stopping)
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			continue;
+		}
+
+		Respond(Socket);
+		MSocket::closesocket(Socket);
+	}
+}
+
+void MMatchStatsServer::Respond(SOCKET Socket)
+{
+	// The request itself doesn't matter, but it has to be read, or closing the socket with unread
+	// data would reset the connection before the client got the response.
+	std::string Request;
+	char Buffer[1024];
+	while (Request.find("\r\n\r\n") == std::string::npos && Request.size() < 8192)
+	{
+		auto Received = MSocket::recv(Socket, Buffer, sizeof(Buffer), 0);
+		if (Received <= 0)
+			return;
+		Request.append(Buffer, Received);
+	}
+
+	std::string Body;
+	WriteStats(Body);
+
+	char Header[256];
+	sprintf_safe(Header, "HTTP/1.0 200 OK\r\n"
+		"Content-Type: text/plain; version=0.0.4\r\n"
+		"Content-Length: %zu\r\n"
+		"Connection: close\r\n\r\n", Body.size());
+	auto Response = Header + Body;
+
+	size_t Sent = 0;
+	while (Sent < Response.size())
+	{
+		auto Result = MSocket::send(Socket, Response.data() + Sent, int(Response.size() - Sent), 0);
+		if (Result <= 0)
+			return;
+		Sent += Result;
+	}
+
+	// Let the client close first, so that the TIME_WAIT ends up on its side. Otherwise the
+	// connections closed in the last minute or so keep the port from being bound on a restart.
+	MSocket::shutdown(Socket, MSocket::SD::SEND);
+	while (MSocket::recv(Socket, Buffer, sizeof(Buffer), 0) > 0)
+		;
+}
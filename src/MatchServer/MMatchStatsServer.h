@@ -0,0 +1,33 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include "MSocket.h"
+#include <string>
+#include <thread>
+#include <atomic>
+#include <functional>
+
+// Serves stats in the Prometheus text format over HTTP on 127.0.0.1, so that they can be scraped
+// or curled while the server runs. Every request gets the same response, whatever its path.
+//
+// Requests are answered one at a time on a thread of its own, so WriteStats must only read what's
+// safe to read from another thread, like the counters in MProfileStats.h.
+class MMatchStatsServer
+{
+public:
+	~MMatchStatsServer() { Destroy(); }
+
+	bool Create(int Port, std::function<void(std::string&)> WriteStats);
+	void Destroy();
+
+	bool IsCreated() const { return Thread.joinable(); }
+
+private:
+	void ThreadProc();
+	void Respond(SOCKET Socket);
+
+	SOCKET ListenSocket = MSocket::InvalidSocket;
+	std::thread Thread;
+	std::atomic<bool> Stopping{ false };
+	std::function<void(std::string&)> WriteStats;
+};
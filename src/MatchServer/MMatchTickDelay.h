@@ -0,0 +1,24 @@
+#pragma once
+
+#include "MMatchStageSetting.h"
+
+// How long the loop that calls MMatchServer::Run can wait for a Wake before the next tick is due,
+// in milliseconds. Stages that are counting down or playing are ticked as often as the clock
+// resolution the simulation uses. Everything else only needs to be looked at a few times a
+// second: schedules, pings, disconnects, clan war matching and the like.
+constexpr u32 MMATCH_ACTIVE_TICK_DELAY = 10;
+constexpr u32 MMATCH_IDLE_TICK_DELAY = 100;
+
+// Stages is a range of pointers to stages, or anything else with a GetState.
+template <typename StageRange>
+u32 MGetNextTickDelay(const StageRange& Stages)
+{
+	for (auto* Stage : Stages)
+	{
+		auto State = Stage->GetState();
+		if (State == STAGE_STATE_COUNTDOWN || State == STAGE_STATE_RUN)
+			return MMATCH_ACTIVE_TICK_DELAY;
+	}
+
+	return MMATCH_IDLE_TICK_DELAY;
+}
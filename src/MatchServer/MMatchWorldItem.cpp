@@ -8,14 +8,20 @@
 #include "MZFileSystem.h"
 #include "MUID.h"
 #include "MMatchWorldItemDesc.h"
+#include "MMatchPickup.h"
 #include "RTypes.h"
 #include <algorithm>
 
+constexpr float MMatchWorldItemManager::PickupRadius;
+constexpr float MMatchWorldItemManager::MaxPickupSweep;
+
 void MMatchWorldItemManager::ClearItems()
 {
 	m_nLastTime = 0;
 	m_nUIDGenerate = 0;
 	m_ItemMap.clear();
+	m_ItemGrid.Clear();
+	m_LastPlayerPositions.clear();
 }
 
 void MMatchWorldItemManager::Clear()
@@ -79,7 +85,7 @@ void MMatchWorldItemManager::Update()
 	}
 
 	// Remove worlditems that have been alive for too long
-	for (auto it = m_ItemMap.begin(); it != m_ItemMap.end(); it++)
+	for (auto it = m_ItemMap.begin(); it != m_ItemMap.end();)
 	{
 		auto& WorldItem = it->second;
 		
@@ -90,39 +96,55 @@ void MMatchWorldItemManager::Update()
 			if (WorldItem.nLifeTime <= 0)
 			{
 				RouteRemoveWorldItem(WorldItem.nUID);
+				m_ItemGrid.Remove(WorldItem.Origin.x, WorldItem.Origin.y, WorldItem.nUID);
 				it = m_ItemMap.erase(it);
-				if (it == m_ItemMap.end())
-					break;
+				continue;
 			}
 		}
+		++it;
 	}
 	
 	if (m_pMatchStage->GetStageSetting()->GetNetcode() == NetcodeType::ServerBased)
+		UpdatePickups();
+
+	m_nLastTime = nNowTime;
+}
+
+void MMatchWorldItemManager::UpdatePickups()
+{
+	m_PlayerPositions.clear();
+	for (auto* Player : m_pMatchStage->GetObjectList())
+		m_PlayerPositions.push_back({ Player->GetUID(), Player->GetPosition(), Player });
+
+	for (auto& Player : m_PlayerPositions)
 	{
-		auto WORLDITEM_PICKUP_RADIUS = 100.0f;
-		for (auto it = m_ItemMap.begin(); it != m_ItemMap.end();)
-		{
-			auto& WorldItem = it->second;
+		if (m_ItemMap.empty())
+			break;
 
-			bool PickedUp = false;
-			for (auto* Player : m_pMatchStage->GetObjectList())
+		// Test the whole path since the last tick.
+		auto From = Player.Position;
+		for (auto& Last : m_LastPlayerPositions)
+		{
+			if (Last.UID == Player.UID)
 			{
-				if (RealSpace2::Magnitude(WorldItem.Origin - Player->GetPosition()) < WORLDITEM_PICKUP_RADIUS)
-				{
-					// This takes care of deleting them also
-					it = std::next(it);
-					Obtain(Player, WorldItem.nUID);
-					PickedUp = true;
-					break;
-				}
+				From = MGetPickupSweepStart(Last.Position, Player.Position, MaxPickupSweep);
+				break;
 			}
-
-			if (!PickedUp)
-				it++;
 		}
+
+		m_PickedUp.clear();
+		MFindPickups(m_ItemGrid, From, Player.Position, PickupRadius,
+			[&](unsigned short nUID) -> const v3* {
+				auto it = m_ItemMap.find(nUID);
+				return it != m_ItemMap.end() ? &it->second.Origin : nullptr;
+			}, m_PickedUp);
+
+		// Obtain takes it out of the grid, so it can't be called while going through it.
+		for (auto nUID : m_PickedUp)
+			Obtain(Player.Object, nUID);
 	}
 
-	m_nLastTime = nNowTime;
+	std::swap(m_LastPlayerPositions, m_PlayerPositions);
 }
 
 static void Make_MTDWorldItem(MTD_WorldItem* pOut, MMatchWorldItem* pWorldItem)
@@ -182,6 +204,7 @@ void MMatchWorldItemManager::AddItem(const unsigned short nItemID, short nSpawnI
 		val = 0;
 
 	m_ItemMap.emplace(m_nUIDGenerate, NewWorldItem);
+	m_ItemGrid.Add(x, y, NewWorldItem.nUID);
 
 	RouteSpawnWorldItem(&NewWorldItem);
 }
@@ -203,6 +226,7 @@ void MMatchWorldItemManager::AddItem(const unsigned short nItemID, short nSpawnI
 		NewWorldItem.nExtraValue[i] = pnExtraValues[i];
 
 	m_ItemMap.emplace(m_nUIDGenerate, NewWorldItem);
+	m_ItemGrid.Add(x, y, NewWorldItem.nUID);
 
 	RouteSpawnWorldItem(&NewWorldItem);
 }
@@ -297,6 +321,7 @@ void MMatchWorldItemManager::DelItem(MMatchWorldItemMap::iterator it)
 		m_SpawnInfos[nSpawnIndex].nElapsedTime = 0;
 	}
 
+	m_ItemGrid.Remove(it->second.Origin.x, it->second.Origin.y, it->second.nUID);
 	m_ItemMap.erase(it);
 }
 
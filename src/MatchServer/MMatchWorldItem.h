@@ -8,6 +8,7 @@
 #include "GlobalTypes.h"
 #include "MUID.h"
 #include "MMatchWorldItemDesc.h"
+#include "MHashGrid.h"
 
 using MMatchWorldItemMap = std::unordered_map<unsigned short, MMatchWorldItem>;
 
@@ -23,6 +24,23 @@ private:
 	short								m_nUIDGenerate = 0;
 	bool								m_bStarted = false;
 
+	// With server-based netcode, the items are picked up by the server, by whoever comes within
+	// PickupRadius of them. The items are bucketed by position so that each player only has to be
+	// tested against the ones near the path they took since the last tick.
+	struct PlayerPosition
+	{
+		MUID UID;
+		v3 Position;
+		// Only valid during the tick the position is from.
+		MMatchObject* Object;
+	};
+	MHashGrid<unsigned short>			m_ItemGrid{ PickupRadius * 2 };
+	std::vector<PlayerPosition>			m_LastPlayerPositions;
+	std::vector<PlayerPosition>			m_PlayerPositions;
+	std::vector<unsigned short>			m_PickedUp;
+
+	void UpdatePickups();
+
 	void AddItem(const unsigned short nItemID, short nSpawnIndex, 
 				 const float x, const float y, const float z);
 	void AddItem(const unsigned short nItemID, short nSpawnIndex, 
@@ -38,6 +56,11 @@ private:
 	void RouteObtainWorldItem(const MUID& uidPlayer, int nWorldItemUID);
 	void RouteRemoveWorldItem(int nWorldItemUID);
 public:
+	static constexpr float PickupRadius = 100.0f;
+	// Anyone who moved further than this in one tick has respawned or teleported, rather than
+	// run past the items in between.
+	static constexpr float MaxPickupSweep = 500.0f;
+
 	MMatchWorldItemManager(MMatchStage* Stage) : m_pMatchStage(Stage) {}
 
 	void OnRoundBegin();
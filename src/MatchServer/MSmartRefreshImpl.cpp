@@ -3,6 +3,7 @@
 #include "MMatchServer.h"
 #include "MMatchObject.h"
 #include "MMatchChannel.h"
+#include "MHash.h"
 
 
 //// MRefreshCategoryChannel ////
@@ -43,21 +44,30 @@ bool MRefreshClientChannelImpl::OnSync(u32 nChecksum)
 bool MRefreshCategoryClanMemberImpl::OnUpdateChecksum(u64 nTick)
 {
 	MMatchClan* pClan = GetMatchClan();
-	u32 nChecksum = 0;
+
+	// Covers everything in the member list and mixes it in instead of summing it, since
+	// MMatchClan also uses it to tell when its encoded member list is out of date, and two
+	// members trading places shouldn't look like nothing happened.
+	u64 nHash = 0;
+	auto Mix = [&](u64 nValue) { nHash = HashMix64(nHash ^ nValue); };
 	for (auto itor= pClan->GetMemberBegin(); itor != pClan->GetMemberEnd(); ++itor)
 	{
 		MMatchObject* pObj = itor->second;
 
-		nChecksum += pObj->GetUID().High;
-		nChecksum += pObj->GetUID().Low;
-		nChecksum += pObj->GetPlace();
+		Mix(pObj->GetUID().AsU64());
+		Mix(pObj->GetPlace());
 
 		if (pObj->GetCharInfo())
 		{
-			nChecksum += pObj->GetCharInfo()->m_ClanInfo.m_nClanID;
-			nChecksum += pObj->GetCharInfo()->m_ClanInfo.m_nGrade;
+			Mix(pObj->GetCharInfo()->m_ClanInfo.m_nClanID);
+			Mix(pObj->GetCharInfo()->m_ClanInfo.m_nGrade);
+			Mix(pObj->GetCharInfo()->m_nLevel);
 		}
 	}
+
+	// 0 is what a client that has to be sent the list is set to.
+	u32 nChecksum = u32(nHash ^ (nHash >> 32));
+	if (nChecksum == 0) nChecksum = 1;
 	SetChecksum(nChecksum);
 	return true;
 }
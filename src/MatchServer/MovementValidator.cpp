@@ -0,0 +1,135 @@
+#include "stdafx.h"
+#include "MovementValidator.h"
+#include "MMatchStage.h"
+#include "MMatchServer.h"
+
+// The client moves characters by sweeping a cylinder of the character's radius and this height,
+// this far above their feet. The server sweeps a slightly thinner one, so that moves that only
+// scrape along a wall aren't counted.
+static constexpr float CollisionUpHeight = 120.f;
+static constexpr float CollisionHeight = 60.f;
+static constexpr float CollisionRadius = 35.f - 5.f;
+
+// How far the sweep may be pushed back before it counts as going through a wall.
+static constexpr float MaxCorrection = 20.f;
+
+// A player who rounds a corner between two basic infos is swept in a straight line that cuts
+// through the corner, and CheckWall leaves them stuck against the wall short of where they
+// are. Before counting the move, it's swept again from there, as the player would have kept
+// walking along the wall, up to this many times.
+static constexpr int MaxCornerSlides = 2;
+
+bool MovementValidator::AddSweep(MMatchObject& Obj, size_t& Count)
+{
+	auto& State = Players[Obj.GetUID()];
+
+	if (!Obj.IsAlive() || Obj.BasicInfoHistory.empty())
+	{
+		State.LastRecvTime = -1;
+		return true;
+	}
+
+	auto& Latest = Obj.BasicInfoHistory.front();
+	if (Latest.RecvTime == State.LastRecvTime)
+		return true;
+
+	if (State.LastRecvTime < 0)
+	{
+		State.LastPos = Latest.position;
+		State.LastRecvTime = Latest.RecvTime;
+		return true;
+	}
+
+	if (Count == MaxSweepsPerUpdate)
+		return false;
+
+	const v3 Up{ 0, 0, CollisionUpHeight };
+	SweepOwners[Count] = &Obj;
+	Sweeps[Count] = { State.LastPos + Up, Latest.position + Up, CollisionRadius, CollisionHeight };
+	++Count;
+
+	// Go on from the reported position either way, so that a player who went through a wall
+	// is counted once, and not again for every move on the other side.
+	State.LastPos = Latest.position;
+	State.LastRecvTime = Latest.RecvTime;
+	LastChecked = Obj.GetUID();
+
+	return true;
+}
+
+void MovementValidator::Update()
+{
+	auto* Bsp = Stage->BspObject;
+	if (!Bsp)
+		return;
+
+	auto Begin = Stage->GetObjBegin();
+	auto End = Stage->GetObjEnd();
+	auto Start = std::find_if(Begin, End, [&](auto& Pair) { return LastChecked < Pair.first; });
+
+	size_t Count = 0;
+	bool Full = false;
+	for (auto it = Start; it != End && !Full; ++it)
+		Full = !AddSweep(*it->second, Count);
+	for (auto it = Begin; it != Start && !Full; ++it)
+		Full = !AddSweep(*it->second, Count);
+
+	if (Count == 0)
+		return;
+
+	for (int Slide = 0; ; ++Slide)
+	{
+		if (Bsp->CheckWalls(Query, Sweeps, Count, Results, Hits) == 0)
+			return;
+
+		// Keep the sweeps that got stuck at the front, continued from where they got stuck.
+		size_t Blocked = 0;
+		for (size_t i = 0; i < Count; ++i)
+		{
+			if (!Hits[i] || RealSpace2::MagnitudeSq(Results[i] - Sweeps[i].To) <= MaxCorrection * MaxCorrection)
+				continue;
+
+			SweepOwners[Blocked] = SweepOwners[i];
+			Sweeps[Blocked] = { Results[i], Sweeps[i].To, CollisionRadius, CollisionHeight };
+			++Blocked;
+		}
+
+		Count = Blocked;
+		if (Count == 0)
+			return;
+		if (Slide == MaxCornerSlides)
+			break;
+	}
+
+	for (size_t i = 0; i < Count; ++i)
+	{
+		auto& Obj = *SweepOwners[i];
+		auto& State = Players[Obj.GetUID()];
+		++State.Violations;
+
+		// Update runs on a stage worker thread, and the log isn't safe to write to from there.
+		// Everything is copied, since the player may be gone by the time it runs.
+		auto To = Sweeps[i].To;
+		auto Violations = State.Violations;
+		std::string Name = Obj.GetName();
+		Stage->Defer([=] {
+			MGetMatchServer()->LogF(MMatchServer::LOG_PROG,
+				"MovementValidator: %s moved through a wall to (%.0f, %.0f, %.0f), %u time(s) this game",
+				Name.c_str(), To.x, To.y, To.z - CollisionUpHeight, Violations);
+		});
+	}
+}
+
+void MovementValidator::Clear()
+{
+	Players.clear();
+	LastChecked = MUID{};
+}
+
+u32 MovementValidator::GetViolationCount(const MUID& uidPlayer) const
+{
+	auto it = Players.find(uidPlayer);
+	if (it == Players.end())
+		return 0;
+	return it->second.Violations;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include "MUID.h"
+#include "RBspObject.h"
+#include <unordered_map>
+
+class MMatchStage;
+
+// Checks the positions that players report in their basic info against the map's collision
+// geometry, and counts the moves that went through walls. Only stages with server-based netcode
+// keep the basic info history that this relies on.
+//
+// An update checks at most MaxSweepsPerUpdate players, taking turns in UID order, with one
+// batched collision query, and a couple more for the moves that got stuck on a wall, so its cost
+// doesn't grow with the number of players. A player that
+// isn't checked in one update has their whole move since their last check swept in a later one.
+class MovementValidator
+{
+public:
+	MovementValidator(MMatchStage& Stage)
+		: Stage(&Stage)
+	{ }
+
+	void Update();
+	void Clear();
+
+	// The number of moves through walls the player has made since the last Clear.
+	u32 GetViolationCount(const MUID& uidPlayer) const;
+
+	static constexpr size_t MaxSweepsPerUpdate = 32;
+
+private:
+	struct PlayerState
+	{
+		v3 LastPos;
+		// RecvTime of the basic info LastPos came from, or negative if there's nothing to
+		// sweep from, e.g. because the player just spawned.
+		double LastRecvTime = -1;
+		u32 Violations = 0;
+	};
+
+	// Queues a sweep for Obj's latest move, if it has made one. Returns false if there's no
+	// room left in this update.
+	bool AddSweep(MMatchObject& Obj, size_t& Count);
+
+	MMatchStage* Stage;
+	std::unordered_map<MUID, PlayerState> Players;
+	// The last player checked. The next update starts with the one after it.
+	MUID LastChecked;
+
+	MMatchObject* SweepOwners[MaxSweepsPerUpdate];
+	RealSpace2::RWALLSWEEP Sweeps[MaxSweepsPerUpdate];
+	rvector Results[MaxSweepsPerUpdate];
+	bool Hits[MaxSweepsPerUpdate];
+	RealSpace2::RCollisionQuery Query;
+};
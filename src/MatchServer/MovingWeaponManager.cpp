@@ -18,84 +18,181 @@ static std::enable_if_t<!has_Update<std::remove_reference_t<T>>::value, bool> Tr
 	MovingWeaponManager& Mgr, float Elapsed)
 { return true; }
 
+constexpr float ItemKit::Radius;
+constexpr float Rocket::Radius;
+constexpr float Grenade::Radius;
+constexpr float MovingWeaponManager::StepTime;
+constexpr int MovingWeaponManager::MaxStepsPerUpdate;
+
 void MovingWeaponManager::Update(float Elapsed)
 {
-	using namespace RealSpace2;
+	Accumulator = (std::min)(Accumulator + Elapsed, StepTime * MaxStepsPerUpdate);
+	const auto Steps = int(Accumulator / StepTime);
+	if (Steps == 0)
+		return;
+	Accumulator -= Steps * StepTime;
+
+	// The steps catch up to now, so the players are rewound to the time each one ends at.
+	const auto Now = MGetMatchServer()->GetGlobalClockCount() / 1000.0;
+	for (int i = 0; i < Steps; ++i)
+		Step(Now - (Steps - 1 - i) * double(StepTime));
+}
+
+void MovingWeaponManager::Step(double Time)
+{
+	Targets.clear();
+	for (auto* Obj : Stage->GetObjectList())
+	{
+		if (Obj->IsDead())
+			continue;
+
+		Target Tar;
+		Tar.Object = Obj;
+		Obj->GetPositions(&Tar.Head, &Tar.Foot, Time);
+		Targets.push_back(Tar);
+	}
+
+	Moves.clear();
 	Weapons.apply([&](auto& Obj)
 	{
-		if (!TryUpdate(Obj, *this, Elapsed))
+		if (!TryUpdate(Obj, *this, StepTime))
 			return false;
 
-		auto diff = Obj.Vel * Elapsed;
-		auto dir = diff;
-		Normalize(dir);
-		auto dist = Magnitude(diff);
+		Move NewMove{};
+		NewMove.From = Obj.Pos;
+		NewMove.To = Obj.Pos + Obj.Vel * StepTime;
+		NewMove.Radius = std::remove_reference_t<decltype(Obj)>::Radius;
+		Moves.push_back(NewMove);
+		return true;
+	});
+
+	CheckMoves();
+
+	// apply goes through the weapons in the same order every time, so the moves line up with them.
+	size_t Index = 0;
+	Weapons.apply([&](auto& Obj)
+	{
+		auto& Result = Moves[Index++];
+		if (!Result.Hit)
+		{
+			Obj.Pos = Result.To;
+			return true;
+		}
+
+		return Obj.OnCollision(*this, Result.HitPos, Result.Normal, Result.PickInfo);
+	});
+}
+
+static RMeshPartsType GetHitParts(ZOBJECTHITTEST HitTest)
+{
+	switch (HitTest)
+	{
+	case ZOH_HEAD: return eq_parts_head;
+	case ZOH_BODY: return eq_parts_chest;
+	case ZOH_LEGS: return eq_parts_legs;
+	default: return eq_parts_etc;
+	}
+}
+
+void MovingWeaponManager::CheckMoves()
+{
+	using namespace RealSpace2;
+	auto* Map = Stage->BspObject;
 
-		auto PickFlag = RM_FLAG_ADDITIVE | RM_FLAG_HIDE | RM_FLAG_PASSROCKET;
-		auto Time = MGetMatchServer()->GetGlobalClockCount() / 1000.0;
+	// The spheres are swept through the map in one batch. The rays are picked one at a time,
+	// since they go through what the map lets rockets through, which its collision doesn't know.
+	Sweeps.clear();
+	SweepMoves.clear();
+	for (size_t i = 0; i < Moves.size(); ++i)
+	{
+		auto& Move = Moves[i];
+		if (!Map || Move.From == Move.To)
+			continue;
 
-		v3 pickpos;
-		MPICKINFO pi;
-		bool bPicked = PickHistory(nullptr, Obj.Pos, Obj.Pos + diff, Stage->BspObject, pi,
-			Stage->GetObjectList(), Time, PickFlag);
-		if (bPicked)
+		if (Move.Radius > 0)
 		{
-			if (pi.bBspPicked)
-			{
-				pickpos = pi.bpi.PickPos;
-			}
-			else if (pi.pObject)
-			{
-#ifdef REFLECT_ROCKETS
-				if (zpi.pObject->IsGuard() && DotProduct(zpi.pObject->GetDirection(), m_Dir) < 0)
-				{
-					auto ReflectedDir = RealSpace2::GetReflectionVector(m_Dir, zpi.pObject->GetDirection());
-					auto ReflectedVel = RealSpace2::GetReflectionVector(m_Velocity, zpi.pObject->GetDirection());
-
-					m_Dir = ReflectedDir;
-					m_Velocity = ReflectedVel;
-
-					diff = m_Velocity * fElapsedTime;
-					dir = diff;
-					Normalize(dir);
-
-					bPicked = false;
-				}
-#endif
-
-				pickpos = pi.info.vOut;
-			}
+			Sweeps.push_back({ Move.From, Move.To, Move.Radius });
+			SweepMoves.push_back(u32(i));
+			continue;
 		}
 
-		v3 Normal;
-		if (pi.bBspPicked)
+		auto& bpi = Move.PickInfo.bpi;
+		if (!Map->PickTo(Move.From, Move.To, &bpi, RM_FLAG_ADDITIVE | RM_FLAG_HIDE | RM_FLAG_PASSROCKET))
+			continue;
+
+		auto& Plane = bpi.pNode->pInfo[bpi.nIndex].plane;
+		Move.Hit = true;
+		Move.HitPos = bpi.PickPos;
+		Move.Normal = v3(Plane.a, Plane.b, Plane.c);
+		Move.PickInfo.bBspPicked = true;
+	}
+
+	if (!Sweeps.empty())
+	{
+		SweepHits.resize(Sweeps.size());
+		Map->SweepSpheres(Query, Sweeps.data(), Sweeps.size(), SweepHits.data());
+		for (size_t i = 0; i < Sweeps.size(); ++i)
 		{
-			rplane& plane = pi.bpi.pNode->pInfo[pi.bpi.nIndex].plane;
-			Normal = rvector(plane.a, plane.b, plane.c);
+			auto& Hit = SweepHits[i];
+			if (!Hit.Hit)
+				continue;
+
+			auto& Move = Moves[SweepMoves[i]];
+			Move.Hit = true;
+			Move.HitPos = Hit.Pos;
+			Move.Normal = Hit.Normal;
+			Move.PickInfo.bBspPicked = true;
+			Move.PickInfo.bpi.PickPos = Hit.Pos;
 		}
-		else if (pi.pObject)
+	}
+
+	// A player takes the hit instead if they're closer than what was hit on the map.
+	for (auto& Move : Moves)
+	{
+		if (Move.From == Move.To)
+			continue;
+
+		const Target* HitTarget = nullptr;
+		auto BestDistSq = Move.Hit ? MagnitudeSq(Move.HitPos - Move.From) : FLT_MAX;
+		for (auto& Tar : Targets)
 		{
-			v3 Origin;
-			pi.pObject->GetPositions(nullptr, &Origin, Time);
-			if (Origin.z + 30.f <= pickpos.z && pickpos.z <= Origin.z + 160.f)
-			{
-				Normal = pickpos - Origin;
-				Normal.z = 0;
-			}
-			else
-			{
-				Normal = pickpos - (Origin + v3(0, 0, 90));
-			}
-			Normalize(Normal);
+			v3 HitPos;
+			auto HitTest = PlayerHitTest(Tar.Head, Tar.Foot, Move.From, Move.To, &HitPos);
+			if (HitTest == ZOH_NONE)
+				continue;
+
+			auto DistSq = MagnitudeSq(HitPos - Move.From);
+			if (DistSq >= BestDistSq)
+				continue;
+
+			BestDistSq = DistSq;
+			HitTarget = &Tar;
+			Move.HitPos = HitPos;
+			Move.PickInfo.info.parts = GetHitParts(HitTest);
 		}
 
-		if (bPicked && Magnitude(pickpos - Obj.Pos) < dist && !Obj.OnCollision(*this, pickpos, Normal, pi))
-			return false;
-		else
-			Obj.Pos += diff;
+		if (!HitTarget)
+			continue;
 
-		return true;
-	});
+		Move.Hit = true;
+		Move.PickInfo.bBspPicked = false;
+		Move.PickInfo.pObject = HitTarget->Object;
+		Move.PickInfo.info.vOut = Move.HitPos;
+
+		// Off the side of the body if it hit between the legs and the head, and off the middle of
+		// it otherwise.
+		auto& Origin = HitTarget->Foot;
+		if (Origin.z + 30.f <= Move.HitPos.z && Move.HitPos.z <= Origin.z + 160.f)
+		{
+			Move.Normal = Move.HitPos - Origin;
+			Move.Normal.z = 0;
+		}
+		else
+		{
+			Move.Normal = Move.HitPos - (Origin + v3(0, 0, 90));
+		}
+		Normalize(Move.Normal);
+	}
 }
 
 void MovingWeaponManager::AddRocket(MMatchObject* Owner, MMatchItemDesc* ItemDesc,
@@ -123,21 +220,30 @@ static void Explosion(MovingWeaponManager& Mgr, const v3& Pos, MMatchObject* Own
 	if (Mgr.Stage->GetStageSetting()->GetGameType() == MMATCH_GAMETYPE_SKILLMAP)
 		return;
 
-	auto GetOrigin = [&](const auto& Obj, auto& Origin)
-	{
-		u64 RealTime = MGetMatchServer()->GetGlobalClockCount();
-		float CompensatedTime = 0;
-		if (&Obj == Owner)
-			CompensatedTime = RealTime / 1000.f;
-		else
-			CompensatedTime = (RealTime - Owner->GetPing()) / 1000.f;
+	// Damage is sent to the players and can end the round, so it's applied on the main thread.
+	// The owner is looked up again there, since they may have left in the meantime.
+	const auto OwnerUID = Owner->GetUID();
+	Mgr.Stage->Defer([=, &Mgr] {
+		auto* Owner = MGetMatchServer()->GetObject(OwnerUID);
+		if (!Owner)
+			return;
 
-		Obj.GetPositions(nullptr, &Origin, CompensatedTime);
-	};
+		auto GetOrigin = [&](const auto& Obj, auto& Origin)
+		{
+			u64 RealTime = MGetMatchServer()->GetGlobalClockCount();
+			float CompensatedTime = 0;
+			if (&Obj == Owner)
+				CompensatedTime = RealTime / 1000.f;
+			else
+				CompensatedTime = (RealTime - Owner->GetPing()) / 1000.f;
 
-	GrenadeExplosion(*Owner, Mgr.Stage->GetObjectList(), Pos, ItemDesc->m_nDamage,
-		Range, MinimumDamage, Knockback,
-		GetOrigin);
+			Obj.GetPositions(nullptr, &Origin, CompensatedTime);
+		};
+
+		GrenadeExplosion(*Owner, Mgr.Stage->GetObjectList(), Pos, ItemDesc->m_nDamage,
+			Range, MinimumDamage, Knockback,
+			GetOrigin);
+	});
 }
 
 bool Rocket::OnCollision(MovingWeaponManager& Mgr, const v3& ColPos, const v3& Normal, const MPICKINFO& pi)
@@ -209,7 +315,12 @@ bool ItemKit::Update(MovingWeaponManager & Mgr, float Elapsed)
 	if (bPicked && fabsf(RealSpace2::Magnitude(rpi.PickPos - Pos)) > 5.0f)
 		return true;
 
-	Mgr.Stage->m_WorldItemManager.SpawnDynamicItem(GetWorldItemID(ItemDesc), Pos.x, Pos.y, Pos.z);
+	auto* Stage = Mgr.Stage;
+	auto* Desc = ItemDesc;
+	auto SpawnPos = Pos;
+	Stage->Defer([=] {
+		Stage->m_WorldItemManager.SpawnDynamicItem(GetWorldItemID(Desc), SpawnPos.x, SpawnPos.y, SpawnPos.z);
+	});
 
 	return false;
 }
\ No newline at end of file
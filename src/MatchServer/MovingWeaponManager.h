@@ -4,9 +4,9 @@
 #include <vector>
 #include "MMatchItem.h"
 #include "MultiVector.h"
+#include "MPickInfo.h"
 
 class MovingWeaponManager;
-struct MPICKINFO;
 
 struct MovingWeapon
 {
@@ -20,10 +20,14 @@ struct MovingWeapon
 	{ }
 };
 
+// Radius is the size of the sphere each weapon is swept through the map as. Zero means it's picked
+// with a ray instead, like the clients do.
 struct ItemKit : MovingWeapon
 {
 	using MovingWeapon::MovingWeapon;
 
+	static constexpr float Radius = 2.0f;
+
 	bool OnCollision(MovingWeaponManager& Mgr, const v3& ColPos, const v3& Normal, const MPICKINFO&);
 	bool Update(MovingWeaponManager& Mgr, float Elapsed);
 };
@@ -32,6 +36,9 @@ struct Rocket : MovingWeapon
 {
 	using MovingWeapon::MovingWeapon;
 
+	// A sphere can't go through the surfaces the map lets rockets through.
+	static constexpr float Radius = 0.0f;
+
 	bool OnCollision(MovingWeaponManager& Mgr, const v3& ColPos, const v3& Normal, const MPICKINFO&);
 };
 
@@ -39,12 +46,18 @@ struct Grenade : MovingWeapon
 {
 	using MovingWeapon::MovingWeapon;
 
+	static constexpr float Radius = 2.0f;
+
 	float Lifetime = 0.0f;
 
 	bool OnCollision(MovingWeaponManager& Mgr, const v3& ColPos, const v3& Normal, const MPICKINFO&);
 	bool Update(MovingWeaponManager& Mgr, float Elapsed);
 };
 
+// Moves the weapons in fixed steps of StepTime, however long it's been since the last Update, so
+// that a weapon takes the same path and lands in the same place whatever the stage's tick rate.
+// In each step, every player's hitbox is rewound once, and every weapon's move is checked against
+// the map in one batch and against the rewound hitboxes.
 class MovingWeaponManager
 {
 public:
@@ -59,6 +72,40 @@ public:
 
 	class MMatchStage* Stage;
 
+	static constexpr float StepTime = 0.01f;
+	// Any more time than this in one Update is dropped, so that a stage that falls behind doesn't
+	// fall further behind catching up.
+	static constexpr int MaxStepsPerUpdate = 10;
+
 private:
+	struct Target
+	{
+		MMatchObject* Object;
+		v3 Head;
+		v3 Foot;
+	};
+
+	struct Move
+	{
+		v3 From;
+		v3 To;
+		float Radius;
+		bool Hit;
+		v3 HitPos;
+		v3 Normal;
+		MPICKINFO PickInfo;
+	};
+
+	void Step(double Time);
+	void CheckMoves();
+
 	MultiVector<ItemKit, Rocket, Grenade> Weapons;
+	float Accumulator = 0;
+
+	std::vector<Target> Targets;
+	std::vector<Move> Moves;
+	std::vector<RealSpace2::RSPHERESWEEP> Sweeps;
+	std::vector<u32> SweepMoves;
+	std::vector<RealSpace2::RSWEEPHIT> SweepHits;
+	RealSpace2::RCollisionQuery Query;
 };
\ No newline at end of file
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+class MMatchStage;
+
+// Runs the stage-local part of each stage's tick, MMatchStage::Simulate, on a pool of worker
+// threads, so that the collision queries of busy stages don't hold up the rest of the server.
+//
+// Simulate may only touch state owned by its own stage, plus data that is read-only while the
+// server runs, like the map geometry. Anything that reaches the rest of the server (posting
+// commands, logging, database jobs) is queued with MMatchStage::Defer instead. Once every stage
+// has been simulated, Run executes the deferred work on the calling thread, one stage at a time
+// in the order the stages were given, so that it sees the server exactly as it would if the
+// stages had been ticked one after another.
+//
+// Stages whose map can't be queried from several threads at once (see
+// RBspObject::SupportsConcurrentQueries) are simulated on the calling thread, while the workers
+// take the others.
+//
+// StageType only needs Simulate, RunDeferred and CanSimulateConcurrently, so that the
+// scheduling can be tested and benchmarked without a server.
+template <typename StageType>
+class TStageSimulator
+{
+public:
+	~TStageSimulator() { Destroy(); }
+
+	// With ThreadCount 0, Run simulates every stage on the calling thread.
+	void Create(int ThreadCount);
+	void Destroy();
+
+	void Run(const std::vector<StageType*>& Stages, u64 nClock);
+
+	int GetThreadCount() const { return static_cast<int>(Threads.size()); }
+
+private:
+	void WorkerThread();
+	// Simulates stages from the current batch until there are none left to claim.
+	void Work(const std::vector<StageType*>& Stages, u64 nClock);
+
+	std::vector<std::thread> Threads;
+
+	// The stages of the current Run that the workers may take, and those that stay on the
+	// calling thread.
+	std::vector<StageType*> ConcurrentStages;
+	std::vector<StageType*> SerialStages;
+
+	std::mutex Mutex;
+	std::condition_variable BatchReady;
+	std::condition_variable BatchDone;
+	bool Stopping = false;
+	// Incremented for every batch, so that workers can tell a new batch from the one they just did.
+	u64 Generation = 0;
+	// The current batch, or nullptr between batches.
+	const std::vector<StageType*>* Batch = nullptr;
+	u64 BatchClock = 0;
+	// Workers that are inside Work. Run doesn't return until this drops back to zero.
+	int ActiveWorkers = 0;
+	std::atomic<size_t> NextStage{ 0 };
+};
+
+using StageSimulator = TStageSimulator<MMatchStage>;
+
+template <typename StageType>
+void TStageSimulator<StageType>::Create(int ThreadCount)
+{
+	Destroy();
+
+	Stopping = false;
+	Threads.reserve(ThreadCount);
+	for (int i = 0; i < ThreadCount; ++i)
+		Threads.emplace_back([this] { WorkerThread(); });
+}
+
+template <typename StageType>
+void TStageSimulator<StageType>::Destroy()
+{
+	{
+		std::lock_guard<std::mutex> Lock{ Mutex };
+		Stopping = true;
+	}
+	BatchReady.notify_all();
+
+	for (auto& Thread : Threads)
+		Thread.join();
+	Threads.clear();
+}
+
+template <typename StageType>
+void TStageSimulator<StageType>::Run(const std::vector<StageType*>& Stages, u64 nClock)
+{
+	ConcurrentStages.clear();
+	SerialStages.clear();
+	for (auto* Stage : Stages)
+	{
+		if (Stage->CanSimulateConcurrently())
+			ConcurrentStages.push_back(Stage);
+		else
+			SerialStages.push_back(Stage);
+	}
+
+	// Not worth waking the workers for one stage.
+	if (Threads.empty() || ConcurrentStages.size() <= 1)
+	{
+		for (auto* Stage : Stages)
+			Stage->Simulate(nClock);
+	}
+	else
+	{
+		{
+			std::lock_guard<std::mutex> Lock{ Mutex };
+			Batch = &ConcurrentStages;
+			BatchClock = nClock;
+			NextStage = 0;
+			++Generation;
+		}
+		BatchReady.notify_all();
+
+		for (auto* Stage : SerialStages)
+			Stage->Simulate(nClock);
+
+		Work(ConcurrentStages, nClock);
+
+		// Every stage has been claimed by now, and whoever claimed one is counted as active
+		// until they're done with it.
+		std::unique_lock<std::mutex> Lock{ Mutex };
+		BatchDone.wait(Lock, [&] { return ActiveWorkers == 0; });
+		Batch = nullptr;
+	}
+
+	for (auto* Stage : Stages)
+		Stage->RunDeferred();
+}
+
+template <typename StageType>
+void TStageSimulator<StageType>::WorkerThread()
+{
+	u64 LastGeneration = 0;
+
+	std::unique_lock<std::mutex> Lock{ Mutex };
+	while (true)
+	{
+		BatchReady.wait(Lock, [&] { return Stopping || Generation != LastGeneration; });
+		if (Stopping)
+			return;
+
+		LastGeneration = Generation;
+		// The batch may have been finished by the others before this thread woke up.
+		if (!Batch)
+			continue;
+
+		auto& Stages = *Batch;
+		auto nClock = BatchClock;
+		++ActiveWorkers;
+		Lock.unlock();
+
+		Work(Stages, nClock);
+
+		Lock.lock();
+		if (--ActiveWorkers == 0)
+			BatchDone.notify_one();
+	}
+}
+
+template <typename StageType>
+void TStageSimulator<StageType>::Work(const std::vector<StageType*>& Stages, u64 nClock)
+{
+	while (true)
+	{
+		const auto Index = NextStage.fetch_add(1, std::memory_order_relaxed);
+		if (Index >= Stages.size())
+			return;
+
+		Stages[Index]->Simulate(nClock);
+	}
+}
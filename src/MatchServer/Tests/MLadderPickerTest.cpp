@@ -0,0 +1,219 @@
+#include "MLadderPicker.h"
+#include "MTest.h"
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
+// Simulates ladder matchmaking with MLadderPicker's rules: groups arrive over a number of
+// ticks, wait, and get paired. Checks that every pair passes EvaluateTicket, that nobody is
+// matched twice or against their own clan, that nobody who has waited out the thresholds is
+// left behind, and that the picker takes the highest rated opponent it may. Reports how long
+// groups wait, how even the matches are, and how long a tick takes.
+
+namespace {
+
+// Stands in for MLadderStatistics: the side with more levels or points wins more often the
+// bigger the difference is.
+struct TestStatistics
+{
+	float GetLevelVictoriesRate(int nLevelDiff) { return (std::min)(1.f, 0.5f + nLevelDiff / 40.f); }
+	float GetClanPointVictoriesRate(int nClanPointDiff) { return (std::min)(1.f, 0.5f + nClanPointDiff / 800.f); }
+	float GetContPointVictoriesRate(int nContPointDiff) { return (std::min)(1.f, 0.5f + nContPointDiff / 2000.f); }
+};
+
+using TestPicker = TLadderPicker<TestStatistics>;
+
+MLadderTicket MakeTicket(int nGroupID, int nCLID, int nCharLevel, int nClanPoint, int nTickCount)
+{
+	MLadderTicket Ticket;
+	Ticket.nGroupID = nGroupID;
+	Ticket.nCLID = nCLID;
+	Ticket.nCharLevel = nCharLevel;
+	Ticket.nContPoint = 0;
+	Ticket.nClanPoint = nClanPoint;
+	Ticket.nTickCount = nTickCount;
+	return Ticket;
+}
+
+void TestBookkeeping()
+{
+	TestPicker Picker;
+	MTEST_CHECK(Picker.AddTicket(MakeTicket(1, 1, 10, 1000, 1)));
+	MTEST_CHECK(!Picker.AddTicket(MakeTicket(1, 1, 10, 1000, 1)));
+	MTEST_CHECK(Picker.AddTicket(MakeTicket(2, 1, 10, 1000, 1)));
+	MTEST_CHECK(Picker.GetTicketCount() == 2);
+
+	// Both groups are from the same clan.
+	TestStatistics Stat;
+	std::vector<std::pair<int, int>> Matches;
+	Picker.PickMatches(Stat, Matches);
+	MTEST_CHECK(Matches.empty());
+
+	MTEST_CHECK(Picker.RemoveTicket(1));
+	MTEST_CHECK(!Picker.RemoveTicket(1));
+	MTEST_CHECK(Picker.GetTicketCount() == 1);
+}
+
+void TestPicksHighestRate()
+{
+	// Group 1 has waited the longest, so it picks first. Both others are close enough in level,
+	// and 3 has the higher rate.
+	TestPicker Picker;
+	Picker.AddTicket(MakeTicket(1, 1, 50, 1000, 2));
+	Picker.AddTicket(MakeTicket(2, 2, 50, 1000, 1));
+	Picker.AddTicket(MakeTicket(3, 3, 54, 1000, 1));
+
+	TestStatistics Stat;
+	std::vector<std::pair<int, int>> Matches;
+	Picker.PickMatches(Stat, Matches);
+	MTEST_CHECK(Matches.size() == 1);
+	MTEST_CHECK(Matches.size() == 1 && Matches[0] == std::make_pair(1, 3));
+	MTEST_CHECK(Picker.GetTicketCount() == 1);
+}
+
+void TestClanPointBuckets()
+{
+	// Group 1 has waited three ticks, so a group 30 levels away is fine if it's within 100 clan
+	// points. More than MAX_CANDIDATES groups at that level are too far away in clan points,
+	// and were there first, but group 2 is in a nearer bucket and gets looked at before them.
+	TestPicker Picker;
+	Picker.AddTicket(MakeTicket(1, 1, 10, 1000, 3));
+	for (int i = 0; i < TestPicker::MAX_CANDIDATES + 10; i++)
+		Picker.AddTicket(MakeTicket(100 + i, 100 + i, 40, 2000, 1));
+	Picker.AddTicket(MakeTicket(2, 2, 40, 1050, 3));
+
+	TestStatistics Stat;
+	std::vector<std::pair<int, int>> Matches;
+	Picker.PickMatches(Stat, Matches);
+	MTEST_CHECK(!Matches.empty() && Matches[0] == std::make_pair(1, 2));
+}
+
+struct SimResult
+{
+	int nMatched = 0;
+	int nTotalWait = 0;
+	int nTotalLevelDiff = 0;
+	int nTotalClanPointDiff = 0;
+	double MaxTickMS = 0;
+	double TotalTickMS = 0;
+};
+
+SimResult Simulate(int nArrivalsPerTick, int nTicks, int nClanCount)
+{
+	std::mt19937 Rng{ 4321 };
+	std::normal_distribution<float> LevelDist{ 40, 15 };
+	std::normal_distribution<float> ClanPointDist{ 1000, 300 };
+	std::uniform_int_distribution<int> ClanDist{ 1, nClanCount };
+
+	TestStatistics Stat;
+	TestPicker Picker;
+	std::unordered_map<int, MLadderTicket> Waiting;
+	std::unordered_set<int> Done;
+	std::vector<std::pair<int, int>> Matches;
+	int nNextID = 1;
+	SimResult Result;
+
+	for (int nTick = 0; nTick < nTicks; nTick++)
+	{
+		for (int i = 0; i < nArrivalsPerTick; i++)
+		{
+			auto Ticket = MakeTicket(nNextID++, ClanDist(Rng),
+				(std::max)(1, (std::min)(99, int(LevelDist(Rng)))),
+				(std::max)(0, int(ClanPointDist(Rng))), 0);
+			Picker.AddTicket(Ticket);
+			Waiting.emplace(Ticket.nGroupID, Ticket);
+		}
+
+		// What MLadderMgr::MakeMatch does for every waiting group, with a little clan point
+		// drift from matches the clan plays elsewhere.
+		for (auto& Pair : Waiting)
+		{
+			auto& Ticket = Pair.second;
+			Ticket.nTickCount++;
+			Ticket.nClanPoint += int(Rng() % 5) - 2;
+			Picker.UpdateTicket(Ticket.nGroupID, Ticket.nClanPoint, Ticket.nTickCount);
+		}
+
+		Matches.clear();
+		const auto TickMS = MTestTimeMS([&] { Picker.PickMatches(Stat, Matches); });
+		Result.TotalTickMS += TickMS;
+		Result.MaxTickMS = (std::max)(Result.MaxTickMS, TickMS);
+
+		for (auto& Match : Matches)
+		{
+			auto itA = Waiting.find(Match.first);
+			auto itB = Waiting.find(Match.second);
+			MTEST_CHECK(itA != Waiting.end() && itB != Waiting.end());
+			if (itA == Waiting.end() || itB == Waiting.end())
+				continue;
+
+			auto& A = itA->second;
+			auto& B = itB->second;
+			float fRate;
+			MTEST_CHECK(A.nGroupID != B.nGroupID);
+			MTEST_CHECK(A.nCLID != B.nCLID);
+			MTEST_CHECK(TestPicker::EvaluateTicket(Stat, A, B, &fRate));
+			MTEST_CHECK(Done.insert(A.nGroupID).second && Done.insert(B.nGroupID).second);
+
+			Result.nMatched += 2;
+			Result.nTotalWait += A.nTickCount + B.nTickCount;
+			Result.nTotalLevelDiff += abs(A.nCharLevel - B.nCharLevel);
+			Result.nTotalClanPointDiff += abs(A.nClanPoint - B.nClanPoint);
+
+			Waiting.erase(itA);
+			Waiting.erase(itB);
+		}
+
+		MTEST_CHECK(Picker.GetTicketCount() == Waiting.size());
+
+		// Anyone can play anyone from another clan once they've waited long enough, so at most
+		// one such group can be left, or one per clan if they're all that's left.
+		int nExpired = 0;
+		std::unordered_set<int> ExpiredClans;
+		for (auto& Pair : Waiting)
+		{
+			if (Pair.second.nTickCount - 1 >= TestPicker::MAX_EVALUATION_TICK)
+			{
+				nExpired++;
+				ExpiredClans.insert(Pair.second.nCLID);
+			}
+		}
+		MTEST_CHECK(nExpired <= 1 || ExpiredClans.size() <= 1);
+	}
+
+	return Result;
+}
+
+void RunSimulation(int nArrivalsPerTick, int nTicks, int nClanCount)
+{
+	const auto Result = Simulate(nArrivalsPerTick, nTicks, nClanCount);
+	MTEST_CHECK(Result.nMatched > 0);
+	if (!Result.nMatched)
+		return;
+
+	std::printf("%d groups per tick, %d ticks: %d matched, average wait %.2f ticks, "
+		"level diff %.2f, clan point diff %.1f, tick %.2f ms average, %.2f ms max\n",
+		nArrivalsPerTick, nTicks, Result.nMatched,
+		float(Result.nTotalWait) / Result.nMatched,
+		float(Result.nTotalLevelDiff) * 2 / Result.nMatched,
+		float(Result.nTotalClanPointDiff) * 2 / Result.nMatched,
+		Result.TotalTickMS / nTicks, Result.MaxTickMS);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int nLargeArrivals = argc > 1 ? atoi(argv[1]) : 20000;
+
+	TestBookkeeping();
+	TestPicksHighestRate();
+	TestClanPointBuckets();
+
+	RunSimulation(10, 100, 20);
+	RunSimulation(500, 50, 1000);
+	RunSimulation(nLargeArrivals, 10, 10000);
+
+	return MTestResult();
+}
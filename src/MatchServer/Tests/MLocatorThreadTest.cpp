@@ -0,0 +1,181 @@
+#include "GlobalTypes.h"
+#include "MLocatorThread.h"
+#include "MServerStatus.h"
+#include "MTest.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Puts a database that blocks for a long time on every call behind a stand-in for MLocator, which
+// runs its refresh on an MLocatorThread and reads the match server's status from an
+// MLocatorSnapshot, the same way MLocator::Start, Run and SetServerStatus do. Runs match server
+// ticks on the main thread that publish the player count like MBMatchServer::UpdateLocatorStatus,
+// and checks that:
+// - no tick waits on the database, unlike when the refresh ran inline in MBMatchServer::OnRun;
+// - Stop only waits for the database call in progress, and returns right away between calls;
+// - the locator picks up the last status the match server published.
+
+namespace {
+
+struct BlockingDB
+{
+	u32 BlockTime;
+	std::atomic<int> Calls{};
+
+	// Stands in for MLocatorDBMgr::GetServerStatus and UpdateLocaterStatus on a database that's
+	// slow to answer.
+	void Query()
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(BlockTime));
+		++Calls;
+	}
+};
+
+struct TestLocator
+{
+	BlockingDB& DB;
+	MLocatorThread Thread;
+	MLocatorSnapshot<MServerStatus> ServerStatus;
+	std::atomic<int> SeenPlayerCount{ -1 };
+
+	static constexpr u32 RunInterval = 20;
+
+	bool Start() { return Thread.Start(RunInterval, [this] { Run(); }); }
+	void Stop() { Thread.Stop(); }
+
+	// MLocator::Run: the status refresh, then the database.
+	void Run()
+	{
+		if (auto pStatus = ServerStatus.Get())
+			SeenPlayerCount = pStatus->GetCurPlayer();
+		DB.Query();
+	}
+};
+
+// MBMatchServer::UpdateLocatorStatus.
+struct StatusPublisher
+{
+	TestLocator& Locator;
+	int LastPlayerCount = -1;
+	int Publishes = 0;
+
+	void Update(int PlayerCount)
+	{
+		if (PlayerCount == LastPlayerCount)
+			return;
+		LastPlayerCount = PlayerCount;
+
+		MServerStatus Status;
+		Status.SetID(1);
+		Status.SetType(4);
+		Status.SetMaxPlayer(500);
+		Status.SetCurPlayer(PlayerCount);
+		Status.SetServerName("Test server");
+		Status.SetOpenState(true);
+		Locator.ServerStatus.Set(Status);
+		++Publishes;
+	}
+};
+
+struct TickStats
+{
+	double Max = 0;
+	double P99 = 0;
+};
+
+// Runs ticks for about Duration ms, a few ms apart, with players coming and going. Inline runs
+// the locator's refresh on the tick instead, every RunInterval, like OnRun used to.
+TickStats RunTicks(TestLocator& Locator, u32 Duration, bool Inline)
+{
+	std::mt19937 Rng{ 2468 };
+	StatusPublisher Publisher{ Locator };
+	std::vector<double> Times;
+	int PlayerCount = 100;
+	double LastInlineRun = -1e9;
+	double Elapsed = 0;
+	const auto Start = std::chrono::steady_clock::now();
+
+	while (Elapsed < Duration)
+	{
+		const auto Time = MTestTimeMS([&] {
+			// Someone logs in or out every other tick.
+			if (Rng() % 2 == 0)
+				PlayerCount += Rng() % 2 ? 1 : -1;
+			if (Inline && Elapsed - LastInlineRun >= TestLocator::RunInterval)
+			{
+				Locator.Run();
+				LastInlineRun = Elapsed;
+			}
+			Publisher.Update(PlayerCount);
+		});
+		Times.push_back(Time);
+		std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		Elapsed = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - Start).count();
+	}
+
+	// Let the locator's next refresh see the last count.
+	const int Calls = Locator.DB.Calls;
+	while (!Inline && Locator.DB.Calls < Calls + 2)
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	MTEST_CHECK(Locator.SeenPlayerCount == PlayerCount || Inline);
+	MTEST_CHECK(Publisher.Publishes > 1);
+
+	TickStats Stats;
+	std::sort(Times.begin(), Times.end());
+	Stats.Max = Times.back();
+	Stats.P99 = Times[(std::min)(Times.size() - 1, size_t(Times.size() * 0.99))];
+	return Stats;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const u32 BlockTime = argc > 1 ? u32(atoi(argv[1])) : 150;
+	const u32 Duration = 1000;
+
+	BlockingDB DB{ BlockTime };
+	TestLocator Locator{ DB };
+
+	MTEST_CHECK(Locator.Start());
+	MTEST_CHECK(!Locator.Start());
+	const auto Threaded = RunTicks(Locator, Duration, false);
+	// The database blocks for BlockTime on each call; a tick that doesn't wait on it is over in
+	// well under that, even on a busy machine.
+	MTEST_CHECK(Threaded.Max < BlockTime / 3.0);
+
+	// Stopping while the database is blocked waits for that one call, and no more.
+	const int CallsBeforeStop = DB.Calls;
+	while (DB.Calls == CallsBeforeStop)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	std::this_thread::sleep_for(std::chrono::milliseconds(BlockTime / 4));
+	const auto BlockedStopTime = MTestTimeMS([&] { Locator.Stop(); });
+	MTEST_CHECK(BlockedStopTime < BlockTime * 1.5);
+	MTEST_CHECK(!Locator.Thread.IsRunning());
+
+	// Between calls, the thread is waiting out RunInterval, and stopping doesn't wait for it.
+	DB.BlockTime = 0;
+	MTEST_CHECK(Locator.Start());
+	const int CallsBeforeIdleStop = DB.Calls;
+	while (DB.Calls == CallsBeforeIdleStop)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	const auto IdleStopTime = MTestTimeMS([&] { Locator.Stop(); });
+	MTEST_CHECK(IdleStopTime < TestLocator::RunInterval);
+	DB.BlockTime = BlockTime;
+
+	// The way it was, for comparison.
+	const auto Inline = RunTicks(Locator, Duration, true);
+	MTEST_CHECK(Inline.Max >= BlockTime);
+
+	std::printf("Database blocking for %u ms: longest tick %.2f ms, p99 %.2f ms with the locator "
+		"on its own thread, %.2f ms and %.2f ms with it on the tick. Stop took %.1f ms during a "
+		"call, %.2f ms between calls\n", BlockTime, Threaded.Max, Threaded.P99, Inline.Max,
+		Inline.P99, BlockedStopTime, IdleStopTime);
+
+	return MTestResult();
+}
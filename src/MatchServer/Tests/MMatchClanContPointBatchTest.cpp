@@ -0,0 +1,177 @@
+#include "MMatchClanContPointBatch.h"
+#include "MTest.h"
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <utility>
+
+// Plays clan battles against MMatchClanContPointBatch the way MMatchServer and MMatchClanMap
+// use it, with a simulated clock and a mock DB that records every UpdateCharClanContPoint and
+// fails some of them. Checks that every point given out ends up either in the DB or in the failed
+// list that gets logged, that a member who wins several battles between flushes is written once,
+// and that no points wait longer than FlushPeriod and a clan tick.
+
+namespace {
+
+using Entry = MMatchClanContPointBatch::Entry;
+using Key = std::pair<int, int>;
+
+// Only the clan tick runs the flush.
+const u64 ClanTickPeriod = 500;
+
+struct MockDB
+{
+	std::map<Key, int> Totals;
+	int nCalls = 0;
+	// Every FailEvery-th call fails, if it's nonzero.
+	int FailEvery = 0;
+
+	bool UpdateCharClanContPoint(int nCID, int nCLID, int nAddedContPoint)
+	{
+		nCalls++;
+		if (FailEvery && nCalls % FailEvery == 0)
+			return false;
+		Totals[Key{ nCID, nCLID }] += nAddedContPoint;
+		return true;
+	}
+};
+
+void TestBasics()
+{
+	MMatchClanContPointBatch Batch;
+	MTEST_CHECK(Batch.IsEmpty() && !Batch.IsFlushDue(100000));
+
+	Batch.Add(1000, 1, 10, 5);
+	Batch.Add(1500, 2, 10, 3);
+	Batch.Add(2000, 1, 10, 7);
+	// The same member in another clan is another row.
+	Batch.Add(2500, 1, 20, 4);
+	Batch.Add(3000, 2, 10, -3);
+	MTEST_CHECK(Batch.GetCount() == 3);
+
+	// Due FlushPeriod after the first points came in, whatever came after them.
+	MTEST_CHECK(!Batch.IsFlushDue(1000 + MMatchClanContPointBatch::FlushPeriod - 1));
+	MTEST_CHECK(Batch.IsFlushDue(1000 + MMatchClanContPointBatch::FlushPeriod));
+
+	// Appended in the order each member first got points.
+	std::vector<Entry> Out{ { 9, 9, 9 } };
+	Batch.Take(Out);
+	MTEST_CHECK(Out.size() == 4);
+	MTEST_CHECK(Out[1].nCID == 1 && Out[1].nCLID == 10 && Out[1].nAddedContPoint == 12);
+	MTEST_CHECK(Out[2].nCID == 2 && Out[2].nCLID == 10 && Out[2].nAddedContPoint == 0);
+	MTEST_CHECK(Out[3].nCID == 1 && Out[3].nCLID == 20 && Out[3].nAddedContPoint == 4);
+	MTEST_CHECK(Batch.IsEmpty() && !Batch.IsFlushDue(100000));
+
+	// The clock starts over with the next points.
+	Batch.Add(50000, 1, 10, 1);
+	MTEST_CHECK(!Batch.IsFlushDue(50000 + MMatchClanContPointBatch::FlushPeriod - 1));
+	MTEST_CHECK(Batch.GetCount() == 1);
+
+	// Failed writes are handed back, and the rest go through.
+	MockDB DB;
+	DB.FailEvery = 2;
+	std::vector<Entry> Failed;
+	MMatchClanContPointBatch::Write(DB, { Out.begin() + 1, Out.end() }, Failed);
+	MTEST_CHECK(DB.nCalls == 3);
+	MTEST_CHECK(Failed.size() == 1 && Failed[0].nCID == 2 && Failed[0].nCLID == 10);
+	MTEST_CHECK(DB.Totals.size() == 2 && DB.Totals[Key(1, 10)] == 12 && DB.Totals[Key(1, 20)] == 4);
+}
+
+void RunSimulation(int nBattles, int nClanCount, int nMembersPerClan)
+{
+	std::mt19937 Rng{ 86420 };
+	MMatchClanContPointBatch Batch;
+	MockDB DB;
+	DB.FailEvery = 200;
+
+	std::map<Key, int> Expected;
+	std::map<Key, int> FailedTotals;
+	int nFailed = 0;
+	int nFlushes = 0;
+	size_t nMaxPending = 0;
+
+	// When the oldest pending points came in, kept here to check how long they wait.
+	u64 nOldestAdd = 0;
+	u64 nMaxWait = 0;
+
+	auto WriteBatch = [&](u64 nClock) {
+		nMaxWait = (std::max)(nMaxWait, nClock - nOldestAdd);
+		nMaxPending = (std::max)(nMaxPending, Batch.GetCount());
+
+		// MMatchClanMap::FlushContPoints and MAsyncDBJob_UpdateCharClanContPoints::Run.
+		std::vector<Entry> Entries, Failed;
+		Batch.Take(Entries);
+		MMatchClanContPointBatch::Write(DB, Entries, Failed);
+		for (auto& ContPoint : Failed)
+			FailedTotals[Key{ ContPoint.nCID, ContPoint.nCLID }] += ContPoint.nAddedContPoint;
+		nFailed += int(Failed.size());
+		nFlushes++;
+	};
+
+	u64 nClock = 0;
+	u64 nNextTick = ClanTickPeriod;
+	std::uniform_int_distribution<int> ClanDist{ 0, nClanCount - 1 };
+	std::uniform_int_distribution<u64> GapDist{ 0, 2000 };
+	for (int i = 0; i < nBattles; i++)
+	{
+		// MMatchClanMap::Tick, between the battles that end in the meantime.
+		nClock += GapDist(Rng);
+		for (; nNextTick <= nClock; nNextTick += ClanTickPeriod)
+		{
+			if (Batch.IsFlushDue(nNextTick))
+				WriteBatch(nNextTick);
+		}
+
+		// MMatchServer::SaveClanPoint, for a 4 on 4 battle.
+		const int nWinnerCLID = 1 + ClanDist(Rng);
+		const int nPoints = 1 + Rng() % 30;
+		for (int j = 0; j < 4; j++)
+		{
+			const int nCID = nWinnerCLID * 1000 + int(Rng() % nMembersPerClan);
+			if (Batch.IsEmpty())
+				nOldestAdd = nClock;
+			Batch.Add(nClock, nCID, nWinnerCLID, nPoints);
+			Expected[Key{ nCID, nWinnerCLID }] += nPoints;
+		}
+	}
+
+	// MMatchClanMap::Destroy writes what's left.
+	if (!Batch.IsEmpty())
+		WriteBatch(nClock);
+	MTEST_CHECK(Batch.IsEmpty());
+
+	// Every point is either in the DB, or in a failed entry that got logged.
+	int nMismatches = 0;
+	for (auto& Pair : Expected)
+	{
+		const auto itDB = DB.Totals.find(Pair.first);
+		const auto itFailed = FailedTotals.find(Pair.first);
+		const int nWritten = (itDB != DB.Totals.end() ? itDB->second : 0) +
+			(itFailed != FailedTotals.end() ? itFailed->second : 0);
+		nMismatches += nWritten != Pair.second;
+	}
+	MTEST_CHECK(nMismatches == 0);
+	MTEST_CHECK(DB.Totals.size() <= Expected.size());
+	MTEST_CHECK(nFailed > 0 && nFailed == DB.nCalls / DB.FailEvery);
+
+	const int nUnbatchedWrites = nBattles * 4;
+	MTEST_CHECK(DB.nCalls < nUnbatchedWrites);
+	MTEST_CHECK(nMaxWait <= MMatchClanContPointBatch::FlushPeriod + ClanTickPeriod);
+
+	std::printf("%d battles, %d clans: %d writes instead of %d in %d flushes, %d failed, "
+		"at most %d entries pending for %.1f s\n", nBattles, nClanCount, DB.nCalls,
+		nUnbatchedWrites, nFlushes, nFailed, int(nMaxPending), nMaxWait / 1000.0);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int nBattles = argc > 1 ? atoi(argv[1]) : 20000;
+
+	TestBasics();
+	RunSimulation(nBattles, 50, 12);
+	RunSimulation(nBattles, 5, 4);
+
+	return MTestResult();
+}
@@ -0,0 +1,169 @@
+#include "MMatchClientFileList.h"
+#include "MTest.h"
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+// Checks MMatchClientFileList's loading and hit bookkeeping, then has threads check logins
+// against it while others reload it, the way admin reloads on the async proxy and config
+// reloads on the main thread overlap in the server. MMatchClientFileListTSanTest runs the same
+// thing under ThreadSanitizer where the compiler has it.
+
+namespace {
+
+const char ListA[] = "MMatchClientFileListTestA.txt";
+const char ListB[] = "MMatchClientFileListTestB.txt";
+
+void WriteList(const char* Path, std::initializer_list<u32> CRCs)
+{
+	FILE* fp = fopen(Path, "w");
+	MTEST_CHECK(fp != NULL);
+	if (fp == NULL)
+		return;
+	for (auto CRC : CRCs)
+		fprintf(fp, "%u\n", CRC);
+	// Lines that aren't numbers are skipped.
+	fprintf(fp, "not a crc\n");
+	fclose(fp);
+}
+
+u32 GetHits(MMatchClientFileList& List, u32 CRC)
+{
+	std::vector<MClientFileCRCHits> Hits;
+	List.GetHits(Hits);
+	for (auto& Hit : Hits)
+	{
+		if (Hit.CRC == CRC)
+			return Hit.Hits;
+	}
+	return 0;
+}
+
+void TestBasics()
+{
+	MMatchClientFileList List;
+	MTEST_CHECK(List.GetSize() == 0);
+	MTEST_CHECK(!List.Check(1));
+
+	// Missing files leave the list alone.
+	MTEST_CHECK(!List.Reload("MMatchClientFileListTestMissing.txt").bLoaded);
+	MTEST_CHECK(List.GetVersion() == 0);
+
+	WriteList(ListA, { 30, 10, 20, 10 });
+	auto Result = List.Reload(ListA);
+	MTEST_CHECK(Result.bLoaded && Result.nCount == 3 && Result.nVersion == 1);
+	MTEST_CHECK(List.GetSize() == 3 && List.GetVersion() == 1);
+	MTEST_CHECK(List.Check(10) && List.Check(20) && List.Check(20) && !List.Check(15));
+
+	// Hits carry over for the CRCs that stay, and the ones that never matched are counted.
+	WriteList(ListB, { 20, 30, 40 });
+	Result = List.Reload(ListB);
+	MTEST_CHECK(Result.bLoaded && Result.nVersion == 2 && Result.nCount == 3);
+	MTEST_CHECK(Result.nPrevCount == 3 && Result.nUnused == 1);
+	MTEST_CHECK(!List.Check(10));
+	MTEST_CHECK(GetHits(List, 20) == 2);
+	MTEST_CHECK(GetHits(List, 30) == 0);
+
+	List.Clear();
+	MTEST_CHECK(List.GetSize() == 0 && List.GetVersion() == 3);
+}
+
+void TestConcurrentReloads(int CheckerCount, int ReloaderCount, int ReloadsPerThread)
+{
+	// 1 and 2 are in both lists, 3 is only in A and 4 only in B.
+	WriteList(ListA, { 1, 2, 3 });
+	WriteList(ListB, { 1, 2, 4 });
+
+	MMatchClientFileList List;
+	MTEST_CHECK(List.Reload(ListA).bLoaded);
+
+	std::atomic<bool> Stop{ false };
+	std::atomic<int> Misses{ 0 };
+	std::atomic<int> CheckCount{ 0 };
+	std::vector<std::thread> Checkers;
+	for (int i = 0; i < CheckerCount; i++)
+	{
+		Checkers.emplace_back([&] {
+			int nChecks = 0;
+			while (!Stop.load(std::memory_order_relaxed))
+			{
+				if (!List.Check(1) || !List.Check(2))
+					Misses++;
+				// Either of these may or may not be in the list, but never both.
+				if (List.GetVersion() > 0 && List.GetSize() != 3)
+					Misses++;
+				List.Check(3);
+				List.Check(4);
+				nChecks++;
+			}
+			CheckCount += nChecks;
+		});
+	}
+
+	std::atomic<int> LoadedCount{ 0 };
+	std::vector<std::vector<u32>> Versions(ReloaderCount);
+	std::vector<std::thread> Reloaders;
+	for (int i = 0; i < ReloaderCount; i++)
+	{
+		Reloaders.emplace_back([&, i] {
+			for (int j = 0; j < ReloadsPerThread; j++)
+			{
+				const auto Result = List.Reload((i + j) % 2 ? ListB : ListA);
+				if (Result.bLoaded)
+				{
+					LoadedCount++;
+					Versions[i].push_back(Result.nVersion);
+				}
+				if (j % 4 == 0)
+				{
+					std::vector<MClientFileCRCHits> Hits;
+					List.GetHits(Hits);
+				}
+			}
+		});
+	}
+
+	for (auto& Thread : Reloaders)
+		Thread.join();
+	Stop = true;
+	for (auto& Thread : Checkers)
+		Thread.join();
+
+	MTEST_CHECK(Misses == 0);
+	MTEST_CHECK(LoadedCount == ReloaderCount * ReloadsPerThread);
+	// Every reload got a version of its own, in the order they were swapped in.
+	MTEST_CHECK(List.GetVersion() == u32(1 + LoadedCount));
+	std::vector<bool> Seen(LoadedCount + 2, false);
+	for (auto& ThreadVersions : Versions)
+	{
+		for (size_t i = 0; i < ThreadVersions.size(); i++)
+		{
+			const auto nVersion = ThreadVersions[i];
+			MTEST_CHECK(nVersion >= 2 && nVersion < Seen.size() && !Seen[nVersion]);
+			if (nVersion < Seen.size())
+				Seen[nVersion] = true;
+			MTEST_CHECK(i == 0 || nVersion > ThreadVersions[i - 1]);
+		}
+	}
+
+	// Checks that landed on a list while it was being replaced may be lost, but the rest carry on.
+	const auto nHits = GetHits(List, 1);
+	MTEST_CHECK(nHits > 0 && nHits <= u32(CheckCount));
+
+	std::printf("%d checkers, %d reloaders: %d checks of each CRC, %u of them counted, "
+		"%d reloads\n", CheckerCount, ReloaderCount, CheckCount.load(), nHits, LoadedCount.load());
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int ReloadsPerThread = argc > 1 ? atoi(argv[1]) : 200;
+
+	TestBasics();
+	TestConcurrentReloads(4, 2, ReloadsPerThread);
+
+	remove(ListA);
+	remove(ListB);
+	return MTestResult();
+}
@@ -0,0 +1,248 @@
+#include "MMatchPickup.h"
+#include "MTest.h"
+#include <algorithm>
+#include <cstdlib>
+#include <deque>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// Benchmarks server-side pickups in a WeaponDrop game: 16 players running around a map with lots
+// of dropped weapons on it, dying, dropping another, and respawning somewhere else. Runs the same
+// game three ways:
+// - Grid, the way MMatchWorldItemManager::UpdatePickups does it, with MFindPickups on an MHashGrid;
+// - LinearSweep, which tests the same path against every item on the map;
+// - LinearPoint, the old Update, which tested every item against where each player is now.
+// Grid and LinearSweep have to pick up exactly the same items on exactly the same ticks.
+
+namespace {
+
+const int PlayerCount = 16;
+const float MapSize = 8000;
+const float PickupRadius = 100;
+const float MaxPickupSweep = 500;
+
+enum class Scan { Grid, LinearSweep, LinearPoint };
+
+struct Pickup
+{
+	int Tick;
+	int Player;
+	u16 UID;
+
+	bool operator==(const Pickup& b) const {
+		return Tick == b.Tick && Player == b.Player && UID == b.UID; }
+};
+
+struct Player
+{
+	v3 Position, LastPosition, Velocity;
+};
+
+struct Game
+{
+	std::mt19937 Rng{ 8642 };
+	std::unordered_map<u16, v3> Items;
+	MHashGrid<u16> Grid{ PickupRadius * 2 };
+	// In the order they were dropped, so that the oldest can expire.
+	std::deque<u16> DropOrder;
+	u16 NextUID = 0;
+	Player Players[PlayerCount];
+
+	size_t MaxItems;
+	std::vector<u16> PickedUp[PlayerCount];
+	std::vector<Pickup> Log;
+	double PickupTime = 0;
+	// Pickups that were further than PickupRadius from where the player is now, which the old
+	// scan wouldn't have seen.
+	int PassedThrough = 0;
+
+	explicit Game(size_t MaxItems) : MaxItems{ MaxItems }
+	{
+		for (auto& p : Players)
+		{
+			p.Position = p.LastPosition = RandomPoint();
+			p.Velocity = v3{ 0, 0, 0 };
+		}
+		while (Items.size() < MaxItems)
+			Drop(RandomPoint());
+	}
+
+	v3 RandomPoint()
+	{
+		std::uniform_real_distribution<float> Coord{ 0, MapSize };
+		return v3{ Coord(Rng), Coord(Rng), 0 };
+	}
+
+	void Drop(const v3& Position)
+	{
+		do
+			++NextUID;
+		while (Items.count(NextUID));
+		Items.emplace(NextUID, Position);
+		Grid.Add(Position.x, Position.y, NextUID);
+		DropOrder.push_back(NextUID);
+	}
+
+	void Remove(u16 UID)
+	{
+		auto it = Items.find(UID);
+		if (it == Items.end())
+			return;
+		Grid.Remove(it->second.x, it->second.y, UID);
+		Items.erase(it);
+	}
+
+	// Running, dashing, and now and then dying and respawning somewhere else. Someone who dies
+	// drops their weapon where they were, and the oldest drops on the map expire.
+	void Move()
+	{
+		std::uniform_real_distribution<float> Turn{ -15, 15 };
+		for (auto& p : Players)
+		{
+			p.LastPosition = p.Position;
+			if (Rng() % 300 == 0)
+			{
+				Drop(p.Position);
+				p.Position = RandomPoint();
+				continue;
+			}
+
+			p.Velocity.x = (std::max)(-60.f, (std::min)(60.f, p.Velocity.x + Turn(Rng)));
+			p.Velocity.y = (std::max)(-60.f, (std::min)(60.f, p.Velocity.y + Turn(Rng)));
+			p.Position += p.Velocity;
+			for (float* Coord : { &p.Position.x, &p.Position.y })
+			{
+				if (*Coord < 0 || *Coord > MapSize)
+				{
+					*Coord = (std::max)(0.f, (std::min)(MapSize, *Coord));
+					p.Velocity = -p.Velocity;
+				}
+			}
+		}
+
+		while (Items.size() > MaxItems)
+		{
+			Remove(DropOrder.front());
+			DropOrder.pop_front();
+		}
+	}
+
+	void FindPickups(Scan Method, const Player& p, std::vector<u16>& PickedUp)
+	{
+		const auto From = MGetPickupSweepStart(p.LastPosition, p.Position, MaxPickupSweep);
+		switch (Method)
+		{
+		case Scan::Grid:
+			MFindPickups(Grid, From, p.Position, PickupRadius, [&](u16 UID) -> const v3* {
+				auto it = Items.find(UID);
+				return it != Items.end() ? &it->second : nullptr;
+			}, PickedUp);
+			break;
+		case Scan::LinearSweep:
+			for (auto& Item : Items)
+				if (MDistanceSqToSegment(Item.second, From, p.Position) < PickupRadius * PickupRadius)
+					PickedUp.push_back(Item.first);
+			break;
+		case Scan::LinearPoint:
+			for (auto& Item : Items)
+				if (RealSpace2::Magnitude(Item.second - p.Position) < PickupRadius)
+					PickedUp.push_back(Item.first);
+			break;
+		}
+	}
+
+	// Each item picked up is replaced by one dropped somewhere else, so the map stays as full.
+	void Tick(Scan Method, int TickIndex)
+	{
+		Move();
+
+		// Only the search is timed, so the items are taken off the map after everyone's have been
+		// found. One that more than one player reached goes to the first of them, like in
+		// UpdatePickups.
+		PickupTime += MTestTimeMS([&] {
+			for (int i = 0; i < PlayerCount; i++)
+			{
+				PickedUp[i].clear();
+				FindPickups(Method, Players[i], PickedUp[i]);
+			}
+		});
+
+		for (int i = 0; i < PlayerCount; i++)
+		{
+			// The grid and the map come out in different orders.
+			std::sort(PickedUp[i].begin(), PickedUp[i].end());
+			for (auto UID : PickedUp[i])
+			{
+				auto it = Items.find(UID);
+				if (it == Items.end())
+					continue;
+				PassedThrough +=
+					RealSpace2::Magnitude(it->second - Players[i].Position) >= PickupRadius;
+				Log.push_back({ TickIndex, i, UID });
+				Remove(UID);
+			}
+		}
+
+		for (size_t i = 0; i < Log.size() && Log[Log.size() - 1 - i].Tick == TickIndex; i++)
+			Drop(RandomPoint());
+	}
+};
+
+struct Result
+{
+	double TimePerTick;
+	std::vector<Pickup> Log;
+	int PassedThrough;
+};
+
+Result Run(Scan Method, size_t ItemCount, int TickCount)
+{
+	Game g{ ItemCount };
+	for (int i = 0; i < TickCount; i++)
+		g.Tick(Method, i);
+	return{ g.PickupTime * 1000 / TickCount, std::move(g.Log), g.PassedThrough };
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int MaxItemCount = argc > 1 ? atoi(argv[1]) : 2000;
+	const int TickCount = argc > 2 ? atoi(argv[2]) : 1000;
+
+	// Segments that are points, that run past the item, and that stop short of it.
+	const v3 Item{ 100, 100, 0 };
+	MTEST_CHECK(MDistanceSqToSegment(Item, v3{ 100, 0, 0 }, v3{ 100, 0, 0 }) == 10000);
+	MTEST_CHECK(MDistanceSqToSegment(Item, v3{ 0, 50, 0 }, v3{ 200, 50, 0 }) == 2500);
+	MTEST_CHECK(MDistanceSqToSegment(Item, v3{ 0, 0, 0 }, v3{ 0, 300, 0 }) == 10000);
+	MTEST_CHECK(MDistanceSqToSegment(Item, v3{ -300, 100, 0 }, v3{ -100, 100, 0 }) == 40000);
+	const v3 Last{ 0, 0, 0 }, Near{ 300, 400, 0 }, Far{ 300, 401, 0 };
+	MTEST_CHECK(&MGetPickupSweepStart(Last, Near, MaxPickupSweep) == &Last);
+	MTEST_CHECK(&MGetPickupSweepStart(Last, Far, MaxPickupSweep) == &Far);
+
+	std::printf("%d players, %d ticks, time spent on pickups per tick:\n", PlayerCount, TickCount);
+	std::printf("%8s %12s %14s %14s %10s %16s\n", "items", "grid", "linear sweep", "linear point",
+		"pickups", "passed through");
+	for (int ItemCount : { 50, 500, MaxItemCount })
+	{
+		const auto Grid = Run(Scan::Grid, ItemCount, TickCount);
+		const auto Sweep = Run(Scan::LinearSweep, ItemCount, TickCount);
+		const auto Point = Run(Scan::LinearPoint, ItemCount, TickCount);
+
+		MTEST_CHECK(Grid.Log == Sweep.Log);
+		MTEST_CHECK(!Grid.Log.empty());
+		// With enough items around, some are run through between two ticks, which the old scan
+		// would have missed, and the grid is well ahead of it.
+		if (ItemCount >= 500)
+		{
+			MTEST_CHECK(Grid.PassedThrough > 0);
+			MTEST_CHECK(Grid.TimePerTick < Point.TimePerTick);
+		}
+
+		std::printf("%8d %9.2f us %11.2f us %11.2f us %10d %16d\n", ItemCount, Grid.TimePerTick,
+			Sweep.TimePerTick, Point.TimePerTick, int(Grid.Log.size()), Grid.PassedThrough);
+	}
+
+	return MTestResult();
+}
@@ -0,0 +1,281 @@
+#include "MMatchRentItemTimer.h"
+#include "MTest.h"
+#include <cstdlib>
+#include <random>
+
+// Drives MMatchRentItemTimer the way MMatchServer does, with a simulated clock that ticks once a
+// second: players log in and out, go in and out of battles, buy rent items and get rid of them,
+// and their items run out. Checks that every item is expired exactly once, never before its
+// time, within a tick of it unless its owner is in a battle, and as soon as they leave the
+// battle if they are, and that compaction keeps the heap from growing with the stale entries.
+
+namespace {
+
+struct Item
+{
+	int nPlayer;
+	MUID uid;
+	u64 nExpireTime;
+	bool bGone = false;
+	bool bExpired = false;
+};
+
+struct Player
+{
+	MUID uid;
+	bool bOnline = false;
+	bool bInBattle = false;
+	std::vector<int> Items;
+};
+
+struct Sim
+{
+	std::mt19937 Rng{ 97531 };
+	MMatchRentItemTimer Timer;
+	std::vector<Player> Players;
+	std::vector<Item> Items;
+	u32 nNextUID = 1;
+	u64 nNow = 0;
+
+	int nExpired = 0;
+	int nExpiredAtLogin = 0;
+	int nExpiredAfterBattle = 0;
+	size_t nMaxCount = 0;
+	int nCompactions = 0;
+
+	MUID NewUID() { return MUID{ 0, nNextUID++ }; }
+
+	Player* FindPlayer(const MUID& uid)
+	{
+		for (auto& P : Players)
+			if (P.bOnline && P.uid == uid)
+				return &P;
+		return nullptr;
+	}
+
+	Item* FindItem(Player& P, const MUID& uid)
+	{
+		for (auto i : P.Items)
+			if (!Items[i].bGone && Items[i].uid == uid)
+				return &Items[i];
+		return nullptr;
+	}
+
+	void Expire(Item& I)
+	{
+		MTEST_CHECK(!I.bExpired);
+		MTEST_CHECK(I.nExpireTime <= nNow);
+		I.bExpired = true;
+		nExpired++;
+	}
+
+	void AddItem(int nPlayer, u64 nDuration)
+	{
+		Item I;
+		I.nPlayer = nPlayer;
+		I.uid = NewUID();
+		I.nExpireTime = nNow + nDuration;
+		Items.push_back(I);
+		Players[nPlayer].Items.push_back(int(Items.size()) - 1);
+		if (Players[nPlayer].bOnline)
+			Timer.Add(I.nExpireTime, Players[nPlayer].uid, I.uid);
+	}
+
+	// MMatchServer::ScheduleRentItems. Every login gets new UIDs, like a new MMatchObject does.
+	void Login(Player& P)
+	{
+		P.bOnline = true;
+		P.bInBattle = false;
+		P.uid = NewUID();
+		for (auto i : P.Items)
+		{
+			auto& I = Items[i];
+			if (I.bGone || I.bExpired)
+				continue;
+			I.uid = NewUID();
+			if (I.nExpireTime <= nNow)
+			{
+				Expire(I);
+				nExpiredAtLogin++;
+			}
+			else
+				Timer.Add(I.nExpireTime, P.uid, I.uid);
+		}
+	}
+
+	// MMatchServer::ExpireDeferredRentItems.
+	void LeaveBattle(Player& P)
+	{
+		P.bInBattle = false;
+		std::vector<MMatchRentItemTimer::Entry> Due;
+		Timer.TakeDeferred(P.uid, Due);
+		for (auto& Entry : Due)
+		{
+			if (auto* pItem = FindItem(P, Entry.uidItem))
+			{
+				Expire(*pItem);
+				nExpiredAfterBattle++;
+			}
+		}
+	}
+
+	// MMatchServer::UpdateRentItems.
+	void Update()
+	{
+		std::vector<MMatchRentItemTimer::Entry> Due;
+		Timer.PopDue(nNow, Due);
+		for (auto& Entry : Due)
+		{
+			MTEST_CHECK(Entry.ExpireTime <= nNow);
+			auto* pPlayer = FindPlayer(Entry.uidPlayer);
+			if (!pPlayer)
+				continue;
+			if (pPlayer->bInBattle)
+			{
+				Timer.Defer(Entry);
+				continue;
+			}
+			if (auto* pItem = FindItem(*pPlayer, Entry.uidItem))
+			{
+				// On time, since the timer runs every tick.
+				MTEST_CHECK(nNow - pItem->nExpireTime < 1);
+				Expire(*pItem);
+			}
+		}
+
+		if (Timer.NeedsCompaction())
+		{
+			Timer.Compact([&](auto& Entry) {
+				auto* pPlayer = FindPlayer(Entry.uidPlayer);
+				return pPlayer && FindItem(*pPlayer, Entry.uidItem) != nullptr;
+			});
+			nCompactions++;
+
+			// What's left is one entry for every item that can still run out.
+			MTEST_CHECK(Timer.GetCount() == size_t(CountLive()));
+		}
+		nMaxCount = (std::max)(nMaxCount, Timer.GetCount());
+	}
+
+	int CountLive()
+	{
+		int nLive = 0;
+		for (auto& I : Items)
+		{
+			if (Players[I.nPlayer].bOnline && !I.bGone && !I.bExpired)
+				nLive++;
+		}
+		return nLive;
+	}
+
+	// Items that should be gone by now, but aren't.
+	int CountOverdue()
+	{
+		int nOverdue = 0;
+		for (auto& I : Items)
+		{
+			auto& P = Players[I.nPlayer];
+			if (P.bOnline && !P.bInBattle && !I.bGone && !I.bExpired && I.nExpireTime <= nNow)
+				nOverdue++;
+		}
+		return nOverdue;
+	}
+};
+
+void TestBasics()
+{
+	MMatchRentItemTimer Timer;
+	const MUID uidA{ 0, 1 }, uidB{ 0, 2 };
+	Timer.Add(30, uidA, MUID{ 0, 10 });
+	Timer.Add(10, uidA, MUID{ 0, 11 });
+	Timer.Add(20, uidB, MUID{ 0, 12 });
+
+	std::vector<MMatchRentItemTimer::Entry> Due;
+	Timer.PopDue(9, Due);
+	MTEST_CHECK(Due.empty());
+	Timer.PopDue(20, Due);
+	MTEST_CHECK(Due.size() == 2 && Due[0].ExpireTime == 10 && Due[1].ExpireTime == 20);
+
+	Timer.Defer(Due[0]);
+	Timer.Defer(Due[1]);
+	MTEST_CHECK(Timer.GetCount() == 3);
+	Due.clear();
+	Timer.TakeDeferred(uidB, Due);
+	MTEST_CHECK(Due.size() == 1 && Due[0].uidItem == MUID(0, 12));
+
+	Timer.Compact([](auto& Entry) { return Entry.ExpireTime != 30; });
+	MTEST_CHECK(Timer.GetCount() == 1);
+}
+
+void RunSimulation(int nPlayerCount, int nItemsPerPlayer, int nDays)
+{
+	const u64 nDay = 24 * 60 * 60;
+	const u64 nEnd = nDays * nDay;
+
+	Sim S;
+	S.Players.resize(nPlayerCount);
+	std::uniform_int_distribution<u64> DurationDist{ 1, nEnd };
+	for (int p = 0; p < nPlayerCount; p++)
+	{
+		for (int i = 0; i < nItemsPerPlayer; i++)
+			S.AddItem(p, DurationDist(S.Rng));
+		if (p % 2 == 0)
+			S.Login(S.Players[p]);
+	}
+
+	std::uniform_int_distribution<int> PlayerDist{ 0, nPlayerCount - 1 };
+	double TotalUpdateMS = 0;
+	for (S.nNow = 1; S.nNow <= nEnd; S.nNow++)
+	{
+		// A few things happen every so often.
+		if (S.Rng() % 4 == 0)
+		{
+			auto& P = S.Players[PlayerDist(S.Rng)];
+			switch (S.Rng() % 6)
+			{
+			case 0:
+				if (P.bOnline) P.bOnline = false;
+				else S.Login(P);
+				break;
+			case 1:
+			case 2:
+				if (!P.bOnline) break;
+				if (P.bInBattle) S.LeaveBattle(P);
+				else P.bInBattle = true;
+				break;
+			case 3:
+				S.AddItem(int(&P - S.Players.data()), 1 + S.Rng() % (2 * nDay));
+				break;
+			case 4:
+				if (!P.Items.empty())
+					S.Items[P.Items[S.Rng() % P.Items.size()]].bGone = true;
+				break;
+			}
+		}
+
+		TotalUpdateMS += MTestTimeMS([&] { S.Update(); });
+		if (S.nNow % 3600 == 0)
+			MTEST_CHECK(S.CountOverdue() == 0);
+	}
+
+	MTEST_CHECK(S.CountOverdue() == 0);
+	MTEST_CHECK(S.nCompactions > 0);
+
+	std::printf("%d players, %d items, %d days: %d expired (%d at login, %d after a battle), "
+		"%d compactions, at most %d entries, %.3f us per update with the lookups\n",
+		nPlayerCount, int(S.Items.size()), nDays, S.nExpired, S.nExpiredAtLogin,
+		S.nExpiredAfterBattle, S.nCompactions, int(S.nMaxCount),
+		TotalUpdateMS * 1000 / nEnd);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int nDays = argc > 1 ? atoi(argv[1]) : 7;
+
+	TestBasics();
+	RunSimulation(500, 20, nDays);
+
+	return MTestResult();
+}
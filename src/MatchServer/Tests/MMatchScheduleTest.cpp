@@ -0,0 +1,314 @@
+#include "MMatchSchedule.h"
+#include "MTest.h"
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <vector>
+
+// Runs MMatchScheduleTimer the way MMatchScheduleMgr::Update does, on a clock set with
+// MMatchSetScheduleClock, and checks:
+// - when schedules are due in months of 28, 29, 30 and 31 days, and with days past the end of the
+//   month, month 0 and day 0, against CompareCurrentTime;
+// - repeat, count and once schedules run when they're due, across the end of a month and a year,
+//   and the wheel doesn't hand out any that aren't;
+// - late schedules are corrected, or polled again a second later until they're used up;
+// - setting the clock back files everything again from the new time;
+// - static schedules that are done stay put and never run again.
+
+namespace {
+
+time_t Now;
+time_t GetNow() { return Now; }
+
+const time_t UpdateTerm = 10;
+
+time_t MakeTime(int Year, int Month, int Day, int Hour, int Min, int Sec = 0)
+{
+	tm t{};
+	t.tm_year = Year - 1900;
+	t.tm_mon = Month - 1;
+	t.tm_mday = Day;
+	t.tm_hour = Hour;
+	t.tm_min = Min;
+	t.tm_sec = Sec;
+	t.tm_isdst = -1;
+	return mktime(&t);
+}
+
+struct Run
+{
+	MMatchScheduleData* pScheduleData;
+	time_t Time;
+};
+
+// MMatchScheduleMgr without the server, the commands and the checks on what's added.
+struct TestScheduler
+{
+	MMatchRepeatScheduleImpl RepeatImpl;
+	MMatchCountScheduleImpl CountImpl;
+	MMatchOnceScheduleImpl OnceImpl;
+
+	// Before the timer, so that it's gone before they are.
+	std::vector<std::unique_ptr<MMatchScheduleData>> Owned;
+	MMatchScheduleTimer Timer{ Now };
+	std::vector<MMatchScheduleData*> StaticSchedules;
+	std::list<MMatchScheduleData*> DynamicSchedules;
+
+	std::vector<Run> Runs;
+	std::vector<MMatchScheduleData*> Removed;
+	// How many schedules the timer handed out.
+	size_t Handled = 0;
+
+	// Next is the repeat interval as { year, month, day, hour, min }.
+	MMatchScheduleData* Add(int Type, time_t First, const unsigned char (&Next)[5], int Count,
+		bool Dynamic)
+	{
+		tm t = *localtime(&First);
+		Owned.emplace_back(new MMatchScheduleData);
+		auto* pScheduleData = Owned.back().get();
+		pScheduleData->SetType(Type);
+		MTEST_CHECK(pScheduleData->SetTimes(t.tm_year - 100, t.tm_mon + 1, t.tm_mday, t.tm_hour,
+			t.tm_min));
+		MTEST_CHECK(pScheduleData->SetNextTimes(Next[0], Next[1], Next[2], Next[3], Next[4]));
+		pScheduleData->SetCount(Count);
+		pScheduleData->SetErrorTime(int(UpdateTerm));
+		pScheduleData->SetImpl(Type == MMatchScheduleData::REPEAT ? (MMatchScheduleImpl*)&RepeatImpl :
+			Type == MMatchScheduleData::COUNT ? (MMatchScheduleImpl*)&CountImpl : &OnceImpl);
+		pScheduleData->SetDynamic(Dynamic);
+		if (Dynamic)
+			DynamicSchedules.push_back(pScheduleData);
+		else
+			StaticSchedules.push_back(pScheduleData);
+		Timer.Schedule(pScheduleData, Now);
+		return pScheduleData;
+	}
+
+	void Update()
+	{
+		Handled += Timer.Update(Now, StaticSchedules, DynamicSchedules,
+			[&](MMatchScheduleData* pScheduleData) { Runs.push_back({ pScheduleData, Now }); },
+			[&](MMatchScheduleData* pScheduleData) {
+				Removed.push_back(pScheduleData);
+				DynamicSchedules.remove(pScheduleData);
+			});
+	}
+
+	// Updates every Step seconds until End.
+	void RunUntil(time_t End, time_t Step = UpdateTerm)
+	{
+		while (Now < End)
+		{
+			Now += Step;
+			Update();
+		}
+	}
+
+	// Whether it ran once at or just after each of the times, and no other time.
+	bool RanAt(MMatchScheduleData* pScheduleData, const std::vector<time_t>& Times) const
+	{
+		std::vector<time_t> Ran;
+		for (auto& r : Runs)
+			if (r.pScheduleData == pScheduleData)
+				Ran.push_back(r.Time);
+		if (Ran.size() != Times.size())
+			return false;
+		for (size_t i = 0; i < Ran.size(); i++)
+			if (Ran[i] < Times[i] || Ran[i] >= Times[i] + UpdateTerm)
+				return false;
+		return true;
+	}
+
+	bool WasRemoved(MMatchScheduleData* pScheduleData) const
+	{
+		return std::count(Removed.begin(), Removed.end(), pScheduleData) == 1;
+	}
+};
+
+const unsigned char Never[5] = { 0, 0, 0, 0, 0 };
+const unsigned char EveryMinute[5] = { 0, 0, 0, 0, 1 };
+const unsigned char EveryQuarterHour[5] = { 0, 0, 0, 0, 15 };
+const unsigned char EveryHour[5] = { 0, 0, 0, 1, 0 };
+
+void TestDueTimes()
+{
+	struct Case
+	{
+		int Year, Month, Day, Hour, Min;
+		time_t Due;
+	};
+	const Case Cases[] = {
+		// 29 days in February 2024, 28 in 2023.
+		{ 24, 2, 29, 12, 30, MakeTime(2024, 2, 29, 12, 30) },
+		{ 23, 2, 28, 23, 59, MakeTime(2023, 2, 28, 23, 59) },
+		{ 23, 2, 29, 12, 30, MakeTime(2023, 3, 1, 0, 0) },
+		{ 24, 2, 30, 12, 30, MakeTime(2024, 3, 1, 0, 0) },
+		// 30 days in April, 31 in January and December.
+		{ 24, 4, 30, 8, 0, MakeTime(2024, 4, 30, 8, 0) },
+		{ 24, 4, 31, 8, 0, MakeTime(2024, 5, 1, 0, 0) },
+		{ 24, 1, 31, 8, 0, MakeTime(2024, 1, 31, 8, 0) },
+		{ 24, 12, 31, 23, 59, MakeTime(2024, 12, 31, 23, 59) },
+		// Month 0 is before January, and day 0 before the 1st.
+		{ 24, 0, 15, 8, 0, MakeTime(2024, 1, 1, 0, 0) },
+		{ 24, 6, 0, 8, 0, MakeTime(2024, 6, 1, 0, 0) },
+	};
+
+	for (auto& c : Cases)
+	{
+		MMatchScheduleData Data;
+		MTEST_CHECK(Data.SetTimes(c.Year, c.Month, c.Day, c.Hour, c.Min));
+		MTEST_CHECK(MMatchScheduleTimer::GetDueTime(&Data) == c.Due);
+
+		// Due is the first second at which it's no longer in the future.
+		Now = c.Due - 1;
+		MTEST_CHECK(Data.CompareCurrentTime() == 1);
+		Now = c.Due;
+		MTEST_CHECK(Data.CompareCurrentTime() != 1);
+	}
+
+	MTEST_CHECK(MMatchDayOfMonth(2024).GetMaxDay(2) == 29);
+	MTEST_CHECK(MMatchDayOfMonth(2023).GetMaxDay(2) == 28);
+	MTEST_CHECK(MMatchDayOfMonth(2100).GetMaxDay(2) == 28);
+	MTEST_CHECK(MMatchDayOfMonth(2023).GetMaxDay(4) == 30);
+	MTEST_CHECK(MMatchDayOfMonth(2023).GetMaxDay(12) == 31);
+}
+
+void TestRepeatCountOnce()
+{
+	Now = MakeTime(2024, 3, 10, 9, 59, 50);
+	TestScheduler s;
+	auto* pRepeat = s.Add(MMatchScheduleData::REPEAT, MakeTime(2024, 3, 10, 10, 0), EveryHour, 0, true);
+	auto* pCount = s.Add(MMatchScheduleData::COUNT, MakeTime(2024, 3, 10, 10, 0), EveryQuarterHour,
+		3, true);
+	auto* pOnce = s.Add(MMatchScheduleData::ONCE, MakeTime(2024, 3, 10, 11, 11), Never, 0, true);
+
+	s.RunUntil(MakeTime(2024, 3, 10, 14, 30));
+
+	MTEST_CHECK(s.RanAt(pRepeat, { MakeTime(2024, 3, 10, 10, 0), MakeTime(2024, 3, 10, 11, 0),
+		MakeTime(2024, 3, 10, 12, 0), MakeTime(2024, 3, 10, 13, 0), MakeTime(2024, 3, 10, 14, 0) }));
+	MTEST_CHECK(s.RanAt(pCount, { MakeTime(2024, 3, 10, 10, 0), MakeTime(2024, 3, 10, 10, 15),
+		MakeTime(2024, 3, 10, 10, 30) }));
+	MTEST_CHECK(s.RanAt(pOnce, { MakeTime(2024, 3, 10, 11, 11) }));
+	MTEST_CHECK(s.WasRemoved(pCount) && s.WasRemoved(pOnce) && !s.WasRemoved(pRepeat));
+	MTEST_CHECK(s.DynamicSchedules.size() == 1);
+	// Nothing was handed out before it was due.
+	MTEST_CHECK(s.Handled == s.Runs.size());
+}
+
+// Every minute, over the ends of a 29-day February, a 30-day April, and a year.
+void TestMonthEnd()
+{
+	const time_t Starts[] = {
+		MakeTime(2024, 2, 29, 23, 58),
+		MakeTime(2024, 4, 30, 23, 58),
+		MakeTime(2024, 12, 31, 23, 58),
+	};
+	for (auto Start : Starts)
+	{
+		Now = Start - 5;
+		TestScheduler s;
+		auto* pRepeat = s.Add(MMatchScheduleData::REPEAT, Start, EveryMinute, 0, true);
+		s.RunUntil(Start + 4 * 60 + 5, 5);
+
+		std::vector<time_t> Expected;
+		for (int i = 0; i <= 4; i++)
+			Expected.push_back(Start + i * 60);
+		MTEST_CHECK(s.RanAt(pRepeat, Expected));
+		MTEST_CHECK(s.Handled == s.Runs.size());
+	}
+}
+
+void TestLate()
+{
+	// The server stalled over 10:00, and the first update after it is at 10:01:05. That's within
+	// ErrorTime seconds of the minute after, so the schedule is moved to that minute and runs, and
+	// keeps going from there.
+	{
+		Now = MakeTime(2024, 3, 10, 9, 59, 50);
+		TestScheduler s;
+		auto* pRepeat = s.Add(MMatchScheduleData::REPEAT, MakeTime(2024, 3, 10, 10, 0), EveryHour,
+			0, true);
+
+		Now = MakeTime(2024, 3, 10, 10, 1, 5);
+		s.Update();
+		s.RunUntil(MakeTime(2024, 3, 10, 12, 30));
+		MTEST_CHECK(s.RanAt(pRepeat, { MakeTime(2024, 3, 10, 10, 1), MakeTime(2024, 3, 10, 11, 1),
+			MakeTime(2024, 3, 10, 12, 1) }));
+	}
+
+	// At 10:01:30 it's too late for that. A repeat schedule is dropped. A count schedule loses one
+	// from its count, and is looked at again a second later, until it has none left.
+	{
+		Now = MakeTime(2024, 3, 10, 9, 59, 50);
+		TestScheduler s;
+		auto* pRepeat = s.Add(MMatchScheduleData::REPEAT, MakeTime(2024, 3, 10, 10, 0), EveryHour,
+			0, true);
+		auto* pCount = s.Add(MMatchScheduleData::COUNT, MakeTime(2024, 3, 10, 10, 0), EveryHour, 3,
+			true);
+
+		Now = MakeTime(2024, 3, 10, 10, 1, 30);
+		s.Update();
+		MTEST_CHECK(s.WasRemoved(pRepeat));
+		MTEST_CHECK(pCount->GetCount() == 2 && pCount->GetExpireTick() == u64(Now + 1));
+
+		Now += 1;
+		s.Update();
+		MTEST_CHECK(pCount->GetCount() == 1 && pCount->GetExpireTick() == u64(Now + 1));
+
+		Now += 1;
+		s.Update();
+		MTEST_CHECK(s.WasRemoved(pCount));
+		MTEST_CHECK(s.Runs.empty() && s.Handled == 4 && s.DynamicSchedules.empty());
+	}
+}
+
+void TestClockSetBack()
+{
+	Now = MakeTime(2024, 3, 10, 9, 59, 50);
+	TestScheduler s;
+	auto* pRepeat = s.Add(MMatchScheduleData::REPEAT, MakeTime(2024, 3, 10, 10, 0), EveryHour, 0, true);
+	auto* pStaticOnce = s.Add(MMatchScheduleData::ONCE, MakeTime(2024, 3, 10, 10, 10), Never, 0,
+		false);
+	auto* pStaticCount = s.Add(MMatchScheduleData::COUNT, MakeTime(2024, 3, 10, 10, 5), EveryMinute,
+		2, false);
+	s.RunUntil(MakeTime(2024, 3, 10, 10, 30));
+
+	MTEST_CHECK(s.RanAt(pRepeat, { MakeTime(2024, 3, 10, 10, 0) }));
+	MTEST_CHECK(s.RanAt(pStaticOnce, { MakeTime(2024, 3, 10, 10, 10) }));
+	MTEST_CHECK(s.RanAt(pStaticCount, { MakeTime(2024, 3, 10, 10, 5),
+		MakeTime(2024, 3, 10, 10, 6) }));
+	// Static schedules that are done stay where they are, out of the wheel.
+	MTEST_CHECK(pStaticOnce->IsNeedDelete() && !pStaticOnce->IsScheduled());
+	MTEST_CHECK(pStaticCount->IsNeedDelete() && !pStaticCount->IsScheduled());
+	MTEST_CHECK(s.Removed.empty() && s.StaticSchedules.size() == 2);
+
+	// An hour back. The wheel is filed again from 9:30, so a schedule added for 9:45 runs at
+	// 9:45, rather than whenever the wheel would have caught up with it.
+	Now = MakeTime(2024, 3, 10, 9, 30);
+	s.Update();
+	auto* pOnce = s.Add(MMatchScheduleData::ONCE, MakeTime(2024, 3, 10, 9, 45), Never, 0, true);
+	s.RunUntil(MakeTime(2024, 3, 10, 11, 5));
+
+	MTEST_CHECK(s.RanAt(pOnce, { MakeTime(2024, 3, 10, 9, 45) }));
+	// The repeat schedule is still due at 11:00, and the static ones don't run again.
+	MTEST_CHECK(s.RanAt(pRepeat, { MakeTime(2024, 3, 10, 10, 0), MakeTime(2024, 3, 10, 11, 0) }));
+	MTEST_CHECK(s.RanAt(pStaticOnce, { MakeTime(2024, 3, 10, 10, 10) }));
+	MTEST_CHECK(s.RanAt(pStaticCount, { MakeTime(2024, 3, 10, 10, 5),
+		MakeTime(2024, 3, 10, 10, 6) }));
+	MTEST_CHECK(s.Handled == s.Runs.size());
+}
+
+}
+
+int main()
+{
+	Now = MakeTime(2024, 1, 15, 12, 0);
+	MMatchSetScheduleClock(GetNow);
+
+	TestDueTimes();
+	TestRepeatCountOnce();
+	TestMonthEnd();
+	TestLate();
+	TestClockSetBack();
+
+	return MTestResult();
+}
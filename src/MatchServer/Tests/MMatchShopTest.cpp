@@ -0,0 +1,188 @@
+#include "MMatchShopCatalog.h"
+#include "MCommandParameter.h"
+#include "MPacketCrypter.h"
+#include "MTest.h"
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Checks MMatchShopCatalog and the MC_MATCH_RESPONSE_SHOP_ITEMLIST parameter that
+// MMatchServer::ResponseShopItemList sends from it, then runs a storm of shop opens, each of
+// which builds the parameter, serializes it and encrypts it like a command on its way out. Runs
+// the storm two ways:
+// - Rebuild, the way the shop list was answered before there were catalogs, with a blob built
+//   from the item list and copied into the parameter for every open;
+// - Shared, with MMakeShopItemListParameter, which shares the catalog's blob.
+
+namespace {
+
+using CatalogPtr = std::shared_ptr<const MMatchShopCatalog>;
+
+CatalogPtr MakeCatalog(int nItemCount, u32 nVersion)
+{
+	auto pCatalog = std::make_shared<MMatchShopCatalog>();
+	for (int i = 0; i < nItemCount; i++)
+	{
+		ShopItemNode Node;
+		// Not in order, like shop.xml.
+		Node.nItemID = 500000 + (i * 7919) % 10007;
+		pCatalog->Items.push_back(Node);
+	}
+	pCatalog->Build(nVersion);
+	return pCatalog;
+}
+
+std::vector<u32> GetItemIDs(MCommandParameter* pParam)
+{
+	std::vector<u32> IDs;
+	const void* pArray = pParam->GetPointer();
+	if (!pArray)
+		return IDs;
+	for (int i = 0; i < MGetBlobArrayCount(pArray); i++)
+		IDs.push_back(*static_cast<const u32*>(MGetBlobArrayElement(pArray, i)));
+	return IDs;
+}
+
+void TestCatalog()
+{
+	auto pCatalog = std::make_shared<MMatchShopCatalog>();
+	for (u32 nItemID : { 30, 10, 20, 10 })
+	{
+		ShopItemNode Node;
+		Node.nItemID = nItemID;
+		pCatalog->Items.push_back(Node);
+	}
+	pCatalog->Build(7);
+
+	MTEST_CHECK(pCatalog->Version == 7);
+	MTEST_CHECK(pCatalog->GetCount() == 4);
+	MTEST_CHECK((pCatalog->SortedItemIDs == std::vector<u32>{ 10, 20, 30 }));
+	MTEST_CHECK(pCatalog->IsSellItem(20));
+	MTEST_CHECK(!pCatalog->IsSellItem(25));
+	MTEST_CHECK(pCatalog->GetSellItem(-1) == nullptr);
+	MTEST_CHECK(pCatalog->GetSellItem(4) == nullptr);
+	MTEST_CHECK(pCatalog->GetSellItem(0)->nItemID == 30);
+
+	std::weak_ptr<const MMatchShopCatalog> Weak = pCatalog;
+	CatalogPtr pShared = std::move(pCatalog);
+
+	// The whole list, in shop.xml order, out of the catalog's own blob.
+	auto* pWhole = MMakeShopItemListParameter(pShared, 0, 0);
+	MTEST_CHECK(pWhole->GetPointer() == pShared->ItemListBlob.get());
+	MTEST_CHECK((GetItemIDs(pWhole) == std::vector<u32>{ 30, 10, 20, 10 }));
+	auto* pClone = pWhole->Clone();
+	MTEST_CHECK(pClone->GetPointer() == pShared->ItemListBlob.get());
+
+	// Asking for more than there is gets everything, too.
+	auto* pTooMany = MMakeShopItemListParameter(pShared, 0, 100);
+	MTEST_CHECK(pTooMany->GetPointer() == pShared->ItemListBlob.get());
+	delete pTooMany;
+
+	// Anything else is a copy, with zeroes past the end.
+	auto* pRange = MMakeShopItemListParameter(pShared, 2, 3);
+	MTEST_CHECK(pRange->GetPointer() != pShared->ItemListBlob.get());
+	MTEST_CHECK((GetItemIDs(pRange) == std::vector<u32>{ 20, 10, 0 }));
+	delete pRange;
+
+	// Swapping in another catalog leaves the one the parameters hold alone until they're gone.
+	pShared = MakeCatalog(10, 8);
+	MTEST_CHECK(!Weak.expired());
+	MTEST_CHECK((GetItemIDs(pClone) == std::vector<u32>{ 30, 10, 20, 10 }));
+	delete pWhole;
+	MTEST_CHECK(!Weak.expired());
+	delete pClone;
+	MTEST_CHECK(Weak.expired());
+
+	// Too big to send, like MCommandParameterBlob, and doesn't keep the buffer alive.
+	std::shared_ptr<const void> pBig(new char[16], std::default_delete<const char[]>());
+	MCommandParameterSharedBlob Big{ pBig, MAX_BLOB_SIZE + 1 };
+	char Data[64];
+	MTEST_CHECK(Big.GetPointer() == nullptr);
+	MTEST_CHECK(Big.GetData(Data, sizeof(Data)) == 0);
+	MTEST_CHECK(pBig.use_count() == 1);
+}
+
+// The old ResponseShopItemList, which went through the shop's list of item nodes.
+MCommandParameter* MakeRebuiltParameter(const std::vector<ShopItemNode*>& Nodes)
+{
+	const int nCount = int(Nodes.size());
+	void* pItemArray = MMakeBlobArray(sizeof(u32), nCount);
+	for (int i = 0; i < nCount; i++)
+		*(u32*)MGetBlobArrayElement(pItemArray, i) = Nodes[i]->nItemID;
+	auto* pParam = new MCommandParameterBlob(pItemArray, MGetBlobArraySize(pItemArray));
+	MEraseBlobArray(pItemArray);
+	return pParam;
+}
+
+struct StormResult
+{
+	double BuildTime = 0;
+	double TotalTime = 0;
+	u32 Checksum = 0;
+};
+
+// Opens the shop OpenCount times. BuildTime is the time spent making parameters, and TotalTime
+// includes serializing and encrypting them.
+template <typename MakeParamType>
+StormResult RunStorm(int OpenCount, MakeParamType&& MakeParam)
+{
+	static char Data[0x10000], Encrypted[0x10000];
+	MPacketCrypterKey Key;
+	memset(Key.szKey, 0x5a, sizeof(Key.szKey));
+
+	StormResult Result;
+	Result.TotalTime = MTestTimeMS([&] {
+		for (int i = 0; i < OpenCount; i++)
+		{
+			MCommandParameter* pParam = nullptr;
+			Result.BuildTime += MTestTimeMS([&] { pParam = MakeParam(); });
+			const int nSize = pParam->GetData(Data, sizeof(Data));
+			MPacketCrypter::Encrypt(Data, nSize, Encrypted, nSize, &Key);
+			Result.Checksum = Result.Checksum * 31 + u8(Encrypted[nSize - 1]);
+			delete pParam;
+		}
+	});
+	return Result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int ItemCount = argc > 1 ? atoi(argv[1]) : 600;
+	const int OpenCount = argc > 2 ? atoi(argv[2]) : 20000;
+
+	TestCatalog();
+
+	auto pCatalog = MakeCatalog(ItemCount, 1);
+	std::vector<ShopItemNode> NodeStorage = pCatalog->Items;
+	std::vector<ShopItemNode*> Nodes;
+	for (auto& Node : NodeStorage)
+		Nodes.push_back(&Node);
+
+	// The same bytes go out either way.
+	{
+		static char RebuiltData[0x10000], SharedData[0x10000];
+		auto* pRebuilt = MakeRebuiltParameter(Nodes);
+		auto* pShared = MMakeShopItemListParameter(pCatalog, 0, 0);
+		const int nSize = pRebuilt->GetData(RebuiltData, sizeof(RebuiltData));
+		MTEST_CHECK(nSize > 0);
+		MTEST_CHECK(pShared->GetData(SharedData, sizeof(SharedData)) == nSize);
+		MTEST_CHECK(memcmp(RebuiltData, SharedData, nSize) == 0);
+		delete pRebuilt;
+		delete pShared;
+	}
+
+	const auto Rebuild = RunStorm(OpenCount, [&] { return MakeRebuiltParameter(Nodes); });
+	const auto Shared = RunStorm(OpenCount, [&] {
+		return MMakeShopItemListParameter(pCatalog, 0, 0); });
+
+	MTEST_CHECK(Rebuild.Checksum == Shared.Checksum);
+	MTEST_CHECK(Shared.BuildTime < Rebuild.BuildTime);
+
+	std::printf("%d shop opens of %d items: rebuild %.1f ms (%.1f ms building), shared %.1f ms "
+		"(%.1f ms building)\n", OpenCount, ItemCount, Rebuild.TotalTime, Rebuild.BuildTime,
+		Shared.TotalTime, Shared.BuildTime);
+
+	return MTestResult();
+}
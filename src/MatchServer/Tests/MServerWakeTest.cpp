@@ -0,0 +1,197 @@
+#include "SafeString.h"
+#include "StringView.h"
+#include "MWorkSignal.h"
+#include "MMatchTickDelay.h"
+#include "MTest.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+// Runs the match server's main loop the way main.cpp does, with MWorkSignal standing in for
+// MServer::WaitForWork and Wake, and MGetNextTickDelay for MMatchServer::GetNextTickDelay. A
+// producer thread posts commands the way PostSafeQueue does. Checks that:
+// - a Wake before the Wait isn't lost, and leftover work doesn't wait at all;
+// - commands are picked up right away, not at the next tick;
+// - an idle server only wakes up every MMATCH_IDLE_TICK_DELAY ms, and one with a game running
+//   every MMATCH_ACTIVE_TICK_DELAY ms.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double MSSince(Clock::time_point Start)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - Start).count();
+}
+
+struct TestStage
+{
+	STAGE_STATE State;
+	STAGE_STATE GetState() const { return State; }
+};
+
+// The safe command queue, with the time each command was posted.
+struct CommandQueue
+{
+	std::mutex Mutex;
+	std::deque<Clock::time_point> Commands;
+	MWorkSignal& Signal;
+
+	void Post()
+	{
+		{
+			std::lock_guard<std::mutex> Lock{ Mutex };
+			Commands.push_back(Clock::now());
+		}
+		Signal.Wake();
+	}
+
+	// Takes one command per call, like MMatchServer::Run does with a command budget, so that
+	// some are left over for the next pass.
+	bool TakeOne(std::vector<double>& Latencies)
+	{
+		std::lock_guard<std::mutex> Lock{ Mutex };
+		if (Commands.empty())
+			return false;
+		Latencies.push_back(MSSince(Commands.front()));
+		Commands.pop_front();
+		return true;
+	}
+
+	bool IsEmpty()
+	{
+		std::lock_guard<std::mutex> Lock{ Mutex };
+		return Commands.empty();
+	}
+};
+
+void TestBasics()
+{
+	MWorkSignal Signal;
+
+	// Woken before it waits.
+	Signal.Wake();
+	const auto Start = Clock::now();
+	MTEST_CHECK(Signal.Wait(1000, false));
+	// Leftover work.
+	MTEST_CHECK(Signal.Wait(1000, true));
+	MTEST_CHECK(MSSince(Start) < 50);
+
+	// The wake was used up, so this one times out.
+	const auto TimeoutStart = Clock::now();
+	MTEST_CHECK(!Signal.Wait(30, false));
+	MTEST_CHECK(MSSince(TimeoutStart) >= 25);
+
+	// Any number of Wakes before a Wait are one wakeup.
+	for (int i = 0; i < 5; i++)
+		Signal.Wake();
+	MTEST_CHECK(Signal.Wait(1000, false));
+	MTEST_CHECK(!Signal.Wait(10, false));
+
+	std::vector<TestStage> Stages{ { STAGE_STATE_STANDBY }, { STAGE_STATE_CLOSE } };
+	std::vector<TestStage*> Pointers{ &Stages[0], &Stages[1] };
+	MTEST_CHECK(MGetNextTickDelay(Pointers) == MMATCH_IDLE_TICK_DELAY);
+	Stages[1].State = STAGE_STATE_COUNTDOWN;
+	MTEST_CHECK(MGetNextTickDelay(Pointers) == MMATCH_ACTIVE_TICK_DELAY);
+	Stages[1].State = STAGE_STATE_RUN;
+	MTEST_CHECK(MGetNextTickDelay(Pointers) == MMATCH_ACTIVE_TICK_DELAY);
+	MTEST_CHECK(MGetNextTickDelay(std::vector<TestStage*>{}) == MMATCH_IDLE_TICK_DELAY);
+}
+
+// Runs the loop for Duration ms with no commands, and returns how many times it went around.
+int CountIdlePasses(STAGE_STATE State, u32 Duration)
+{
+	MWorkSignal Signal;
+	std::vector<TestStage> Stages{ { STAGE_STATE_STANDBY }, { State } };
+	std::vector<TestStage*> Pointers{ &Stages[0], &Stages[1] };
+
+	int Passes = 0;
+	const auto Start = Clock::now();
+	while (MSSince(Start) < Duration)
+	{
+		Signal.Wait(MGetNextTickDelay(Pointers), false);
+		Passes++;
+	}
+	return Passes;
+}
+
+struct Latency
+{
+	double P50, P99, Max;
+	int Passes;
+};
+
+// A producer posts Count commands at random intervals while the loop is idle, and the loop
+// records how long each one waited.
+Latency MeasureLatency(int Count)
+{
+	MWorkSignal Signal;
+	CommandQueue Queue{ {}, {}, Signal };
+	std::vector<TestStage*> Stages;
+	std::atomic<bool> Done{ false };
+
+	std::thread Producer{ [&] {
+		std::mt19937 Rng{ 97531 };
+		for (int i = 0; i < Count; i++)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(200 + Rng() % 5000));
+			// Sometimes two at once, so that one is left over for the next pass.
+			Queue.Post();
+			if (Rng() % 8 == 0)
+				Queue.Post();
+		}
+		Done = true;
+		Signal.Wake();
+	} };
+
+	std::vector<double> Latencies;
+	int Passes = 0;
+	while (!Done || !Queue.IsEmpty())
+	{
+		Queue.TakeOne(Latencies);
+		Signal.Wait(MGetNextTickDelay(Stages), !Queue.IsEmpty());
+		Passes++;
+	}
+	Producer.join();
+
+	std::sort(Latencies.begin(), Latencies.end());
+	MTEST_CHECK(Latencies.size() >= size_t(Count));
+	return{ Latencies[Latencies.size() / 2],
+		Latencies[(std::min)(Latencies.size() - 1, Latencies.size() * 99 / 100)],
+		Latencies.back(), Passes };
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int CommandCount = argc > 1 ? atoi(argv[1]) : 300;
+
+	TestBasics();
+
+	// Idle, about ten passes a second; with a game running, about a hundred. The bounds are loose
+	// at the bottom, since a busy machine can oversleep, but the top is what matters: no polling.
+	const u32 Duration = 1000;
+	const int IdlePasses = CountIdlePasses(STAGE_STATE_STANDBY, Duration);
+	const int ActivePasses = CountIdlePasses(STAGE_STATE_RUN, Duration);
+	MTEST_CHECK(IdlePasses <= int(Duration / MMATCH_IDLE_TICK_DELAY) + 1 && IdlePasses >= 5);
+	MTEST_CHECK(ActivePasses <= int(Duration / MMATCH_ACTIVE_TICK_DELAY) + 1 && ActivePasses >= 30);
+
+	// Commands are handled as soon as they're posted, far sooner than the idle tick would get
+	// to them.
+	const auto Result = MeasureLatency(CommandCount);
+	MTEST_CHECK(Result.P50 < MMATCH_IDLE_TICK_DELAY / 10.0);
+	MTEST_CHECK(Result.P99 < MMATCH_IDLE_TICK_DELAY / 4.0);
+
+	std::printf("Wakeups in %u ms: %d idle, %d with a game running. %d commands: latency p50 "
+		"%.3f ms, p99 %.3f ms, max %.3f ms, in %d passes\n", Duration, IdlePasses, ActivePasses,
+		CommandCount, Result.P50, Result.P99, Result.Max, Result.Passes);
+
+	return MTestResult();
+}
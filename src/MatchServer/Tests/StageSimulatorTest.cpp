@@ -0,0 +1,170 @@
+#include "StageSimulator.h"
+#include "MTest.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Runs TStageSimulator over stand-in stages whose Simulate burns about as much CPU as the
+// collision queries of a busy stage, and checks that:
+// - every stage is simulated once per Run;
+// - stages that can't be simulated concurrently stay on the calling thread;
+// - the deferred work runs on the calling thread, in stage order, after all simulation.
+// It then times a number of ticks with and without worker threads, and reports the median and
+// 99th percentile tick, since a tick that waits on one slow stage matters more than the average.
+
+namespace {
+
+struct TestStage
+{
+	int Index;
+	bool Concurrent;
+	int WorkPerTick;
+
+	std::vector<int>* DeferredLog;
+	std::thread::id MainThread;
+	std::atomic<int>* SimulatingNow;
+
+	int SimulateCount = 0;
+	bool SimulatedOffMainThread = false;
+	bool DeferredBeforeAllSimulated = false;
+	double Sink = 0;
+
+	bool CanSimulateConcurrently() const { return Concurrent; }
+
+	void Simulate(u64 nClock)
+	{
+		++*SimulatingNow;
+		++SimulateCount;
+		if (std::this_thread::get_id() != MainThread)
+			SimulatedOffMainThread = true;
+
+		// A stand-in for moving projectiles and sweeping players through the map.
+		double x = double(Index + nClock);
+		for (int i = 0; i < WorkPerTick; ++i)
+			x = std::sqrt(x * x + i) * 0.5 + 1;
+		Sink += x;
+		--*SimulatingNow;
+	}
+
+	void RunDeferred()
+	{
+		if (*SimulatingNow != 0 || std::this_thread::get_id() != MainThread)
+			DeferredBeforeAllSimulated = true;
+		DeferredLog->push_back(Index);
+	}
+};
+
+struct Setup
+{
+	std::vector<TestStage> Stages;
+	std::vector<TestStage*> Pointers;
+	std::vector<int> DeferredLog;
+	std::atomic<int> SimulatingNow{ 0 };
+
+	Setup(int StageCount, int SerialEvery, int WorkPerTick)
+	{
+		Stages.reserve(StageCount);
+		for (int i = 0; i < StageCount; ++i)
+		{
+			const bool Concurrent = SerialEvery == 0 || i % SerialEvery != 0;
+			Stages.push_back({ i, Concurrent, WorkPerTick, &DeferredLog,
+				std::this_thread::get_id(), &SimulatingNow });
+		}
+		for (auto& Stage : Stages)
+			Pointers.push_back(&Stage);
+	}
+};
+
+void CheckRuns(int ThreadCount, int SerialEvery)
+{
+	const int StageCount = 37;
+	const int Ticks = 50;
+	Setup s{ StageCount, SerialEvery, 200 };
+
+	TStageSimulator<TestStage> Simulator;
+	Simulator.Create(ThreadCount);
+	for (int Tick = 0; Tick < Ticks; ++Tick)
+	{
+		s.DeferredLog.clear();
+		Simulator.Run(s.Pointers, u64(Tick) * 10);
+
+		bool InOrder = int(s.DeferredLog.size()) == StageCount;
+		for (int i = 0; InOrder && i < StageCount; ++i)
+			InOrder = s.DeferredLog[i] == i;
+		MTEST_CHECK(InOrder);
+	}
+	Simulator.Destroy();
+
+	for (auto& Stage : s.Stages)
+	{
+		MTEST_CHECK(Stage.SimulateCount == Ticks);
+		MTEST_CHECK(!Stage.DeferredBeforeAllSimulated);
+		if (!Stage.Concurrent)
+			MTEST_CHECK(!Stage.SimulatedOffMainThread);
+	}
+}
+
+struct TickTimes
+{
+	double Total = 0;
+	double P50 = 0;
+	double P99 = 0;
+};
+
+// The value that Fraction of the sorted Times are at or below.
+double Percentile(std::vector<double>& Times, double Fraction)
+{
+	const auto Index = (std::min)(size_t(Fraction * Times.size()), Times.size() - 1);
+	std::nth_element(Times.begin(), Times.begin() + Index, Times.end());
+	return Times[Index];
+}
+
+TickTimes TimeTicks(int ThreadCount, int StageCount, int Ticks, int WorkPerTick)
+{
+	Setup s{ StageCount, 0, WorkPerTick };
+	TStageSimulator<TestStage> Simulator;
+	Simulator.Create(ThreadCount);
+
+	std::vector<double> Times;
+	Times.reserve(Ticks);
+	TickTimes Result;
+	for (int Tick = 0; Tick < Ticks; ++Tick)
+	{
+		s.DeferredLog.clear();
+		Times.push_back(MTestTimeMS([&] { Simulator.Run(s.Pointers, u64(Tick) * 10); }));
+		Result.Total += Times.back();
+	}
+	Simulator.Destroy();
+
+	Result.P50 = Percentile(Times, 0.5);
+	Result.P99 = Percentile(Times, 0.99);
+	return Result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	for (int Threads : { 0, 1, 3, 8 })
+	{
+		CheckRuns(Threads, 0);
+		CheckRuns(Threads, 4);
+		// Everything on the calling thread.
+		CheckRuns(Threads, 1);
+	}
+
+	const int StageCount = argc > 1 ? atoi(argv[1]) : 64;
+	const int Ticks = argc > 2 ? atoi(argv[2]) : 100;
+	const int WorkPerTick = 5000;
+	const int Workers = (std::max)(int(std::thread::hardware_concurrency()), 1) - 1;
+
+	const auto Serial = TimeTicks(0, StageCount, Ticks, WorkPerTick);
+	const auto Parallel = TimeTicks(Workers, StageCount, Ticks, WorkPerTick);
+	MTEST_CHECK(Serial.P50 <= Serial.P99 && Parallel.P50 <= Parallel.P99);
+	std::printf("%d stages, %d ticks on the main thread: %.1f ms, tick p50 %.3f ms, p99 %.3f ms\n",
+		StageCount, Ticks, Serial.Total, Serial.P50, Serial.P99);
+	std::printf("%d stages, %d ticks with %d worker(s): %.1f ms, tick p50 %.3f ms, p99 %.3f ms\n",
+		StageCount, Ticks, Workers, Parallel.Total, Parallel.P50, Parallel.P99);
+
+	return MTestResult();
+}
@@ -4,10 +4,59 @@
 #include <atomic>
 #include "MFile.h"
 #include "MCrashDump.h"
+#include "MProfileStats.h"
+#include <new>
+#include <cstdlib>
+#include <algorithm>
 #ifndef WIN32
 	#include <systemd/sd-daemon.h>
 #endif
 
+// Counts allocations for the command profiler while it's enabled. Every form of delete is
+// replaced along with new, so that none of them can reach a standard library version that
+// doesn't match the allocation. The nothrow forms of new call these.
+void* operator new(size_t Size)
+{
+	if (MCountAllocations.load(std::memory_order_relaxed))
+		++MThreadAllocCount;
+	if (auto* Ptr = malloc(Size ? Size : 1))
+		return Ptr;
+	throw std::bad_alloc{};
+}
+void* operator new[](size_t Size) { return operator new(Size); }
+void operator delete(void* Ptr) noexcept { free(Ptr); }
+void operator delete[](void* Ptr) noexcept { free(Ptr); }
+void operator delete(void* Ptr, size_t) noexcept { free(Ptr); }
+void operator delete[](void* Ptr, size_t) noexcept { free(Ptr); }
+
+#ifdef __cpp_aligned_new
+void* operator new(size_t Size, std::align_val_t Align)
+{
+	if (MCountAllocations.load(std::memory_order_relaxed))
+		++MThreadAllocCount;
+	if (!Size)
+		Size = 1;
+#ifdef _WIN32
+	if (auto* Ptr = _aligned_malloc(Size, size_t(Align)))
+		return Ptr;
+#else
+	void* Ptr;
+	if (posix_memalign(&Ptr, (std::max)(size_t(Align), sizeof(void*)), Size) == 0)
+		return Ptr;
+#endif
+	throw std::bad_alloc{};
+}
+void* operator new[](size_t Size, std::align_val_t Align) { return operator new(Size, Align); }
+#ifdef _WIN32
+void operator delete(void* Ptr, std::align_val_t) noexcept { _aligned_free(Ptr); }
+#else
+void operator delete(void* Ptr, std::align_val_t) noexcept { free(Ptr); }
+#endif
+void operator delete[](void* Ptr, std::align_val_t Align) noexcept { operator delete(Ptr, Align); }
+void operator delete(void* Ptr, size_t, std::align_val_t Align) noexcept { operator delete(Ptr, Align); }
+void operator delete[](void* Ptr, size_t, std::align_val_t Align) noexcept { operator delete(Ptr, Align); }
+#endif
+
 template <size_t size>
 static bool GetLogFileName(char(&pszBuf)[size])
 {
@@ -53,6 +102,7 @@ static void InputThreadProc()
 			InputQueue.emplace_back(Input);
 			HasInput = true;
 		}
+		MMatchServer::GetInstance()->Wake();
 	}
 }
 
@@ -100,7 +150,8 @@ try
 	{
 		MatchServer.Run();
 		HandleInput(MatchServer);
-		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		// Sleeps until a command or a database result comes in, or the next tick is due.
+		MatchServer.WaitForWork(MatchServer.GetNextTickDelay());
 	}
 }
 catch (std::runtime_error& e)
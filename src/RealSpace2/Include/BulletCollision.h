@@ -7,6 +7,7 @@
 #pragma warning(pop)
 #include "optional.h"
 #include "RNameSpace.h"
+#include <mutex>
 
 _NAMESPACE_REALSPACE2_BEGIN
 
@@ -22,6 +23,8 @@ public:
 	void Build();
 	void Clear();
 
+	// The queries lock QueryMutex, since the broadphase keeps its traversal stack in the world
+	// and two threads sweeping the same world at once would corrupt it.
 	bool Pick(const v3& Src, const v3& Dest, v3* Hit = nullptr, v3* Normal = nullptr);
 	bool CheckCylinder(const v3& Src, const v3& Dest, float Radius, float Height, v3* Hit = nullptr, v3* Normal = nullptr);
 	bool CheckSphere(const v3& Src, const v3& Dest, float Radius, v3* Hit = nullptr, v3* Normal = nullptr);
@@ -42,6 +45,8 @@ private:
 	optional<btBvhTriangleMeshShape> Mesh;
 	std::vector<v3> Vertices;
 	std::vector<BulletCollision::IndexType> Indices;
+
+	std::mutex QueryMutex;
 };
 
 _NAMESPACE_REALSPACE2_END
@@ -20,6 +20,8 @@ using RFREEBLOCKLIST = std::list<FreeBlock>;
 
 using RGENERATELIGHTMAPCALLBACK = bool(*)(float fProgress);
 
+struct LightmapShadowBVH;
+
 struct LightmapGenerator
 {
 	const char* filename{};
@@ -27,6 +29,8 @@ struct LightmapGenerator
 	int Supersample{};
 	float Tolerance{};
 	v3 AmbientLight{ 0, 0, 0 };
+	// Number of threads that bake polygons. Zero means one per hardware thread.
+	int ThreadCount{};
 
 	RGENERATELIGHTMAPCALLBACK pProgressFn{};
 
@@ -38,17 +42,38 @@ struct LightmapGenerator
 	bool Generate();
 
 private:
+	// Buffers that a thread needs while it's baking a polygon.
+	struct Scratch
+	{
+		std::unique_ptr<RLIGHT*[]> pplight;
+		std::unique_ptr<rvector[]> lightmap;
+		std::unique_ptr<bool[]> isshadow;
+		u64 RayCount{};
+	};
+
+	// The lightmap of one convex polygon, handed from the worker threads
+	// to the thread that inserts them in polygon order.
+	struct PolygonLightmap
+	{
+		int lightmapsize{};
+		std::unique_ptr<u32[]> data;
+		bool Done{};
+	};
+
 	void Init();
-	bool ProcessConvexPolygon(const RCONVEXPOLYGONINFO* poly, int PolyIndex, int& lightmapsize);
-	void InsertLightmap(int lightmapsize, int PolyIndex);
-	v3 CalcDiffuse(const rboundingbox& bbox,
+	void InitScratch(Scratch& s);
+	bool BakePolygons(int nThreads);
+	bool ProcessConvexPolygon(Scratch& s, const RCONVEXPOLYGONINFO* poly, int PolyIndex,
+		PolygonLightmap& Out);
+	void InsertLightmap(int lightmapsize, const u32* lightmapdata, int PolyIndex);
+	v3 CalcDiffuse(Scratch& s, const rboundingbox& bbox,
 		const RCONVEXPOLYGONINFO* poly,
 		const v3& polynormal, const v3& diff,
 		const RLIGHT* plight,
 		int lightmapsize,
 		int j, int k,
 		int au, int av, int ax);
-	bool CheckShadow(const RLIGHT* plight,
+	bool CheckShadow(Scratch& s, const RLIGHT* plight,
 		const RCONVEXPOLYGONINFO* poly,
 		const rboundingbox& bbox,
 		const v3& pnormal, const v3& diff,
@@ -59,12 +84,12 @@ private:
 
 	float MaximumArea{};
 	int ConstCount{};
-	int LightIndex{};
 
-	std::unique_ptr<RLIGHT*[]> pplight;
-	std::unique_ptr<rvector[]> lightmap;
-	std::unique_ptr<u32[]> lightmapdata;
-	std::unique_ptr<bool[]> isshadow;
+	// Shadow casters: the BSP polygons that PickShadow would hit, and the map objects.
+	std::unique_ptr<LightmapShadowBVH> BspShadowBVH;
+	std::unique_ptr<LightmapShadowBVH> ObjectShadowBVH;
+
+	std::vector<PolygonLightmap> PolygonLightmaps;
 	std::unique_ptr<int[]> SourceLightmap;
 	std::map<u32, int> ConstmapTable;
 
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "RNameSpace.h"
+#include "MUtil.h"
+#include "RMath.h"
+#include <algorithm>
+#include <vector>
+
+_NAMESPACE_REALSPACE2_BEGIN
+
+// Flattened bounding volume hierarchy over the triangles that cast shadows onto the lightmaps.
+// A shadow ray only needs to know whether anything is in the way, so traversal stops at the
+// first hit instead of looking for the nearest one. It's read-only once built, so every baking
+// thread can query it at the same time.
+struct LightmapShadowBVH
+{
+	struct Triangle
+	{
+		v3 V[3];
+		// Rays that start behind this plane pass through the triangle.
+		rplane Plane;
+	};
+
+	void Build(std::vector<Triangle> NewTriangles)
+	{
+		Triangles = std::move(NewTriangles);
+		Nodes.clear();
+		if (Triangles.empty())
+			return;
+
+		Nodes.reserve(2 * Triangles.size() / MaxLeafSize + 1);
+		BuildNode(0, Triangles.size());
+	}
+
+	// Returns true if a triangle lies between From and To,
+	// at least Tolerance units away from To.
+	bool Occluded(const v3& From, const v3& To, float Tolerance) const
+	{
+		if (Nodes.empty())
+			return false;
+
+		auto Dir = To - From;
+		const auto Length = Magnitude(Dir);
+		const auto MaxDist = Length - Tolerance;
+		if (Length == 0 || MaxDist <= 0)
+			return false;
+		Dir *= 1.f / Length;
+		const auto InverseDir = NoninfiniteReciprocal(Dir);
+
+		u32 Stack[64];
+		int StackSize = 0;
+		u32 Index = 0;
+		while (true)
+		{
+			auto& Node = Nodes[Index];
+			if (IntersectsNode(Node, From, InverseDir, MaxDist))
+			{
+				if (Node.Count == 0)
+				{
+					// The left child always directly follows its parent.
+					Stack[StackSize++] = Node.RightOrFirst;
+					Index = Index + 1;
+					continue;
+				}
+
+				for (u32 i = Node.RightOrFirst; i < Node.RightOrFirst + Node.Count; ++i)
+				{
+					auto& Tri = Triangles[i];
+					if (DotProduct(Tri.Plane, From) < 0)
+						continue;
+
+					float Dist;
+					if (IntersectTriangle(Tri.V[0], Tri.V[1], Tri.V[2], From, Dir, &Dist) &&
+						Dist < MaxDist)
+						return true;
+				}
+			}
+
+			if (StackSize == 0)
+				return false;
+			Index = Stack[--StackSize];
+		}
+	}
+
+private:
+	static constexpr size_t MaxLeafSize = 4;
+
+	struct Node
+	{
+		rboundingbox Bounds;
+		// Index of the right child for inner nodes, of the first triangle for leaves.
+		u32 RightOrFirst;
+		// Zero for inner nodes.
+		u32 Count;
+	};
+
+	static v3 Centroid(const Triangle& Tri) { return Tri.V[0] + Tri.V[1] + Tri.V[2]; }
+
+	static bool IntersectsNode(const Node& Node, const v3& From, const v3& InverseDir, float MaxDist)
+	{
+		float tmin = 0, tmax = MaxDist;
+		for (int i = 0; i < 3; ++i)
+		{
+			auto t0 = (Node.Bounds.vmin[i] - From[i]) * InverseDir[i];
+			auto t1 = (Node.Bounds.vmax[i] - From[i]) * InverseDir[i];
+			if (t0 > t1)
+				std::swap(t0, t1);
+			tmin = max(tmin, t0);
+			tmax = min(tmax, t1);
+			if (tmin > tmax)
+				return false;
+		}
+		return true;
+	}
+
+	// Splits at the median centroid along the widest axis, which keeps the tree
+	// balanced so that the traversal stack can't overflow.
+	u32 BuildNode(size_t First, size_t Count)
+	{
+		const auto Index = static_cast<u32>(Nodes.size());
+		Nodes.emplace_back();
+
+		rboundingbox Bounds, CentroidBounds;
+		Bounds.vmin = Bounds.vmax = Triangles[First].V[0];
+		CentroidBounds.vmin = CentroidBounds.vmax = Centroid(Triangles[First]);
+		for (size_t i = First; i < First + Count; ++i)
+		{
+			const auto c = Centroid(Triangles[i]);
+			for (int k = 0; k < 3; ++k)
+			{
+				for (auto& v : Triangles[i].V)
+				{
+					Bounds.vmin[k] = min(Bounds.vmin[k], v[k]);
+					Bounds.vmax[k] = max(Bounds.vmax[k], v[k]);
+				}
+				CentroidBounds.vmin[k] = min(CentroidBounds.vmin[k], c[k]);
+				CentroidBounds.vmax[k] = max(CentroidBounds.vmax[k], c[k]);
+			}
+		}
+
+		// Pad the box a little so that rounding never makes a ray miss
+		// the box of a triangle that it hits.
+		for (int k = 0; k < 3; ++k)
+		{
+			Bounds.vmin[k] -= 0.01f;
+			Bounds.vmax[k] += 0.01f;
+		}
+		Nodes[Index].Bounds = Bounds;
+
+		const auto Extent = CentroidBounds.vmax - CentroidBounds.vmin;
+		int Axis = 0;
+		if (Extent.y > Extent[Axis]) Axis = 1;
+		if (Extent.z > Extent[Axis]) Axis = 2;
+
+		if (Count <= MaxLeafSize || Extent[Axis] == 0)
+		{
+			Nodes[Index].RightOrFirst = static_cast<u32>(First);
+			Nodes[Index].Count = static_cast<u32>(Count);
+			return Index;
+		}
+
+		const auto LeftCount = Count / 2;
+		std::nth_element(Triangles.begin() + First,
+			Triangles.begin() + First + LeftCount,
+			Triangles.begin() + First + Count,
+			[&](const Triangle& a, const Triangle& b) {
+				return Centroid(a)[Axis] < Centroid(b)[Axis]; });
+
+		BuildNode(First, LeftCount);
+		const auto Right = BuildNode(First + LeftCount, Count - LeftCount);
+		Nodes[Index].RightOrFirst = Right;
+		Nodes[Index].Count = 0;
+		return Index;
+	}
+
+	std::vector<Node> Nodes;
+	std::vector<Triangle> Triangles;
+};
+
+_NAMESPACE_REALSPACE2_END
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "RAnimationNode.h"
+#include <vector>
 
 _NAMESPACE_REALSPACE2_BEGIN
 
@@ -28,6 +29,10 @@ public:
 
 	int		m_max_frame;
 	int		m_nRefCount;
+
+private:
+	// m_ani_node sorted by name, for GetNode.
+	std::vector<RAnimationNode*>	m_NodesByName;
 };
 
 _NAMESPACE_REALSPACE2_END
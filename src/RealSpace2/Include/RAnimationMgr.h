@@ -1,6 +1,8 @@
 #pragma once
 
 #include "RAnimation.h"
+#include <vector>
+#include <unordered_map>
 
 _NAMESPACE_REALSPACE2_BEGIN
 
@@ -66,6 +68,8 @@ public:
 
 	RAnimationHashList  m_list;
 	RAnimationHashList* m_list_map;
+	// Animations by sID, in the order they were added.
+	std::unordered_map<int, std::vector<RAnimation*>> m_IDMap;
 
 	std::vector<RAnimation*> m_node_table;
 };
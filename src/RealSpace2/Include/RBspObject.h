@@ -103,6 +103,36 @@ struct RBSPPICKINFO {
 
 using RMapObjectList = std::vector<ROBJECTINFO>;
 
+// A cylinder moved from From to To, for RBspObject::CheckWalls.
+struct RWALLSWEEP {
+	rvector From;
+	rvector To;
+	float Radius;
+	float Height;
+};
+
+// A cylinder dropped from Origin, for RBspObject::GetFloors.
+struct RFLOORPROBE {
+	rvector Origin;
+	float Radius;
+	float Height;
+};
+
+// A sphere moved from From to To, for RBspObject::SweepSpheres.
+struct RSPHERESWEEP {
+	rvector From;
+	rvector To;
+	float Radius;
+};
+
+// Where a swept sphere first touched the map. Pos is the center of the sphere at that point, and
+// Normal the normal of what it touched. If it didn't touch anything, Pos is where it was swept to.
+struct RSWEEPHIT {
+	bool Hit;
+	rvector Pos;
+	rvector Normal;
+};
+
 struct RDrawInfo {
 	RDrawInfo() = default;
 	RDrawInfo(RDrawInfo&& src) = delete;
@@ -269,6 +299,15 @@ public:
 	BulletCollision* GetCollision() { return Collision.get(); }
 #endif
 
+	// Whether the collision queries below can usefully run on several threads at once. RS3 maps
+	// are checked against a Bullet collision world instead, which BulletCollision has to lock
+	// around every query, so threads sharing one would only wait on each other.
+#ifdef _WIN32
+	bool SupportsConcurrentQueries() const { return !Collision; }
+#else
+	bool SupportsConcurrentQueries() const { return true; }
+#endif
+
 	RLightList& GetMapLightList() { return StaticMapLightList; }
 	RLightList& GetObjectLightList() { return StaticObjectLightList; }
 	RLightList& GetSunLightList() { return StaticSunLightList; }
@@ -288,14 +327,44 @@ public:
 	int GetLightmapCount() const { return LightmapTextures.size(); }
 #endif
 
+	// The collision queries keep all of their state in an RCollisionQuery, so any number of
+	// threads may run them on the same map at once. On maps with Bullet collision they're safe
+	// but take turns; see SupportsConcurrentQueries. The overloads without one use a temporary.
 	// TODO: Make a separate output parameter
 	bool CheckWall(const rvector &origin, rvector &targetpos, float fRadius, float fHeight = 0.f,
 		RCOLLISIONMETHOD method = RCW_CYLINDER, int nDepth = 0, rplane *pimpactplane = nullptr);
+	bool CheckWall(RCollisionQuery& Query, const rvector &origin, rvector &targetpos,
+		float fRadius, float fHeight = 0.f, RCOLLISIONMETHOD method = RCW_CYLINDER,
+		int nDepth = 0, rplane *pimpactplane = nullptr);
 
 	bool CheckSolid(const rvector &pos, float fRadius, float fHeight = 0.f,
 		RCOLLISIONMETHOD method = RCW_CYLINDER);
+	bool CheckSolid(RCollisionQuery& Query, const rvector &pos, float fRadius, float fHeight = 0.f,
+		RCOLLISIONMETHOD method = RCW_CYLINDER);
 
 	rvector GetFloor(const rvector &origin, float fRadius, float fHeight, rplane *pimpactplane = nullptr);
+	rvector GetFloor(RCollisionQuery& Query, const rvector &origin, float fRadius, float fHeight,
+		rplane *pimpactplane = nullptr);
+
+	// Batched forms of CheckWall and GetFloor, for checking many objects at once.
+	// OutPos[i] is where Sweeps[i] ends up, and OutHit[i], if OutHit isn't null, whether it ran
+	// into a wall; OutFloor[i] is the floor below Probes[i]. The queries are run in spatial
+	// order rather than the order they're given in, so that consecutive traversals go through
+	// the same nodes while they're still in cache, and sweeps that don't move are answered
+	// without traversing at all. Returns the number of sweeps that hit a wall.
+	int CheckWalls(RCollisionQuery& Query, const RWALLSWEEP* Sweeps, size_t Count,
+		rvector* OutPos, bool* OutHit = nullptr);
+	void GetFloors(RCollisionQuery& Query, const RFLOORPROBE* Probes, size_t Count,
+		rvector* OutFloor, rplane* OutPlanes = nullptr);
+
+	// Sweeps a sphere from From to To and stops it at the first thing in the way, instead of
+	// sliding it along like CheckWall does, for things that bounce off or explode on the map.
+	// SweepSpheres is the batched form, run in spatial order like CheckWalls, and returns the
+	// number of sweeps that hit something.
+	bool SweepSphere(RCollisionQuery& Query, const rvector& From, const rvector& To, float Radius,
+		RSWEEPHIT& Out);
+	int SweepSpheres(RCollisionQuery& Query, const RSPHERESWEEP* Sweeps, size_t Count,
+		RSWEEPHIT* OutHits);
 
 	void OnInvalidate();
 	void OnRestore();
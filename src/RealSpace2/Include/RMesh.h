@@ -357,6 +357,8 @@ public:
 	bool Pick(int x,int y,RPickInfo* pInfo,rmatrix* world_mat=NULL);
 	bool Pick(const rvector* vInVec,RPickInfo* pInfo,rmatrix* world_mat=NULL);
 	bool Pick(const rvector& pos, const rvector& dir,RPickInfo* pInfo,rmatrix* world_mat=NULL);
+	// Appends the world space triangles that Pick tests against, three vertices each.
+	void GetPickTriangles(const rmatrix& world_mat, std::vector<rvector>& OutVertices);
 
 	void ClearMtrl();
 	void SetBaseMtrlMesh(RMesh* pMesh);
@@ -493,6 +495,7 @@ private:
 		rmatrix* world_mat = nullptr, bool fastmode = false);
 	void GetNodeAniMatrix(RMeshNode* pMeshNode, rmatrix& m);
 	RMeshNode* UpdateNodeAniMatrix(RMeshNode* pNode);
+	RMeshNode* GetPickableNode(RMeshNode* pMeshNode);
 
 	void CalcLookAtParts(rmatrix& pAniMat, RMeshNode* pMeshNode, RVisualMesh* pVisualMesh);
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <list>
 #include <string>
 #include <unordered_map>
@@ -318,6 +319,33 @@ public:
 	int frame;
 };
 
+// Returns the index of the first of the Count items, sorted by the frame GetFrame returns for
+// them, that comes after frame, or Count if there is none. Long tracks are binary searched. Most
+// tracks are short, though, and a plain scan is faster on those. RAnimationKeyTest times both:
+// the binary search starts to win somewhere between 100 and 200 keys, depending on the machine,
+// so tracks of up to 128 are scanned.
+template <typename ItemType, typename FrameType, typename GetFrameType>
+int RGetNextFrame(const ItemType* Items, int Count, FrameType frame, GetFrameType&& GetFrame)
+{
+	if (Count <= 128)
+	{
+		int p = 0;
+		while (p < Count && GetFrame(Items[p]) <= frame)
+			++p;
+		return p;
+	}
+
+	return int(std::upper_bound(Items, Items + Count, frame,
+		[&](FrameType f, const ItemType& Item) { return f < GetFrame(Item); }) - Items);
+}
+
+// RGetNextFrame for keys, which have their frame in them.
+template <typename KeyType>
+int RGetNextKey(const KeyType* Keys, int Count, int frame)
+{
+	return RGetNextFrame(Keys, Count, frame, [](const KeyType& Key) { return Key.frame; });
+}
+
 struct RFaceInfoOld {
 	int				m_point_index[3];
 	rvector		m_point_tex[3];
@@ -2,12 +2,52 @@
 
 #include "RTypes.h"
 #include "RNameSpace.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 _NAMESPACE_REALSPACE2_BEGIN
 
-class RImpactPlanes : public std::list<rplane> {
+// The planes a collision query ran into. A query rarely touches more than a handful, so they're
+// kept inline, and only spill over to the heap for unusual geometry.
+class RImpactPlanes {
 public:
-	bool Add(rplane &p);
+	using iterator = rplane*;
+	using const_iterator = const rplane*;
+
+	RImpactPlanes() = default;
+	RImpactPlanes(const RImpactPlanes&) = delete;
+	RImpactPlanes& operator=(const RImpactPlanes&) = delete;
+
+	// Returns false if the plane was already in the list.
+	bool Add(const rplane &p);
+
+	iterator erase(iterator it) {
+		std::copy(it + 1, end(), it);
+		--Size;
+		return it;
+	}
+	void clear() { Size = 0; }
+
+	size_t size() const { return Size; }
+	bool empty() const { return Size == 0; }
+
+	rplane& operator[](size_t i) { return Data[i]; }
+	const rplane& operator[](size_t i) const { return Data[i]; }
+
+	iterator begin() { return Data; }
+	iterator end() { return Data + Size; }
+	const_iterator begin() const { return Data; }
+	const_iterator end() const { return Data + Size; }
+
+private:
+	static constexpr size_t InlineCapacity = 16;
+
+	rplane* Data = Inline;
+	size_t Size{};
+	size_t Capacity = InlineCapacity;
+	rplane Inline[InlineCapacity];
+	std::unique_ptr<rplane[]> Heap;
 };
 
 enum RCOLLISIONMETHOD{
@@ -15,19 +55,51 @@ enum RCOLLISIONMETHOD{
 	RCW_CYLINDER
 };
 
+// Everything a collision query against an RSolidBspNode tree needs while it runs. Each thread
+// (or each query, if they're interleaved) needs its own, but one can be reused for any number
+// of queries in a row.
+struct RCollisionQuery
+{
+	enum { MAX_DEPTH = 256 };
+
+	RCOLLISIONMETHOD	Method;
+	float				Radius;
+	float				Height;
+	rvector				Origin;
+	rvector				To;
+	RImpactPlanes*		OutList;
+
+	// The closest point of impact found by the last GetColPlanes_* call, and the plane it's on.
+	// ImpactPos is zero if nothing was hit.
+	float				ImpactDist;
+	rvector				ImpactPos;
+	rplane				ImpactPlane;
+
+	// The normalized direction of the current CheckWall move.
+	rvector				CheckWallDir;
+
+	// The planes bounding the path from the root to the current node.
+	rplane				SolidPlanes[MAX_DEPTH];
+
+	// Scratch space for the order that RBspObject's batched queries run in, kept here so that
+	// reusing a query doesn't allocate.
+	std::vector<u64>	SortKeys;
+	std::vector<u32>	Order;
+};
+
 class RSolidBspNode
 {
 public:
-	bool GetColPlanes_Cylinder(RImpactPlanes *pOutList, const rvector &origin, const rvector &to, float fRadius, float fHeight);
-	bool GetColPlanes_Sphere(RImpactPlanes *pOutList, const rvector &origin, const rvector &to, float fRadius);
-	rvector GetLastColPos() { return impact; }
-	rplane GetLastColPlane() { return impactPlane; }
+	bool GetColPlanes_Cylinder(RCollisionQuery& Query, RImpactPlanes *pOutList,
+		const rvector &origin, const rvector &to, float fRadius, float fHeight);
+	bool GetColPlanes_Sphere(RCollisionQuery& Query, RImpactPlanes *pOutList,
+		const rvector &origin, const rvector &to, float fRadius);
 
-	static bool CheckWall(RSolidBspNode *pRootNode, const rvector &origin, rvector &targetpos,
-		float fRadius, float fHeight = 0.f, RCOLLISIONMETHOD method = RCW_CYLINDER,
+	static bool CheckWall(RCollisionQuery& Query, RSolidBspNode *pRootNode, const rvector &origin,
+		rvector &targetpos, float fRadius, float fHeight = 0.f, RCOLLISIONMETHOD method = RCW_CYLINDER,
 		int nDepth = 0, rplane *pimpactplane = NULL);
-	static bool CheckWall2(RSolidBspNode *pRootNode, RImpactPlanes &impactPlanes, const rvector &origin,
-		rvector &targetpos, float fRadius, float fHeight, RCOLLISIONMETHOD method);
+	static bool CheckWall2(RCollisionQuery& Query, RSolidBspNode *pRootNode, RImpactPlanes &impactPlanes,
+		const rvector &origin, rvector &targetpos, float fRadius, float fHeight, RCOLLISIONMETHOD method);
 
 	static bool				m_bTracePath;
 
@@ -56,17 +128,7 @@ public:
 #endif
 
 private:
-	bool GetColPlanes_Recurse(int nDepth = 0);
-
-	static RCOLLISIONMETHOD m_ColMethod;
-	static float	m_fColRadius;
-	static float	m_fColHeight;
-	static rvector	m_ColOrigin;
-	static rvector	m_ColTo;
-	static RImpactPlanes* m_pOutList;
-	static float	fImpactDist;
-	static rvector	impact;
-	static rplane	impactPlane;
+	bool GetColPlanes_Recurse(RCollisionQuery& Query, int nDepth = 0);
 };
 
 _NAMESPACE_REALSPACE2_END
\ No newline at end of file
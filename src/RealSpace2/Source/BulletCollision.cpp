@@ -108,7 +108,10 @@ bool BulletCollision::Pick(const v3 & Src, const v3 & Dest,
 	btVector3 btSrc{ EXPAND_VECTOR(Src) }, btDest{ EXPAND_VECTOR(Dest) };
 	btCollisionWorld::ClosestRayResultCallback cr{ btSrc, btDest };
 
-	World.rayTest(btSrc, btDest, cr);
+	{
+		std::lock_guard<std::mutex> Lock{ QueryMutex };
+		World.rayTest(btSrc, btDest, cr);
+	}
 
 	return SetResults(cr, btSrc, btDest, Hit, Normal);
 }
@@ -144,7 +147,10 @@ bool BulletCollision::CheckCylinder(const v3 & Src, const v3 & Dest,
 
 	btCylinderShapeZ cylinder{ btCyl };
 
-	World.convexSweepTest(&cylinder, tFrom, tTo, cc);
+	{
+		std::lock_guard<std::mutex> Lock{ QueryMutex };
+		World.convexSweepTest(&cylinder, tFrom, tTo, cc);
+	}
 
 	return SetResults(cc, btSrc, btDest, Hit, Normal);
 }
@@ -163,7 +169,10 @@ bool BulletCollision::CheckSphere(const v3& Src, const v3& Dest,
 	tTo.setIdentity();
 	tTo.setOrigin(btDest);
 
-	World.convexSweepTest(&sphere, tFrom, tTo, cc);
+	{
+		std::lock_guard<std::mutex> Lock{ QueryMutex };
+		World.convexSweepTest(&sphere, tFrom, tTo, cc);
+	}
 
 	return SetResults(cc, btSrc, btDest, Hit, Normal);
 }
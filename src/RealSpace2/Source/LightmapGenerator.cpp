@@ -1,8 +1,15 @@
 #include "stdafx.h"
 #include "LightmapGenerator.h"
+#include "LightmapShadowBVH.h"
 #include "RBspObject.h"
 #include "RVersions.h"
 #include "RealSpace2.h"
+#include "MTime.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 #define MAX_LIGHTMAP_SIZE		1024
 #define MAX_LEVEL_COUNT			10
@@ -333,7 +340,7 @@ static void CalcLightmapUV(
 	CalcNodeUV(pNode->m_pNegative);
 }
 
-v3 LightmapGenerator::CalcDiffuse(const rboundingbox& bbox,
+v3 LightmapGenerator::CalcDiffuse(Scratch& s, const rboundingbox& bbox,
 	const RCONVEXPOLYGONINFO* poly,
 	const v3& polynormal, const v3& diff,
 	const RLIGHT* plight,
@@ -345,7 +352,7 @@ v3 LightmapGenerator::CalcDiffuse(const rboundingbox& bbox,
 
 	for (int m = 0; m < 4; m++)
 	{
-		if (isshadow[(k + m % 2)*(lightmapsize + 1) + j + m / 2])
+		if (s.isshadow[(k + m % 2)*(lightmapsize + 1) + j + m / 2])
 			nShadowCount++;
 	}
 
@@ -367,17 +374,8 @@ v3 LightmapGenerator::CalcDiffuse(const rboundingbox& bbox,
 				position[av] = bbox.vmin[av] + ((j + (m + .5f) / Supersample) / lightmapsize)*diff[av];
 				position[ax] = (-poly->plane.d - polynormal[au] * position[au] - polynormal[av] * position[av]) / polynormal[ax];
 
-				bool bShadow = false;
-
-				float fDistanceToPolygon = Magnitude(position - plight->Position);
-
-				RBSPPICKINFO bpi;
-				if (bsp.PickShadow(plight->Position, position, &bpi))
-				{
-					float fDistanceToPickPos = Magnitude(bpi.PickPos - plight->Position);
-					if (fDistanceToPolygon > fDistanceToPickPos + Tolerance)
-						bShadow = true;
-				}
+				++s.RayCount;
+				bool bShadow = BspShadowBVH->Occluded(plight->Position, position, Tolerance);
 
 				if (!bShadow)
 				{
@@ -425,7 +423,7 @@ v3 LightmapGenerator::CalcDiffuse(const rboundingbox& bbox,
 	return color;
 }
 
-bool LightmapGenerator::CheckShadow(const RLIGHT* plight,
+bool LightmapGenerator::CheckShadow(Scratch& s, const RLIGHT* plight,
 	const RCONVEXPOLYGONINFO* poly,
 	const rboundingbox& bbox,
 	const v3& pnormal, const v3& diff,
@@ -441,54 +439,13 @@ bool LightmapGenerator::CheckShadow(const RLIGHT* plight,
 	position[av] = bbox.vmin[av] + ((float)j / (float)lightmapsize)*diff[av];
 	position[ax] = (-poly->plane.d - pnormal[au] * position[au] - pnormal[av] * position[av]) / pnormal[ax];
 
-	float fDistanceToPolygon = Magnitude(position - plight->Position);
-
-	RBSPPICKINFO bpi;
-	if (bsp.PickShadow(plight->Position, position, &bpi))
-	{
-		float fDistanceToPickPos = Magnitude(bpi.PickPos - plight->Position);
-
-		if (fDistanceToPolygon > fDistanceToPickPos + Tolerance)
-			return true;
-	}
-
-#ifdef _WIN32
-	for (auto& ObjectInfo : bsp.m_ObjectList)
-	{
-		if (!ObjectInfo.pVisualMesh) return false;
-
-		rmatrix inv = Inverse(ObjectInfo.pVisualMesh->m_WorldMat);
-
-		rvector origin = plight->Position * inv;
-		rvector target = position * inv;
-
-		rvector dir = target - origin;
-		rvector dirorigin = position - plight->Position;
-
-		rvector vOut;
-
-		rboundingbox bbox;
-		bbox.vmin = ObjectInfo.pVisualMesh->m_vBMin;
-		bbox.vmax = ObjectInfo.pVisualMesh->m_vBMax;
-
-		auto bBBTest = IntersectLineAABB(origin, dir, bbox);
-		float t;
-		if (bBBTest &&
-			ObjectInfo.pVisualMesh->Pick(plight->Position, dirorigin, &vOut, &t))
-		{
-			rvector PickPos = plight->Position + vOut*t;
-			return true;
-		}
-	}
-#else
-	assert(false);
-#endif
-
-	return false;
+	++s.RayCount;
+	return BspShadowBVH->Occluded(plight->Position, position, Tolerance) ||
+		ObjectShadowBVH->Occluded(plight->Position, position, Tolerance);
 }
 
-bool LightmapGenerator::ProcessConvexPolygon(const RCONVEXPOLYGONINFO* poly,
-	int PolyIndex, int& lightmapsize)
+bool LightmapGenerator::ProcessConvexPolygon(Scratch& s, const RCONVEXPOLYGONINFO* poly,
+	int PolyIndex, PolygonLightmap& Out)
 {
 	rboundingbox bbox;
 
@@ -502,7 +459,7 @@ bool LightmapGenerator::ProcessConvexPolygon(const RCONVEXPOLYGONINFO* poly,
 		}
 	}
 
-	lightmapsize = MaxLightmapSize;
+	int lightmapsize = MaxLightmapSize;
 
 	float targetarea = MaximumArea / 4.f;
 	while (poly->fArea < targetarea && lightmapsize > MinLightmapSize)
@@ -522,7 +479,10 @@ bool LightmapGenerator::ProcessConvexPolygon(const RCONVEXPOLYGONINFO* poly,
 
 	v3 pnormal{ poly->plane.a, poly->plane.b, poly->plane.c };
 
-	LightIndex = 0;
+	auto& pplight = s.pplight;
+	auto& lightmap = s.lightmap;
+	auto& isshadow = s.isshadow;
+	int LightIndex = 0;
 
 	for (auto& Light : bsp.StaticMapLightList)
 	{
@@ -567,7 +527,7 @@ bool LightmapGenerator::ProcessConvexPolygon(const RCONVEXPOLYGONINFO* poly,
 		{
 			for (int k = 0; k < lightmapsize + 1; k++)		// u
 			{
-				isshadow[k*(lightmapsize + 1) + j] = CheckShadow(plight,
+				isshadow[k*(lightmapsize + 1) + j] = CheckShadow(s, plight,
 					poly,
 					bbox,
 					pnormal, diff,
@@ -581,7 +541,7 @@ bool LightmapGenerator::ProcessConvexPolygon(const RCONVEXPOLYGONINFO* poly,
 		{
 			for (int k = 0; k < lightmapsize; k++)
 			{
-				lightmap[j*lightmapsize + k] += CalcDiffuse(bbox,
+				lightmap[j*lightmapsize + k] += CalcDiffuse(s, bbox,
 					poly,
 					pnormal, diff,
 					plight,
@@ -592,6 +552,10 @@ bool LightmapGenerator::ProcessConvexPolygon(const RCONVEXPOLYGONINFO* poly,
 		}
 	}
 
+	Out.lightmapsize = lightmapsize;
+	Out.data.reset(new u32[Square(lightmapsize)]);
+	auto* lightmapdata = Out.data.get();
+
 	for (int j = 0; j < Square(lightmapsize); j++)
 	{
 		auto color = lightmap[j];
@@ -610,7 +574,7 @@ bool LightmapGenerator::ProcessConvexPolygon(const RCONVEXPOLYGONINFO* poly,
 	return true;
 }
 
-void LightmapGenerator::InsertLightmap(int lightmapsize,
+void LightmapGenerator::InsertLightmap(int lightmapsize, const u32* lightmapdata,
 	int PolyIndex)
 {
 	bool bConstmap = true;
@@ -650,7 +614,7 @@ void LightmapGenerator::InsertLightmap(int lightmapsize,
 		new_lightmap.bLoaded = false;
 		new_lightmap.nSize = lightmapsize;
 		new_lightmap.data = decltype(new_lightmap.data){new u32[Square(lightmapsize)]};
-		memcpy(new_lightmap.data.get(), lightmapdata.get(), Square(lightmapsize) * sizeof(u32));
+		memcpy(new_lightmap.data.get(), lightmapdata, Square(lightmapsize) * sizeof(u32));
 	}
 }
 
@@ -720,33 +684,163 @@ void LightmapGenerator::Init()
 	for (auto& Poly : bsp.ConvexPolygons)
 		MaximumArea = max(MaximumArea, Poly.fArea);
 
-	pplight = std::unique_ptr<RLIGHT*[]>{ new RLIGHT*[bsp.StaticMapLightList.size()] };
-	lightmap = std::unique_ptr<rvector[]>{ new rvector[Square(MaxLightmapSize)] };
-	lightmapdata = std::unique_ptr<u32[]>{ new u32[Square(MaxLightmapSize)] };
-	isshadow = std::unique_ptr<bool[]>{ new bool[Square(MaxLightmapSize + 1)] };
 	SourceLightmap = std::unique_ptr<int[]>{ new int[bsp.ConvexPolygons.size()] };
+	PolygonLightmaps.clear();
+	PolygonLightmaps.resize(bsp.ConvexPolygons.size());
+
+	// The same polygons that PickShadow tests.
+	std::vector<LightmapShadowBVH::Triangle> BspCasters;
+	for (auto& Info : bsp.BspInfo)
+	{
+		if ((Info.dwFlags & RBspObject::DefaultPassFlag) != 0 ||
+			(Info.dwFlags & RM_FLAG_CASTSHADOW) == 0)
+			continue;
+
+		for (int j = 0; j < Info.nVertices - 2; j++)
+		{
+			BspCasters.push_back({ { *Info.pVertices[0].Coord(),
+				*Info.pVertices[j + 1].Coord(),
+				*Info.pVertices[j + 2].Coord() },
+				Info.plane });
+		}
+	}
+	BspShadowBVH = std::make_unique<LightmapShadowBVH>();
+	BspShadowBVH->Build(std::move(BspCasters));
+
+	// Map object triangles are one-sided, like in RMesh::Pick.
+	std::vector<LightmapShadowBVH::Triangle> ObjectCasters;
+#ifdef _WIN32
+	std::vector<rvector> Vertices;
+	for (auto& ObjectInfo : bsp.m_ObjectList)
+	{
+		auto* pVisualMesh = ObjectInfo.pVisualMesh.get();
+		if (!pVisualMesh || !pVisualMesh->m_pMesh)
+			continue;
+
+		Vertices.clear();
+		pVisualMesh->m_pMesh->GetPickTriangles(pVisualMesh->m_WorldMat, Vertices);
+		for (size_t i = 0; i + 2 < Vertices.size(); i += 3)
+		{
+			ObjectCasters.push_back({ { Vertices[i], Vertices[i + 1], Vertices[i + 2] },
+				PlaneFromPoints(Vertices[i], Vertices[i + 1], Vertices[i + 2]) });
+		}
+	}
+#endif
+	ObjectShadowBVH = std::make_unique<LightmapShadowBVH>();
+	ObjectShadowBVH->Build(std::move(ObjectCasters));
 }
 
-bool LightmapGenerator::Generate()
-{	
-	Init();
+void LightmapGenerator::InitScratch(Scratch& s)
+{
+	s.pplight = std::unique_ptr<RLIGHT*[]>{ new RLIGHT*[bsp.StaticMapLightList.size()] };
+	s.lightmap = std::unique_ptr<rvector[]>{ new rvector[Square(MaxLightmapSize)] };
+	s.isshadow = std::unique_ptr<bool[]>{ new bool[Square(MaxLightmapSize + 1)] };
+	s.RayCount = 0;
+}
+
+// Polygons are baked by nThreads worker threads, in whatever order they finish. This thread
+// inserts the finished lightmaps in polygon order, so that the output is the same as if
+// they'd been baked one at a time.
+bool LightmapGenerator::BakePolygons(int nThreads)
+{
+	const auto PolygonCount = bsp.ConvexPolygons.size();
+
+	std::mutex Mutex;
+	std::condition_variable Cond;
+	std::atomic<size_t> NextPolygon{ 0 };
+	std::atomic<bool> Cancel{ false };
+	int FailedIndex = -1;
+	u64 RayCount = 0;
 
-	for (size_t i = 0; i < bsp.ConvexPolygons.size(); i++)
+	auto Work = [&]
+	{
+		Scratch s;
+		InitScratch(s);
+
+		while (!Cancel)
+		{
+			const auto i = NextPolygon++;
+			if (i >= PolygonCount)
+				break;
+
+			PolygonLightmap Result;
+			const bool Success = ProcessConvexPolygon(s, &bsp.ConvexPolygons[i], i, Result);
+
+			{
+				std::lock_guard<std::mutex> Lock{ Mutex };
+				if (!Success && FailedIndex == -1)
+					FailedIndex = static_cast<int>(i);
+				PolygonLightmaps[i] = std::move(Result);
+				PolygonLightmaps[i].Done = true;
+			}
+			Cond.notify_all();
+		}
+
+		std::lock_guard<std::mutex> Lock{ Mutex };
+		RayCount += s.RayCount;
+	};
+
+	const auto StartTime = GetGlobalTimeMS();
+
+	std::vector<std::thread> Threads;
+	for (int i = 0; i < nThreads; i++)
+		Threads.emplace_back(Work);
+
+	bool bSuccess = true;
+	for (size_t i = 0; i < PolygonCount; i++)
 	{
 		// The progress function returning false
 		// indicates that the generation needs to stop.
-		if (pProgressFn && !pProgressFn((float)i / (float)bsp.ConvexPolygons.size()))
-			return false;
+		if (pProgressFn && !pProgressFn((float)i / (float)PolygonCount))
+		{
+			bSuccess = false;
+			break;
+		}
 
-		int lightmapsize{};
-		if (!ProcessConvexPolygon(&bsp.ConvexPolygons[i], i, lightmapsize))
+		std::unique_lock<std::mutex> Lock{ Mutex };
+		Cond.wait(Lock, [&] { return PolygonLightmaps[i].Done || FailedIndex != -1; });
+		if (FailedIndex != -1)
 		{
-			MLog("LightmapGenerator::Generate -- ProcessConvexPolygon failed for polygon index %d\n", i);
-			return false;
+			MLog("LightmapGenerator::Generate -- ProcessConvexPolygon failed for polygon index %d\n",
+				FailedIndex);
+			bSuccess = false;
+			break;
 		}
-		InsertLightmap(lightmapsize, i);
+
+		auto Lightmap = std::move(PolygonLightmaps[i]);
+		Lock.unlock();
+
+		InsertLightmap(Lightmap.lightmapsize, Lightmap.data.get(), i);
+	}
+
+	Cancel = true;
+	for (auto& Thread : Threads)
+		Thread.join();
+
+	if (bSuccess)
+	{
+		const auto Seconds = (GetGlobalTimeMS() - StartTime) / 1000.0;
+		MLog("LightmapGenerator::Generate -- Baked %d polygons on %d threads in %.2f s, "
+			"%llu shadow rays (%.0f rays/s)\n",
+			static_cast<int>(PolygonCount), nThreads, Seconds,
+			static_cast<unsigned long long>(RayCount),
+			Seconds > 0 ? RayCount / Seconds : 0.0);
 	}
 
+	return bSuccess;
+}
+
+bool LightmapGenerator::Generate()
+{	
+	Init();
+
+	int nThreads = ThreadCount;
+	if (nThreads <= 0)
+		nThreads = max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+
+	if (!BakePolygons(nThreads))
+		return false;
+
 	if (!SaveToFile())
 	{
 		MLog("LightmapGenerator::Generate -- SaveToFile failed\n");
@@ -4,6 +4,7 @@
 #include "RealSpace2.h"
 
 #include "MZFileSystem.h"
+#include <algorithm>
 
 _USING_NAMESPACE_REALSPACE2
 
@@ -52,11 +53,11 @@ void RAnimationFile::DecRef()
 
 RAnimationNode* RAnimationFile::GetNode(const char* name)
 {
-	for(int i=0;i<m_ani_node_cnt;i++) {
-		if(m_ani_node[i]->CheckName(name))
-			return m_ani_node[i];
-	}
-	return NULL;
+	auto it = std::lower_bound(m_NodesByName.begin(), m_NodesByName.end(), name,
+		[](RAnimationNode* pNode, const char* name) { return strcmp(pNode->GetName(), name) < 0; });
+	if (it == m_NodesByName.end() || strcmp((*it)->GetName(), name) != 0)
+		return NULL;
+	return *it;
 }
 
 bool RAnimationFile::LoadAni(const char* filename)
@@ -300,6 +301,12 @@ bool RAnimationFile::LoadAni(const char* filename)
 		m_max_frame = vis_max_frame;
 	}
 
+	// Stable, so that the first of several nodes with the same name is still the one found.
+	m_NodesByName.assign(m_ani_node, m_ani_node + m_ani_node_cnt);
+	std::stable_sort(m_NodesByName.begin(), m_NodesByName.end(), [](RAnimationNode* a, RAnimationNode* b) {
+		return strcmp(a->GetName(), b->GetName()) < 0;
+	});
+
 	mzf.Close();
 
 	return true;
@@ -95,6 +95,7 @@ RAnimation* RAnimationMgr::AddAnimationFile(const char* name, const char* filena
 		mlog("ϸ̼    ø° ..\n",filename);
 
 	m_list.PushBack(node);
+	m_IDMap[sID].push_back(node);
 
 	if(m_list_map) {
 		if(MotionTypeID != -1) {
@@ -128,6 +129,7 @@ void RAnimationMgr::DelAll() {
 	}
 
 	m_list.Clear();
+	m_IDMap.clear();
 
 	if(!m_node_table.empty())
 		m_node_table.clear();
@@ -205,15 +207,13 @@ RAnimation* RAnimationMgr::GetAnimation(const char* name,int wtype)
 
 RAnimation* RAnimationMgr::GetAnimation(int sID,int wtype) {
 
-	RAnimationHashList_Iter node;
-
-	if( m_list.empty() ) 
+	auto it = m_IDMap.find(sID);
+	if( it == m_IDMap.end() )
 		return NULL;
 
-	for(node = m_list.begin(); node != m_list.end(); ++node) {
-		if( (*node)->CheckWeaponMotionType(wtype) )
-			if( (*node)->m_sID == sID )
-				return *node;
+	for(auto* pAni : it->second) {
+		if( pAni->CheckWeaponMotionType(wtype) )
+			return pAni;
 	}
 	return NULL;
 }
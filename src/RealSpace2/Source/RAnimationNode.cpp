@@ -2,6 +2,7 @@
 #include "RAnimationNode.h"
 #include "RealSpace2.h"
 #include "RMeshNodeStringTable.h"
+#include <algorithm>
 
 _USING_NAMESPACE_REALSPACE2
 _NAMESPACE_REALSPACE2_BEGIN
@@ -79,12 +80,7 @@ int GetVisKeyPos(RVisKey* pKey,int key_max,int frame)
 	if(!pKey)		return 0;
 	if(key_max==0)	return 0;
 
-	int p;
-	for (p=0;p<key_max;p++) {
-		if ( pKey[p].frame > frame) {
-			break;
-		}
-	}
+	int p = RGetNextKey(pKey, key_max, frame);
 
 	if(p) p--;
 
@@ -117,12 +113,7 @@ rquaternion RAnimationNode::GetRotValue(int frame)
 		return MatrixToQuaternion(m_mat_base);
 	}
 
-	int p;
-	for (p = 0; p < m_rot_cnt; p++) {
-		if (m_quat[p].frame > frame) {
-			break;
-		}
-	}
+	int p = RGetNextKey(m_quat, m_rot_cnt, frame);
 
 	if(p>=m_rot_cnt) {
 		return m_quat[m_rot_cnt-1];
@@ -149,12 +140,7 @@ rvector RAnimationNode::GetPosValue(int frame)
 		return GetTransPos(m_mat_base);
 	}
 
-	int p;
-	for (p = 0; p < m_pos_cnt; p++) {
-		if (m_pos[p].frame > frame) {
-			break;
-		}
-	}
+	int p = RGetNextKey(m_pos, m_pos_cnt, frame);
 
 	if (p >= m_pos_cnt) {
 		return m_pos[m_pos_cnt - 1];
@@ -179,17 +165,13 @@ int	RAnimationNode::GetVecValue(int frame,rvector* pVecTable)
 {
 	u32 dwFrame = frame;
 
-	int j;
-	for (j=0;j<m_vertex_cnt;j++) {
-		if ( m_vertex_frame[j] > dwFrame) 
-			break;
-	}
+	int j = RGetNextFrame(m_vertex_frame, m_vertex_cnt, dwFrame, [](u32 f) { return f; });
 
 	if( j>= m_vertex_cnt) {
 
 		int vcnt = m_vertex_vcnt;
 
-		rvector* v1 = m_vertex[vcnt-1];
+		rvector* v1 = m_vertex[m_vertex_cnt-1];
 		memcpy(pVecTable,v1,sizeof(rvector)*vcnt);
 
 		return vcnt;
@@ -220,11 +202,7 @@ int	RAnimationNode::GetVecValue(int frame,rvector* pVecTable)
 
 rmatrix RAnimationNode::GetTMValue(int frame)
 {
-	int j = 0;
-
-	for (j=0;j<m_mat_cnt;j++) {
-		if ( m_mat[j].frame > frame) break;
-	}
+	int j = RGetNextKey(m_mat, m_mat_cnt, frame);
 
 	if(j >= m_mat_cnt) {
 		return m_mat[m_mat_cnt-1];
@@ -1355,7 +1355,7 @@ bool RBspObject::Open_DummyList(rapidxml::xml_node<>& parent)
 	if (!m_DummyList.Open(parent))
 		return false;
 
-	if (!Make_LenzFalreList())
+	if (!PhysOnly && !Make_LenzFalreList())
 		return false;
 
 	return true;
@@ -1523,6 +1523,12 @@ bool RBspObject::LoadRS2Map(rapidxml::xml_node<>& aParent)
 		auto* szTagName = node->name();
 		if (_stricmp(szTagName, RTOK_MATERIALLIST) == 0)
 			Open_MaterialList(*node);
+		// The server needs the dummies too, for the NPC spawn points.
+		else if (_stricmp(szTagName, RTOK_DUMMYLIST) == 0)
+		{
+			if (!Open_DummyList(*node))
+				MLog("RBspObject::LoadRS2Map -- Failed to open dummy list\n");
+		}
 		else if (!PhysOnly)
 		{
 			if (_stricmp(szTagName, RTOK_LIGHTLIST) == 0)
@@ -1531,11 +1537,6 @@ bool RBspObject::LoadRS2Map(rapidxml::xml_node<>& aParent)
 				Open_ObjectList(*node);
 			else if (_stricmp(szTagName, RTOK_OCCLUSIONLIST) == 0)
 				Open_OcclusionList(*node);
-			else if (_stricmp(szTagName, RTOK_DUMMYLIST) == 0)
-			{
-				if (!Open_DummyList(*node))
-					MLog("RBspObject::LoadRS2Map -- Failed to open dummy list\n");
-			}
 			else if (_stricmp(szTagName, RTOK_FOG) == 0)
 				Set_Fog(*node);
 			else if (_stricmp(szTagName, "AMBIENTSOUNDLIST") == 0)
@@ -2367,6 +2368,13 @@ void RBspObject::DrawSolidNode()
 
 bool RBspObject::CheckWall(const rvector& origin, rvector& targetpos, float Radius, float Height,
 	RCOLLISIONMETHOD method, int nDepth, rplane* impactplane)
+{
+	RCollisionQuery Query;
+	return CheckWall(Query, origin, targetpos, Radius, Height, method, nDepth, impactplane);
+}
+
+bool RBspObject::CheckWall(RCollisionQuery& Query, const rvector& origin, rvector& targetpos,
+	float Radius, float Height, RCOLLISIONMETHOD method, int nDepth, rplane* impactplane)
 {
 #ifdef _WIN32
 	if (Collision)
@@ -2397,11 +2405,18 @@ bool RBspObject::CheckWall(const rvector& origin, rvector& targetpos, float Radi
 	}
 #endif
 
-	return RSolidBspNode::CheckWall(ColRoot.data(), origin, targetpos,
+	return RSolidBspNode::CheckWall(Query, ColRoot.data(), origin, targetpos,
 		Radius, Height, method, nDepth, impactplane);
 }
 
 bool RBspObject::CheckSolid(const rvector& pos, float Radius, float Height, RCOLLISIONMETHOD method)
+{
+	RCollisionQuery Query;
+	return CheckSolid(Query, pos, Radius, Height, method);
+}
+
+bool RBspObject::CheckSolid(RCollisionQuery& Query, const rvector& pos, float Radius, float Height,
+	RCOLLISIONMETHOD method)
 {
 #ifdef _WIN32
 	if (Collision)
@@ -2417,12 +2432,19 @@ bool RBspObject::CheckSolid(const rvector& pos, float Radius, float Height, RCOL
 
 	RImpactPlanes impactPlanes;
 	if (method == RCW_SPHERE)
-		return ColRoot[0].GetColPlanes_Sphere(&impactPlanes, pos, pos, Radius);
+		return ColRoot[0].GetColPlanes_Sphere(Query, &impactPlanes, pos, pos, Radius);
 	else
-		return ColRoot[0].GetColPlanes_Cylinder(&impactPlanes, pos, pos, Radius, Height);
+		return ColRoot[0].GetColPlanes_Cylinder(Query, &impactPlanes, pos, pos, Radius, Height);
 }
 
 rvector RBspObject::GetFloor(const rvector& origin, float Radius, float Height, rplane* impactplane)
+{
+	RCollisionQuery Query;
+	return GetFloor(Query, origin, Radius, Height, impactplane);
+}
+
+rvector RBspObject::GetFloor(RCollisionQuery& Query, const rvector& origin, float Radius, float Height,
+	rplane* impactplane)
 {
 	auto targetpos = origin + rvector(0, 0, -10000);
 
@@ -2439,18 +2461,142 @@ rvector RBspObject::GetFloor(const rvector& origin, float Radius, float Height,
 #endif
 
 	RImpactPlanes impactPlanes;
-	bool bIntersect = ColRoot[0].GetColPlanes_Cylinder(&impactPlanes, origin, targetpos, Radius, Height);
+	bool bIntersect = ColRoot[0].GetColPlanes_Cylinder(Query, &impactPlanes, origin, targetpos, Radius, Height);
 	if (!bIntersect)
 		return targetpos;
 
-	rvector floor = ColRoot[0].GetLastColPos();
+	rvector floor = Query.ImpactPos;
 	floor.z -= Height;
 	if (impactplane)
-		*impactplane = ColRoot[0].GetLastColPlane();
+		*impactplane = Query.ImpactPlane;
 
 	return floor;
 }
 
+// Interleaves the bits of the position in 128 unit cells, so that sorting by the result puts
+// queries that are close to each other next to each other.
+static u32 GetMortonKey(const rvector& Pos)
+{
+	auto Spread = [](float x) {
+		auto v = u32(max(0.f, min(1023.f, x / 128.f + 512.f)));
+		v = (v | (v << 16)) & 0x030000FF;
+		v = (v | (v << 8)) & 0x0300F00F;
+		v = (v | (v << 4)) & 0x030C30C3;
+		v = (v | (v << 2)) & 0x09249249;
+		return v;
+	};
+	return Spread(Pos.x) | (Spread(Pos.y) << 1) | (Spread(Pos.z) << 2);
+}
+
+// Fills Query.Order with the indices of the queries in spatial order.
+template <typename GetPosType>
+static void GetSpatialOrder(RCollisionQuery& Query, size_t Count, GetPosType&& GetPos)
+{
+	auto& Keys = Query.SortKeys;
+	Keys.resize(Count);
+	for (size_t i = 0; i < Count; ++i)
+		Keys[i] = (u64(GetMortonKey(GetPos(i))) << 32) | i;
+	std::sort(Keys.begin(), Keys.end());
+
+	Query.Order.resize(Count);
+	for (size_t i = 0; i < Count; ++i)
+		Query.Order[i] = u32(Keys[i]);
+}
+
+int RBspObject::CheckWalls(RCollisionQuery& Query, const RWALLSWEEP* Sweeps, size_t Count,
+	rvector* OutPos, bool* OutHit)
+{
+	GetSpatialOrder(Query, Count, [&](size_t i) { return Sweeps[i].From; });
+
+	int HitCount = 0;
+	for (auto i : Query.Order)
+	{
+		auto& Sweep = Sweeps[i];
+		OutPos[i] = Sweep.To;
+
+		// CheckWall never adjusts a sweep that doesn't go anywhere.
+		bool Hit = false;
+		if (Sweep.From != Sweep.To)
+			Hit = CheckWall(Query, Sweep.From, OutPos[i], Sweep.Radius, Sweep.Height, RCW_CYLINDER);
+
+		if (OutHit)
+			OutHit[i] = Hit;
+		HitCount += Hit;
+	}
+
+	return HitCount;
+}
+
+void RBspObject::GetFloors(RCollisionQuery& Query, const RFLOORPROBE* Probes, size_t Count,
+	rvector* OutFloor, rplane* OutPlanes)
+{
+	GetSpatialOrder(Query, Count, [&](size_t i) { return Probes[i].Origin; });
+
+	for (auto i : Query.Order)
+	{
+		auto& Probe = Probes[i];
+		OutFloor[i] = GetFloor(Query, Probe.Origin, Probe.Radius, Probe.Height,
+			OutPlanes ? &OutPlanes[i] : nullptr);
+	}
+}
+
+bool RBspObject::SweepSphere(RCollisionQuery& Query, const rvector& From, const rvector& To,
+	float Radius, RSWEEPHIT& Out)
+{
+	Out.Hit = false;
+	Out.Pos = To;
+	Out.Normal = rvector(0, 0, 0);
+
+#ifdef _WIN32
+	if (Collision)
+	{
+		if (!Collision->CheckSphere(From, To, Radius, &Out.Pos, &Out.Normal))
+			return false;
+		Normalize(Out.Normal);
+		Out.Hit = true;
+		return true;
+	}
+#endif
+
+	if (ColRoot.empty())
+		return false;
+
+	RImpactPlanes ImpactPlanes;
+	if (!ColRoot[0].GetColPlanes_Sphere(Query, &ImpactPlanes, From, To, Radius))
+		return false;
+
+	Out.Hit = true;
+	if (Query.ImpactDist != FLT_MAX)
+	{
+		Out.Pos = Query.ImpactPos;
+		Out.Normal = rvector(Query.ImpactPlane.a, Query.ImpactPlane.b, Query.ImpactPlane.c);
+	}
+	else
+	{
+		// It was already in something where it started, so send it back the way it came.
+		Out.Pos = From;
+		Out.Normal = From - To;
+		if (MagnitudeSq(Out.Normal) > 0)
+			Normalize(Out.Normal);
+	}
+	return true;
+}
+
+int RBspObject::SweepSpheres(RCollisionQuery& Query, const RSPHERESWEEP* Sweeps, size_t Count,
+	RSWEEPHIT* OutHits)
+{
+	GetSpatialOrder(Query, Count, [&](size_t i) { return Sweeps[i].From; });
+
+	int HitCount = 0;
+	for (auto i : Query.Order)
+	{
+		auto& Sweep = Sweeps[i];
+		HitCount += SweepSphere(Query, Sweep.From, Sweep.To, Sweep.Radius, OutHits[i]);
+	}
+
+	return HitCount;
+}
+
 RBSPMATERIAL* RBspObject::GetMaterial(int nIndex)
 {
 	assert(nIndex >= 0 && static_cast<size_t>(nIndex) < Materials.size());
@@ -561,6 +561,45 @@ static bool find_intersects_triangle_sub(const rvector& orig, const rvector& dir
 	return true;
 }
 
+RMeshNode* RMesh::GetPickableNode(RMeshNode* pMeshNode)
+{
+	auto* pPartsMeshNode = UpdateNodeAniMatrix(pMeshNode);
+
+	if (m_PickingType == pick_collision_mesh) {
+		if (!pPartsMeshNode->m_isCollisionMesh) {
+			return nullptr;
+		}
+	}
+	else if (m_PickingType == pick_real_mesh) {
+		if (pPartsMeshNode->m_isDummyMesh) {//Bip,Bone,Dummy Skip
+			return nullptr;
+		}
+	}
+
+	if (pPartsMeshNode->m_face_num == 0)
+		return nullptr;
+
+	return pPartsMeshNode;
+}
+
+void RMesh::GetPickTriangles(const rmatrix& world_mat, std::vector<rvector>& OutVertices)
+{
+	for (auto* pMeshNode : m_list)
+	{
+		auto* pPartsMeshNode = GetPickableNode(pMeshNode);
+		if (!pPartsMeshNode)
+			continue;
+
+		std::vector<rvector> VecPick;
+		pPartsMeshNode->CalcPickVertexBuffer(world_mat, VecPick);
+
+		for (int i = 0; i < pPartsMeshNode->m_face_num; i++) {
+			for (int j = 0; j < 3; j++)
+				OutVertices.push_back(VecPick[pPartsMeshNode->m_face_list[i].m_point_index[j]]);
+		}
+	}
+}
+
 bool RMesh::CalcIntersectsTriangle(const v3& origin, const v3& dir, RPickInfo* pInfo, rmatrix* world_mat, bool fastmode)
 {
 	float best_t = 9999.f;
@@ -574,20 +613,8 @@ bool RMesh::CalcIntersectsTriangle(const v3& origin, const v3& dir, RPickInfo* p
 
 	for (auto* pMeshNode : m_list)
 	{
-		pPartsMeshNode = UpdateNodeAniMatrix(pMeshNode);
-
-		if (m_PickingType == pick_collision_mesh) {
-			if (!pPartsMeshNode->m_isCollisionMesh) {
-				continue;
-			}
-		}
-		else if (m_PickingType == pick_real_mesh) {
-			if (pPartsMeshNode->m_isDummyMesh) {//Bip,Bone,Dummy Skip
-				continue;
-			}
-		}
-
-		if (pPartsMeshNode->m_face_num == 0)
+		pPartsMeshNode = GetPickableNode(pMeshNode);
+		if (!pPartsMeshNode)
 			continue;
 
 		std::vector<rvector> VecPick;
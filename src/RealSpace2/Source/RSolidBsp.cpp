@@ -2,29 +2,29 @@
 #include "MDebug.h"
 #include "RealSpace2.h"
 #include "RSolidBsp.h"
+#include <cfloat>
 
 _USING_NAMESPACE_REALSPACE2
 
-bool RImpactPlanes::Add(rplane &p)
+bool RImpactPlanes::Add(const rplane &p)
 {
 	for(iterator i=begin();i!=end();i++)
 	{
 		if(*i==p) return false;
 	}
-	push_back(p);
-	return  true;
-}
 
+	if (Size == Capacity)
+	{
+		Capacity *= 2;
+		std::unique_ptr<rplane[]> NewHeap{ new rplane[Capacity] };
+		std::copy(begin(), end(), NewHeap.get());
+		Heap = std::move(NewHeap);
+		Data = Heap.get();
+	}
 
-RCOLLISIONMETHOD RSolidBspNode::m_ColMethod;
-float	RSolidBspNode::m_fColRadius;
-float	RSolidBspNode::m_fColHeight;
-rvector	RSolidBspNode::m_ColOrigin;
-rvector	RSolidBspNode::m_ColTo;
-RImpactPlanes* RSolidBspNode::m_pOutList;
-float	RSolidBspNode::fImpactDist;
-rvector	RSolidBspNode::impact;
-rplane	RSolidBspNode::impactPlane;
+	Data[Size++] = p;
+	return  true;
+}
 
 #ifndef _PUBLISH
 #ifdef _WIN32
@@ -250,10 +250,7 @@ void RSolidBspNode::ConstructBoundingBox()
 
 bool RSolidBspNode::m_bTracePath = false;
 
-#define MAX_DEPTH	256
-rplane	m_SolidPlanes[MAX_DEPTH];
-
-bool IsCross(const rplane &plane,const rvector &v0,const rvector &v1,float *fParam)
+static bool IsCross(const rplane &plane,const rvector &v0,const rvector &v1,float *fParam)
 {
 #define CSIGN(x) ( (x)<-0.1? -1 : (x)>0.1? 1 : 0 )
 	float dotv0 = DotProduct(plane, v0);
@@ -284,7 +281,7 @@ bool IsCross(const rplane &plane,const rvector &v0,const rvector &v1,float *fPar
 			return true;
 }
 
-bool RSolidBspNode::GetColPlanes_Recurse(int nDepth)
+bool RSolidBspNode::GetColPlanes_Recurse(RCollisionQuery& Query, int nDepth)
 {
 	bool bHit=false;
 
@@ -292,24 +289,24 @@ bool RSolidBspNode::GetColPlanes_Recurse(int nDepth)
 		if(m_bSolid) {
 			bool bInSolid=true;
 			for(int i=0;i<nDepth;i++) {
-				rplane *pPlane=m_SolidPlanes+i;
-				float dotv0 = DotProduct(*pPlane, m_ColOrigin);
+				rplane *pPlane=Query.SolidPlanes+i;
+				float dotv0 = DotProduct(*pPlane, Query.Origin);
 				if(dotv0>-0.1f) {
 					bInSolid=false;
 					break;
 				}
 			}
-			rvector dir=m_ColTo-m_ColOrigin;
+			rvector dir=Query.To-Query.Origin;
 
 			float fMaxParam = 0;
 			for(int i=0;i<nDepth;i++) {
-				rplane *pPlane=m_SolidPlanes+i;
+				rplane *pPlane=Query.SolidPlanes+i;
 
-				float dotv0 = DotProduct(*pPlane, m_ColOrigin);
-				float dotv1 = DotProduct(*pPlane, m_ColTo);
+				float dotv0 = DotProduct(*pPlane, Query.Origin);
+				float dotv1 = DotProduct(*pPlane, Query.To);
 
 				if(fabs(dotv0)<0.1f && fabs(dotv1)<0.1f) {
-					m_pOutList->Add(*pPlane);
+					Query.OutList->Add(*pPlane);
 					return false;	
 				}
 
@@ -322,20 +319,20 @@ bool RSolidBspNode::GetColPlanes_Recurse(int nDepth)
 				fMaxParam = max(fMaxParam,fParam);
 			}
 
-			rvector colPos = m_ColOrigin+(m_ColTo-m_ColOrigin)*fMaxParam;
+			rvector colPos = Query.Origin+(Query.To-Query.Origin)*fMaxParam;
 			
-			float fDist = Magnitude(colPos-m_ColOrigin);
+			float fDist = Magnitude(colPos-Query.Origin);
 			int nCount=0;
 			for(int i=0;i<nDepth;i++) {
-				rplane *pPlane=m_SolidPlanes+i;
+				rplane *pPlane=Query.SolidPlanes+i;
 				if (DotPlaneNormal(*pPlane, dir)>0) continue;
 				if (abs(DotProduct(*pPlane, colPos)) < 0.1f) {
-					m_pOutList->Add(*pPlane);
-					if(fDist<fImpactDist)
+					Query.OutList->Add(*pPlane);
+					if(fDist<Query.ImpactDist)
 					{
-						fImpactDist = fDist;
-						impact = colPos;
-						impactPlane = *pPlane;
+						Query.ImpactDist = fDist;
+						Query.ImpactPos = colPos;
+						Query.ImpactPlane = *pPlane;
 					}
 					nCount++;
 				}
@@ -347,81 +344,79 @@ bool RSolidBspNode::GetColPlanes_Recurse(int nDepth)
 	}
 
 	float fShift;
-	if(m_ColMethod==RCW_CYLINDER)
+	if(Query.Method==RCW_CYLINDER)
 	{
 		rvector rimpoint=rvector(-m_Plane.a,-m_Plane.b,0);
 		if(IS_ZERO(rimpoint.x) && IS_ZERO(rimpoint.y))
 			rimpoint.x=1.f;
 		Normalize(rimpoint);
-		rimpoint= rimpoint*m_fColRadius;
-		rimpoint.z +=  (m_Plane.c < 0 ) ? m_fColHeight : -m_fColHeight;
+		rimpoint= rimpoint*Query.Radius;
+		rimpoint.z +=  (m_Plane.c < 0 ) ? Query.Height : -Query.Height;
 		fShift = -DotPlaneNormal(m_Plane, rimpoint);
 	}else
 	{
-		fShift=m_fColRadius;
+		fShift=Query.Radius;
 	}
 
 	rplane shiftPlane=m_Plane;
 	shiftPlane.d=m_Plane.d-fShift;
 
 	float fCurParam;
-	if(m_pNegative!=NULL && IsCross(shiftPlane,m_ColOrigin,m_ColTo,&fCurParam))
+	if(m_pNegative!=NULL && IsCross(shiftPlane,Query.Origin,Query.To,&fCurParam))
 	{
-		m_SolidPlanes[nDepth]=shiftPlane;
-		bHit=m_pNegative->GetColPlanes_Recurse(nDepth+1);
+		Query.SolidPlanes[nDepth]=shiftPlane;
+		bHit=m_pNegative->GetColPlanes_Recurse(Query, nDepth+1);
 	}
 
 	shiftPlane.d=m_Plane.d+fShift;
 	shiftPlane=-shiftPlane;
 
-	if(m_pPositive!=NULL && IsCross(shiftPlane,m_ColOrigin,m_ColTo,&fCurParam))
+	if(m_pPositive!=NULL && IsCross(shiftPlane,Query.Origin,Query.To,&fCurParam))
 	{
-		m_SolidPlanes[nDepth]=shiftPlane;
-		bHit|=m_pPositive->GetColPlanes_Recurse(nDepth+1);
+		Query.SolidPlanes[nDepth]=shiftPlane;
+		bHit|=m_pPositive->GetColPlanes_Recurse(Query, nDepth+1);
 	}
 
 	return bHit;
 }
 
-bool RSolidBspNode::GetColPlanes_Sphere(RImpactPlanes *pOutList,const rvector &origin,const rvector &to,float fRadius)
+bool RSolidBspNode::GetColPlanes_Sphere(RCollisionQuery& Query, RImpactPlanes *pOutList,
+	const rvector &origin,const rvector &to,float fRadius)
 {
-	m_ColMethod = RCW_SPHERE;
-	m_ColOrigin = origin;
-	m_ColTo = to;
-	m_pOutList = pOutList;
+	Query.Method = RCW_SPHERE;
+	Query.Origin = origin;
+	Query.To = to;
+	Query.OutList = pOutList;
 
-	m_fColRadius = fRadius;
+	Query.Radius = fRadius;
+	Query.Height = 0;
 
-	fImpactDist=FLT_MAX;
-	impact=rvector(0,0,0);
+	Query.ImpactDist=FLT_MAX;
+	Query.ImpactPos=rvector(0,0,0);
 
-	return GetColPlanes_Recurse();    
+	return GetColPlanes_Recurse(Query);
 }
 
-bool RSolidBspNode::GetColPlanes_Cylinder(RImpactPlanes *pOutList,const rvector &origin,const rvector &to,float fRadius,float fHeight)
+bool RSolidBspNode::GetColPlanes_Cylinder(RCollisionQuery& Query, RImpactPlanes *pOutList,
+	const rvector &origin,const rvector &to,float fRadius,float fHeight)
 {
-	m_ColMethod = RCW_CYLINDER;
-	m_ColOrigin = origin;
-	m_ColTo = to;
-	m_pOutList = pOutList;
+	Query.Method = RCW_CYLINDER;
+	Query.Origin = origin;
+	Query.To = to;
+	Query.OutList = pOutList;
 
-	m_fColRadius = fRadius;
-	m_fColHeight = fHeight;
+	Query.Radius = fRadius;
+	Query.Height = fHeight;
 
-	fImpactDist=FLT_MAX;
-	impact=rvector(0,0,0);
+	Query.ImpactDist=FLT_MAX;
+	Query.ImpactPos=rvector(0,0,0);
 
-	return GetColPlanes_Recurse();    
+	return GetColPlanes_Recurse(Query);
 }
 
-
-rvector checkwallorigin;
-rvector checkwalldir;
-
-bool RSolidBspNode::CheckWall2(RSolidBspNode *pRootNode,RImpactPlanes &impactPlanes, const rvector &origin, rvector &targetpos,float fRadius,float fHeight,RCOLLISIONMETHOD method)
+bool RSolidBspNode::CheckWall2(RCollisionQuery& Query, RSolidBspNode *pRootNode,RImpactPlanes &impactPlanes,
+	const rvector &origin, rvector &targetpos,float fRadius,float fHeight,RCOLLISIONMETHOD method)
 {
-	checkwallorigin=origin;
-
 	if(m_bTracePath) {
 		rvector dif=targetpos-origin;
 		mlog(" from ( %3.5f %3.5f %3.5f ) by ( %3.3f %3.3f %3.3f ) "
@@ -430,12 +425,12 @@ bool RSolidBspNode::CheckWall2(RSolidBspNode *pRootNode,RImpactPlanes &impactPla
 
 	bool bIntersectThis;
 
-	impactPlanes.erase(impactPlanes.begin(),impactPlanes.end());
+	impactPlanes.clear();
 
 	if(method==RCW_SPHERE)
-		bIntersectThis=pRootNode->GetColPlanes_Sphere(&impactPlanes,origin,targetpos,fRadius);
+		bIntersectThis=pRootNode->GetColPlanes_Sphere(Query,&impactPlanes,origin,targetpos,fRadius);
 	else
-		bIntersectThis=pRootNode->GetColPlanes_Cylinder(&impactPlanes,origin,targetpos,fRadius,fHeight);
+		bIntersectThis=pRootNode->GetColPlanes_Cylinder(Query,&impactPlanes,origin,targetpos,fRadius,fHeight);
 
 	RImpactPlanes::iterator i;
 
@@ -461,7 +456,7 @@ bool RSolidBspNode::CheckWall2(RSolidBspNode *pRootNode,RImpactPlanes &impactPla
 		float fMinProjDist;
 		float fMinDistToOrigin;
 
-		for(i=impactPlanes.begin();i!=impactPlanes.end();i++)
+		for(i=impactPlanes.begin();i!=impactPlanes.end();)
 		{
 			rplane plane = *i;
 
@@ -471,6 +466,7 @@ bool RSolidBspNode::CheckWall2(RSolidBspNode *pRootNode,RImpactPlanes &impactPla
 				i=impactPlanes.erase(i);
 				continue;
 			}
+			++i;
 
 			float fDistToOrigin = DotProduct(plane, origin);
 			float fDistToTarget = DotProduct(plane, targetpos);
@@ -538,12 +534,10 @@ bool RSolidBspNode::CheckWall2(RSolidBspNode *pRootNode,RImpactPlanes &impactPla
 	return false;
 }
 
-bool g_bchecktest=false;
-rvector g_checkdebug;
-
-bool RSolidBspNode::CheckWall(RSolidBspNode *pRootNode, const rvector &origin,rvector &targetpos,float fRadius,float fHeight,RCOLLISIONMETHOD method,int nDepth,rplane *pimpactplane)
+bool RSolidBspNode::CheckWall(RCollisionQuery& Query, RSolidBspNode *pRootNode, const rvector &origin,
+	rvector &targetpos,float fRadius,float fHeight,RCOLLISIONMETHOD method,int nDepth,rplane *pimpactplane)
 {
-	checkwallorigin=origin;
+	auto& checkwalldir = Query.CheckWallDir;
 	checkwalldir=targetpos-origin;
 	if (checkwalldir.x || checkwalldir.y || checkwalldir.z)
 		Normalize(checkwalldir);
@@ -551,12 +545,11 @@ bool RSolidBspNode::CheckWall(RSolidBspNode *pRootNode, const rvector &origin,rv
 	bool bIntersectThis;
 
 	RImpactPlanes impactPlanes;
-	impactPlanes.erase(impactPlanes.begin(),impactPlanes.end());
 
 	if(method==RCW_SPHERE)
-		bIntersectThis=pRootNode->GetColPlanes_Sphere(&impactPlanes,origin,targetpos,fRadius);
+		bIntersectThis=pRootNode->GetColPlanes_Sphere(Query,&impactPlanes,origin,targetpos,fRadius);
 	else
-		bIntersectThis=pRootNode->GetColPlanes_Cylinder(&impactPlanes,origin,targetpos,fRadius,fHeight);
+		bIntersectThis=pRootNode->GetColPlanes_Cylinder(Query,&impactPlanes,origin,targetpos,fRadius,fHeight);
 
 	if(m_bTracePath) {
 		mlog("\n");
@@ -592,7 +585,7 @@ bool RSolidBspNode::CheckWall(RSolidBspNode *pRootNode, const rvector &origin,rv
 		float fMinProjDist = 1.f;
 		float fMinDistToOrigin = 0.f;
 
-		for(i=impactPlanes.begin();i!=impactPlanes.end();i++)
+		for(i=impactPlanes.begin();i!=impactPlanes.end();)
 		{
 			rplane plane = *i;
 
@@ -602,6 +595,7 @@ bool RSolidBspNode::CheckWall(RSolidBspNode *pRootNode, const rvector &origin,rv
 				i=impactPlanes.erase(i);
 				continue;
 			}
+			++i;
 
 			float fProjDist = -DotPlaneNormal(plane, diff);
 			float fDistToOrigin = DotProduct(plane, origin);
@@ -637,10 +631,6 @@ bool RSolidBspNode::CheckWall(RSolidBspNode *pRootNode, const rvector &origin,rv
 		float fInter = max(0.f,min(1.f,fMinDistToOrigin/fMinProjDist));
 		rvector currentorigin = origin + fInter * diff;
 
-		if(nDepth==0 && pimpactplane)
-			*pimpactplane=simulplanes[0];
-
-
 		int nSimulCount=0;
 
 		for(i=impactPlanes.begin();i!=impactPlanes.end();i++) 
@@ -651,6 +641,9 @@ bool RSolidBspNode::CheckWall(RSolidBspNode *pRootNode, const rvector &origin,rv
 			}
 		}
 
+		if(nDepth==0 && pimpactplane && nSimulCount)
+			*pimpactplane=simulplanes[0];
+
 		if(m_bTracePath) {
 			mlog("fInter = %3.3f %d simul ",fInter,nSimulCount);
 		}
@@ -673,7 +666,7 @@ bool RSolidBspNode::CheckWall(RSolidBspNode *pRootNode, const rvector &origin,rv
 					mlog("\n    check 1 : ");
 				}
 				rvector checktargetpos = adjtargetpos;
-				CheckWall2(pRootNode, impactPlanes, currentorigin, checktargetpos, fRadius, fHeight, method);
+				CheckWall2(Query, pRootNode, impactPlanes, currentorigin, checktargetpos, fRadius, fHeight, method);
 				float fDot = DotProduct(checkwalldir, checktargetpos - origin);
 				if(m_bTracePath) {
 					mlog("dot = %3.3f ",fDot);
@@ -707,7 +700,7 @@ bool RSolidBspNode::CheckWall(RSolidBspNode *pRootNode, const rvector &origin,rv
 							mlog("\n   check 2 : ");
 						}
 						rvector checktargetpos = adjtargetpos;
-						CheckWall2(pRootNode,impactPlanes,currentorigin,checktargetpos,fRadius,fHeight,method);
+						CheckWall2(Query, pRootNode,impactPlanes,currentorigin,checktargetpos,fRadius,fHeight,method);
 						float fDot=DotProduct(checkwalldir,checktargetpos-origin);
 						if(fDot>fBestCase)
 						{
@@ -745,13 +738,11 @@ bool RSolidBspNode::CheckWall(RSolidBspNode *pRootNode, const rvector &origin,rv
 				mlog("@ %3.3f = final ( %3.3f %3.3f %3.3f )",fInter,targetpos.x,targetpos.y,targetpos.z);
 				}
 
-			g_checkdebug = targetpos;
-			g_bchecktest=true;
 			return true;
 		}
 
 		rvector checktargetpos = newtargetpos;
-		CheckWall2(pRootNode,impactPlanes,currentorigin,checktargetpos,fRadius,fHeight,method);
+		CheckWall2(Query, pRootNode,impactPlanes,currentorigin,checktargetpos,fRadius,fHeight,method);
 		for(i=impactPlanes.begin();i!=impactPlanes.end();i++)
 		{
 			rplane plane = *i;
@@ -0,0 +1,104 @@
+#include "LightmapShadowBVH.h"
+#include "MTest.h"
+#include <cstdlib>
+#include <random>
+
+using namespace RealSpace2;
+
+// Compares LightmapShadowBVH::Occluded against testing every triangle on a random scene,
+// and reports how many shadow rays per second each of them manages.
+
+static bool OccludedBruteForce(const std::vector<LightmapShadowBVH::Triangle>& Triangles,
+	const v3& From, const v3& To, float Tolerance)
+{
+	auto Dir = To - From;
+	const auto Length = Magnitude(Dir);
+	const auto MaxDist = Length - Tolerance;
+	if (Length == 0 || MaxDist <= 0)
+		return false;
+	Dir *= 1.f / Length;
+
+	for (auto& Tri : Triangles)
+	{
+		if (DotProduct(Tri.Plane, From) < 0)
+			continue;
+
+		float Dist;
+		if (IntersectTriangle(Tri.V[0], Tri.V[1], Tri.V[2], From, Dir, &Dist) && Dist < MaxDist)
+			return true;
+	}
+	return false;
+}
+
+int main(int argc, char** argv)
+{
+	const int TriangleCount = argc > 1 ? atoi(argv[1]) : 10000;
+	const int RayCount = argc > 2 ? atoi(argv[2]) : 2000;
+	const float WorldSize = 10000;
+	const float TriangleSize = 300;
+	const float Tolerance = 5;
+
+	std::mt19937 Rng{ 1234 };
+	std::uniform_real_distribution<float> WorldDist{ -WorldSize / 2, WorldSize / 2 };
+	std::uniform_real_distribution<float> TriangleDist{ -TriangleSize, TriangleSize };
+
+	auto RandomPoint = [&] { return v3{ WorldDist(Rng), WorldDist(Rng), WorldDist(Rng) }; };
+
+	std::vector<LightmapShadowBVH::Triangle> Triangles;
+	Triangles.reserve(TriangleCount);
+	for (int i = 0; i < TriangleCount; ++i)
+	{
+		const auto Center = RandomPoint();
+		LightmapShadowBVH::Triangle Tri;
+		for (auto& v : Tri.V)
+			v = Center + v3{ TriangleDist(Rng), TriangleDist(Rng), TriangleDist(Rng) };
+		Tri.Plane = PlaneFromPoints(Tri.V[0], Tri.V[1], Tri.V[2]);
+		Triangles.push_back(Tri);
+	}
+
+	struct Ray { v3 From, To; };
+	std::vector<Ray> Rays;
+	Rays.reserve(RayCount);
+	for (int i = 0; i < RayCount; ++i)
+		Rays.push_back({ RandomPoint(), RandomPoint() });
+	// Degenerate rays and rays shorter than the tolerance are never occluded.
+	Rays.push_back({ Triangles[0].V[0], Triangles[0].V[0] });
+	Rays.push_back({ v3{ 0, 0, 0 }, v3{ Tolerance / 2, 0, 0 } });
+
+	LightmapShadowBVH BVH;
+	const auto BuildTime = MTestTimeMS([&] { BVH.Build(Triangles); });
+
+	std::vector<char> Expected(Rays.size()), Actual(Rays.size());
+	const auto BruteForceTime = MTestTimeMS([&] {
+		for (size_t i = 0; i < Rays.size(); ++i)
+			Expected[i] = OccludedBruteForce(Triangles, Rays[i].From, Rays[i].To, Tolerance);
+	});
+	const auto BVHTime = MTestTimeMS([&] {
+		for (size_t i = 0; i < Rays.size(); ++i)
+			Actual[i] = BVH.Occluded(Rays[i].From, Rays[i].To, Tolerance);
+	});
+
+	int Mismatches = 0, Occluded = 0;
+	for (size_t i = 0; i < Rays.size(); ++i)
+	{
+		Mismatches += Expected[i] != Actual[i];
+		Occluded += Expected[i] != 0;
+	}
+	MTEST_CHECK(Mismatches == 0);
+	// Make sure the scene actually exercises both outcomes.
+	MTEST_CHECK(Occluded > 0 && Occluded < RayCount);
+	MTEST_CHECK(!Actual[RayCount] && !Actual[RayCount + 1]);
+
+	LightmapShadowBVH Empty;
+	Empty.Build({});
+	MTEST_CHECK(!Empty.Occluded(Rays[0].From, Rays[0].To, Tolerance));
+
+	const auto RaysPerSecond = [&](double ms) { return ms > 0 ? Rays.size() * 1000.0 / ms : 0.0; };
+	std::printf("%d triangles, %d rays, %d occluded, %d mismatches\n",
+		TriangleCount, int(Rays.size()), Occluded, Mismatches);
+	std::printf("Build: %.1f ms\n", BuildTime);
+	std::printf("Brute force: %.1f ms, %.0f rays/s\n", BruteForceTime, RaysPerSecond(BruteForceTime));
+	std::printf("BVH: %.1f ms, %.0f rays/s\n", BVHTime, RaysPerSecond(BVHTime));
+
+	return MTestResult();
+}
@@ -0,0 +1,106 @@
+#include "MUtil.h"
+#include "RMeshUtil.h"
+#include "MTest.h"
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Compares RGetNextKey against the linear scan RAnimationNode used to do, on position tracks
+// of the lengths found in character animations and longer, and times sampling a position the
+// way RAnimationNode::GetPosValue does with a linear scan, a binary search and RGetNextKey.
+// Where the first two cross over is where RGetNextFrame switches from one to the other.
+
+static int GetNextKeyLinear(const RPosKey* Keys, int Count, int frame)
+{
+	int p;
+	for (p = 0; p < Count; p++) {
+		if (Keys[p].frame > frame)
+			break;
+	}
+	return p;
+}
+
+static int GetNextKeyBinary(const RPosKey* Keys, int Count, int frame)
+{
+	return int(std::upper_bound(Keys, Keys + Count, frame,
+		[](int f, const RPosKey& Key) { return f < Key.frame; }) - Keys);
+}
+
+template <typename LookupType>
+static rvector SamplePosition(const std::vector<RPosKey>& Keys, int frame, LookupType&& Lookup)
+{
+	const int Count = int(Keys.size());
+	int p = Lookup(Keys.data(), Count, frame);
+	if (p >= Count)
+		return Keys[Count - 1];
+	if (p)
+		p--;
+
+	float d = 1.f;
+	const int s = Keys[p + 1].frame - Keys[p].frame;
+	if (s != 0) d = float(frame % s) / float(s);
+	const rvector v = Keys[p] - Keys[p + 1];
+	return Keys[p] - v * d;
+}
+
+int main(int argc, char** argv)
+{
+	const int SampleCount = argc > 1 ? atoi(argv[1]) : 200000;
+
+	std::mt19937 Rng{ 1357 };
+	std::uniform_real_distribution<float> PosDist{ -100, 100 };
+
+	// Exported animations have a key every 160 ticks or so, and a few hundred keys at most, but
+	// repeat frames and uneven spacing happen.
+	for (int KeyCount : { 1, 2, 3, 16, 30, 64, 96, 128, 129, 160, 192, 256, 300, 5000 })
+	{
+		std::vector<RPosKey> Keys(KeyCount);
+		int Frame = 0;
+		for (auto& Key : Keys)
+		{
+			static_cast<rvector&>(Key) = rvector{ PosDist(Rng), PosDist(Rng), PosDist(Rng) };
+			Key.frame = Frame;
+			Frame += Rng() % 8 == 0 ? 0 : 1 + Rng() % 320;
+		}
+
+		// Include frames before the first key and after the last one.
+		std::uniform_int_distribution<int> FrameDist{ -200, Frame + 200 };
+		std::vector<int> Frames(SampleCount);
+		for (auto& f : Frames)
+			f = FrameDist(Rng);
+
+		int Mismatches = 0;
+		for (auto f : Frames)
+			Mismatches += RGetNextKey(Keys.data(), KeyCount, f) != GetNextKeyLinear(Keys.data(), KeyCount, f);
+		for (auto& Key : Keys)
+		{
+			for (int f : { Key.frame - 1, Key.frame, Key.frame + 1 })
+				Mismatches += RGetNextKey(Keys.data(), KeyCount, f) != GetNextKeyLinear(Keys.data(), KeyCount, f);
+		}
+		MTEST_CHECK(Mismatches == 0);
+
+		// The sums keep the samples from being optimized away, and have to agree, since both
+		// lookups find the same keys.
+		float LinearSum = 0, BinarySum = 0, Sum = 0;
+		const auto LinearTime = MTestTimeMS([&] {
+			for (auto f : Frames)
+				LinearSum += SamplePosition(Keys, f, GetNextKeyLinear).x;
+		});
+		const auto BinaryTime = MTestTimeMS([&] {
+			for (auto f : Frames)
+				BinarySum += SamplePosition(Keys, f, GetNextKeyBinary).x;
+		});
+		const auto Time = MTestTimeMS([&] {
+			for (auto f : Frames)
+				Sum += SamplePosition(Keys, f, RGetNextKey<RPosKey>).x;
+		});
+		MTEST_CHECK(LinearSum == Sum && BinarySum == Sum);
+
+		std::printf("%5d keys: %d mismatches, %.1f ns per sample with a linear scan, %.1f ns with "
+			"a binary search, %.1f ns with RGetNextKey\n", KeyCount, Mismatches,
+			LinearTime * 1e6 / SampleCount, BinaryTime * 1e6 / SampleCount,
+			Time * 1e6 / SampleCount);
+	}
+
+	return MTestResult();
+}
@@ -0,0 +1,222 @@
+#include "stdafx.h"
+#include "RSolidBsp.h"
+#include "RMath.h"
+#include "MTest.h"
+#include <atomic>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace RealSpace2;
+
+// Builds a solid BSP tree for a random block map, runs CheckWall for sphere and cylinder moves
+// through it on one thread, and then runs the same moves again on several threads at once, each
+// with its own RCollisionQuery, in different orders. Every result has to match the
+// single-threaded one exactly. Also built with ThreadSanitizer, as RSolidBspTSanTest.
+
+namespace {
+
+const int SizeX = 24, SizeY = 24, SizeZ = 6;
+const float CellSize = 100;
+
+struct BlockMap
+{
+	bool Solid[SizeX][SizeY][SizeZ];
+
+	// A floor, walls around the edges, and random blocks and pillars inside.
+	explicit BlockMap(std::mt19937& Rng)
+	{
+		for (int x = 0; x < SizeX; x++)
+			for (int y = 0; y < SizeY; y++)
+				for (int z = 0; z < SizeZ; z++)
+					Solid[x][y][z] = z == 0 || x == 0 || y == 0 || x == SizeX - 1 ||
+						y == SizeY - 1 || (z < 4 && Rng() % 5 == 0);
+	}
+
+	bool IsUniform(const int (&Min)[3], const int (&Max)[3]) const
+	{
+		const bool First = Solid[Min[0]][Min[1]][Min[2]];
+		for (int x = Min[0]; x < Max[0]; x++)
+			for (int y = Min[1]; y < Max[1]; y++)
+				for (int z = Min[2]; z < Max[2]; z++)
+					if (Solid[x][y][z] != First)
+						return false;
+		return true;
+	}
+};
+
+// Splits the map in half along its longest side until each piece is all solid or all empty.
+// The positive side of each plane is the one with the larger coordinates.
+struct BspBuilder
+{
+	const BlockMap& Map;
+	std::vector<RSolidBspNode>& Nodes;
+
+	RSolidBspNode* Build(const int (&Min)[3], const int (&Max)[3])
+	{
+		Nodes.emplace_back();
+		auto* Node = &Nodes.back();
+		if (Map.IsUniform(Min, Max))
+		{
+			Node->m_bSolid = Map.Solid[Min[0]][Min[1]][Min[2]];
+			return Node;
+		}
+
+		int Axis = 0;
+		for (int i = 1; i < 3; i++)
+			if (Max[i] - Min[i] > Max[Axis] - Min[Axis])
+				Axis = i;
+		const int Split = (Min[Axis] + Max[Axis]) / 2;
+
+		float Normal[3]{};
+		Normal[Axis] = 1;
+		Node->m_Plane = rplane(Normal[0], Normal[1], Normal[2], -Split * CellSize);
+		Node->m_bSolid = false;
+
+		int NegativeMax[3] = { Max[0], Max[1], Max[2] };
+		int PositiveMin[3] = { Min[0], Min[1], Min[2] };
+		NegativeMax[Axis] = Split;
+		PositiveMin[Axis] = Split;
+		Node->m_pNegative = Build(Min, NegativeMax);
+		Node->m_pPositive = Build(PositiveMin, Max);
+		return Node;
+	}
+};
+
+struct Move
+{
+	rvector From, To;
+	RCOLLISIONMETHOD Method;
+};
+
+struct MoveResult
+{
+	bool Hit;
+	rvector To;
+	rplane ImpactPlane;
+	rvector ImpactPos;
+};
+
+bool operator==(const MoveResult& a, const MoveResult& b)
+{
+	auto Same = [](const float* x, const float* y, int n) {
+		return memcmp(x, y, n * sizeof(float)) == 0;
+	};
+	return a.Hit == b.Hit && Same(&a.To.x, &b.To.x, 3) &&
+		Same(a.ImpactPlane, b.ImpactPlane, 4) && Same(&a.ImpactPos.x, &b.ImpactPos.x, 3);
+}
+
+const float Radius = 30, Height = 30;
+
+MoveResult RunMove(RCollisionQuery& Query, RSolidBspNode* Root, const Move& m)
+{
+	MoveResult Result;
+	Result.To = m.To;
+	Result.ImpactPlane = rplane(0, 0, 0, 0);
+	Result.Hit = RSolidBspNode::CheckWall(Query, Root, m.From, Result.To, Radius, Height,
+		m.Method, 0, &Result.ImpactPlane);
+	Result.ImpactPos = Query.ImpactPos;
+	return Result;
+}
+
+// Moves of up to a few cells from random points in the empty cells that sit on something.
+std::vector<Move> MakeMoves(const BlockMap& Map, std::mt19937& Rng, int Count)
+{
+	std::uniform_real_distribution<float> Offset{ Radius + 1, CellSize - Radius - 1 };
+	std::uniform_real_distribution<float> Step{ -2 * CellSize, 2 * CellSize };
+	std::vector<Move> Moves;
+	while (int(Moves.size()) < Count)
+	{
+		const int x = Rng() % SizeX, y = Rng() % SizeY, z = 1 + Rng() % (SizeZ - 2);
+		if (Map.Solid[x][y][z] || !Map.Solid[x][y][z - 1])
+			continue;
+
+		Move m;
+		m.Method = Rng() % 2 ? RCW_CYLINDER : RCW_SPHERE;
+		m.From = rvector(x * CellSize + Offset(Rng), y * CellSize + Offset(Rng),
+			z * CellSize + CellSize / 2);
+		m.To = m.From + rvector(Step(Rng), Step(Rng), Step(Rng) / 8);
+		Moves.push_back(m);
+	}
+	return Moves;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int MoveCount = argc > 1 ? atoi(argv[1]) : 5000;
+	const int ThreadCount = (std::max)(4, (std::min)(8, int(std::thread::hardware_concurrency())));
+	const int Rounds = 3;
+
+	std::mt19937 Rng{ 31337 };
+	std::unique_ptr<BlockMap> Map{ new BlockMap{ Rng } };
+	std::vector<RSolidBspNode> Nodes;
+	// Never reallocated, since the nodes point at each other.
+	Nodes.reserve(2 * SizeX * SizeY * SizeZ);
+	const int Min[3] = { 0, 0, 0 }, Max[3] = { SizeX, SizeY, SizeZ };
+	auto* Root = BspBuilder{ *Map, Nodes }.Build(Min, Max);
+	MTEST_CHECK(Nodes.size() <= size_t(2 * SizeX * SizeY * SizeZ));
+
+	const auto Moves = MakeMoves(*Map, Rng, MoveCount);
+
+	// The reference results, from one query reused for every move.
+	std::vector<MoveResult> Expected(Moves.size());
+	int Hits = 0;
+	const auto SingleTime = MTestTimeMS([&] {
+		std::unique_ptr<RCollisionQuery> Query{ new RCollisionQuery };
+		for (size_t i = 0; i < Moves.size(); i++)
+		{
+			Expected[i] = RunMove(*Query, Root, Moves[i]);
+			Hits += Expected[i].Hit;
+		}
+	});
+	// Enough of the moves run into something, and enough don't, for the comparison to mean
+	// something.
+	MTEST_CHECK(Hits > MoveCount / 10 && Hits < MoveCount * 9 / 10);
+
+	// No move ends up inside a block.
+	int InSolid = 0;
+	for (auto& Result : Expected)
+	{
+		const int x = int(Result.To.x / CellSize), y = int(Result.To.y / CellSize),
+			z = int(Result.To.z / CellSize);
+		InSolid += x < 0 || y < 0 || z < 0 || x >= SizeX || y >= SizeY || z >= SizeZ ||
+			Map->Solid[x][y][z];
+	}
+	MTEST_CHECK(InSolid == 0);
+
+	// Each thread starts at a different place in the list, and steps through it with a different
+	// stride, so that the threads are in different parts of the tree at the same time.
+	std::atomic<int> Mismatches{};
+	const auto MultiTime = MTestTimeMS([&] {
+		std::vector<std::thread> Threads;
+		for (int t = 0; t < ThreadCount; t++)
+		{
+			Threads.emplace_back([&, t] {
+				std::unique_ptr<RCollisionQuery> Query{ new RCollisionQuery };
+				const size_t Count = Moves.size();
+				const size_t Stride = 1 + 2 * t;
+				int Local = 0;
+				for (int Round = 0; Round < Rounds; Round++)
+				{
+					size_t i = t * Count / ThreadCount;
+					for (size_t n = 0; n < Count; n++, i = (i + Stride) % Count)
+						Local += !(RunMove(*Query, Root, Moves[i]) == Expected[i]);
+				}
+				Mismatches += Local;
+			});
+		}
+		for (auto& Thread : Threads)
+			Thread.join();
+	});
+	MTEST_CHECK(Mismatches == 0);
+
+	std::printf("%d nodes, %d moves, %d hits: %.1f ms on one thread, %d threads x %d rounds "
+		"in %.1f ms, %d mismatches\n", int(Nodes.size()), MoveCount, Hits, SingleTime,
+		ThreadCount, Rounds, MultiTime, int(Mismatches));
+
+	return MTestResult();
+}
@@ -17,13 +17,18 @@
 #include "MBasePacket.h"
 #include "MTrafficLog.h"
 #include "MInetUtil.h"
+#include "MTimerWheel.h"
+#include "MOpenHashMap.h"
 #include <memory>
+#include <atomic>
 
 #ifdef WIN32
 #pragma comment(lib, "ws2_32.lib")
 #endif
 
 class MSafeUDP;
+class MNetLink;
+struct MACKWaitItem;
 
 // INNER CLASS //////////////////////////////////////////////////////////////////////////
 struct MSendQueueItem {
@@ -31,6 +36,7 @@ struct MSendQueueItem {
 	u16 wRawPort;
 	MBasePacket* pPacket;
 	u32 dwPacketSize;
+	std::shared_ptr<const char> pSharedPacket;	// If set, pPacket points into it and isn't freed
 };
 
 struct MACKQueueItem {
@@ -39,12 +45,40 @@ struct MACKQueueItem {
 	u8 nSafeIndex;
 };
 
+// Entry in MSafeUDP's timer wheel. The wheel hands back the node, and these fields tell
+// the socket thread what it belongs to.
+struct MSafeUDPTimer : MTimerWheelNode {
+	enum TYPE {
+		TIMER_RETRANSMIT,	// pACKWaitItem is due for a resend, or has run out of retries
+		TIMER_IDLE			// pNetLink has been idle without being established for too long
+	};
+
+	TYPE nType;
+	MNetLink* pNetLink;
+	MACKWaitItem* pACKWaitItem;
+
+	MSafeUDPTimer(TYPE nType, MNetLink* pNetLink, MACKWaitItem* pACKWaitItem = nullptr)
+		: nType{ nType }, pNetLink{ pNetLink }, pACKWaitItem{ pACKWaitItem } {}
+};
+
 struct MACKWaitItem {
 	std::unique_ptr<MSafePacket> pPacket;
 	u32 dwPacketSize;
 	MTime::timeval tvFirstSent;
 	MTime::timeval tvLastSent;
 	u8 nSendCount;
+	MSafeUDPTimer RetransmitTimer;
+
+	MACKWaitItem(MNetLink* pNetLink) : RetransmitTimer{ MSafeUDPTimer::TIMER_RETRANSMIT, pNetLink, this } {}
+};
+
+// Counters kept by the socket thread, see MSafeUDP::GetStats.
+struct MSafeUDPStats {
+	u64 nRetransmits;			// Safe packets sent again after SAFEUDP_SAFE_RETRANS_TIME without an ACK
+	u64 nRetransmitTimeouts;	// Links closed because a safe packet went unacknowledged for too long
+	u64 nIdleTimeouts;			// Links dropped for staying unestablished for too long
+	u32 nScheduledTimers;		// Timers currently in the wheel
+	u32 nNetLinks;				// Links currently in the link table
 };
 
 // OUTER CLASS //////////////////////////////////////////////////////////////////////////
@@ -79,6 +113,7 @@ public:
 
 public:
 	ACKWaitList		m_ACKWaitQueue;	// Safe Sent queue, Wait for ACK
+	MSafeUDPTimer	m_IdleTimer{ MSafeUDPTimer::TIMER_IDLE, this };
 
 private:
 	void Setconnected(bool bConnected)	{ m_bConnected = bConnected; }
@@ -120,8 +155,7 @@ public:
 	void* GetUserData() const			{ return m_pUserData; }
 };
 
-typedef std::map<i64, MNetLink*>	NetLinkMap;
-typedef NetLinkMap::value_type	NetLinkType;
+typedef MOpenHashMap<i64, MNetLink*>	NetLinkMap;
 typedef NetLinkMap::iterator	NetLinkItor;
 
 
@@ -156,10 +190,15 @@ public:
 	bool PushSend(MNetLink* pNetLink, MBasePacket* pPacket, u32 dwpPacketSize, bool bRetransmit);	
 	bool PushSend(const char* pszIP, int nPort, char* pPacket, u32 dwPacketSize);
 	bool PushSend(u32 dwIP, int nPort, char* pPacket, u32 dwPacketSize );
+	bool PushSend(u32 dwIP, int nPort, std::shared_ptr<const char> pPacket, u32 dwPacketSize);
 
 	int GetSendTraffic() const { return m_SendTrafficLog.GetTrafficSpeed(); }
 	int GetRecvTraffic() const { return m_RecvTrafficLog.GetTrafficSpeed(); }
 
+	u64 GetRetransmitCount() const { return m_nRetransmits; }
+	u64 GetRetransmitTimeoutCount() const { return m_nRetransmitTimeouts; }
+	u64 GetIdleTimeoutCount() const { return m_nIdleTimeouts; }
+
 	virtual void Run() override;
 
 private:
@@ -173,6 +212,8 @@ private:
 	bool FlushSend();
 
 	bool SafeSendManage();
+	void OnRetransmitTimer(MNetLink* pNetLink, MACKWaitItem* pACKWaitItem, u64 nNow);
+	void OnIdleTimer(MNetLink* pNetLink);
 
 	bool Recv();
 	bool OnCustomRecv(u32 dwIP, u16 wRawPort, char* pPacket, u32 dwSize);
@@ -201,6 +242,10 @@ private:
 	u32						m_nTotalRecv{};
 	MTrafficLog				m_SendTrafficLog;
 	MTrafficLog				m_RecvTrafficLog;
+
+	std::atomic<u64>		m_nRetransmits{};
+	std::atomic<u64>		m_nRetransmitTimeouts{};
+	std::atomic<u64>		m_nIdleTimeouts{};
 };
 
 class MSafeUDP
@@ -225,6 +270,9 @@ public:
 	bool Send(MNetLink* pNetLink, MBasePacket* pPacket, u32 dwSize);
 	bool Send(const char* pszIP, int nPort, char* pPacket, u32 dwSize);
 	bool Send(u32 dwIP, int nPort, char* pPacket, u32 dwSize );
+	// Sends a buffer that's shared with other sends instead of handed over, e.g. a response
+	// that's encoded once and sent to many clients. The buffer is kept alive until it's sent.
+	bool Send(u32 dwIP, int nPort, std::shared_ptr<const char> pPacket, u32 dwSize);
 
 	SOCKET GetLocalSocket() const { return m_Socket; }
 	std::string GetLocalIPString() const { return GetIPv4String(m_LocalAddress.sin_addr); }
@@ -239,14 +287,25 @@ public:
 		*nRecvTraffic = m_SocketThread.GetRecvTraffic();
 	}
 
+	MSafeUDPStats GetStats();
+
 	void LockNetLink() { m_csNetLink.lock(); }
 	void UnlockNetLink() { m_csNetLink.unlock(); }
 
+	// Retransmit and idle timeouts. m_csTimer only guards the wheel itself, and is never held
+	// while a timer is handled, so handlers can freely send and schedule.
+	void ScheduleTimer(MSafeUDPTimer& Timer, u64 nExpireTime);
+	void CancelTimer(MSafeUDPTimer& Timer);
+	MSafeUDPTimer* PopExpiredTimer(u64 nNow);
+
 	MCriticalSection			m_csNetLink;
 
 	NetLinkMap					m_NetLinkMap;
 	MNETLINKSTATECALLBACK*		m_fnNetLinkStateCallback;
 
+	MCriticalSection			m_csTimer;
+	MTimerWheel					m_TimerWheel{ GetGlobalTimeMS() };
+
 private:
 	bool OpenSocket(int nPort, bool bReuse = true);
 	void CloseSocket();
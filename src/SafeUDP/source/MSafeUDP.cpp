@@ -24,6 +24,20 @@ void MTRACE(const char* pszLog)
 	DMLog("%s", pszLog);
 }
 
+// MTime::GetTime stores milliseconds in tv_usec.
+static u64 TimevalToMS(const MTime::timeval& tv)
+{
+	return u64(tv.tv_sec) * 1000 + tv.tv_usec;
+}
+
+// When the retransmit timer of an ACK wait item should next fire: either to resend it, or
+// to give up on the link once SAFEUDP_MAX_SAFE_RETRANS_TIME has passed since the first send.
+static u64 GetNextRetransmitTime(const MACKWaitItem& Item)
+{
+	return (std::min)(TimevalToMS(Item.tvLastSent) + SAFEUDP_SAFE_RETRANS_TIME,
+		TimevalToMS(Item.tvFirstSent) + SAFEUDP_MAX_SAFE_RETRANS_TIME) + 1;
+}
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 // MNetLink ////////////////////////////////////////////////////////////////////////////////
 MNetLink::MNetLink()
@@ -43,7 +57,12 @@ MNetLink::MNetLink()
 
 MNetLink::~MNetLink()
 {
+	if (m_pSafeUDP)
+		m_pSafeUDP->CancelTimer(m_IdleTimer);
+
 	for (ACKWaitListItor itor = m_ACKWaitQueue.begin(); itor != m_ACKWaitQueue.end(); ) {
+		if (m_pSafeUDP)
+			m_pSafeUDP->CancelTimer((*itor)->RetransmitTimer);
 		delete (*itor);
 		itor = m_ACKWaitQueue.erase(itor);
 	}
@@ -56,6 +75,11 @@ void MNetLink::SetLinkState(MNetLink::LINKSTATE nState)
 
 	m_nLinkState = nState; 
 
+	// Links that aren't established get dropped once they've been idle for too long.
+	if (m_nLinkState != LINKSTATE_ESTABLISHED && m_pSafeUDP)
+		m_pSafeUDP->ScheduleTimer(m_IdleTimer,
+			TimevalToMS(m_tvLastPacketRecvTime) + SAFEUDP_MAX_SAFE_RETRANS_TIME + 1);
+
 	#ifdef LINKSTATE_LOG
 	switch(m_nLinkState) {
 	case LINKSTATE_CLOSED:
@@ -219,7 +243,7 @@ bool MNetLink::SetACKWait(MSafePacket* pPacket, u32 dwPacketSize)
 		return false;
 
 	pPacket->nSafeIndex = GetNextWriteIndex();
-	MACKWaitItem* pACKWaitItem = new MACKWaitItem;
+	MACKWaitItem* pACKWaitItem = new MACKWaitItem{ this };
 	pACKWaitItem->pPacket = std::unique_ptr<MSafePacket>{ pPacket };
 	pACKWaitItem->dwPacketSize = dwPacketSize;
 	pACKWaitItem->nSendCount = 1;		// SendQueue
@@ -227,6 +251,8 @@ bool MNetLink::SetACKWait(MSafePacket* pPacket, u32 dwPacketSize)
 	MTime::GetTime(&pACKWaitItem->tvLastSent);
 	m_ACKWaitQueue.push_back(pACKWaitItem);
 
+	m_pSafeUDP->ScheduleTimer(pACKWaitItem->RetransmitTimer, GetNextRetransmitTime(*pACKWaitItem));
+
 	return true;
 }
 
@@ -235,6 +261,7 @@ bool MNetLink::ClearACKWait(u8 nSafeIndex)
 	for (ACKWaitListItor itor = m_ACKWaitQueue.begin(); itor != m_ACKWaitQueue.end(); ) {
 		MACKWaitItem* pACKWaitItem = *itor;
 		if (pACKWaitItem->pPacket->nSafeIndex == nSafeIndex) {
+			m_pSafeUDP->CancelTimer(pACKWaitItem->RetransmitTimer);
 			delete pACKWaitItem;	// pACKWaitItem->pPacket will Delete too
 			itor = m_ACKWaitQueue.erase(itor);
 			return true;
@@ -342,11 +369,14 @@ void MSocketThread::Run()
 			goto end_thread; // Stop Thread
 
 		default:
-			m_pSafeUDP->LockNetLink();
-			SafeSendManage();
-			m_pSafeUDP->UnlockNetLink();
 			break;
 		}
+
+		// Only timers that are due are touched here, so this is cheap enough to run on every
+		// wakeup instead of only when the socket has been quiet for SAFEUDP_SAFE_MANAGE_TIME.
+		m_pSafeUDP->LockNetLink();
+		SafeSendManage();
+		m_pSafeUDP->UnlockNetLink();
 	}
 
 end_thread:
@@ -407,16 +437,22 @@ bool MSocketThread::PushSend(MNetLink* pNetLink, MBasePacket* pPacket, u32 dwPac
 	if (!pNetLink || m_SendList.size() > SAFEUDP_MAX_SENDQUEUE_LENGTH)
 		return false;
 
+	MBasePacket* pSendPacket = pPacket;
+	if (pPacket->GetFlag(SAFEUDP_FLAG_SAFE_PACKET) != false &&
+		(bRetransmit || pNetLink->SetACKWait((MSafePacket*)pPacket, dwPacketSize))) {
+		// The ACK wait item owns the packet until it's acknowledged, and FlushSend frees
+		// whatever it sends, so queue a copy.
+		auto* pCopy = new char[dwPacketSize];
+		memcpy(pCopy, pPacket, dwPacketSize);
+		pSendPacket = (MBasePacket*)pCopy;
+	}
+
 	MSendQueueItem* pSendItem = new MSendQueueItem;
 	pSendItem->dwIP = pNetLink->GetIP();
 	pSendItem->wRawPort = pNetLink->GetRawPort();
-	pSendItem->pPacket = pPacket;
+	pSendItem->pPacket = pSendPacket;
 	pSendItem->dwPacketSize = dwPacketSize;
 
-	if (pPacket->GetFlag(SAFEUDP_FLAG_SAFE_PACKET) != false && bRetransmit == false) {
-		pNetLink->SetACKWait((MSafePacket*)pPacket, dwPacketSize);
-	}
-
 	LockSend();
 	m_TempSendList.push_back(pSendItem);
 	UnlockSend();
@@ -483,6 +519,28 @@ bool MSocketThread::PushSend(u32 dwIP, int nPort, char* pPacket, u32 dwPacketSiz
 	return false;
 }
 
+bool MSocketThread::PushSend(u32 dwIP, int nPort, std::shared_ptr<const char> pPacket, u32 dwPacketSize)
+{
+	if (SAFEUDP_MAX_SENDQUEUE_LENGTH < m_SendList.size() ||
+		MSocket::in_addr::None == dwIP || !pPacket)
+		return false;
+
+	MSendQueueItem* pSendItem = new MSendQueueItem;
+	pSendItem->dwIP = dwIP;
+	pSendItem->wRawPort = MSocket::htons(nPort);
+	pSendItem->pPacket = (MBasePacket*)pPacket.get();
+	pSendItem->dwPacketSize = dwPacketSize;
+	pSendItem->pSharedPacket = std::move(pPacket);
+
+	LockSend();
+	m_TempSendList.push_back(pSendItem);
+	UnlockSend();
+
+	m_SendEvent.SetEvent();
+
+	return true;
+}
+
 template <typename T>
 bool MSocketThread::SendPacket(const T& DestAddr, const void* Data, size_t DataSize)
 {
@@ -576,7 +634,8 @@ bool MSocketThread::FlushSend()
 				m_SendList.erase(itor);
 			}
 		#else
-			delete pSendItem->pPacket;
+			if (!pSendItem->pSharedPacket)
+				delete pSendItem->pPacket;
 			delete pSendItem;
 			m_SendList.erase(itor);
 		#endif
@@ -587,47 +646,55 @@ bool MSocketThread::FlushSend()
 
 bool MSocketThread::SafeSendManage()
 {
-	int nCnt = m_pSafeUDP->m_NetLinkMap.size();
-	for (NetLinkItor itorLink = m_pSafeUDP->m_NetLinkMap.begin(); itorLink != m_pSafeUDP->m_NetLinkMap.end(); ) {
-		MNetLink* pNetLink = (*itorLink).second;
+	const auto nNow = GetGlobalTimeMS();
 
-		MTime::timeval tvNow;
-		MTime::GetTime(&tvNow);
+	while (auto* pTimer = m_pSafeUDP->PopExpiredTimer(nNow)) {
+		switch (pTimer->nType) {
+		case MSafeUDPTimer::TIMER_RETRANSMIT:
+			OnRetransmitTimer(pTimer->pNetLink, pTimer->pACKWaitItem, nNow);
+			break;
+		case MSafeUDPTimer::TIMER_IDLE:
+			OnIdleTimer(pTimer->pNetLink);
+			break;
+		}
+	}
+	return true;
+}
 
-		// Closed Idle time check
-		auto tvIdleDiff = MTime::TimeSub(tvNow, pNetLink->m_tvLastPacketRecvTime);
-		if ( (pNetLink->GetLinkState() != MNetLink::LINKSTATE_ESTABLISHED) &&
-			 ((tvIdleDiff.tv_sec*1000 + tvIdleDiff.tv_usec) > SAFEUDP_MAX_SAFE_RETRANS_TIME) ) {
-			MTRACE("SUDP> Idle Control Timeout \n");
-			pNetLink->SetLinkState(MNetLink::LINKSTATE_CLOSED);
+void MSocketThread::OnRetransmitTimer(MNetLink* pNetLink, MACKWaitItem* pACKWaitItem, u64 nNow)
+{
+	if (nNow - TimevalToMS(pACKWaitItem->tvFirstSent) > SAFEUDP_MAX_SAFE_RETRANS_TIME) {
+		// Disconnect....
+		MTRACE("SUDP> Retransmit Timeout \n");
+		++m_nRetransmitTimeouts;
+
+		// Give up on the whole link. Closing it arms the idle timer, which deletes it.
+		for (auto* pItem : pNetLink->m_ACKWaitQueue)
+			m_pSafeUDP->CancelTimer(pItem->RetransmitTimer);
+		pNetLink->SetLinkState(MNetLink::LINKSTATE_CLOSED);
+		return;
+	}
 
-			delete (*itorLink).second;
-			m_pSafeUDP->m_NetLinkMap.erase(itorLink++);
-			continue;
-		} else {
-			++itorLink;
-		}
+	PushSend(pNetLink, pACKWaitItem->pPacket.get(), pACKWaitItem->dwPacketSize, true);
+	pACKWaitItem->tvLastSent.tv_sec = i32(nNow / 1000);
+	pACKWaitItem->tvLastSent.tv_usec = i32(nNow % 1000);
+	pACKWaitItem->nSendCount++;
+	++m_nRetransmits;
 
-		for (MNetLink::ACKWaitListItor itorACK = pNetLink->m_ACKWaitQueue.begin(); itorACK != pNetLink->m_ACKWaitQueue.end(); ++itorACK) {
-			MACKWaitItem* pACKWaitItem = *itorACK;
+	m_pSafeUDP->ScheduleTimer(pACKWaitItem->RetransmitTimer, GetNextRetransmitTime(*pACKWaitItem));
+}
 
-			auto tvDiff = MTime::TimeSub(tvNow, pACKWaitItem->tvFirstSent);
-			if ((tvDiff.tv_sec*1000 + tvDiff.tv_usec) > SAFEUDP_MAX_SAFE_RETRANS_TIME) {
-				// Disconnect....
-				MTRACE("SUDP> Retransmit Timeout \n");
-				pNetLink->SetLinkState(MNetLink::LINKSTATE_CLOSED);
-				break;
-			}
+void MSocketThread::OnIdleTimer(MNetLink* pNetLink)
+{
+	// The timer is armed again if the link ever leaves the established state.
+	if (pNetLink->GetLinkState() == MNetLink::LINKSTATE_ESTABLISHED)
+		return;
 
-			tvDiff = MTime::TimeSub(tvNow, pACKWaitItem->tvLastSent);
-			if ((tvDiff.tv_sec*1000 + tvDiff.tv_usec) > SAFEUDP_SAFE_RETRANS_TIME) {
-				PushSend(pNetLink, pACKWaitItem->pPacket.get(), pACKWaitItem->dwPacketSize, true);
-				pACKWaitItem->tvLastSent = tvNow;
-				pACKWaitItem->nSendCount++;
-			}
-		}
-	}
-	return true;
+	MTRACE("SUDP> Idle Control Timeout \n");
+	++m_nIdleTimeouts;
+
+	pNetLink->SetLinkState(MNetLink::LINKSTATE_CLOSED);
+	m_pSafeUDP->CloseNetLink(pNetLink);
 }
 
 bool MSocketThread::Recv()
@@ -836,24 +903,25 @@ bool MSafeUDP::Send(u32 dwIP, int nPort, char* pPacket, u32 dwSize )
 	return m_SocketThread.PushSend( dwIP, nPort, pPacket, dwSize );
 }
 
+bool MSafeUDP::Send(u32 dwIP, int nPort, std::shared_ptr<const char> pPacket, u32 dwSize)
+{
+	return m_SocketThread.PushSend(dwIP, nPort, std::move(pPacket), dwSize);
+}
+
 MNetLink* MSafeUDP::FindNetLink(u32 dwIP, u16 wRawPort)
 {
 	i64 nKey = wRawPort;
 	nKey = nKey << 32;
 	nKey += dwIP;
 
-	NetLinkItor pos = m_NetLinkMap.find(nKey);
-	if (pos != m_NetLinkMap.end())
-		return (*pos).second;
-
-	return NULL;
+	return FindNetLink(nKey);
 }
 
 MNetLink* MSafeUDP::FindNetLink(i64 nMapKey)
 {
-	NetLinkItor pos = m_NetLinkMap.find(nMapKey);
-	if (pos != m_NetLinkMap.end())
-		return (*pos).second;
+	auto* ppNetLink = m_NetLinkMap.find(nMapKey);
+	if (ppNetLink)
+		return *ppNetLink;
 	return NULL;
 }
 
@@ -865,13 +933,15 @@ MNetLink* MSafeUDP::OpenNetLink(char* szIP, int nPort)
 	
 	auto nKey = pNetLink->GetMapKey();
 	
-	auto pos = m_NetLinkMap.find(nKey);
-	if (pos != m_NetLinkMap.end()) {
-		Reconnect((*pos).second);
+	auto* ppExisting = m_NetLinkMap.find(nKey);
+	if (ppExisting) {
+		Reconnect(*ppExisting);
 		delete pNetLink;
-		pNetLink = (*pos).second;
+		pNetLink = *ppExisting;
 	} else {
-		m_NetLinkMap.insert(NetLinkType(nKey, pNetLink));
+		m_NetLinkMap.insert(nKey, pNetLink);
+		ScheduleTimer(pNetLink->m_IdleTimer,
+			TimevalToMS(pNetLink->GetLastPacketRecvTime()) + SAFEUDP_MAX_SAFE_RETRANS_TIME + 1);
 	}
 
 	return pNetLink;
@@ -881,12 +951,12 @@ bool MSafeUDP::CloseNetLink(MNetLink* pNetLink)
 {
 	auto nKey = pNetLink->GetMapKey();
 
-	auto pos = m_NetLinkMap.find(nKey);
-	if (pos == m_NetLinkMap.end())
+	auto* ppNetLink = m_NetLinkMap.find(nKey);
+	if (!ppNetLink)
 		return false;
 
-	delete (*pos).second;
-	m_NetLinkMap.erase(pos);
+	delete *ppNetLink;
+	m_NetLinkMap.erase(nKey);
 
 	return true;
 }
@@ -915,12 +985,49 @@ int MSafeUDP::DisconnectAll()
 {
 	LockNetLink();
 	int nCount = 0;
-	for (NetLinkItor itor = m_NetLinkMap.begin(); itor != m_NetLinkMap.end(); ) {
-		delete (*itor).second;
-		m_NetLinkMap.erase(itor++);
+	for (auto& Entry : m_NetLinkMap) {
+		delete Entry.Value;
 		++nCount;
 	}
+	m_NetLinkMap.clear();
 	UnlockNetLink();
 	return nCount;
 }
 
+MSafeUDPStats MSafeUDP::GetStats()
+{
+	MSafeUDPStats Stats{};
+	Stats.nRetransmits = m_SocketThread.GetRetransmitCount();
+	Stats.nRetransmitTimeouts = m_SocketThread.GetRetransmitTimeoutCount();
+	Stats.nIdleTimeouts = m_SocketThread.GetIdleTimeoutCount();
+
+	{
+		std::lock_guard<MCriticalSection> lock{ m_csTimer };
+		Stats.nScheduledTimers = static_cast<u32>(m_TimerWheel.Size());
+	}
+
+	LockNetLink();
+	Stats.nNetLinks = static_cast<u32>(m_NetLinkMap.size());
+	UnlockNetLink();
+
+	return Stats;
+}
+
+void MSafeUDP::ScheduleTimer(MSafeUDPTimer& Timer, u64 nExpireTime)
+{
+	std::lock_guard<MCriticalSection> lock{ m_csTimer };
+	m_TimerWheel.Schedule(Timer, nExpireTime);
+}
+
+void MSafeUDP::CancelTimer(MSafeUDPTimer& Timer)
+{
+	std::lock_guard<MCriticalSection> lock{ m_csTimer };
+	m_TimerWheel.Cancel(Timer);
+}
+
+MSafeUDPTimer* MSafeUDP::PopExpiredTimer(u64 nNow)
+{
+	std::lock_guard<MCriticalSection> lock{ m_csTimer };
+	return static_cast<MSafeUDPTimer*>(m_TimerWheel.PopExpired(nNow));
+}
+
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cassert>
+
+// Aho-Corasick automaton for finding any of a set of byte strings in a text in one pass.
+//
+// Every pattern is added under a category mask, and lookups only report patterns in the
+// categories they ask for, so that several dictionaries can share one automaton. Add every
+// pattern, then call Build once; Find can be called any number of times after that, and finds
+// nothing before it. Find only reads the automaton and doesn't allocate, so it's safe to call
+// from several threads at once.
+//
+// Transitions are stored sparsely, sorted by byte, with a full table for the root, which is
+// where a scan spends most of its time on text that doesn't match anything.
+class MAhoCorasick
+{
+public:
+	static constexpr u32 NotFound = u32(-1);
+
+	MAhoCorasick() { Clear(); }
+
+	void Clear()
+	{
+		Nodes.clear();
+		Edges.clear();
+		Patterns.clear();
+		Building.clear();
+
+		Nodes.emplace_back();
+		Building.emplace_back();
+		std::fill(std::begin(RootNext), std::end(RootNext), 0);
+		Built = false;
+	}
+
+	// Returns the index of the pattern, which is what Find reports. Adding the same pattern
+	// again adds the categories to the existing one and returns its index.
+	u32 Add(const char* Pattern, size_t Length, u32 Mask)
+	{
+		assert(!Built && Length > 0);
+
+		u32 Cur = 0;
+		for (size_t i = 0; i < Length; ++i)
+		{
+			const auto Byte = u8(Pattern[i]);
+			auto& Children = Building[Cur];
+			auto it = std::find_if(Children.begin(), Children.end(),
+				[&](const Edge& e) { return e.Byte == Byte; });
+			if (it != Children.end())
+			{
+				Cur = it->Target;
+				continue;
+			}
+
+			const auto Next = u32(Nodes.size());
+			Children.push_back({ Byte, Next });
+			Nodes.emplace_back();
+			Building.emplace_back();
+			Cur = Next;
+		}
+
+		auto& Node = Nodes[Cur];
+		if (Node.Pattern == NotFound)
+		{
+			Node.Pattern = u32(Patterns.size());
+			Patterns.emplace_back(Pattern, Length);
+		}
+		Node.OwnMask |= Mask;
+		return Node.Pattern;
+	}
+
+	void Build()
+	{
+		// Flatten the children of every node into one sorted array.
+		Edges.clear();
+		for (u32 i = 0; i < Nodes.size(); ++i)
+		{
+			auto& Children = Building[i];
+			std::sort(Children.begin(), Children.end(),
+				[](const Edge& a, const Edge& b) { return a.Byte < b.Byte; });
+			Nodes[i].FirstEdge = u32(Edges.size());
+			Nodes[i].EdgeCount = u32(Children.size());
+			Edges.insert(Edges.end(), Children.begin(), Children.end());
+		}
+		Building.clear();
+		Building.shrink_to_fit();
+
+		for (u32 i = Nodes[0].FirstEdge; i < Nodes[0].FirstEdge + Nodes[0].EdgeCount; ++i)
+			RootNext[Edges[i].Byte] = Edges[i].Target;
+
+		// Breadth first, so that the failure link of every node's parent is known before
+		// the node itself is reached.
+		std::vector<u32> Queue;
+		Queue.reserve(Nodes.size());
+		Nodes[0].OutMask = Nodes[0].OwnMask;
+		Queue.push_back(0);
+		for (size_t Head = 0; Head < Queue.size(); ++Head)
+		{
+			const auto Parent = Queue[Head];
+			const auto& ParentNode = Nodes[Parent];
+			for (u32 i = ParentNode.FirstEdge; i < ParentNode.FirstEdge + ParentNode.EdgeCount; ++i)
+			{
+				const auto Byte = Edges[i].Byte;
+				const auto Child = Edges[i].Target;
+				auto& ChildNode = Nodes[Child];
+
+				u32 Fail = 0;
+				if (Parent != 0)
+				{
+					auto State = Nodes[Parent].Fail;
+					while (true)
+					{
+						const auto Next = GetChild(State, Byte);
+						if (Next != NotFound)
+						{
+							Fail = Next;
+							break;
+						}
+						if (State == 0)
+							break;
+						State = Nodes[State].Fail;
+					}
+				}
+
+				auto& FailNode = Nodes[Fail];
+				ChildNode.Fail = Fail;
+				ChildNode.DictLink = FailNode.Pattern != NotFound ? Fail : FailNode.DictLink;
+				ChildNode.OutMask = ChildNode.OwnMask | FailNode.OutMask;
+				Queue.push_back(Child);
+			}
+		}
+
+		Built = true;
+	}
+
+	// Returns the index of the first pattern in any of the categories in Mask that ends in Text,
+	// or NotFound. Until Build has been called, nothing is found.
+	u32 Find(const char* Text, size_t Length, u32 Mask) const
+	{
+		if (!Built)
+			return NotFound;
+
+		u32 State = 0;
+		for (size_t i = 0; i < Length; ++i)
+		{
+			const auto Byte = u8(Text[i]);
+			while (true)
+			{
+				if (State == 0)
+				{
+					State = RootNext[Byte];
+					break;
+				}
+
+				const auto Next = GetChild(State, Byte);
+				if (Next != NotFound)
+				{
+					State = Next;
+					break;
+				}
+				State = Nodes[State].Fail;
+			}
+
+			if (Nodes[State].OutMask & Mask)
+			{
+				for (auto Cur = State; Cur != NotFound; Cur = Nodes[Cur].DictLink)
+				{
+					if (Nodes[Cur].OwnMask & Mask)
+						return Nodes[Cur].Pattern;
+				}
+			}
+		}
+
+		return NotFound;
+	}
+	u32 Find(const std::string& Text, u32 Mask) const { return Find(Text.data(), Text.size(), Mask); }
+
+	const std::string& GetPattern(u32 Index) const { return Patterns[Index]; }
+	size_t GetPatternCount() const { return Patterns.size(); }
+
+private:
+	struct Node
+	{
+		u32 Fail = 0;
+		// The nearest node along the failure links that ends a pattern, or NotFound.
+		u32 DictLink = NotFound;
+		// The pattern that ends exactly at this node, or NotFound.
+		u32 Pattern = NotFound;
+		// Categories of the pattern that ends here.
+		u32 OwnMask = 0;
+		// Categories of every pattern that ends here or at any node along the failure links.
+		u32 OutMask = 0;
+		u32 FirstEdge = 0;
+		u32 EdgeCount = 0;
+	};
+
+	struct Edge
+	{
+		u8 Byte;
+		u32 Target;
+	};
+
+	u32 GetChild(u32 State, u8 Byte) const
+	{
+		auto& Node = Nodes[State];
+		auto Begin = Edges.data() + Node.FirstEdge;
+		auto End = Begin + Node.EdgeCount;
+		auto it = std::lower_bound(Begin, End, Byte,
+			[](const Edge& e, u8 b) { return e.Byte < b; });
+		if (it == End || it->Byte != Byte)
+			return NotFound;
+		return it->Target;
+	}
+
+	std::vector<Node> Nodes;
+	std::vector<Edge> Edges;
+	std::vector<std::string> Patterns;
+	u32 RootNext[256];
+	// Children of every node, only kept between Clear and Build.
+	std::vector<std::vector<Edge>> Building;
+	bool Built;
+};
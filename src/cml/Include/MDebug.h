@@ -17,7 +17,14 @@
 
 bool IsLogAvailable();
 
+struct MLogOptions;
+
+// With MLOGSTYLE_FILE, the file is written from a thread of its own, see MLogWriter.
 void InitLog(int logmethodflags = MLOGSTYLE_DEBUGSTRING, const char* pszLogFileName = "mlog.txt");
+void InitLog(int logmethodflags, const char* pszLogFileName, const MLogOptions& Options);
+void SetLogOptions(const MLogOptions& Options);
+// Waits until everything logged so far is in the log file.
+void MFlushLog();
 
 #if defined(_DEBUG) || defined(DEBUG_FAST)
 void DMLog(const char* Format, ...);
@@ -74,6 +74,24 @@ struct PathHasher {
 	}
 };
 
+// Mixes all the bits of an integer key, for open addressing tables where std::hash's
+// identity hash would put keys that only differ in their high bits in neighbouring slots.
+inline u64 HashMix64(u64 x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
+
+struct IntegerHasher {
+	template <typename T>
+	size_t operator()(T Value) const {
+		return static_cast<size_t>(HashMix64(static_cast<u64>(Value)));
+	}
+};
+
 struct PathComparer {
 	bool operator()(StringView lhs, StringView rhs) const {
 		return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include "RingBuffer.h"
+#include "MFile.h"
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+
+// What MLogWriter::Write does when the writer thread has fallen so far behind that the queue is full.
+enum class MLogOverflow
+{
+	// Waits for the writer to make room, so that nothing is lost.
+	Block,
+	// Throws the line away, and has the writer note how many were lost in the file.
+	Drop,
+};
+
+struct MLogOptions
+{
+	MLogOverflow Overflow = MLogOverflow::Block;
+	// Once the file is this big, it's moved aside and a new one is started. 0 to never do that.
+	u64 RotateSize = 0;
+	// Whether to move the file aside and start a new one when the date changes.
+	bool RotateDaily = false;
+	// Whatever has been written goes to the file when this much is waiting or this many
+	// milliseconds have passed since the last time, whichever comes first.
+	size_t FlushSize = 64 * 1024;
+	u32 FlushInterval = 1000;
+};
+
+// Writes log lines to a file from a thread of its own, so that the threads that log never wait on
+// the disk.
+//
+// Write copies the line into a lock-free queue, and the writer thread drains it into the file,
+// which it keeps open. Lines from different threads are never interleaved with each other, and
+// lines from the same thread stay in order. Files that are moved aside by rotation get the date
+// the file was started on appended to their name.
+class MLogWriter
+{
+public:
+	~MLogWriter() { Destroy(); }
+
+	// Truncates the file at Path and starts the writer thread.
+	bool Create(const char* Path, const MLogOptions& Options = {});
+	// Writes out everything that's still queued and closes the file.
+	void Destroy();
+
+	bool IsCreated() const { return Thread.joinable(); }
+
+	void SetOptions(const MLogOptions& Options);
+
+	// Thread safe. Doesn't lock unless the queue is full and the overflow policy is Block.
+	void Write(const char* Text, size_t Length);
+	// Waits until everything written before the call is in the file, for up to Timeout
+	// milliseconds. Returns false if it ran out of time.
+	bool Flush(u32 Timeout = 5000);
+
+	u64 GetDroppedCount() const { return Dropped.load(std::memory_order_relaxed); }
+
+	static constexpr size_t QueueSize = 4096;
+
+private:
+	void ThreadProc();
+	MLogOptions GetOptions();
+	void WritePending(const MLogOptions& Options);
+	bool Open(bool Truncate);
+	void Rotate();
+
+	MPSCRingBuffer<std::string, QueueSize> Queue;
+	std::thread Thread;
+	std::atomic<bool> Stopping{ false };
+	std::atomic<bool> FlushRequested{ false };
+	// The number of queued lines that have made it to the file.
+	std::atomic<size_t> WrittenCount{ 0 };
+	std::atomic<u64> Dropped{ 0 };
+	std::atomic<MLogOverflow> Overflow{ MLogOverflow::Block };
+
+	std::mutex OptionsMutex;
+	MLogOptions Options;
+
+	// Only touched by the writer thread, after Create.
+	std::string Path;
+	MFile::RWFile File;
+	u64 FileSize = 0;
+	std::string FileDate;
+	std::string Pending;
+	u64 ReportedDropped = 0;
+};
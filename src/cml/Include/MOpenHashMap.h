@@ -0,0 +1,195 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include "MHash.h"
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <functional>
+
+// Open addressing hash map with linear probing and backward shift deletion.
+//
+// All entries live in one flat array, so lookups touch one or two cache lines instead of
+// chasing tree or bucket nodes. Keys and values are moved around on insertion, erasure and
+// rehashing, so pointers to values are invalidated by any of those, and so are iterators.
+// The default hasher mixes integer keys; pass another hasher for other key types.
+template <typename KeyType, typename ValueType,
+	typename HasherType = IntegerHasher,
+	typename KeyEqualType = std::equal_to<KeyType>>
+class MOpenHashMap
+{
+public:
+	// Iteration yields entries; only Value may be modified through them.
+	struct Entry
+	{
+		KeyType Key{};
+		ValueType Value{};
+		bool Used{};
+	};
+
+	template <typename EntryType>
+	class basic_iterator
+	{
+	public:
+		basic_iterator(EntryType* Cur, EntryType* End) : Cur{ Cur }, End{ End } { SkipEmpty(); }
+
+		EntryType& operator*() const { return *Cur; }
+		EntryType* operator->() const { return Cur; }
+		basic_iterator& operator++() { ++Cur; SkipEmpty(); return *this; }
+		bool operator==(const basic_iterator& rhs) const { return Cur == rhs.Cur; }
+		bool operator!=(const basic_iterator& rhs) const { return Cur != rhs.Cur; }
+
+	private:
+		void SkipEmpty() { while (Cur != End && !Cur->Used) ++Cur; }
+
+		EntryType* Cur;
+		EntryType* End;
+	};
+
+	using iterator = basic_iterator<Entry>;
+	using const_iterator = basic_iterator<const Entry>;
+
+	MOpenHashMap() = default;
+	explicit MOpenHashMap(size_t ExpectedSize) { reserve(ExpectedSize); }
+
+	// Returns nullptr if Key isn't in the map.
+	ValueType* find(const KeyType& Key)
+	{
+		auto Index = FindIndex(Key);
+		return Index == NotFound ? nullptr : &Slots[Index].Value;
+	}
+	const ValueType* find(const KeyType& Key) const
+	{
+		auto Index = FindIndex(Key);
+		return Index == NotFound ? nullptr : &Slots[Index].Value;
+	}
+
+	// Inserts Value unless Key is already in the map. Returns a pointer to the value stored
+	// under Key and whether the insertion took place, like std::map::insert.
+	template <typename T>
+	std::pair<ValueType*, bool> insert(const KeyType& Key, T&& Value)
+	{
+		if ((Count + 1) * MaxLoadDen > Slots.size() * MaxLoadNum)
+			Rehash((std::max)(Slots.size() * 2, size_t(MinCapacity)));
+
+		auto Mask = Slots.size() - 1;
+		for (auto Index = Hash(Key) & Mask;; Index = (Index + 1) & Mask)
+		{
+			auto& Cur = Slots[Index];
+			if (!Cur.Used)
+			{
+				Cur.Key = Key;
+				Cur.Value = std::forward<T>(Value);
+				Cur.Used = true;
+				++Count;
+				return{ &Cur.Value, true };
+			}
+			if (KeyEqual(Cur.Key, Key))
+				return{ &Cur.Value, false };
+		}
+	}
+
+	// Returns false if Key wasn't in the map.
+	bool erase(const KeyType& Key)
+	{
+		auto Index = FindIndex(Key);
+		if (Index == NotFound)
+			return false;
+
+		// Shift the following entries of the probe sequence back into the hole, so that no
+		// tombstones are needed and lookups never get slower after erasures.
+		auto Mask = Slots.size() - 1;
+		auto Hole = Index;
+		for (auto Next = (Hole + 1) & Mask; Slots[Next].Used; Next = (Next + 1) & Mask)
+		{
+			auto Ideal = Hash(Slots[Next].Key) & Mask;
+			// Move the entry if its ideal slot isn't cyclically in (Hole, Next].
+			if (((Next - Ideal) & Mask) >= ((Next - Hole) & Mask))
+			{
+				Slots[Hole].Key = std::move(Slots[Next].Key);
+				Slots[Hole].Value = std::move(Slots[Next].Value);
+				Hole = Next;
+			}
+		}
+
+		Slots[Hole] = Entry{};
+		--Count;
+		return true;
+	}
+
+	void clear()
+	{
+		for (auto& Cur : Slots)
+			Cur = Entry{};
+		Count = 0;
+	}
+
+	void reserve(size_t Size)
+	{
+		size_t Capacity = MinCapacity;
+		while (Size * MaxLoadDen > Capacity * MaxLoadNum)
+			Capacity *= 2;
+		if (Capacity > Slots.size())
+			Rehash(Capacity);
+	}
+
+	size_t size() const { return Count; }
+	bool empty() const { return Count == 0; }
+	size_t capacity() const { return Slots.size(); }
+
+	iterator begin() { return{ Slots.data(), Slots.data() + Slots.size() }; }
+	iterator end() { return{ Slots.data() + Slots.size(), Slots.data() + Slots.size() }; }
+	const_iterator begin() const { return{ Slots.data(), Slots.data() + Slots.size() }; }
+	const_iterator end() const { return{ Slots.data() + Slots.size(), Slots.data() + Slots.size() }; }
+
+private:
+	static constexpr size_t NotFound = size_t(-1);
+	static constexpr size_t MinCapacity = 16;
+	// Grow when more than 7/10 of the slots are in use.
+	static constexpr size_t MaxLoadNum = 7;
+	static constexpr size_t MaxLoadDen = 10;
+
+	size_t Hash(const KeyType& Key) const { return Hasher(Key); }
+
+	size_t FindIndex(const KeyType& Key) const
+	{
+		if (Count == 0)
+			return NotFound;
+
+		auto Mask = Slots.size() - 1;
+		for (auto Index = Hash(Key) & Mask;; Index = (Index + 1) & Mask)
+		{
+			auto& Cur = Slots[Index];
+			if (!Cur.Used)
+				return NotFound;
+			if (KeyEqual(Cur.Key, Key))
+				return Index;
+		}
+	}
+
+	void Rehash(size_t NewCapacity)
+	{
+		std::vector<Entry> Old(NewCapacity);
+		Old.swap(Slots);
+
+		auto Mask = Slots.size() - 1;
+		for (auto& Cur : Old)
+		{
+			if (!Cur.Used)
+				continue;
+
+			auto Index = Hash(Cur.Key) & Mask;
+			while (Slots[Index].Used)
+				Index = (Index + 1) & Mask;
+
+			Slots[Index].Key = std::move(Cur.Key);
+			Slots[Index].Value = std::move(Cur.Value);
+			Slots[Index].Used = true;
+		}
+	}
+
+	std::vector<Entry> Slots;
+	size_t Count{};
+	HasherType Hasher;
+	KeyEqualType KeyEqual;
+};
@@ -0,0 +1,318 @@
+#pragma once
+
+#include "GlobalTypes.h"
+
+// Intrusive hook for MTimerWheel. Embed (or derive from) this in whatever owns the timer;
+// the wheel never allocates or frees nodes.
+struct MTimerWheelNode
+{
+	MTimerWheelNode() = default;
+	MTimerWheelNode(const MTimerWheelNode&) = delete;
+	MTimerWheelNode& operator=(const MTimerWheelNode&) = delete;
+
+	bool IsScheduled() const { return Next != nullptr; }
+	u64 GetExpireTick() const { return Expire; }
+
+	MTimerWheelNode* Prev{};
+	MTimerWheelNode* Next{};
+	u64 Expire{};
+	// Which level of the wheel the node is filed in, or -1 if it's in the expired list.
+	int Level{};
+};
+
+// Hierarchical timer wheel (see Varghese & Lauck, "Hashed and Hierarchical Timing Wheels").
+//
+// Time is measured in abstract ticks chosen by the owner, e.g. milliseconds from
+// GetGlobalTimeMS(). Scheduling and cancelling are O(1), and Advance only touches
+// slots that come due, plus an occasional cascade of one slot from a coarser level.
+// Stretches of time where the lower levels are empty are skipped over instead of being
+// walked one tick at a time.
+//
+// Level 0 has 256 slots of one tick each, and the three levels above it have 64 slots
+// each, so timers up to 2^26 ticks away are stored exactly. Anything further than that
+// is clamped into the last level and re-filed whenever it is cascaded down.
+//
+// The wheel is not thread-safe; callers are expected to guard it with whatever lock
+// already protects the objects that own the nodes.
+class MTimerWheel
+{
+public:
+	MTimerWheel(u64 StartTick = 0) : NextTick{ StartTick }
+	{
+		InitList(Expired);
+		for (auto& Slot : Root)
+			InitList(Slot);
+		for (auto& Level : Vec)
+			for (auto& Slot : Level)
+				InitList(Slot);
+	}
+	MTimerWheel(const MTimerWheel&) = delete;
+	MTimerWheel& operator=(const MTimerWheel&) = delete;
+	~MTimerWheel() { Clear(); }
+
+	// Schedules Node to fire on the first Advance whose Now is >= ExpireTick.
+	// A node that is already scheduled is moved to the new time.
+	// If ExpireTick is before GetNextTick(), that tick has been processed already, and the node
+	// fires with GetNextTick() instead, so that a handler that reschedules its own node for Now
+	// doesn't get it back in the same Advance.
+	void Schedule(MTimerWheelNode& Node, u64 ExpireTick)
+	{
+		if (Node.IsScheduled())
+			Cancel(Node);
+
+		Node.Expire = ExpireTick;
+		Add(Node);
+		++Count;
+	}
+
+	// Returns false if the node wasn't scheduled.
+	bool Cancel(MTimerWheelNode& Node)
+	{
+		if (!Node.IsScheduled())
+			return false;
+
+		Remove(Node);
+		--Count;
+		return true;
+	}
+
+	// Removes and returns one node whose expire tick is <= Now, or nullptr if there are none.
+	// Nodes are handed out one at a time so that the caller can drop any locks around the
+	// handling of each, and so that nodes cancelled by an earlier handler are never returned.
+	MTimerWheelNode* PopExpired(u64 Now)
+	{
+		while (Expired.Next == &Expired)
+		{
+			if (Count == 0)
+			{
+				// Nothing to expire, so there's no point in walking the empty slots.
+				if (Now >= NextTick)
+					NextTick = Now + 1;
+				return nullptr;
+			}
+
+			if (NextTick > Now)
+				return nullptr;
+
+			// If the lowest levels are empty, nothing can happen before the next tick at which
+			// the lowest non-empty level is cascaded, so jump straight to it.
+			int Lowest = 0;
+			while (LevelCount[Lowest] == 0)
+				++Lowest;
+			if (Lowest > 0)
+			{
+				const auto Granularity = u64(1) << (RootBits + (Lowest - 1) * VecBits);
+				const auto Boundary = (NextTick + Granularity - 1) & ~(Granularity - 1);
+				if (Boundary > Now)
+				{
+					NextTick = Now + 1;
+					return nullptr;
+				}
+				NextTick = Boundary;
+			}
+
+			const auto Index = NextTick & RootMask;
+			if (Index == 0 &&
+				Cascade(0, VecIndex(0)) == 0 &&
+				Cascade(1, VecIndex(1)) == 0)
+			{
+				Cascade(2, VecIndex(2));
+			}
+
+			++NextTick;
+
+			for (auto* Node = Root[Index].Next; Node != &Root[Index]; Node = Node->Next)
+			{
+				Node->Level = -1;
+				--LevelCount[0];
+			}
+			SpliceAll(Root[Index], Expired);
+		}
+
+		auto& Node = *Expired.Next;
+		Remove(Node);
+		--Count;
+		return &Node;
+	}
+
+	// Calls OnExpire(MTimerWheelNode&) for every node whose expire tick is <= Now.
+	// The node is unscheduled before the callback runs, so the callback is free to reschedule
+	// it, or to cancel or schedule any other node.
+	template <typename FnType>
+	void Advance(u64 Now, FnType&& OnExpire)
+	{
+		while (auto* Node = PopExpired(Now))
+			OnExpire(*Node);
+	}
+
+	// Unschedules every node without firing it.
+	void Clear()
+	{
+		auto ClearList = [&](MTimerWheelNode& Head) {
+			while (Head.Next != &Head)
+				Unlink(*Head.Next);
+		};
+
+		ClearList(Expired);
+		for (auto& Slot : Root)
+			ClearList(Slot);
+		for (auto& Level : Vec)
+			for (auto& Slot : Level)
+				ClearList(Slot);
+
+		Count = 0;
+		// Leaves the sentinel at the end alone.
+		for (int Level = 0; Level <= NumVecs; ++Level)
+			LevelCount[Level] = 0;
+	}
+
+	// Unschedules every node and starts over at StartTick, which may be earlier than the
+	// current tick, e.g. after the clock the ticks come from was set back.
+	void Reset(u64 StartTick)
+	{
+		Clear();
+		NextTick = StartTick;
+	}
+
+	// Number of nodes currently scheduled.
+	size_t Size() const { return Count; }
+	bool Empty() const { return Count == 0; }
+
+	// The next tick that Advance will process.
+	u64 GetNextTick() const { return NextTick; }
+
+private:
+	static constexpr int RootBits = 8;
+	static constexpr int VecBits = 6;
+	static constexpr int NumVecs = 3;
+	static constexpr u64 RootSize = u64(1) << RootBits;
+	static constexpr u64 VecSize = u64(1) << VecBits;
+	static constexpr u64 RootMask = RootSize - 1;
+	static constexpr u64 VecMask = VecSize - 1;
+	static constexpr u64 MaxInterval = (u64(1) << (RootBits + NumVecs * VecBits)) - 1;
+
+	static void InitList(MTimerWheelNode& Head)
+	{
+		Head.Prev = &Head;
+		Head.Next = &Head;
+	}
+
+	static void LinkTail(MTimerWheelNode& Head, MTimerWheelNode& Node)
+	{
+		Node.Prev = Head.Prev;
+		Node.Next = &Head;
+		Head.Prev->Next = &Node;
+		Head.Prev = &Node;
+	}
+
+	static void Unlink(MTimerWheelNode& Node)
+	{
+		Node.Prev->Next = Node.Next;
+		Node.Next->Prev = Node.Prev;
+		Node.Prev = nullptr;
+		Node.Next = nullptr;
+	}
+
+	static size_t CountList(const MTimerWheelNode& Head)
+	{
+		size_t Size = 0;
+		for (auto* Node = Head.Next; Node != &Head; Node = Node->Next)
+			++Size;
+		return Size;
+	}
+
+	static void SpliceAll(MTimerWheelNode& From, MTimerWheelNode& To)
+	{
+		if (From.Next == &From)
+			return;
+
+		From.Next->Prev = To.Prev;
+		To.Prev->Next = From.Next;
+		From.Prev->Next = &To;
+		To.Prev = From.Prev;
+		InitList(From);
+	}
+
+	void Link(int Level, MTimerWheelNode& Head, MTimerWheelNode& Node)
+	{
+		Node.Level = Level;
+		++LevelCount[Level];
+		LinkTail(Head, Node);
+	}
+
+	void Remove(MTimerWheelNode& Node)
+	{
+		if (Node.Level >= 0)
+			--LevelCount[Node.Level];
+		Unlink(Node);
+	}
+
+	u64 VecIndex(int Level) const
+	{
+		return (NextTick >> (RootBits + Level * VecBits)) & VecMask;
+	}
+
+	void Add(MTimerWheelNode& Node)
+	{
+		auto Expire = Node.Expire;
+
+		// Already due: fire on the next processed tick.
+		if (Expire < NextTick)
+		{
+			Link(0, Root[NextTick & RootMask], Node);
+			return;
+		}
+
+		auto Interval = Expire - NextTick;
+		if (Interval < RootSize)
+		{
+			Link(0, Root[Expire & RootMask], Node);
+			return;
+		}
+
+		if (Interval > MaxInterval)
+		{
+			Interval = MaxInterval;
+			Expire = NextTick + Interval;
+		}
+
+		for (int Level = 0; Level < NumVecs; ++Level)
+		{
+			const auto Shift = RootBits + Level * VecBits;
+			if (Level == NumVecs - 1 || Interval < (u64(1) << (Shift + VecBits)))
+			{
+				Link(Level + 1, Vec[Level][(Expire >> Shift) & VecMask], Node);
+				return;
+			}
+		}
+	}
+
+	// Moves every node in Vec[Level][Index] down to wherever it belongs now.
+	// Returns Index so that the caller can tell whether the next level needs to cascade too.
+	u64 Cascade(int Level, u64 Index)
+	{
+		MTimerWheelNode List;
+		InitList(List);
+		LevelCount[Level + 1] -= CountList(Vec[Level][Index]);
+		SpliceAll(Vec[Level][Index], List);
+
+		while (List.Next != &List)
+		{
+			auto& Node = *List.Next;
+			Unlink(Node);
+			Add(Node);
+		}
+
+		return Index;
+	}
+
+	// Nodes whose tick has been processed but that haven't been handed out by PopExpired yet.
+	MTimerWheelNode Expired;
+	MTimerWheelNode Root[RootSize];
+	MTimerWheelNode Vec[NumVecs][VecSize];
+	u64 NextTick;
+	size_t Count{};
+	// Number of nodes filed in Root and in each Vec. The extra element is never zero so that
+	// the search for the lowest non-empty level always terminates.
+	size_t LevelCount[NumVecs + 2]{ 0, 0, 0, 0, 1 };
+};
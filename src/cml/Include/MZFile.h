@@ -37,6 +37,13 @@ public:
 		return Read(&dest, sizeof(dest));
 	}
 
+	// Returns the whole file. Unlike the buffer from Release, this may point straight into
+	// the mapped archive or the file system's inflated file cache, so it must not be written
+	// to, isn't necessarily null terminated, and is only valid until the file is closed.
+	const char* GetData();
+
+	// Returns the whole file, followed by a null terminator, in a buffer that the caller
+	// may modify.
 	DataPtr Release();
 
 	static void SetReadMode(u32 mode) { ReadMode = mode; }
@@ -51,10 +58,17 @@ protected:
 		Data = DataPtr{ ptr, MaybeArrayDeleter{ShouldDelete} }; }
 	void SetData(nullptr_t) {
 		SetData(nullptr, false); }
+	// Points Data at memory that this MZFile doesn't own and must not write to.
+	void SetSharedData(const char* ptr) {
+		SetData(const_cast<char*>(ptr), false); }
+	bool OwnsData() const { return Data.get_deleter().ShouldDelete; }
 
 	CFilePtr fp;
 	DataPtr Data{ (char*)nullptr, MaybeArrayDeleter{false} };
+	// Keeps an inflated file from the file system's cache alive while Data points into it.
+	std::shared_ptr<const char> SharedData;
 	const MZFileDesc* Desc{};
+	MZFileSystem* FS{};
 
 	i64 Pos{};
 	size_t FileSize{};
@@ -4,6 +4,10 @@
 #include <unordered_map>
 #include <string>
 #include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
 #include "MZip.h"
 #include "MUtil.h"
 #include "StringView.h"
@@ -85,6 +89,7 @@ private:
 
 struct PreprocessedDir;
 struct PreprocessedFileTree;
+class MMappedFile;
 
 class MZFileSystem
 {
@@ -106,9 +111,28 @@ public:
 	int GetFileLength(const StringView& szFileName);
 	int GetFileLength(int i);
 
+	// Inflates the compressed files in the archive Filename (relative to the base path, without
+	// the extension) into the inflated file cache, as far as the cache size allows.
 	void CacheArchive(const StringView& Filename);
+	// Empties the inflated file cache. Files that are still open keep their data.
 	void ReleaseCachedArchives();
 
+	// Sets how many bytes of inflated archive files are kept around for the next MZFile::Open
+	// of the same file. The default is 64 MiB. Zero disables the cache.
+	void SetInflatedFileCacheSize(size_t Size);
+
+	// These are safe to call from any thread.
+
+	// Returns the data of Desc in the archive it's in, as stored there, or nullptr if Desc isn't
+	// in an archive, the archive couldn't be mapped, or the data doesn't fit inside it. Archives
+	// are mapped into memory on first use and stay mapped until the file system is destroyed.
+	const char* GetArchiveData(const MZFileDesc& Desc);
+
+	// Returns the inflated contents of a compressed archive file, with a null terminator
+	// after the last byte, or nullptr on failure. Recently used files are shared from a
+	// cache instead of being inflated again.
+	std::shared_ptr<const char> GetInflatedFile(const MZFileDesc& Desc);
+
 protected:
 	friend class MZFile;
 
@@ -130,7 +154,22 @@ protected:
 
 	std::vector<std::unique_ptr<char[]>> Strings;
 
-	std::unordered_map<const MZFileDesc*, std::unique_ptr<char[]>> CachedFileMap;
+	// Keyed by MZFileDesc::ArchivePath.data(), which every file in an archive shares.
+	std::mutex ArchiveMutex;
+	std::unordered_map<const char*, std::unique_ptr<MMappedFile>> Archives;
+
+	// Least recently used list of inflated files. The front is the most recently used.
+	struct InflatedFile
+	{
+		const MZFileDesc* Desc;
+		std::shared_ptr<const char> Data;
+	};
+	using InflatedFileList = std::list<InflatedFile>;
+	std::mutex InflatedFileMutex;
+	InflatedFileList InflatedFiles;
+	std::unordered_map<const MZFileDesc*, InflatedFileList::iterator> InflatedFileMap;
+	size_t InflatedFileCacheBytes{};
+	size_t MaxInflatedFileCacheBytes = 64 * 1024 * 1024;
 };
 
 #include "MZFile.h"
@@ -6,6 +6,8 @@
 #include <cstddef>
 #include <utility>
 #include <algorithm>
+#include <atomic>
+#include <memory>
 #include "GlobalTypes.h"
 
 // Use the lowest of u8, u16, and u32 that support the size
@@ -168,4 +170,87 @@ private:
 template <typename T, size_t N>
 T& RingIterator<T, N>::operator*() { return Ring[Offset]; }
 template <typename T, size_t N>
-const T& RingIterator<T, N>::operator*() const { return Ring[Offset]; }
\ No newline at end of file
+const T& RingIterator<T, N>::operator*() const { return Ring[Offset]; }
+
+// A bounded queue that any number of threads can push to at once without locking, and one thread
+// pops from. N must be a power of two.
+//
+// Every slot has a sequence number that says whether it's free for the push with a given ticket or
+// holds the value for the pop with a given ticket, so a push only has to win the write cursor with
+// one compare-exchange, and the pop never touches it. The values are assigned in place, so a slot
+// that holds something like a std::string keeps its storage for the next push.
+template <typename T, size_t N>
+class MPSCRingBuffer
+{
+	static_assert(N != 0 && (N & (N - 1)) == 0, "N must be a power of two");
+
+public:
+	MPSCRingBuffer()
+	{
+		for (size_t i = 0; i < N; ++i)
+			Slots[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+	MPSCRingBuffer(const MPSCRingBuffer&) = delete;
+	MPSCRingBuffer& operator=(const MPSCRingBuffer&) = delete;
+
+	// Calls Fill(T&) on the slot it gets. Returns false without calling it if the buffer is full.
+	template <typename FuncT>
+	bool try_push(FuncT&& Fill)
+	{
+		auto Pos = WritePos.load(std::memory_order_relaxed);
+		Slot* S;
+		while (true)
+		{
+			S = &Slots[Pos & (N - 1)];
+			auto Seq = S->Sequence.load(std::memory_order_acquire);
+			auto Diff = std::ptrdiff_t(Seq - Pos);
+			if (Diff == 0)
+			{
+				if (WritePos.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (Diff < 0)
+				return false;
+			else
+				Pos = WritePos.load(std::memory_order_relaxed);
+		}
+
+		Fill(S->Value);
+		S->Sequence.store(Pos + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Only for the consumer thread. Calls Consume(T&) on the oldest value and frees its slot, or
+	// returns false if there's nothing to pop. A value whose push hasn't finished yet holds up the
+	// ones after it.
+	template <typename FuncT>
+	bool try_pop(FuncT&& Consume)
+	{
+		auto& S = Slots[ReadPos & (N - 1)];
+		if (S.Sequence.load(std::memory_order_acquire) != ReadPos + 1)
+			return false;
+
+		Consume(S.Value);
+		S.Sequence.store(ReadPos + N, std::memory_order_release);
+		++ReadPos;
+		return true;
+	}
+
+	// The number of pushes that have got a slot so far, whether or not they've finished.
+	size_t push_count() const { return WritePos.load(std::memory_order_acquire); }
+	// Only for the consumer thread.
+	size_t pop_count() const { return ReadPos; }
+
+	constexpr auto max_size() const { return N; }
+
+private:
+	struct Slot
+	{
+		std::atomic<size_t> Sequence;
+		T Value;
+	};
+
+	std::unique_ptr<Slot[]> Slots{ new Slot[N] };
+	alignas(64) std::atomic<size_t> WritePos{ 0 };
+	alignas(64) size_t ReadPos = 0;
+};
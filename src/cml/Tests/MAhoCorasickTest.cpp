@@ -0,0 +1,148 @@
+#include "stdafx.h"
+#include "MAhoCorasick.h"
+#include "MTest.h"
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// Checks MAhoCorasick against searching for every word on its own, with a word list the size
+// of a large chat filter, and times both on chat-sized messages.
+
+namespace {
+
+struct Word
+{
+	std::string Text;
+	u32 Mask;
+};
+
+// Returns where the first match of any word in Mask ends in Text, or npos.
+size_t FindFirstEndNaive(const std::vector<Word>& Words, const std::string& Text, u32 Mask)
+{
+	auto Best = std::string::npos;
+	for (auto& Word : Words)
+	{
+		if (!(Word.Mask & Mask))
+			continue;
+		const auto Pos = Text.find(Word.Text);
+		if (Pos != std::string::npos)
+			Best = (std::min)(Best, Pos + Word.Text.size());
+	}
+	return Best;
+}
+
+void TestBasics()
+{
+	MAhoCorasick Empty;
+	MTEST_CHECK(Empty.Find("anything", 1) == MAhoCorasick::NotFound);
+
+	// Nothing is found until the automaton is built.
+	MAhoCorasick Words;
+	const auto He = Words.Add("he", 2, 1);
+	MTEST_CHECK(Words.Find("he", 1) == MAhoCorasick::NotFound);
+	const auto She = Words.Add("she", 3, 2);
+	const auto Hers = Words.Add("hers", 4, 1);
+	MTEST_CHECK(Words.Add("he", 2, 2) == He);
+	Words.Build();
+
+	MTEST_CHECK(Words.GetPatternCount() == 3);
+	MTEST_CHECK(Words.Find("ushers", 1) == He);
+	MTEST_CHECK(Words.Find("ushers", 2) == She);
+	MTEST_CHECK(Words.Find("xhers", 2) == He);
+	MTEST_CHECK(Words.Find("hershey", 4) == MAhoCorasick::NotFound);
+	MTEST_CHECK(Words.Find("", 3) == MAhoCorasick::NotFound);
+	MTEST_CHECK(Words.GetPattern(Hers) == "hers");
+
+	// Clearing goes back to finding nothing.
+	Words.Clear();
+	MTEST_CHECK(Words.Find("ushers", 3) == MAhoCorasick::NotFound);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int WordCount = argc > 1 ? atoi(argv[1]) : 10000;
+	const int MessageCount = argc > 2 ? atoi(argv[2]) : 2000;
+
+	TestBasics();
+
+	std::mt19937 Rng{ 2468 };
+	// A small alphabet, so that words share prefixes and occur in the messages by chance.
+	const char Alphabet[] = "abcdefghijklmnop";
+	auto RandomString = [&](size_t Length) {
+		std::string Str(Length, ' ');
+		for (auto& c : Str)
+			c = Alphabet[Rng() % (sizeof(Alphabet) - 1)];
+		return Str;
+	};
+
+	std::vector<Word> Words;
+	Words.reserve(WordCount);
+	MAhoCorasick Automaton;
+	for (int i = 0; i < WordCount; ++i)
+	{
+		Word NewWord{ RandomString(4 + Rng() % 5), 1u << (Rng() % 2) };
+		Automaton.Add(NewWord.Text.data(), NewWord.Text.size(), NewWord.Mask);
+		Words.push_back(std::move(NewWord));
+	}
+	const auto BuildTime = MTestTimeMS([&] { Automaton.Build(); });
+
+	std::vector<std::string> Messages;
+	Messages.reserve(MessageCount);
+	for (int i = 0; i < MessageCount; ++i)
+	{
+		auto Message = RandomString(20 + Rng() % 60);
+		// Plant a word in every other message.
+		if (i % 2)
+		{
+			auto& Planted = Words[Rng() % Words.size()].Text;
+			Message.insert(Rng() % (Message.size() + 1), Planted);
+		}
+		Messages.push_back(std::move(Message));
+	}
+
+	std::vector<size_t> Expected(Messages.size());
+	std::vector<u32> Actual(Messages.size());
+	const u32 Mask = 1;
+	const auto NaiveTime = MTestTimeMS([&] {
+		for (size_t i = 0; i < Messages.size(); ++i)
+			Expected[i] = FindFirstEndNaive(Words, Messages[i], Mask);
+	});
+	const auto AutomatonTime = MTestTimeMS([&] {
+		for (size_t i = 0; i < Messages.size(); ++i)
+			Actual[i] = Automaton.Find(Messages[i], Mask);
+	});
+
+	int Mismatches = 0, Found = 0;
+	for (size_t i = 0; i < Messages.size(); ++i)
+	{
+		auto& Message = Messages[i];
+		if (Expected[i] == std::string::npos)
+		{
+			Mismatches += Actual[i] != MAhoCorasick::NotFound;
+			continue;
+		}
+
+		++Found;
+		// Any word that ends where the first match ends will do.
+		if (Actual[i] == MAhoCorasick::NotFound)
+		{
+			++Mismatches;
+			continue;
+		}
+		auto& Pattern = Automaton.GetPattern(Actual[i]);
+		Mismatches += Pattern.size() > Expected[i] ||
+			Message.compare(Expected[i] - Pattern.size(), Pattern.size(), Pattern) != 0;
+	}
+	MTEST_CHECK(Mismatches == 0);
+	MTEST_CHECK(Found > 0 && Found < MessageCount);
+
+	std::printf("%d words, %d messages, %d with a match, %d mismatches\n",
+		WordCount, MessageCount, Found, Mismatches);
+	std::printf("Build: %.1f ms\n", BuildTime);
+	std::printf("Each word on its own: %.1f ms, automaton: %.1f ms\n", NaiveTime, AutomatonTime);
+
+	return MTestResult();
+}
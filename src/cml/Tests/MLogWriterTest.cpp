@@ -0,0 +1,279 @@
+#include "stdafx.h"
+#include "MLogWriter.h"
+#include "MDebug.h"
+#include "MFile.h"
+#include "MUtil.h"
+#include "MTest.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Has several threads log numbered lines through MLogWriter and checks that every line makes it
+// to the file whole, with each thread's lines in order, with either overflow policy and with
+// rotation. Times it against opening the file for every line, which is what MLog did before.
+// Also checks that MLog still works from static destructors once InitLog has been called, by
+// running itself with --exit-child.
+
+namespace {
+
+const char LogPath[] = "MLogWriterTest.log";
+
+std::vector<std::string> ReadLines(const char* Path)
+{
+	std::vector<std::string> Lines;
+	std::ifstream File{ Path };
+	std::string Line;
+	while (std::getline(File, Line))
+		Lines.push_back(Line);
+	return Lines;
+}
+
+void FormatLine(char (&Buffer)[128], int Thread, int Index)
+{
+	// Long enough that a torn write would be likely to show.
+	sprintf_safe(Buffer, "%d %d -------------------------------------------------------------\n",
+		Thread, Index);
+}
+
+struct CheckResult
+{
+	int Lines = 0;
+	int DropNotes = 0;
+};
+
+// Checks that every line is one that was written, that none are repeated, and that each thread's
+// lines are in order. With AllowGaps, lines may be missing.
+CheckResult CheckLines(const std::vector<std::string>& Lines, int ThreadCount, int LinesPerThread,
+	bool AllowGaps)
+{
+	CheckResult Result;
+	std::vector<int> Next(ThreadCount, 0);
+	int Bad = 0;
+	for (auto& Line : Lines)
+	{
+		if (Line.compare(0, 14, "MLogWriter -- ") == 0)
+		{
+			++Result.DropNotes;
+			continue;
+		}
+
+		int Thread = -1, Index = -1;
+		char Expected[128];
+		if (sscanf(Line.c_str(), "%d %d", &Thread, &Index) != 2 ||
+			Thread < 0 || Thread >= ThreadCount || Index < 0 || Index >= LinesPerThread)
+		{
+			++Bad;
+			continue;
+		}
+		FormatLine(Expected, Thread, Index);
+		if (Line + "\n" != Expected ||
+			(AllowGaps ? Index < Next[Thread] : Index != Next[Thread]))
+			++Bad;
+		Next[Thread] = Index + 1;
+		++Result.Lines;
+	}
+	MTEST_CHECK(Bad == 0);
+	if (!AllowGaps)
+	{
+		for (auto n : Next)
+			MTEST_CHECK(n == LinesPerThread);
+	}
+	return Result;
+}
+
+double WriteFromThreads(MLogWriter& Writer, int ThreadCount, int LinesPerThread)
+{
+	return MTestTimeMS([&] {
+		std::vector<std::thread> Threads;
+		for (int t = 0; t < ThreadCount; ++t)
+		{
+			Threads.emplace_back([&Writer, t, LinesPerThread] {
+				char Line[128];
+				for (int i = 0; i < LinesPerThread; ++i)
+				{
+					FormatLine(Line, t, i);
+					Writer.Write(Line, strlen(Line));
+				}
+			});
+		}
+		for (auto& Thread : Threads)
+			Thread.join();
+	});
+}
+
+void TestOrdering(int ThreadCount, int LinesPerThread)
+{
+	MLogWriter Writer;
+	MTEST_CHECK(Writer.Create(LogPath));
+	const auto WriteTime = WriteFromThreads(Writer, ThreadCount, LinesPerThread);
+	double FlushTime = 0;
+	FlushTime = MTestTimeMS([&] { MTEST_CHECK(Writer.Flush()); });
+
+	// Flush has to have put everything in the file already.
+	auto Lines = ReadLines(LogPath);
+	MTEST_CHECK(int(Lines.size()) == ThreadCount * LinesPerThread);
+
+	Writer.Destroy();
+	MTEST_CHECK(!Writer.IsCreated());
+	MTEST_CHECK(Writer.GetDroppedCount() == 0);
+	Lines = ReadLines(LogPath);
+	const auto Result = CheckLines(Lines, ThreadCount, LinesPerThread, false);
+	MTEST_CHECK(Result.DropNotes == 0);
+
+	const auto Total = ThreadCount * LinesPerThread;
+	std::printf("%d threads, %d lines: %.1f ms to queue, %.1f ms more to flush, %.0f lines/s\n",
+		ThreadCount, Total, WriteTime, FlushTime, Total / ((WriteTime + FlushTime) / 1000));
+}
+
+void TestDrop(int ThreadCount, int LinesPerThread)
+{
+	MLogOptions Options;
+	Options.Overflow = MLogOverflow::Drop;
+	MLogWriter Writer;
+	MTEST_CHECK(Writer.Create(LogPath, Options));
+	WriteFromThreads(Writer, ThreadCount, LinesPerThread);
+	Writer.Destroy();
+
+	// Whatever wasn't dropped is there, and the drops were noted.
+	const auto Result = CheckLines(ReadLines(LogPath), ThreadCount, LinesPerThread, true);
+	const auto Dropped = Writer.GetDroppedCount();
+	MTEST_CHECK(Result.Lines + Dropped == u64(ThreadCount * LinesPerThread));
+	MTEST_CHECK((Dropped > 0) == (Result.DropNotes > 0));
+
+	std::printf("Drop policy: %d lines written, %llu dropped\n", Result.Lines,
+		static_cast<unsigned long long>(Dropped));
+}
+
+void TestRotation()
+{
+	const int LineCount = 2000;
+	MLogOptions Options;
+	Options.RotateSize = 16 * 1024;
+	Options.FlushSize = 4 * 1024;
+	MLogWriter Writer;
+	MTEST_CHECK(Writer.Create(LogPath, Options));
+	char Line[128];
+	for (int i = 0; i < LineCount; ++i)
+	{
+		FormatLine(Line, 0, i);
+		Writer.Write(Line, strlen(Line));
+		// Give the writer a chance to flush more than once.
+		if (i % 100 == 0)
+			Writer.Flush();
+	}
+	Writer.Destroy();
+
+	// Rotated files are named after the date, numbered in the order they were moved aside, and
+	// the current file comes last.
+	std::vector<std::string> Paths;
+	const std::string Base = std::string{ LogPath } + "." + MGetStrLocalTime(MDT_YMD).c_str();
+	for (int i = 0;; ++i)
+	{
+		auto Path = i == 0 ? Base : Base + "." + std::to_string(i);
+		if (!MFile::Exists(Path.c_str()))
+			break;
+		Paths.push_back(Path);
+	}
+	MTEST_CHECK(Paths.size() > 1);
+	Paths.push_back(LogPath);
+
+	std::vector<std::string> Lines;
+	for (auto& Path : Paths)
+	{
+		auto FileLines = ReadLines(Path.c_str());
+		Lines.insert(Lines.end(), FileLines.begin(), FileLines.end());
+		if (&Path != &Paths.back())
+		{
+			MTEST_CHECK(MFile::File{ Path.c_str() }.size() <= Options.RotateSize);
+			MFile::Delete(Path.c_str());
+		}
+	}
+	CheckLines(Lines, 1, LineCount, false);
+}
+
+// Opens the file for every line, like MLogFile does when there's no writer thread.
+double TimeDirectWrites(int LineCount)
+{
+	MFile::Delete(LogPath);
+	return MTestTimeMS([&] {
+		char Line[128];
+		for (int i = 0; i < LineCount; ++i)
+		{
+			FormatLine(Line, 0, i);
+			auto File = fopen(LogPath, "a");
+			if (!File)
+				continue;
+			fputs(Line, File);
+			fclose(File);
+		}
+	});
+}
+
+struct LogsOnExit
+{
+	const char* Text;
+	~LogsOnExit() { MLog("%s\n", Text); }
+};
+
+// Destroyed after StopLogWriter has run, since it's constructed before InitLog registers it.
+LogsOnExit& GetEarlyObject()
+{
+	static LogsOnExit Object{ "destroyed after the writer stopped" };
+	return Object;
+}
+
+int RunExitChild(const char* Path)
+{
+	GetEarlyObject();
+	InitLog(MLOGSTYLE_FILE, Path);
+	// Destroyed while the writer is still running.
+	static LogsOnExit LateObject{ "destroyed before the writer stopped" };
+	MLog("logged from main\n");
+	return 0;
+}
+
+void TestExitLogging(const char* Self)
+{
+	const char ChildLogPath[] = "MLogWriterTestExit.log";
+	// InitLog resolves the path, which has to exist for that.
+	MFile::RWFile{ ChildLogPath, MFile::Clear };
+
+	const auto Command = std::string{ "\"" } + Self + "\" --exit-child " + ChildLogPath;
+	MTEST_CHECK(std::system(Command.c_str()) == 0);
+
+	const auto Lines = ReadLines(ChildLogPath);
+	const std::vector<std::string> Expected{
+		"logged from main",
+		"destroyed before the writer stopped",
+		"destroyed after the writer stopped",
+	};
+	MTEST_CHECK(Lines == Expected);
+	MFile::Delete(ChildLogPath);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 2 && strcmp(argv[1], "--exit-child") == 0)
+		return RunExitChild(argv[2]);
+
+	const int LinesPerThread = argc > 1 ? atoi(argv[1]) : 50000;
+
+	TestOrdering(1, LinesPerThread);
+	TestOrdering(8, LinesPerThread);
+	TestDrop(8, LinesPerThread);
+	TestRotation();
+	TestExitLogging(argv[0]);
+
+	const auto DirectLines = (std::min)(LinesPerThread, 20000);
+	const auto DirectTime = TimeDirectWrites(DirectLines);
+	std::printf("Opening the file for every line: %d lines in %.1f ms, %.0f lines/s\n",
+		DirectLines, DirectTime, DirectLines / (DirectTime / 1000));
+
+	MFile::Delete(LogPath);
+	return MTestResult();
+}
@@ -0,0 +1,169 @@
+#include "MOpenHashMap.h"
+#include "MTest.h"
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <unordered_map>
+
+// Runs random inserts, erases and lookups on MOpenHashMap and on std::unordered_map side by
+// side, and checks that they always agree, including what iteration visits. Does it once with
+// the default hasher, and once with one that puts every key in a few slots, so that the probe
+// sequences are long, wrap around the end of the array, and have to be shifted back on erase.
+// Times lookups against std::unordered_map.
+
+namespace {
+
+// Sends every key to one of 4 slots.
+struct ClumpingHasher
+{
+	size_t operator()(u32 Key) const { return Key % 4 * 5; }
+};
+
+template <typename MapType>
+void TestAgainstStd(MapType& Map, u32 KeyRange, int NumSteps, const char* Name)
+{
+	std::mt19937 Rng{ 4242 };
+	std::unordered_map<u32, std::string> Ref;
+	int Mismatches = 0;
+
+	for (int Step = 0; Step < NumSteps; Step++)
+	{
+		const u32 Key = Rng() % KeyRange;
+		switch (Rng() % 5)
+		{
+		case 0:
+		case 1:
+		{
+			auto Value = std::to_string(Step);
+			auto Result = Map.insert(Key, Value);
+			auto RefResult = Ref.emplace(Key, Value);
+			Mismatches += Result.second != RefResult.second;
+			Mismatches += *Result.first != RefResult.first->second;
+			break;
+		}
+		case 2:
+			Mismatches += Map.erase(Key) != (Ref.erase(Key) == 1);
+			break;
+		default:
+		{
+			auto* Value = Map.find(Key);
+			auto it = Ref.find(Key);
+			Mismatches += (Value != nullptr) != (it != Ref.end());
+			if (Value && it != Ref.end())
+				Mismatches += *Value != it->second;
+			break;
+		}
+		}
+
+		Mismatches += Map.size() != Ref.size();
+		// The load factor is kept under 7/10, and the capacity a power of two.
+		Mismatches += Map.capacity() != 0 && (Map.size() * 10 > Map.capacity() * 7 ||
+			(Map.capacity() & (Map.capacity() - 1)) != 0);
+
+		if (Step % 1000 == 0)
+		{
+			size_t Visited = 0;
+			for (auto& Entry : Map)
+			{
+				auto it = Ref.find(Entry.Key);
+				Mismatches += it == Ref.end() || it->second != Entry.Value;
+				Visited++;
+			}
+			Mismatches += Visited != Ref.size();
+		}
+	}
+	MTEST_CHECK(Mismatches == 0);
+
+	// Every key that's left is found after erasing the rest, whatever order they go in.
+	std::vector<u32> Keys;
+	for (auto& Pair : Ref)
+		Keys.push_back(Pair.first);
+	std::shuffle(Keys.begin(), Keys.end(), Rng);
+	for (size_t i = 0; i < Keys.size(); i++)
+	{
+		MTEST_CHECK(Map.erase(Keys[i]));
+		if (i % 64 == 0)
+		{
+			int Lost = 0;
+			for (size_t j = i + 1; j < Keys.size(); j++)
+				Lost += Map.find(Keys[j]) == nullptr;
+			MTEST_CHECK(Lost == 0);
+		}
+	}
+	MTEST_CHECK(Map.empty());
+	MTEST_CHECK(Map.begin() == Map.end());
+
+	std::printf("%s: %d steps on %u keys, %d mismatches\n", Name, NumSteps, KeyRange, Mismatches);
+}
+
+void TestClear()
+{
+	MOpenHashMap<u32, int> Map{ 100 };
+	const auto Capacity = Map.capacity();
+	MTEST_CHECK(Capacity >= 143);
+	for (u32 i = 0; i < 100; i++)
+		Map.insert(i, int(i));
+	MTEST_CHECK(Map.capacity() == Capacity);
+	Map.clear();
+	MTEST_CHECK(Map.empty() && Map.find(5) == nullptr && Map.capacity() == Capacity);
+	Map.insert(5u, 50);
+	MTEST_CHECK(Map.size() == 1 && *Map.find(5) == 50);
+}
+
+void TimeLookups(int NumKeys, int NumLookups)
+{
+	std::mt19937 Rng{ 999 };
+	MOpenHashMap<u32, u32> Map;
+	std::unordered_map<u32, u32> Ref;
+	std::vector<u32> Keys(NumKeys);
+	for (auto& Key : Keys)
+	{
+		Key = Rng();
+		Map.insert(Key, Key);
+		Ref.emplace(Key, Key);
+	}
+
+	// Half of them hit.
+	std::vector<u32> Lookups(NumLookups);
+	for (auto& Key : Lookups)
+		Key = Rng() % 2 ? Keys[Rng() % NumKeys] : u32(Rng());
+
+	u64 MapSum = 0, RefSum = 0;
+	const auto MapTime = MTestTimeMS([&] {
+		for (auto Key : Lookups)
+			if (auto* Value = Map.find(Key))
+				MapSum += *Value;
+	});
+	const auto RefTime = MTestTimeMS([&] {
+		for (auto Key : Lookups)
+		{
+			auto it = Ref.find(Key);
+			if (it != Ref.end())
+				RefSum += it->second;
+		}
+	});
+	MTEST_CHECK(MapSum == RefSum);
+
+	std::printf("%d keys: %.1f ns per lookup, %.1f ns with std::unordered_map\n", NumKeys,
+		MapTime * 1e6 / NumLookups, RefTime * 1e6 / NumLookups);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int NumSteps = argc > 1 ? atoi(argv[1]) : 200000;
+
+	{
+		MOpenHashMap<u32, std::string> Map;
+		TestAgainstStd(Map, 5000, NumSteps, "Default hasher");
+	}
+	{
+		MOpenHashMap<u32, std::string, ClumpingHasher> Map;
+		TestAgainstStd(Map, 300, NumSteps / 10, "Clumping hasher");
+	}
+	TestClear();
+	TimeLookups(100000, 1000000);
+
+	return MTestResult();
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+
+// Checks and timing for the test and benchmark executables under the */Tests directories.
+//
+// A failed MTEST_CHECK prints the expression and keeps going, and main returns
+// MTestResult(), so CTest sees a nonzero exit code if anything failed. The checks don't
+// depend on assert, which is compiled out in every non-MSVC configuration.
+
+inline int& MTestFailureCount()
+{
+	static int nFailures;
+	return nFailures;
+}
+
+#define MTEST_CHECK(expr) \
+	do { \
+		if (!(expr)) { \
+			++MTestFailureCount(); \
+			std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+		} \
+	} while (false)
+
+inline int MTestResult()
+{
+	const auto nFailures = MTestFailureCount();
+	if (nFailures)
+		std::printf("%d check(s) failed\n", nFailures);
+	else
+		std::printf("All checks passed\n");
+	return nFailures ? 1 : 0;
+}
+
+// Runs fn once and returns how long it took, in milliseconds.
+template <typename T>
+double MTestTimeMS(T&& fn)
+{
+	const auto Start = std::chrono::steady_clock::now();
+	fn();
+	const auto End = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::milli>(End - Start).count();
+}
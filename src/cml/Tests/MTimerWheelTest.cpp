@@ -0,0 +1,285 @@
+#include "MTimerWheel.h"
+#include "MTest.h"
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Checks that MTimerWheel fires every timer on the first Advance at or after its expire tick and
+// never before, on timers around the boundaries where they're cascaded from one level down to the
+// next, on timers further away than the wheel can hold exactly, and on random mixes of scheduling,
+// cancelling and advancing compared against a plain list. Also checks that nodes cancelled while
+// PopExpired is handing the expired ones out aren't handed out, and that Reset can go back in time.
+
+namespace {
+
+struct Timer : MTimerWheelNode
+{
+	int Index = 0;
+	int Fired = 0;
+	u64 FiredAt = 0;
+	// The tick it's really due at, which is the next one the wheel processes if it was
+	// scheduled for one that's been processed already.
+	u64 DueAt = 0;
+};
+
+// The boundaries of each level: Root holds 2^8 ticks, and each of the three levels above it 2^6
+// times as many as the one below.
+const u64 Boundaries[] = {
+	u64(1) << 8,
+	u64(1) << 14,
+	u64(1) << 20,
+	u64(1) << 26,
+};
+
+// Schedules a timer at each offset around each boundary, from a few starting ticks that aren't
+// aligned to anything, and advances one tick at a time around each expire tick.
+void TestBoundaries()
+{
+	int Early = 0, Late = 0;
+	for (u64 Start : { u64(0), u64(1), u64(255), u64(12345), (u64(1) << 26) - 3 })
+	{
+		for (auto Boundary : Boundaries)
+		{
+			for (u64 Offset : { Boundary - 2, Boundary - 1, Boundary, Boundary + 1, 2 * Boundary + 1 })
+			{
+				MTimerWheel Wheel{ Start };
+				Timer T;
+				const auto Expire = Start + Offset;
+				Wheel.Schedule(T, Expire);
+
+				auto OnExpire = [&](MTimerWheelNode& Node) {
+					auto& Fired = static_cast<Timer&>(Node);
+					Fired.Fired++;
+				};
+				Wheel.Advance(Expire - 3, OnExpire);
+				Wheel.Advance(Expire - 1, OnExpire);
+				Early += T.Fired;
+				Wheel.Advance(Expire, OnExpire);
+				Late += T.Fired != 1;
+				MTEST_CHECK(Wheel.Empty() && !T.IsScheduled());
+			}
+		}
+	}
+	MTEST_CHECK(Early == 0);
+	MTEST_CHECK(Late == 0);
+}
+
+// Timers further away than the last level covers are clamped into it, and filed again each time
+// they're cascaded down, until they fire at the tick they were given.
+void TestClamped()
+{
+	const u64 MaxInterval = (u64(1) << 26) - 1;
+	MTimerWheel Wheel{ 1000 };
+	std::vector<std::unique_ptr<Timer>> Timers;
+	const u64 Offsets[] = { MaxInterval, MaxInterval + 1, 2 * MaxInterval + 17, u64(1) << 32 };
+	for (auto Offset : Offsets)
+	{
+		Timers.emplace_back(new Timer);
+		Wheel.Schedule(*Timers.back(), 1000 + Offset);
+	}
+
+	// Advance in big steps; PopExpired skips the empty stretches.
+	u64 Now = 1000;
+	int Early = 0;
+	const u64 Step = (u64(1) << 20) + 7;
+	while (!Wheel.Empty())
+	{
+		Now += Step;
+		Wheel.Advance(Now, [&](MTimerWheelNode& Node) {
+			auto& T = static_cast<Timer&>(Node);
+			T.Fired++;
+			T.FiredAt = Now;
+			Early += T.GetExpireTick() > Now;
+		});
+	}
+	MTEST_CHECK(Early == 0);
+	for (size_t i = 0; i < Timers.size(); i++)
+	{
+		MTEST_CHECK(Timers[i]->Fired == 1);
+		// Within a step of when it was due.
+		MTEST_CHECK(Timers[i]->FiredAt - (1000 + Offsets[i]) < Step);
+	}
+}
+
+// Cancelling and rescheduling from inside the handler, while the rest of the nodes that expired
+// on the same tick are waiting in the expired list.
+void TestCancelWhileExpiring()
+{
+	const int Count = 100;
+	MTimerWheel Wheel;
+	std::vector<Timer> Timers(Count);
+	for (int i = 0; i < Count; i++)
+	{
+		Timers[i].Index = i;
+		Wheel.Schedule(Timers[i], 50);
+	}
+
+	while (auto* Node = Wheel.PopExpired(50))
+	{
+		auto& T = static_cast<Timer&>(*Node);
+		MTEST_CHECK(!T.IsScheduled());
+		T.Fired++;
+
+		// Each odd one cancels the one after it, which has expired but not been handed out.
+		if (T.Index % 2 == 1 && T.Index + 1 < Count)
+			MTEST_CHECK(Wheel.Cancel(Timers[T.Index + 1]));
+		// Every tenth one moves itself later.
+		if (T.Index % 10 == 0)
+			Wheel.Schedule(T, 60);
+	}
+
+	int Wrong = 0;
+	for (auto& T : Timers)
+	{
+		const bool Cancelled = T.Index % 2 == 0 && T.Index > 0;
+		Wrong += T.Fired != (Cancelled ? 0 : 1);
+	}
+	MTEST_CHECK(Wrong == 0);
+	// Only the first got to reschedule itself, since the odd ones before the other multiples of
+	// ten cancelled them.
+	MTEST_CHECK(Wheel.Size() == 1 && Timers[0].IsScheduled());
+	MTEST_CHECK(Wheel.PopExpired(59) == nullptr);
+	MTEST_CHECK(Wheel.PopExpired(60) == &Timers[0]);
+	MTEST_CHECK(Wheel.Empty());
+
+	// A handler that reschedules its node for a tick that's been processed gets it on the next
+	// Advance to a later tick, not again in the same one.
+	int Fired = 0;
+	Wheel.Schedule(Timers[0], 70);
+	auto Reschedule = [&](MTimerWheelNode& Node) {
+		Fired++;
+		Wheel.Schedule(Node, 70);
+	};
+	Wheel.Advance(70, Reschedule);
+	MTEST_CHECK(Fired == 1);
+	Wheel.Advance(70, Reschedule);
+	MTEST_CHECK(Fired == 1);
+	Wheel.Advance(71, Reschedule);
+	MTEST_CHECK(Fired == 2);
+	Wheel.Cancel(Timers[0]);
+}
+
+// Reset unschedules everything and can take the wheel back to an earlier tick, like
+// MMatchScheduleMgr does when the clock is set back. Timers on every level work afterwards.
+void TestReset()
+{
+	MTimerWheel Wheel{ 5000000 };
+	std::vector<Timer> Timers(5);
+	for (size_t i = 0; i < Timers.size(); i++)
+		Wheel.Schedule(Timers[i], 5000000 + (u64(1) << (6 * i)));
+	Wheel.Advance(5000100, [](MTimerWheelNode&) {});
+
+	Wheel.Reset(100);
+	MTEST_CHECK(Wheel.Empty() && Wheel.GetNextTick() == 100);
+	for (auto& T : Timers)
+		MTEST_CHECK(!T.IsScheduled());
+
+	for (size_t i = 0; i < Timers.size(); i++)
+		Wheel.Schedule(Timers[i], 100 + Boundaries[i % 4] + i);
+	int Fired = 0, Early = 0;
+	for (u64 Now = 100; !Wheel.Empty(); Now += 1 + Now / 4)
+	{
+		Wheel.Advance(Now, [&](MTimerWheelNode& Node) {
+			Fired++;
+			Early += Node.GetExpireTick() > Now;
+		});
+	}
+	MTEST_CHECK(Fired == int(Timers.size()) && Early == 0);
+
+	// A timer in the last level after a Clear, so that the search for the lowest level that
+	// isn't empty goes all the way up.
+	Wheel.Schedule(Timers[0], Wheel.GetNextTick() + 1000);
+	Wheel.Clear();
+	const auto Far = Wheel.GetNextTick() + (u64(3) << 26);
+	Wheel.Schedule(Timers[0], Far);
+	MTEST_CHECK(Wheel.PopExpired(Far - 1) == nullptr);
+	MTEST_CHECK(Wheel.PopExpired(Far) == &Timers[0]);
+}
+
+// Random scheduling, cancelling and advancing, checked against a plain list of the timers.
+void TestRandom(int NumTimers, int NumSteps)
+{
+	std::mt19937_64 Rng{ 13579 };
+	MTimerWheel Wheel{ 777 };
+	std::vector<Timer> Timers(NumTimers);
+	for (int i = 0; i < NumTimers; i++)
+		Timers[i].Index = i;
+
+	// Spread across the levels, with some right on their edges.
+	auto RandomInterval = [&]() -> u64 {
+		switch (Rng() % 6)
+		{
+		case 0: return Rng() % 256;
+		case 1: return Rng() % (u64(1) << 14);
+		case 2: return Rng() % (u64(1) << 20);
+		case 3: return Rng() % (u64(1) << 27);
+		case 4: return Boundaries[Rng() % 4] + Rng() % 3 - 1;
+		default: return 0;
+		}
+	};
+
+	u64 Now = 777;
+	int Early = 0, Missed = 0, Stray = 0;
+	size_t Expected = 0;
+	double Time = MTestTimeMS([&] {
+		for (int Step = 0; Step < NumSteps; Step++)
+		{
+			auto& T = Timers[Rng() % NumTimers];
+			switch (Rng() % 4)
+			{
+			case 0:
+			case 1:
+			{
+				if (!T.IsScheduled())
+					Expected++;
+				// Some of them are due at a tick that's already been processed.
+				const auto Expire = Now + RandomInterval() - (Rng() % 16 == 0);
+				T.DueAt = (std::max)(Expire, Wheel.GetNextTick());
+				Wheel.Schedule(T, Expire);
+				break;
+			}
+			case 2:
+				if (Wheel.Cancel(T))
+					Expected--;
+				break;
+			case 3:
+			{
+				// Mostly small steps, sometimes big jumps.
+				Now += Rng() % 8 == 0 ? Rng() % (u64(1) << 22) : Rng() % 300;
+				Wheel.Advance(Now, [&](MTimerWheelNode& Node) {
+					auto& Fired = static_cast<Timer&>(Node);
+					Early += Fired.DueAt > Now;
+					Stray += Fired.IsScheduled();
+					Expected--;
+				});
+				for (auto& Check : Timers)
+					Missed += Check.IsScheduled() && Check.DueAt <= Now;
+				break;
+			}
+			}
+			MTEST_CHECK(Wheel.Size() == Expected);
+		}
+	});
+	MTEST_CHECK(Early == 0);
+	MTEST_CHECK(Missed == 0);
+	MTEST_CHECK(Stray == 0);
+
+	std::printf("%d timers, %d random steps: %.1f ms\n", NumTimers, NumSteps, Time);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int NumSteps = argc > 1 ? atoi(argv[1]) : 20000;
+
+	TestBoundaries();
+	TestClamped();
+	TestCancelWhileExpiring();
+	TestReset();
+	TestRandom(300, NumSteps);
+
+	return MTestResult();
+}
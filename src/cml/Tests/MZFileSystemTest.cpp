@@ -0,0 +1,279 @@
+#include "stdafx.h"
+#include "MZFileSystem.h"
+#include "MZFile.h"
+#include "MFile.h"
+#include "MTest.h"
+#include "zip/zlib.h"
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Builds a small archive, then checks and times MZFile reads through the mapped archive and
+// the inflated file cache. The interesting case is a file that's evicted from the cache, or
+// dropped by ReleaseCachedArchives, while an MZFile still points into it.
+
+namespace {
+
+struct ArchiveEntry
+{
+	std::string Name;
+	std::string Contents;
+	bool Deflate;
+	// Added to the sizes written in the directory, to make it point past the end of the archive.
+	u32 Overclaim = 0;
+};
+
+void Put16(std::string& Out, u32 Value)
+{
+	Out += char(Value & 0xFF);
+	Out += char((Value >> 8) & 0xFF);
+}
+
+void Put32(std::string& Out, u32 Value)
+{
+	Put16(Out, Value & 0xFFFF);
+	Put16(Out, Value >> 16);
+}
+
+std::string DeflateRaw(const std::string& Input)
+{
+	z_stream Stream{};
+	deflateInit2(&Stream, Z_BEST_SPEED, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+	std::string Output(deflateBound(&Stream, uLong(Input.size())), '\0');
+	Stream.next_in = (Bytef*)Input.data();
+	Stream.avail_in = uInt(Input.size());
+	Stream.next_out = (Bytef*)&Output[0];
+	Stream.avail_out = uInt(Output.size());
+	deflate(&Stream, Z_FINISH);
+	Output.resize(Stream.total_out);
+	deflateEnd(&Stream);
+	return Output;
+}
+
+// Writes a plain zip file, which MZip reads like an .mrs archive.
+bool WriteArchive(const char* Path, const std::vector<ArchiveEntry>& Entries)
+{
+	std::string Body, Directory;
+	for (auto& Entry : Entries)
+	{
+		const auto Data = Entry.Deflate ? DeflateRaw(Entry.Contents) : Entry.Contents;
+		const auto CRC = u32(crc32(0, (const Bytef*)Entry.Contents.data(), uInt(Entry.Contents.size())));
+		const auto Offset = u32(Body.size());
+
+		Put32(Body, 0x04034b50);
+		Put16(Body, 20);
+		Put16(Body, 0);
+		Put16(Body, Entry.Deflate ? 8 : 0);
+		Put32(Body, 0);
+		Put32(Body, CRC);
+		Put32(Body, u32(Data.size()));
+		Put32(Body, u32(Entry.Contents.size()));
+		Put16(Body, u32(Entry.Name.size()));
+		Put16(Body, 0);
+		Body += Entry.Name;
+		Body += Data;
+
+		Put32(Directory, 0x02014b50);
+		Put16(Directory, 20);
+		Put16(Directory, 20);
+		Put16(Directory, 0);
+		Put16(Directory, Entry.Deflate ? 8 : 0);
+		Put32(Directory, 0);
+		Put32(Directory, CRC);
+		Put32(Directory, u32(Data.size()) + Entry.Overclaim);
+		Put32(Directory, u32(Entry.Contents.size()) + (Entry.Deflate ? 0 : Entry.Overclaim));
+		Put16(Directory, u32(Entry.Name.size()));
+		Put16(Directory, 0);
+		Put16(Directory, 0);
+		Put16(Directory, 0);
+		Put16(Directory, 0);
+		Put32(Directory, 0);
+		Put32(Directory, Offset);
+		Directory += Entry.Name;
+	}
+
+	std::string End;
+	Put32(End, 0x06054b50);
+	Put16(End, 0);
+	Put16(End, 0);
+	Put16(End, u32(Entries.size()));
+	Put16(End, u32(Entries.size()));
+	Put32(End, u32(Directory.size()));
+	Put32(End, u32(Body.size()));
+	Put16(End, 0);
+
+	MFile::RWFile File{ Path, MFile::Clear };
+	if (File.error())
+		return false;
+	const auto All = Body + Directory + End;
+	return File.write(All.data(), All.size()) == All.size();
+}
+
+std::string MakeContents(int Seed, size_t Size)
+{
+	std::string Contents;
+	Contents.reserve(Size);
+	while (Contents.size() < Size)
+		Contents += "line " + std::to_string(Contents.size() * 31 + Seed) + " of file " +
+			std::to_string(Seed) + "\n";
+	Contents.resize(Size);
+	return Contents;
+}
+
+bool ReadsAs(MZFileSystem& FS, const char* Path, const std::string& Expected)
+{
+	MZFile File;
+	if (!File.Open(Path, &FS))
+		return false;
+	auto* Data = File.GetData();
+	return Data && File.GetLength() == Expected.size() &&
+		memcmp(Data, Expected.data(), Expected.size()) == 0;
+}
+
+}
+
+int main()
+{
+	const size_t FileSize = 64 * 1024;
+	const char* BaseDir = "MZFileSystemTest";
+
+	std::vector<ArchiveEntry> Entries{
+		{ "stored.txt", MakeContents(0, FileSize), false },
+		{ "a.txt", MakeContents(1, FileSize), true },
+		{ "b.txt", MakeContents(2, FileSize), true },
+		{ "c.txt", MakeContents(3, FileSize), true },
+	};
+
+	MFile::CreateDir(BaseDir);
+	if (!WriteArchive("MZFileSystemTest/test.mrs", Entries))
+	{
+		std::printf("Couldn't write the test archive\n");
+		return 1;
+	}
+
+	MZFileSystem FS;
+	MTEST_CHECK(FS.Create(BaseDir));
+	// Room for exactly two inflated files.
+	FS.SetInflatedFileCacheSize(2 * (FileSize + 1));
+
+	for (auto& Entry : Entries)
+		MTEST_CHECK(ReadsAs(FS, ("test/" + Entry.Name).c_str(), Entry.Contents));
+
+	// Stored files point straight into the mapped archive.
+	{
+		MZFile First, Second;
+		MTEST_CHECK(First.Open("test/stored.txt", &FS));
+		MTEST_CHECK(Second.Open("test/stored.txt", &FS));
+		MTEST_CHECK(First.GetData() == Second.GetData());
+	}
+
+	// Opens of a cached file share one buffer.
+	{
+		MZFile First, Second;
+		MTEST_CHECK(First.Open("test/a.txt", &FS));
+		MTEST_CHECK(Second.Open("test/a.txt", &FS));
+		MTEST_CHECK(First.GetData() == Second.GetData());
+	}
+
+	// Evict a.txt while it's still open. The open file must keep its data.
+	{
+		MZFile Held;
+		MTEST_CHECK(Held.Open("test/a.txt", &FS));
+		auto* HeldData = Held.GetData();
+
+		MTEST_CHECK(ReadsAs(FS, "test/b.txt", Entries[2].Contents));
+		MTEST_CHECK(ReadsAs(FS, "test/c.txt", Entries[3].Contents));
+
+		MTEST_CHECK(Held.GetData() == HeldData);
+		MTEST_CHECK(memcmp(HeldData, Entries[1].Contents.data(), FileSize) == 0);
+
+		// a.txt is inflated again into a new buffer.
+		MZFile Reopened;
+		MTEST_CHECK(Reopened.Open("test/a.txt", &FS));
+		MTEST_CHECK(Reopened.GetData() != HeldData);
+		MTEST_CHECK(memcmp(Reopened.GetData(), Entries[1].Contents.data(), FileSize) == 0);
+
+		FS.ReleaseCachedArchives();
+		MTEST_CHECK(memcmp(HeldData, Entries[1].Contents.data(), FileSize) == 0);
+
+		// Shrinking the cache evicts too.
+		MTEST_CHECK(ReadsAs(FS, "test/b.txt", Entries[2].Contents));
+		FS.SetInflatedFileCacheSize(0);
+		MTEST_CHECK(memcmp(HeldData, Entries[1].Contents.data(), FileSize) == 0);
+		MTEST_CHECK(ReadsAs(FS, "test/b.txt", Entries[2].Contents));
+		FS.SetInflatedFileCacheSize(2 * (FileSize + 1));
+	}
+
+	// Release hands out a modifiable, null-terminated copy of shared data.
+	{
+		MZFile File;
+		MTEST_CHECK(File.Open("test/b.txt", &FS));
+		auto* Shared = File.GetData();
+		auto Released = File.Release();
+		MTEST_CHECK(Released.get() != Shared);
+		MTEST_CHECK(memcmp(Released.get(), Entries[2].Contents.data(), FileSize) == 0);
+		MTEST_CHECK(Released[FileSize] == 0);
+		Released[0] = '!';
+		MTEST_CHECK(ReadsAs(FS, "test/b.txt", Entries[2].Contents));
+	}
+
+	// Many threads opening files that keep evicting each other.
+	{
+		std::atomic<int> Failures{};
+		std::vector<std::thread> Threads;
+		for (int t = 0; t < 4; ++t)
+		{
+			Threads.emplace_back([&, t] {
+				for (int i = 0; i < 200; ++i)
+				{
+					auto& Entry = Entries[1 + (i + t) % 3];
+					if (!ReadsAs(FS, ("test/" + Entry.Name).c_str(), Entry.Contents))
+						++Failures;
+				}
+			});
+		}
+		for (auto& Thread : Threads)
+			Thread.join();
+		MTEST_CHECK(Failures == 0);
+	}
+
+	// An archive whose directory says its files go on past the end of it. Reads of those fail,
+	// instead of reading past the end of the mapping, and the rest of the archive still works.
+	{
+		std::vector<ArchiveEntry> Bad{
+			{ "fine.txt", MakeContents(4, 1000), false },
+			{ "stored.txt", MakeContents(5, 1000), false, 1u << 20 },
+			{ "deflated.txt", MakeContents(6, 1000), true, 1u << 20 },
+		};
+		MTEST_CHECK(WriteArchive("MZFileSystemTest/bad.mrs", Bad));
+		MZFileSystem BadFS;
+		MTEST_CHECK(BadFS.Create(BaseDir));
+		MTEST_CHECK(!ReadsAs(BadFS, "bad/stored.txt", Bad[1].Contents));
+		MTEST_CHECK(!ReadsAs(BadFS, "bad/deflated.txt", Bad[2].Contents));
+		MTEST_CHECK(ReadsAs(BadFS, "bad/fine.txt", Bad[0].Contents));
+
+		auto* Desc = BadFS.GetFileDesc("bad/stored.txt");
+		MTEST_CHECK(Desc && BadFS.GetArchiveData(*Desc) == nullptr);
+		Desc = BadFS.GetFileDesc("bad/fine.txt");
+		MTEST_CHECK(Desc && BadFS.GetArchiveData(*Desc) != nullptr &&
+			memcmp(BadFS.GetArchiveData(*Desc), Bad[0].Contents.data(), Bad[0].Contents.size()) == 0);
+	}
+
+	// Reopening one file, with and without the cache.
+	const int Opens = 500;
+	const auto CachedTime = MTestTimeMS([&] {
+		for (int i = 0; i < Opens; ++i)
+			ReadsAs(FS, "test/a.txt", Entries[1].Contents);
+	});
+	FS.SetInflatedFileCacheSize(0);
+	const auto UncachedTime = MTestTimeMS([&] {
+		for (int i = 0; i < Opens; ++i)
+			ReadsAs(FS, "test/a.txt", Entries[1].Contents);
+	});
+	std::printf("%d opens of a %d KiB deflated file: %.1f ms cached, %.1f ms uncached\n",
+		Opens, int(FileSize / 1024), CachedTime, UncachedTime);
+
+	return MTestResult();
+}
@@ -3,8 +3,11 @@
 #include <signal.h>
 #include "FileInfo.h"
 #include "MDebug.h"
+#include "MLogWriter.h"
 #include <string>
 #include <mutex>
+#include <atomic>
+#include <cstdlib>
 #include <cassert>
 
 #ifdef WIN32
@@ -17,26 +20,63 @@ static int g_nLogMethod=MLOGSTYLE_DEBUGSTRING;
 
 static bool g_bLogInitialized = false;
 
+// Never destroyed, since static destructors and other threads can still log while the process
+// exits. StopLogWriter, registered with atexit by InitLog, writes out whatever is queued and stops
+// the writer thread instead, and MLogFile writes to the file directly from then on. A line that
+// another thread logs while StopLogWriter is running may be lost.
+static MLogWriter& GetLogWriter()
+{
+	static auto* Writer = new MLogWriter;
+	return *Writer;
+}
+
+static std::atomic<bool> g_bLogWriterRunning{ false };
+
+static void StopLogWriter()
+{
+	g_bLogWriterRunning = false;
+	GetLogWriter().Destroy();
+}
+
 bool IsLogAvailable()
 {
 	return g_bLogInitialized;
 }
 
-void InitLog(int logmethodflags, const char* pszLogFileName)
+void InitLog(int logmethodflags, const char* pszLogFileName, const MLogOptions& Options)
 {
 	g_nLogMethod=logmethodflags;
 
 	if(g_nLogMethod&MLOGSTYLE_FILE)
 	{
 		GetFullPath(logfilename, sizeof(logfilename), pszLogFileName);
-		FILE *pFile = fopen(logfilename,"w+");
-		if( !pFile ) return;
-		fclose(pFile);
+		g_bLogWriterRunning = false;
+		if (!GetLogWriter().Create(logfilename, Options)) return;
+
+		static const bool StopAtExit = (atexit(StopLogWriter), true);
+		(void)StopAtExit;
+		g_bLogWriterRunning = true;
 	}
 
 	g_bLogInitialized = true;
 }
 
+void InitLog(int logmethodflags, const char* pszLogFileName)
+{
+	InitLog(logmethodflags, pszLogFileName, MLogOptions{});
+}
+
+void SetLogOptions(const MLogOptions& Options)
+{
+	GetLogWriter().SetOptions(Options);
+}
+
+void MFlushLog()
+{
+	if (g_bLogWriterRunning)
+		GetLogWriter().Flush();
+}
+
 #ifdef _DEBUG
 void DMLog(const char* Format, ...)
 {
@@ -69,6 +109,13 @@ void DMLog(const char* Format, ...)
 
 void MLogFile(const char* Msg)
 {
+	if (g_bLogWriterRunning)
+	{
+		GetLogWriter().Write(Msg, strlen(Msg));
+		return;
+	}
+
+	// Before InitLog or after exit, there's no writer thread to hand it to.
 	FILE *pFile = fopen(logfilename, "a");
 
 	if (!pFile)
@@ -183,6 +230,9 @@ void MFilterException(LPEXCEPTION_POINTERS p)
 
 	mlog(str.c_str());
 	mlog("\n");
+
+	// The process may not live long enough for the writer thread to get to it.
+	MFlushLog();
 }
 
 void MSEHTranslator(UINT nSeCode, _EXCEPTION_POINTERS* pExcPointers)
@@ -0,0 +1,173 @@
+#include "stdafx.h"
+#include "MLogWriter.h"
+#include "MUtil.h"
+#include <chrono>
+
+constexpr size_t MLogWriter::QueueSize;
+
+// Slots that held an unusually long line give the memory back, so that a burst of them doesn't
+// pin it for the life of the process.
+static constexpr size_t MaxKeptLineCapacity = 4096;
+
+// How long the writer sleeps when there's nothing to write.
+static constexpr auto IdleWait = std::chrono::milliseconds(5);
+
+bool MLogWriter::Create(const char* Path, const MLogOptions& Options)
+{
+	Destroy();
+
+	this->Path = Path;
+	if (!Open(true))
+		return false;
+
+	SetOptions(Options);
+	Stopping = false;
+	Thread = std::thread{ [this] { ThreadProc(); } };
+	return true;
+}
+
+void MLogWriter::Destroy()
+{
+	if (!Thread.joinable())
+		return;
+
+	Stopping = true;
+	Thread.join();
+	File.close();
+}
+
+void MLogWriter::SetOptions(const MLogOptions& NewOptions)
+{
+	std::lock_guard<std::mutex> Lock{ OptionsMutex };
+	Options = NewOptions;
+	Overflow.store(NewOptions.Overflow, std::memory_order_relaxed);
+}
+
+MLogOptions MLogWriter::GetOptions()
+{
+	std::lock_guard<std::mutex> Lock{ OptionsMutex };
+	return Options;
+}
+
+void MLogWriter::Write(const char* Text, size_t Length)
+{
+	auto Fill = [&](std::string& Line) { Line.assign(Text, Length); };
+	if (Queue.try_push(Fill))
+		return;
+
+	if (Overflow.load(std::memory_order_relaxed) == MLogOverflow::Drop)
+	{
+		Dropped.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	while (!Queue.try_push(Fill))
+	{
+		// Nobody's going to make room.
+		if (Stopping.load(std::memory_order_relaxed))
+		{
+			Dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		std::this_thread::yield();
+	}
+}
+
+bool MLogWriter::Flush(u32 Timeout)
+{
+	if (!IsCreated())
+		return true;
+
+	const auto Target = Queue.push_count();
+	const auto End = std::chrono::steady_clock::now() + std::chrono::milliseconds(Timeout);
+	while (WrittenCount.load(std::memory_order_acquire) < Target)
+	{
+		if (std::chrono::steady_clock::now() >= End)
+			return false;
+		FlushRequested = true;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	return true;
+}
+
+void MLogWriter::ThreadProc()
+{
+	auto LastFlush = std::chrono::steady_clock::now();
+	while (true)
+	{
+		// Read before draining, so that everything queued before Destroy makes it in.
+		const bool Stop = Stopping.load();
+
+		bool Popped = false;
+		while (Queue.try_pop([&](std::string& Line) {
+			Pending.append(Line);
+			if (Line.capacity() > MaxKeptLineCapacity)
+				std::string().swap(Line);
+		}))
+			Popped = true;
+
+		const auto Options = GetOptions();
+		const auto Now = std::chrono::steady_clock::now();
+		if (Stop || FlushRequested.exchange(false) || Pending.size() >= Options.FlushSize ||
+			Now - LastFlush >= std::chrono::milliseconds(Options.FlushInterval))
+		{
+			WritePending(Options);
+			LastFlush = Now;
+			WrittenCount.store(Queue.pop_count(), std::memory_order_release);
+		}
+
+		if (Stop)
+			break;
+		if (!Popped)
+			std::this_thread::sleep_for(IdleWait);
+	}
+}
+
+void MLogWriter::WritePending(const MLogOptions& Options)
+{
+	const auto TotalDropped = Dropped.load(std::memory_order_relaxed);
+	if (TotalDropped != ReportedDropped)
+	{
+		char Note[128];
+		sprintf_safe(Note, "MLogWriter -- %llu lines were dropped because the log queue was full\n",
+			static_cast<unsigned long long>(TotalDropped - ReportedDropped));
+		Pending += Note;
+		ReportedDropped = TotalDropped;
+	}
+
+	if (Pending.empty())
+		return;
+
+	if ((Options.RotateSize && FileSize > 0 && FileSize + Pending.size() > Options.RotateSize) ||
+		(Options.RotateDaily && MGetStrLocalTime(MDT_YMD) != FileDate))
+		Rotate();
+
+	if (File.is_open())
+	{
+		FileSize += File.write(Pending.data(), Pending.size());
+		File.flush();
+	}
+	Pending.clear();
+}
+
+bool MLogWriter::Open(bool Truncate)
+{
+	if (!File.open(Path.c_str(), (Truncate ? MFile::Clear : MFile::Append) | MFile::Text))
+		return false;
+
+	FileSize = Truncate ? 0 : File.size();
+	FileDate = MGetStrLocalTime(MDT_YMD);
+	return true;
+}
+
+void MLogWriter::Rotate()
+{
+	File.close();
+
+	auto RotatedPath = Path + "." + FileDate;
+	for (int i = 1; MFile::Exists(RotatedPath.c_str()); ++i)
+		RotatedPath = Path + "." + FileDate + "." + std::to_string(i);
+
+	// If it can't be moved, keep appending to it rather than losing what's in it.
+	Open(!MFile::Move(Path.c_str(), RotatedPath.c_str()));
+}
@@ -37,11 +37,11 @@ std::string MGetStrLocalTime(MDateType DateType)
 	auto t = time(nullptr);
 	tm TM;
 #ifdef _MSC_VER
-	auto ret = localtime_s(&TM, &t);
+	auto ok = localtime_s(&TM, &t) == 0;
 #else
-	auto ret = localtime_r(&t, &TM);
+	auto ok = localtime_r(&t, &TM) != nullptr;
 #endif
-	if (ret != 0)
+	if (!ok)
 	{
 		return{};
 	}
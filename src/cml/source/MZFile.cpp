@@ -62,18 +62,6 @@ bool MZFile::Open(const char* szFileName, MZFileSystem* pZFS)
 			return false;
 		}
 
-		// Check if it's in the file cache.
-		{
-			auto CacheIt = pZFS->CachedFileMap.find(pDesc);
-			if (CacheIt != pZFS->CachedFileMap.end())
-			{
-				Data = DataPtr{ CacheIt->second.get(), MaybeArrayDeleter{ false } };
-				FileSize = pDesc->Size;
-				this->Desc = pDesc;
-				return true;
-			}
-		}
-
 		if (!pDesc->ArchivePath.empty())
 		{
 			return OpenArchive(*pDesc, *pZFS);
@@ -91,6 +79,16 @@ bool MZFile::Open(const char* szFileName, MZFileSystem* pZFS)
 
 bool MZFile::OpenArchive(const MZFileDesc& Desc, MZFileSystem& FS)
 {
+	// Read through the file system's mapping of the archive if there is one.
+	// The data is only inflated, or pointed at, once it's read.
+	if (FS.GetArchiveData(Desc))
+	{
+		this->Desc = &Desc;
+		this->FS = &FS;
+		FileSize = Desc.Size;
+		return true;
+	}
+
 	char FullArchivePath[MFile::MaxPath];
 	GetFullArchivePath(FullArchivePath, Desc, FS);
 
@@ -112,7 +110,9 @@ void MZFile::Close()
 {
 	fp = nullptr;
 	Data = nullptr;
+	SharedData = nullptr;
 	Desc = nullptr;
+	FS = nullptr;
 	Pos = 0;
 	FileSize = 0;
 }
@@ -211,6 +211,28 @@ bool MZFile::Read(void* pBuffer, int nMaxSize)
 
 bool MZFile::LoadFile()
 {
+	if (IsArchive() && FS)
+	{
+		if (Desc->CompressedSize == 0)
+		{
+			// Stored, so the mapped archive has the file as is.
+			auto* ArchiveData = FS->GetArchiveData(*Desc);
+			if (!ArchiveData)
+				return false;
+			SetSharedData(ArchiveData);
+			return true;
+		}
+
+		SharedData = FS->GetInflatedFile(*Desc);
+		if (!SharedData)
+		{
+			assert(false);
+			return false;
+		}
+		SetSharedData(SharedData.get());
+		return true;
+	}
+
 	SetData(new char[FileSize + 1], true);
 	Data[FileSize] = 0;
 
@@ -260,10 +282,34 @@ bool MZFile::LoadFile()
 	return true;
 }
 
+const char* MZFile::GetData()
+{
+	if (!Data) {
+		if (!LoadFile()) {
+			return nullptr;
+		}
+	}
+
+	return Data.get();
+}
+
 MZFile::DataPtr MZFile::Release()
 {
 	if (!Data) {
-		LoadFile();
+		if (!LoadFile()) {
+			return DataPtr{ nullptr, MaybeArrayDeleter{ false } };
+		}
+	}
+
+	if (!OwnsData())
+	{
+		// Shared with the file system, so the caller gets its own copy.
+		DataPtr Copy{ new char[FileSize + 1], MaybeArrayDeleter{ true } };
+		memcpy(Copy.get(), Data.get(), FileSize);
+		Copy[FileSize] = 0;
+		Data = nullptr;
+		SharedData = nullptr;
+		return Copy;
 	}
 
 	return std::move(Data);
@@ -4,11 +4,18 @@
 #include "MZip.h"
 #include "FileInfo.h"
 #include "zip/zlib.h"
+#include "zlib_util.h"
 #include "MDebug.h"
 #include "MUtil.h"
 #include <algorithm>
 #include <cassert>
 #include "Arena.h"
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 static void ReplaceBackSlashToSlash(char* szPath)
 {
@@ -83,6 +90,107 @@ static bool IsArchivePath(const StringView& Path)
 	return Ext && (_stricmp(Ext, "." DEF_EXT) == 0 || _stricmp(Ext, ".zip") == 0);
 }
 
+// Read-only view of a whole file.
+class MMappedFile
+{
+public:
+	MMappedFile(const char* Filename);
+	MMappedFile(const MMappedFile&) = delete;
+	MMappedFile& operator=(const MMappedFile&) = delete;
+	~MMappedFile();
+
+	bool Dead() const { return View == nullptr; }
+	auto GetPointer() const { return static_cast<const char*>(View); }
+	auto GetSize() const { return Size; }
+
+private:
+#ifdef WIN32
+	HANDLE File = INVALID_HANDLE_VALUE;
+	HANDLE Mapping = NULL;
+#endif
+	void* View = nullptr;
+	size_t Size = 0;
+};
+
+#ifdef WIN32
+MMappedFile::MMappedFile(const char* Filename)
+{
+	File = CreateFileA(Filename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		MLog("MMappedFile::MMappedFile - CreateFile failed on %s! GetLastError() = %d\n",
+			Filename, GetLastError());
+		return;
+	}
+
+	Size = GetFileSize(File, nullptr);
+	if (Size == 0)
+		return;
+
+	Mapping = CreateFileMapping(File, 0, PAGE_READONLY, 0, 0, nullptr);
+	if (Mapping == NULL)
+	{
+		MLog("MMappedFile::MMappedFile - CreateFileMapping failed on %s! GetLastError() = %d\n",
+			Filename, GetLastError());
+		return;
+	}
+
+	View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+	if (View == NULL)
+	{
+		MLog("MMappedFile::MMappedFile - MapViewOfFile failed on %s! GetLastError() = %d\n",
+			Filename, GetLastError());
+		return;
+	}
+}
+
+MMappedFile::~MMappedFile()
+{
+	if (View) {
+		auto Success = UnmapViewOfFile(View);
+		assert(Success);
+	}
+	if (Mapping != NULL) {
+		auto Success = CloseHandle(Mapping);
+		assert(Success);
+	}
+	if (File != INVALID_HANDLE_VALUE) {
+		auto Success = CloseHandle(File);
+		assert(Success);
+	}
+}
+#else
+MMappedFile::MMappedFile(const char* Filename)
+{
+	const auto fd = open(Filename, O_RDONLY);
+	if (fd == -1)
+	{
+		MLog("MMappedFile::MMappedFile - open failed on %s! errno = %d\n", Filename, errno);
+		return;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		Size = static_cast<size_t>(st.st_size);
+		auto ptr = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (ptr != MAP_FAILED)
+			View = ptr;
+		else
+			MLog("MMappedFile::MMappedFile - mmap failed on %s! errno = %d\n", Filename, errno);
+	}
+
+	// The mapping keeps the file alive.
+	close(fd);
+}
+
+MMappedFile::~MMappedFile()
+{
+	if (View)
+		munmap(View, Size);
+}
+#endif
+
 template <typename T>
 using AllocType = ArenaAllocator<T>;
 
@@ -206,16 +314,26 @@ void MZFileSystem::MakeDirectoryTree(PreprocessedFileTree& Tree,
 				BasePath.c_str(),
 				Subdir.ArchivePath.size(), Subdir.ArchivePath.data());
 
-			auto fp = fopen(FullArchivePath, "rb");
-			if (!fp)
+			// Reading the directory out of a mapping is much cheaper than
+			// the seek and read per file that MZip does on a FILE.
+			MMappedFile File{ FullArchivePath };
+			MZip Zip;
+			if (!File.Dead())
 			{
-				MLog("fopen on %s failed\n", FullArchivePath);
-				assert(false);
-				continue;
+				Zip.Initialize(File.GetPointer(), File.GetSize(), MZFile::GetReadMode());
+			}
+			else
+			{
+				auto fp = fopen(FullArchivePath, "rb");
+				if (!fp)
+				{
+					MLog("fopen on %s failed\n", FullArchivePath);
+					assert(false);
+					continue;
+				}
+
+				Zip.Initialize(fp, MZFile::GetReadMode());
 			}
-
-			MZip Zip;
-			Zip.Initialize(fp, MZFile::GetReadMode());
 
 			AddFilesInArchive(Tree, Subdir, Zip);
 
@@ -404,163 +522,151 @@ int MZFileSystem::GetFileLength(const StringView& szFileName)
 	return pDesc->Size;
 }
 
-#ifdef WIN32
-class MMappedFile
-{
-public:
-	MMappedFile() {}
-	MMappedFile(const char* Filename);
-	MMappedFile(const MMappedFile&) = delete;
-	MMappedFile(MMappedFile&&);
-	~MMappedFile();
-	MMappedFile& operator =(MMappedFile&& src)
-	{
-		this->~MMappedFile();
-		new (this) MMappedFile(std::move(src));
-		return *this;
-	}
-
-	bool Dead() const { return bDead; }
-	auto GetPointer() const { return reinterpret_cast<const char*>(View); }
-	auto GetSize() const { return Size; }
-
-private:
-	bool bDead = true;
-	HANDLE File = INVALID_HANDLE_VALUE;
-	HANDLE Mapping = INVALID_HANDLE_VALUE;
-	HANDLE View = INVALID_HANDLE_VALUE;
-	size_t Size = 0;
-};
-#endif
-
-#ifdef WIN32
-#define ARCHIVE_CACHE_MMAP
-#endif
-
 void MZFileSystem::CacheArchive(const StringView& Filename)
 {
-	char FilenameWithExtension[MFile::MaxPath];
-	sprintf_safe(FilenameWithExtension, "%.*s.%s", Filename.size(), Filename.data(), DEF_EXT);
-
-	MZip Zip;
-
-#ifdef ARCHIVE_CACHE_MMAP
-	MMappedFile File{ FilenameWithExtension };
-	if (File.Dead())
-	{
-		MLog("MZFileSystem::CacheArchive -- Failed to load file %s!\n", FilenameWithExtension);
-		return;
-	}
-
-	const auto ZipInitialized = Zip.Initialize(File.GetPointer(), File.GetSize(), MZFile::GetReadMode());
-#else
-	auto fp = fopen(FilenameWithExtension, "rb");
-	if (!fp)
+	auto Dir = GetDirectory(Filename);
+	if (!Dir)
 	{
-		MLog("MZFileSystem::CacheArchive -- fopen_s failed on %s\n", Filename);
-		return;
-	}
-
-	const auto ZipInitialized = Zip.Initialize(fp, MZFile::GetReadMode());
-#endif
-
-	if (!ZipInitialized)
-	{
-		MLog("MZFileSystem::CacheArchive -- MZip::Initialize on %s failed!\n", Filename);
+		MLog("MZFileSystem::CacheArchive -- Couldn't find archive %.*s\n",
+			Filename.size(), Filename.data());
 		return;
 	}
 
-	auto FileCount = Zip.GetFileCount();
-	for (int i = 0; i < FileCount; i++)
+	int CachedCount = 0;
+	for (auto&& File : FilesInDirRecursive(*Dir))
 	{
-		char Name[64];
-		Zip.GetFileName(i, Name);
-		char AbsName[64];
-		sprintf_safe(AbsName, "%.*s/%s", Filename.size(), Filename.data(), Name);
-		auto Desc = GetFileDesc(AbsName);
-		if (!Desc)
-		{
-			DMLog("Couldn't find file desc for %s\n", AbsName);
-			continue;
-		}
-		if (Desc->ArchivePath == FilenameWithExtension)
+		if (File.ArchivePath.empty() || File.CompressedSize == 0)
 			continue;
-		auto Size = Zip.GetFileLength(i);
 
-		auto p = std::make_unique<char[]>(Size);
-		if (!Zip.ReadFile(i, p.get(), Size)) {
-			MLog("MZFileSystem::CacheArchive - MZip::ReadFile on %s failed!\n", Name);
-			continue;
+		{
+			std::lock_guard<std::mutex> Lock{ InflatedFileMutex };
+			if (InflatedFileCacheBytes + File.Size > MaxInflatedFileCacheBytes)
+				break;
 		}
 
-		CachedFileMap.emplace(Desc, std::move(p));
+		if (GetInflatedFile(File))
+			++CachedCount;
 	}
 
-	DMLog("Cached %d files for archive %s\n", FileCount, Filename);
+	DMLog("Cached %d files for archive %.*s\n", CachedCount, Filename.size(), Filename.data());
 }
 
 void MZFileSystem::ReleaseCachedArchives()
 {
-	CachedFileMap.clear();
+	std::lock_guard<std::mutex> Lock{ InflatedFileMutex };
+	InflatedFiles.clear();
+	InflatedFileMap.clear();
+	InflatedFileCacheBytes = 0;
 }
 
-#ifdef WIN32
-MMappedFile::MMappedFile(const char * Filename)
+void MZFileSystem::SetInflatedFileCacheSize(size_t Size)
 {
-	File = CreateFileA(Filename, GENERIC_READ, 0, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
-	if (File == INVALID_HANDLE_VALUE)
+	std::lock_guard<std::mutex> Lock{ InflatedFileMutex };
+	MaxInflatedFileCacheBytes = Size;
+	while (InflatedFileCacheBytes > MaxInflatedFileCacheBytes)
 	{
-		MLog("MMappedFile::MMappedFile - CreateFile failed on %s! GetLastError() = %d\n",
-			Filename, GetLastError());
-		return;
+		auto& Oldest = InflatedFiles.back();
+		InflatedFileCacheBytes -= Oldest.Desc->Size + 1;
+		InflatedFileMap.erase(Oldest.Desc);
+		InflatedFiles.pop_back();
 	}
+}
 
-	Size = GetFileSize(File, nullptr);
+const char* MZFileSystem::GetArchiveData(const MZFileDesc& Desc)
+{
+	if (Desc.ArchivePath.empty())
+		return nullptr;
 
-	char FileMappingName[256];
-	sprintf_safe(FileMappingName, "GunzCache_%s", Filename);
-	Mapping = CreateFileMapping(File, 0, PAGE_READONLY, 0, 0, FileMappingName);
-	if (Mapping == NULL)
+	std::lock_guard<std::mutex> Lock{ ArchiveMutex };
+
+	auto it = Archives.find(Desc.ArchivePath.data());
+	if (it == Archives.end())
 	{
-		assert(false);
-		return;
+		char FullArchivePath[MFile::MaxPath];
+		sprintf_safe(FullArchivePath, "%s%.*s",
+			BasePath.c_str(),
+			Desc.ArchivePath.size(), Desc.ArchivePath.data());
+
+		// A failed mapping is stored too, so that it's not retried on every open.
+		it = Archives.emplace(Desc.ArchivePath.data(),
+			std::make_unique<MMappedFile>(FullArchivePath)).first;
 	}
 
-	View = MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
-	if (View == NULL)
+	auto& File = *it->second;
+	if (File.Dead())
+		return nullptr;
+
+	// The directory of a truncated or corrupt archive can point past the end of it.
+	const auto DataSize = Desc.CompressedSize ? Desc.CompressedSize : Desc.Size;
+	if (Desc.ArchiveOffset > File.GetSize() || DataSize > File.GetSize() - Desc.ArchiveOffset)
 	{
-		assert(false);
-		return;
+		MLog("MZFileSystem::GetArchiveData -- %.*s is at %zu, %zu bytes, past the end of %.*s, "
+			"which is %zu bytes\n",
+			Desc.Path.size(), Desc.Path.data(), Desc.ArchiveOffset, DataSize,
+			Desc.ArchivePath.size(), Desc.ArchivePath.data(), File.GetSize());
+		return nullptr;
 	}
 
-	bDead = false;
+	return File.GetPointer() + Desc.ArchiveOffset;
 }
 
-MMappedFile::~MMappedFile()
+std::shared_ptr<const char> MZFileSystem::GetInflatedFile(const MZFileDesc& Desc)
 {
-	if (View != INVALID_HANDLE_VALUE) {
-		auto Success = UnmapViewOfFile(View);
-		assert(Success);
+	{
+		std::lock_guard<std::mutex> Lock{ InflatedFileMutex };
+		auto it = InflatedFileMap.find(&Desc);
+		if (it != InflatedFileMap.end())
+		{
+			InflatedFiles.splice(InflatedFiles.begin(), InflatedFiles, it->second);
+			return it->second->Data;
+		}
 	}
-	if (Mapping != INVALID_HANDLE_VALUE) {
-		auto Success = CloseHandle(Mapping);
-		assert(Success);
+
+	auto ArchiveData = GetArchiveData(Desc);
+	if (!ArchiveData)
+		return nullptr;
+
+	// Inflate without holding the lock. If another thread inflates the same file in the
+	// meantime, one of the copies is simply dropped.
+	std::shared_ptr<char> Data{ new char[Desc.Size + 1], std::default_delete<char[]>{} };
+	Data.get()[Desc.Size] = 0;
+
+	auto ret = InflateMemory(Data.get(), Desc.Size,
+		ArchiveData, Desc.CompressedSize, -MAX_WBITS);
+	if (ret.ErrorCode < 0 || ret.BytesWritten != Desc.Size)
+	{
+		MLog("MZFileSystem::GetInflatedFile -- InflateMemory failed on %.*s with error code %d, "
+			"error message: %s, written %d, read %d\n",
+			Desc.Path.size(), Desc.Path.data(),
+			ret.ErrorCode, ret.ErrorMessage, ret.BytesWritten, ret.BytesRead);
+		return nullptr;
 	}
-	if (File != INVALID_HANDLE_VALUE) {
-		auto Success = CloseHandle(File);
-		assert(Success);
+
+	const auto EntrySize = Desc.Size + 1;
+
+	std::lock_guard<std::mutex> Lock{ InflatedFileMutex };
+
+	if (EntrySize > MaxInflatedFileCacheBytes)
+		return Data;
+
+	auto it = InflatedFileMap.find(&Desc);
+	if (it != InflatedFileMap.end())
+		return it->second->Data;
+
+	while (InflatedFileCacheBytes + EntrySize > MaxInflatedFileCacheBytes)
+	{
+		auto& Oldest = InflatedFiles.back();
+		InflatedFileCacheBytes -= Oldest.Desc->Size + 1;
+		InflatedFileMap.erase(Oldest.Desc);
+		InflatedFiles.pop_back();
 	}
-}
 
-MMappedFile::MMappedFile(MMappedFile && src)
-	: bDead(src.bDead), View(src.View), Mapping(src.Mapping), File(src.File)
-{
-	src.bDead = true;
-	src.View = INVALID_HANDLE_VALUE;
-	src.Mapping = INVALID_HANDLE_VALUE;
-	src.File = INVALID_HANDLE_VALUE;
+	InflatedFiles.push_front({ &Desc, Data });
+	InflatedFileMap.emplace(&Desc, InflatedFiles.begin());
+	InflatedFileCacheBytes += EntrySize;
+
+	return Data;
 }
-#endif
 
 static const MZDirDesc* Down(const MZDirDesc* Dir);
 
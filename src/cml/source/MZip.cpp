@@ -8,8 +8,9 @@
 #include "zlib_util.h"
 #include <algorithm>
 
-typedef unsigned long dword;
-typedef unsigned short word;
+// Fixed width, since the headers below are read straight from the file.
+typedef u32 dword;
+typedef u16 word;
 
 #define MRS_ZIP_CODE	0x05030207
 #define MRS2_ZIP_CODE	0x05030208
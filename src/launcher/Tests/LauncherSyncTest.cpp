@@ -0,0 +1,500 @@
+#include "Sync.h"
+#include "Download.h"
+#include "Hash.h"
+#include "RollingHashFilter.h"
+#include "MFile.h"
+#include "MSocket.h"
+#include "MTest.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <csignal>
+#include <unistd.h>
+#endif
+
+// Checks the pieces the launcher patches files with:
+//
+// - RollingHashFilter never turns away a hash that was added, and lets few of the others through.
+// - DownloadRanges gets each range byte for byte, from a loopback HTTP server that serves range
+//   requests and counts how many are in flight at once, and from file:// URLs, and fails when a
+//   range can't be had.
+// - Sync::SynchronizeFile rebuilds a remote file from a local one that's identical, edited,
+//   shifted, reordered, truncated, unrelated or empty, fetching the missing blocks through
+//   file:// URLs, and reports the expected block counts.
+
+namespace {
+
+const auto BlockSize = LauncherConfig::BlockSize;
+
+const char RemotePath[] = "LauncherSyncTestRemote.bin";
+const char SyncPath[] = "LauncherSyncTestRemote.bin.sync";
+const char LocalPath[] = "LauncherSyncTestLocal.bin";
+const char OutputPath[] = "LauncherSyncTestOutput.bin";
+
+std::mt19937 Rng{ 24680 };
+
+std::string RandomData(size_t Size)
+{
+	std::string Data(Size, 0);
+	for (auto& c : Data)
+		c = char(Rng());
+	return Data;
+}
+
+void WriteFile(const char* Path, const std::string& Data)
+{
+	MFile::RWFile File{ Path, MFile::Clear };
+	MTEST_CHECK(!File.error());
+	if (!Data.empty())
+		MTEST_CHECK(File.write(Data.data(), Data.size()) == Data.size());
+}
+
+std::string ReadFile(const char* Path)
+{
+	MFile::File File{ Path };
+	if (File.error())
+		return "<missing>";
+	std::string Data(size_t(File.size()), 0);
+	if (!Data.empty())
+		File.read(&Data[0], Data.size());
+	return Data;
+}
+
+std::string FileURL(const char* Path)
+{
+	char Dir[MFile::MaxPath];
+#ifdef _WIN32
+	_getcwd(Dir, sizeof(Dir));
+	std::string URL = std::string{ "file:///" } + Dir + "/" + Path;
+	for (auto& c : URL)
+		if (c == '\\')
+			c = '/';
+	return URL;
+#else
+	MTEST_CHECK(getcwd(Dir, sizeof(Dir)) != nullptr);
+	return std::string{ "file://" } + Dir + "/" + Path;
+#endif
+}
+
+void TestFilter(size_t NumHashes, size_t NumProbes)
+{
+	std::unordered_set<u32> Added;
+	Sync::RollingHashFilter Filter;
+	Filter.Create(NumHashes);
+	while (Added.size() < NumHashes)
+	{
+		Hash::Rolling Hash;
+		Hash.Value = u32(Rng());
+		Added.insert(Hash.Value);
+		Filter.Add(Hash);
+	}
+
+	int FalseNegatives = 0;
+	for (auto Value : Added)
+	{
+		Hash::Rolling Hash;
+		Hash.Value = Value;
+		FalseNegatives += !Filter.MayContain(Hash);
+	}
+	MTEST_CHECK(FalseNegatives == 0);
+
+	std::vector<Hash::Rolling> Probes;
+	while (Probes.size() < NumProbes)
+	{
+		Hash::Rolling Hash;
+		Hash.Value = u32(Rng());
+		if (!Added.count(Hash.Value))
+			Probes.push_back(Hash);
+	}
+
+	size_t FalsePositives = 0;
+	const auto ProbeTime = MTestTimeMS([&] {
+		for (auto& Hash : Probes)
+			FalsePositives += Filter.MayContain(Hash);
+	});
+	const auto Rate = double(FalsePositives) / NumProbes;
+	// About 1.4% in theory, at 16 bits per hash with two of them.
+	MTEST_CHECK(Rate < 0.03);
+
+	std::printf("Filter with %zu hashes: %.2f%% false positives, %.1f ns per probe\n",
+		NumHashes, Rate * 100, ProbeTime * 1e6 / NumProbes);
+}
+
+// Serves Data over HTTP on a loopback port, answering "Range: bytes=First-Last" requests with
+// 206 and that range, or 416 if it's out of bounds. Each connection gets a thread of its own and
+// waits a bit before answering, so that the requests a client makes at once overlap here.
+class RangeServer
+{
+public:
+	std::string Data;
+	std::atomic<int> Requests{ 0 };
+	std::atomic<int> MaxActive{ 0 };
+
+	bool Create(std::string Data)
+	{
+		this->Data = std::move(Data);
+
+		ListenSocket = MSocket::socket(MSocket::AF::INET, MSocket::SOCK::STREAM, 0);
+		if (ListenSocket == MSocket::InvalidSocket)
+			return false;
+
+		MSocket::sockaddr_in Address{};
+		Address.sin_family = MSocket::AF::INET;
+		Address.sin_addr.s_addr = MSocket::htonl(0x7F000001);
+		Address.sin_port = 0;
+		int AddressSize = sizeof(Address);
+		if (MSocket::bind(ListenSocket, reinterpret_cast<MSocket::sockaddr*>(&Address),
+				sizeof(Address)) == MSocket::SocketError ||
+			MSocket::listen(ListenSocket, 16) == MSocket::SocketError ||
+			MSocket::getsockname(ListenSocket, reinterpret_cast<MSocket::sockaddr*>(&Address),
+				&AddressSize) == MSocket::SocketError)
+		{
+			MSocket::closesocket(ListenSocket);
+			return false;
+		}
+
+		Port = MSocket::ntohs(Address.sin_port);
+		Thread = std::thread{ [this] { AcceptLoop(); } };
+		return true;
+	}
+
+	void Destroy()
+	{
+		Stopping = true;
+		MSocket::shutdown(ListenSocket, MSocket::SD::BOTH);
+#ifdef _WIN32
+		MSocket::closesocket(ListenSocket);
+#endif
+		Thread.join();
+#ifndef _WIN32
+		MSocket::closesocket(ListenSocket);
+#endif
+		for (auto& Connection : Connections)
+			Connection.join();
+	}
+
+	std::string URL() const { return "http://127.0.0.1:" + std::to_string(Port) + "/file.bin"; }
+	int GetPort() const { return Port; }
+
+private:
+	void AcceptLoop()
+	{
+		while (!Stopping)
+		{
+			auto Socket = MSocket::accept(ListenSocket, nullptr, nullptr);
+			if (Socket == MSocket::InvalidSocket)
+				continue;
+			Connections.emplace_back([this, Socket] { Serve(Socket); });
+		}
+	}
+
+	void Serve(SOCKET Socket)
+	{
+		std::string Request;
+		char Buffer[1024];
+		while (Request.find("\r\n\r\n") == std::string::npos)
+		{
+			auto Received = MSocket::recv(Socket, Buffer, sizeof(Buffer), 0);
+			if (Received <= 0)
+			{
+				MSocket::closesocket(Socket);
+				return;
+			}
+			Request.append(Buffer, Received);
+		}
+
+		++Requests;
+		const auto NowActive = ++Active;
+		auto Max = MaxActive.load();
+		while (NowActive > Max && !MaxActive.compare_exchange_weak(Max, NowActive))
+			;
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+		unsigned long long First = 0, Last = 0;
+		const auto RangeHeader = strstr(Request.c_str(), "Range: bytes=");
+		std::string Response;
+		if (!RangeHeader || sscanf(RangeHeader, "Range: bytes=%llu-%llu", &First, &Last) != 2 ||
+			First > Last || Last >= Data.size())
+		{
+			Response = "HTTP/1.0 416 Range Not Satisfiable\r\nContent-Length: 0\r\n"
+				"Connection: close\r\n\r\n";
+		}
+		else
+		{
+			char Header[256];
+			sprintf_safe(Header, "HTTP/1.0 206 Partial Content\r\n"
+				"Content-Range: bytes %llu-%llu/%zu\r\n"
+				"Content-Length: %llu\r\n"
+				"Connection: close\r\n\r\n", First, Last, Data.size(), Last - First + 1);
+			Response = Header + Data.substr(size_t(First), size_t(Last - First + 1));
+		}
+		--Active;
+
+		size_t Sent = 0;
+		while (Sent < Response.size())
+		{
+			auto Result = MSocket::send(Socket, Response.data() + Sent,
+				int(Response.size() - Sent), 0);
+			if (Result <= 0)
+				break;
+			Sent += Result;
+		}
+
+		MSocket::shutdown(Socket, MSocket::SD::SEND);
+		while (MSocket::recv(Socket, Buffer, sizeof(Buffer), 0) > 0)
+			;
+		MSocket::closesocket(Socket);
+	}
+
+	SOCKET ListenSocket = MSocket::InvalidSocket;
+	int Port = 0;
+	std::atomic<bool> Stopping{ false };
+	std::atomic<int> Active{ 0 };
+	std::thread Thread;
+	// Only touched by the accept thread until Destroy joins it.
+	std::vector<std::thread> Connections;
+};
+
+std::vector<DownloadRange> RandomRanges(size_t FileSize, int Count)
+{
+	std::vector<DownloadRange> Ranges;
+	// The first and last bytes, and a single byte, are the edge cases.
+	Ranges.push_back({ 0, BlockSize - 1 });
+	Ranges.push_back({ FileSize - 1, FileSize - 1 });
+	Ranges.push_back({ 12345, 12345 });
+	while (int(Ranges.size()) < Count)
+	{
+		const auto First = Rng() % FileSize;
+		const auto Last = First + (std::min)(u64(Rng() % (4 * BlockSize)), FileSize - 1 - First);
+		Ranges.push_back({ First, Last });
+	}
+	return Ranges;
+}
+
+// Downloads the ranges and checks that each one came back whole and in order. Returns the time
+// it took in milliseconds.
+double CheckRanges(const DownloadManagerType& DownloadManager, const char* URL, int Port,
+	const std::string& Data, const std::vector<DownloadRange>& Ranges, int MaxConnections)
+{
+	std::vector<std::string> Received(Ranges.size());
+	int NotRanges = 0;
+	size_t LastTotal = 0, LastNow = 0;
+	auto Callback = [&](size_t RangeIndex, const u8* Buffer, size_t Size, DownloadInfo& Info)
+	{
+		NotRanges += !Info.IsRange();
+		Received[RangeIndex].append(reinterpret_cast<const char*>(Buffer), Size);
+		return true;
+	};
+	auto Progress = [&](size_t DLTotal, size_t DLNow)
+	{
+		MTEST_CHECK(DLNow >= LastNow);
+		LastTotal = DLTotal;
+		LastNow = DLNow;
+	};
+
+	bool Success = false;
+	DownloadError Error{};
+	const auto Time = MTestTimeMS([&] {
+		Success = DownloadRanges(DownloadManager, URL, Port, Ranges, MaxConnections,
+			std::ref(Callback), std::ref(Progress), &Error);
+	});
+	MTEST_CHECK(Success);
+	if (!Success)
+		std::printf("DownloadRanges failed: %s\n", Error.String);
+
+	MTEST_CHECK(NotRanges == 0);
+	int Mismatches = 0;
+	u64 TotalSize = 0;
+	for (size_t i = 0; i < Ranges.size(); ++i)
+	{
+		TotalSize += Ranges[i].size();
+		Mismatches += Received[i] != Data.substr(size_t(Ranges[i].First), size_t(Ranges[i].size()));
+	}
+	MTEST_CHECK(Mismatches == 0);
+	MTEST_CHECK(LastTotal == TotalSize && LastNow == TotalSize);
+	return Time;
+}
+
+void TestDownloadRanges(const DownloadManagerType& DownloadManager)
+{
+	const auto Data = RandomData(1024 * 1024 + 77);
+	const auto Ranges = RandomRanges(Data.size(), 40);
+
+	RangeServer Server;
+	MTEST_CHECK(Server.Create(Data));
+	const auto URL = Server.URL();
+
+	const auto ConcurrentTime = CheckRanges(DownloadManager, URL.c_str(), Server.GetPort(),
+		Data, Ranges, LauncherConfig::MaxConcurrentDownloads);
+	MTEST_CHECK(Server.Requests == int(Ranges.size()));
+	MTEST_CHECK(Server.MaxActive > 1 && Server.MaxActive <= LauncherConfig::MaxConcurrentDownloads);
+	const auto ConcurrentMax = Server.MaxActive.load();
+
+	Server.MaxActive = 0;
+	const auto SerialTime = CheckRanges(DownloadManager, URL.c_str(), Server.GetPort(),
+		Data, Ranges, 1);
+	MTEST_CHECK(Server.MaxActive == 1);
+
+	std::printf("%zu ranges over HTTP: %.1f ms with %d connections (at most %d at once), "
+		"%.1f ms with 1\n", Ranges.size(), ConcurrentTime, LauncherConfig::MaxConcurrentDownloads,
+		ConcurrentMax, SerialTime);
+
+	// Nothing to do is a success, without a request.
+	const auto RequestsBefore = Server.Requests.load();
+	MTEST_CHECK(DownloadRanges(DownloadManager, URL.c_str(), Server.GetPort(), {}, 4,
+		[](size_t, const u8*, size_t, DownloadInfo&) { return true; }));
+	MTEST_CHECK(Server.Requests == RequestsBefore);
+
+	// A range past the end of the file fails the whole thing, and says which one it was.
+	auto BadRanges = Ranges;
+	BadRanges[5] = { Data.size(), Data.size() + 10 };
+	DownloadError Error{};
+	MTEST_CHECK(!DownloadRanges(DownloadManager, URL.c_str(), Server.GetPort(), BadRanges, 4,
+		[](size_t, const u8*, size_t, DownloadInfo&) { return true; }, {}, &Error));
+	MTEST_CHECK(strstr(Error.String, "416") != nullptr);
+
+	// So does a callback that asks to stop.
+	MTEST_CHECK(!DownloadRanges(DownloadManager, URL.c_str(), Server.GetPort(), Ranges, 4,
+		[](size_t RangeIndex, const u8*, size_t, DownloadInfo&) { return RangeIndex != 3; }));
+
+	Server.Destroy();
+
+	// The same ranges out of a file.
+	WriteFile(RemotePath, Data);
+	const auto RemoteURL = FileURL(RemotePath);
+	const auto FileTime = CheckRanges(DownloadManager, RemoteURL.c_str(),
+		LauncherConfig::PatchPort, Data, Ranges, LauncherConfig::MaxConcurrentDownloads);
+	std::printf("%zu ranges from a file: %.1f ms\n", Ranges.size(), FileTime);
+}
+
+// Synchronizes Local with Remote through file:// URLs and checks that the output is Remote,
+// with the block counts expected. Returns the time it took in milliseconds.
+double CheckSync(const char* Name, const std::string& Remote, const std::string& Local,
+	size_t ExpectedUnmatching, DownloadManagerType& DownloadManager, Sync::Memory& Memory)
+{
+	WriteFile(RemotePath, Remote);
+	WriteFile(LocalPath, Local);
+	MTEST_CHECK(Sync::MakeSyncFile(SyncPath, RemotePath));
+	MFile::Delete(OutputPath);
+
+	const auto RemoteURL = FileURL(RemotePath);
+	const auto SyncURL = FileURL(SyncPath);
+
+	Sync::SyncResult Result{};
+	Hash::Strong OutputHash{};
+	u64 OutputSize = 0;
+	Sync::BlockCounts Counts{};
+	const auto Time = MTestTimeMS([&] {
+		Result = Sync::SynchronizeFile(Memory, LocalPath, OutputPath, RemoteURL.c_str(),
+			SyncURL.c_str(), Remote.size(), DownloadManager, {}, &OutputHash, &OutputSize, &Counts);
+	});
+
+	MTEST_CHECK(Result.Success);
+	if (!Result.Success)
+		std::printf("%s: %s\n", Name, Result.ErrorMessage.c_str());
+
+	const auto Output = ReadFile(OutputPath);
+	MTEST_CHECK(Output == Remote);
+	Hash::Strong RemoteHash;
+	RemoteHash.HashMemory(Remote.data(), Remote.size());
+	MTEST_CHECK(OutputHash == RemoteHash);
+	MTEST_CHECK(OutputSize == Remote.size());
+
+	const auto NumBlocks = (Remote.size() + BlockSize - 1) / BlockSize;
+	MTEST_CHECK(Counts.MatchingBlocks + Counts.UnmatchingBlocks == NumBlocks);
+	MTEST_CHECK(Counts.UnmatchingBlocks == ExpectedUnmatching);
+
+	std::printf("%-28s %zu of %zu blocks downloaded in %.1f ms\n", Name,
+		Counts.UnmatchingBlocks, size_t(NumBlocks), Time);
+	return Time;
+}
+
+void TestSync(DownloadManagerType& DownloadManager)
+{
+	Sync::Memory Memory;
+
+	// 40 whole blocks and a short last one.
+	const auto Remote = RandomData(40 * BlockSize + 1000);
+	const size_t NumBlocks = 41;
+
+	CheckSync("Identical", Remote, Remote, 0, DownloadManager, Memory);
+
+	auto Edited = Remote;
+	for (size_t Block : { 0, 7, 20, 39, 40 })
+		Edited[Block * BlockSize + 100] ^= 0x55;
+	CheckSync("Edited in 5 blocks", Remote, Edited, 5, DownloadManager, Memory);
+
+	// Everything after the insertion is found at the shifted offsets, as is the last block,
+	// which is looked for at the end of the file.
+	auto Inserted = Remote;
+	Inserted.insert(5 * BlockSize + 10, RandomData(100));
+	CheckSync("Bytes inserted in a block", Remote, Inserted, 1, DownloadManager, Memory);
+
+	auto Swapped = Remote;
+	std::swap_ranges(Swapped.begin() + 3 * BlockSize, Swapped.begin() + 4 * BlockSize,
+		Swapped.begin() + 10 * BlockSize);
+	CheckSync("Blocks swapped", Remote, Swapped, 0, DownloadManager, Memory);
+
+	CheckSync("Truncated to 20 blocks", Remote, Remote.substr(0, 20 * BlockSize), NumBlocks - 20,
+		DownloadManager, Memory);
+	CheckSync("Unrelated", Remote, RandomData(Remote.size()), NumBlocks, DownloadManager, Memory);
+	CheckSync("Empty", Remote, "", NumBlocks, DownloadManager, Memory);
+
+	// Blocks with the same contents share a rolling hash, and are all found from one window.
+	std::string Repeated(8 * BlockSize, 0);
+	Repeated.replace(2 * BlockSize, BlockSize, RandomData(BlockSize));
+	CheckSync("Repeated blocks", Repeated, std::string(BlockSize, 0) + Repeated.substr(2 * BlockSize, BlockSize),
+		0, DownloadManager, Memory);
+
+	const auto Small = RandomData(1000);
+	CheckSync("Smaller than a block", Small, Small, 0, DownloadManager, Memory);
+	CheckSync("Smaller than a block, edited", Small, RandomData(1000), 1, DownloadManager, Memory);
+
+	// Large enough to be scanned in several segments on several threads. A byte in front shifts
+	// every block off the segment boundaries, so the ones straddling them have to be found too.
+	const auto Large = RandomData(600 * BlockSize + 123);
+	auto LargeShifted = "x" + Large;
+	for (size_t Block : { 50, 128, 300, 511 })
+		LargeShifted[1 + Block * BlockSize + 7] ^= 0x55;
+	CheckSync("Large, shifted and edited", Large, LargeShifted, 4, DownloadManager, Memory);
+
+	MFile::Delete(LocalPath);
+	MFile::Delete(SyncPath);
+	MFile::Delete(OutputPath);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+	const int FilterProbes = argc > 1 ? atoi(argv[1]) : 1000000;
+
+	if (!MSocket::Startup())
+		return 1;
+#ifndef _WIN32
+	signal(SIGPIPE, SIG_IGN);
+#endif
+
+	TestFilter(0, 1000);
+	TestFilter(1000, FilterProbes);
+	TestFilter(100000, FilterProbes);
+
+	auto DownloadManager = CreateDownloadManager();
+	MTEST_CHECK(DownloadManager != nullptr);
+	if (DownloadManager)
+	{
+		TestDownloadRanges(DownloadManager);
+		TestSync(DownloadManager);
+	}
+
+	MFile::Delete(RemotePath);
+	return MTestResult();
+}
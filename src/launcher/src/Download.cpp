@@ -3,6 +3,7 @@
 #include "MUtil.h"
 #include "MFile.h"
 #include "Hash.h"
+#include "defer.h"
 
 #include "sodium.h"
 
@@ -271,4 +272,194 @@ bool DownloadFile(const DownloadManagerType& DownloadManager,
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+namespace
+{
+// One connection of DownloadRanges.
+struct RangeTransfer
+{
+	CURL* curl{};
+	size_t RangeIndex{};
+	char Range[64];
+	char ErrorBuffer[CURL_ERROR_SIZE];
+	function_view<RangeDownloadCallbackType> Callback;
+	u64* Received{};
+	CurlWriteData WriteData;
+
+	bool operator()(const u8* Buffer, size_t Size, DownloadInfo& Info)
+	{
+		*Received += Size;
+		return Callback(RangeIndex, Buffer, Size, Info);
+	}
+};
+}
+
+bool DownloadRanges(const DownloadManagerType& DownloadManager,
+	const char* URL,
+	int Port,
+	ArrayView<const DownloadRange> Ranges,
+	int MaxConnections,
+	function_view<RangeDownloadCallbackType> Callback,
+	function_view<ProgressCallbackType> ProgressCallback,
+	DownloadError* ErrorOutput)
+{
+	if (Ranges.empty())
+		return true;
+
+	ProtocolType Protocol;
+	if (!SetProtocol(Protocol, URL))
+	{
+		FormatError(ErrorOutput, "Unrecognized protocol in URL \"%s\"", URL);
+		return false;
+	}
+
+	// The global state is set up by CreateDownloadManager, so the handles here need it alive.
+	if (!DownloadManager)
+	{
+		FormatError(ErrorOutput, "Curl is dead! Can't download files");
+		return false;
+	}
+
+	const auto multi = curl_multi_init();
+	if (!multi)
+	{
+		FormatError(ErrorOutput, "curl_multi_init failed");
+		return false;
+	}
+
+	u64 TotalSize = 0;
+	for (auto&& Range : Ranges)
+		TotalSize += Range.size();
+	u64 Received = 0;
+
+	// Never reallocated, since curl holds pointers into it.
+	const auto NumTransfers = size_t(std::max(1, std::min(MaxConnections, int(Ranges.size()))));
+	std::unique_ptr<RangeTransfer[]> Transfers{ new RangeTransfer[NumTransfers] };
+
+	DEFER([&] {
+		for (size_t i = 0; i < NumTransfers; ++i)
+		{
+			if (!Transfers[i].curl)
+				continue;
+			curl_multi_remove_handle(multi, Transfers[i].curl);
+			curl_easy_cleanup(Transfers[i].curl);
+		}
+		curl_multi_cleanup(multi);
+	});
+
+	size_t NextRange = 0;
+	size_t ActiveTransfers = 0;
+
+	// Starts the next range on the transfer's handle.
+	auto Start = [&](RangeTransfer& Transfer)
+	{
+		Transfer.RangeIndex = NextRange++;
+		auto&& Range = Ranges[Transfer.RangeIndex];
+		sprintf_safe(Transfer.Range, "%llu-%llu", Range.First, Range.Last);
+		Transfer.ErrorBuffer[0] = 0;
+
+		const auto curl = Transfer.curl;
+		curl_easy_setopt_v(curl, CURLOPT_URL, URL);
+		curl_easy_setopt_v(curl, CURLOPT_PORT, Port);
+		curl_easy_setopt_v(curl, CURLOPT_WRITEFUNCTION, CurlWriteFunction);
+		curl_easy_setopt_v(curl, CURLOPT_WRITEDATA, &Transfer.WriteData);
+		curl_easy_setopt_v(curl, CURLOPT_RANGE, Transfer.Range);
+		curl_easy_setopt_v(curl, CURLOPT_FAILONERROR, 1l);
+		curl_easy_setopt_v(curl, CURLOPT_ERRORBUFFER, Transfer.ErrorBuffer);
+		curl_easy_setopt_v(curl, CURLOPT_PRIVATE, &Transfer);
+		curl_easy_setopt_v(curl, CURLOPT_NOPROGRESS, 1l);
+
+		const auto res = curl_multi_add_handle(multi, curl);
+		if (res != CURLM_OK)
+		{
+			FormatError(ErrorOutput, "curl_multi_add_handle returned %d", int(res));
+			return false;
+		}
+
+		++ActiveTransfers;
+		return true;
+	};
+
+	for (size_t i = 0; i < NumTransfers; ++i)
+	{
+		auto&& Transfer = Transfers[i];
+		Transfer.curl = curl_easy_init();
+		if (!Transfer.curl)
+		{
+			FormatError(ErrorOutput, "curl_easy_init failed");
+			return false;
+		}
+
+		Transfer.Callback = Callback;
+		Transfer.Received = &Received;
+		Transfer.WriteData.curl = Transfer.curl;
+		Transfer.WriteData.Callback = Transfer;
+		Transfer.WriteData.Context.curl = Transfer.curl;
+		Transfer.WriteData.Context.Range = Transfer.Range;
+		Transfer.WriteData.Context.Protocol = Protocol;
+
+		if (!Start(Transfer))
+			return false;
+	}
+
+	while (ActiveTransfers > 0)
+	{
+		int Running;
+		const auto PerformRet = curl_multi_perform(multi, &Running);
+		if (PerformRet != CURLM_OK)
+		{
+			FormatError(ErrorOutput, "curl_multi_perform returned %d", int(PerformRet));
+			return false;
+		}
+
+		int Queued;
+		while (auto* Msg = curl_multi_info_read(multi, &Queued))
+		{
+			if (Msg->msg != CURLMSG_DONE)
+				continue;
+
+			RangeTransfer* Transfer;
+			curl_easy_getinfo(Msg->easy_handle, CURLINFO_PRIVATE, reinterpret_cast<char**>(&Transfer));
+			const auto Result = Msg->data.result;
+
+			curl_multi_remove_handle(multi, Transfer->curl);
+			--ActiveTransfers;
+
+			if (Result != CURLE_OK)
+			{
+				if (Result == CURLE_HTTP_RETURNED_ERROR)
+				{
+					FormatError(ErrorOutput, "Received HTTP error code %d when trying to "
+						"download range %s from URL %s",
+						GetCurlResponseCode(Transfer->curl), Transfer->Range, URL);
+				}
+				else
+				{
+					FormatError(ErrorOutput, "Curl error when trying to download range %s from "
+						"URL %s! Code = %d, message = \"%s\"",
+						Transfer->Range, URL, Result,
+						Transfer->ErrorBuffer[0] ? Transfer->ErrorBuffer : curl_easy_strerror(Result));
+				}
+				return false;
+			}
+
+			if (NextRange < Ranges.size() && !Start(*Transfer))
+				return false;
+		}
+
+		if (ProgressCallback)
+			ProgressCallback(size_t(TotalSize), size_t(Received));
+
+		if (ActiveTransfers > 0)
+		{
+			const auto WaitRet = curl_multi_wait(multi, nullptr, 0, 1000, nullptr);
+			if (WaitRet != CURLM_OK)
+			{
+				FormatError(ErrorOutput, "curl_multi_wait returned %d", int(WaitRet));
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
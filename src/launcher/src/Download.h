@@ -5,6 +5,7 @@
 #include "GlobalTypes.h"
 #include "optional.h"
 #include "function_view.h"
+#include "ArrayView.h"
 
 struct DownloadManagerDeleter { void operator()(void*) const; };
 using DownloadManagerType = std::unique_ptr<void, DownloadManagerDeleter>;
@@ -77,4 +78,38 @@ bool DownloadFile(const DownloadManagerType& DownloadManager,
 	function_view<DownloadCallbackType> Callback,
 	function_view<ProgressCallbackType> ProgressCallback = {},
 	const char* Range = nullptr,
-	DownloadError* ErrorOutput = nullptr);
\ No newline at end of file
+	DownloadError* ErrorOutput = nullptr);
+
+// A range of bytes to download with DownloadRanges. Last is inclusive, like in the HTTP header.
+struct DownloadRange
+{
+	u64 First;
+	u64 Last;
+
+	u64 size() const { return Last - First + 1; }
+};
+
+// Same as DownloadCallbackType, except that it also gets the index of the range in the list
+// passed to DownloadRanges that the data belongs to.
+using RangeDownloadCallbackType = bool(size_t RangeIndex, const u8* Buffer, size_t Size,
+	DownloadInfo& Info);
+
+// Downloads a list of ranges of one file, with one request per range and up to MaxConnections
+// requests in flight at once.
+//
+// Like DownloadFile, this blocks until all the ranges are done, and all the callbacks are called
+// from the calling thread. The data of each range comes in order, but the calls for different
+// ranges are interleaved. Nothing is buffered beyond what curl itself holds for each connection,
+// so the memory it takes doesn't grow with the number or size of the ranges.
+//
+// The progress callback gets the total size of the ranges and the number of bytes received so far.
+//
+// Stops and returns false if any request fails or any call to the callback returns false.
+bool DownloadRanges(const DownloadManagerType& DownloadManager,
+	const char* URL,
+	int Port,
+	ArrayView<const DownloadRange> Ranges,
+	int MaxConnections,
+	function_view<RangeDownloadCallbackType> Callback,
+	function_view<ProgressCallbackType> ProgressCallback = {},
+	DownloadError* ErrorOutput = nullptr);
@@ -10,5 +10,6 @@ constexpr char LauncherFilename[] = "launcher.exe";
 constexpr char PatchDomain[] = "";
 constexpr u16 PatchPort = 80; // 80 is the default http port.
 constexpr size_t BlockSize = 32 * 1024; // 32 KiB
+constexpr int MaxConcurrentDownloads = 4; // Range requests in flight at once when syncing.
 
 }
\ No newline at end of file
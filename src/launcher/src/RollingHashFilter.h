@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GlobalTypes.h"
+#include "Hash.h"
+#include "MHash.h"
+#include <vector>
+
+namespace Sync
+{
+
+// A bloom filter over the rolling hashes of the remote blocks.
+//
+// Most windows of the local file don't match any block, and this turns them away with two bit
+// tests in an array small enough to stay in cache, where a probe into the hash map would miss it
+// once the file is large.
+class RollingHashFilter
+{
+public:
+	void Create(size_t NumHashes)
+	{
+		size_t NumBits = 64;
+		while (NumBits < NumHashes * BitsPerHash)
+			NumBits *= 2;
+		Bits.assign(NumBits / 64, 0);
+		Mask = NumBits - 1;
+	}
+
+	void Add(Hash::Rolling RollingHash)
+	{
+		const auto Mixed = HashMix64(RollingHash.Value);
+		Set(Mixed & Mask);
+		Set((Mixed >> 32) & Mask);
+	}
+
+	bool MayContain(Hash::Rolling RollingHash) const
+	{
+		const auto Mixed = HashMix64(RollingHash.Value);
+		return Test(Mixed & Mask) && Test((Mixed >> 32) & Mask);
+	}
+
+private:
+	// With two hashes, this lets about 1.4% of the misses through.
+	static constexpr size_t BitsPerHash = 16;
+
+	void Set(u64 Bit) { Bits[Bit / 64] |= u64(1) << (Bit % 64); }
+	bool Test(u64 Bit) const { return (Bits[Bit / 64] >> (Bit % 64)) & 1; }
+
+	std::vector<u64> Bits;
+	u64 Mask{};
+};
+
+}
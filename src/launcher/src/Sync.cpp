@@ -39,7 +39,8 @@
 // ## Delta computation
 //
 // When the client consumes the .sync file, it constructs a hash map that maps rolling hashes to
-// data about the block that the hash corresponds to.
+// data about the block that the hash corresponds to, along with a bloom filter of the rolling
+// hashes to turn most of the lookups away before they get to the map.
 //
 // The client then computes the rolling hash of every block in the file at every possible offset
 // (not just multiples of the block size). That is, at every index in the list
@@ -52,11 +53,16 @@
 // If the strong hash also matches, we set the block data to indicate that it can be found in the
 // local file at that offset.
 //
+// The local file is split into segments that are scanned in parallel, each one reading the
+// BlockSize - 1 bytes past its end so that the blocks straddling the boundary are seen too.
+//
 // When the file is reconstructed, the client iterates over the list of blocks, grabbing blocks
 // from the local file if they were found, or downloading new blocks if not.
 //
 // To download blocks, the HTTP range request header is used. Thus, the webserver serving the files
-// must support it (the feature is optional).
+// must support it (the feature is optional). Runs of consecutive missing blocks are requested as
+// one range, and several ranges are downloaded at once, each written straight to its place in the
+// new file.
 //
 // ## Hash algorithms
 //
@@ -99,9 +105,13 @@
 #include "Download.h"
 #include "File.h"
 
+#include "MOpenHashMap.h"
+#include "RollingHashFilter.h"
+
 #include <vector>
-#include <unordered_map>
 #include <algorithm>
+#include <atomic>
+#include <thread>
 using std::min;
 using std::max;
 
@@ -110,6 +120,15 @@ namespace Sync
 
 const auto BlockSize = LauncherConfig::BlockSize;
 
+// The number of window positions each thread takes at a time when scanning the local file.
+constexpr u64 ScanSegmentSize = 128 * BlockSize;
+
+// The most missing blocks that are requested in one range.
+constexpr size_t MaxBlocksPerRange = 32;
+
+// Terminates the lists in RemoteFile::NextBlockWithSameHash.
+constexpr u32 NoBlock = u32(-1);
+
 // A block in the remote file.
 // Each of these are LauncherConfig::BlockSize byte large.
 // If the last block is smaller than that, it's represented as a LastRemoteBlock instead of as a
@@ -145,10 +164,14 @@ struct RemoteFile
 	// index in this list.
 	std::vector<RemoteBlock> RemoteBlocks;
 
-	// Maps rolling hashes to indices into the above list.
-	// Due to how weak the rolling hash is, each value might map to multiple blocks. Therefore,
-	// the map is a multimap.
-	std::unordered_multimap<Hash::Rolling, size_t> RollingHashToBlockMap;
+	// Maps rolling hashes to the index of the first block in the above list with that hash.
+	// Due to how weak the rolling hash is, each value might map to multiple blocks, so the rest
+	// of them are found by following NextBlockWithSameHash from there.
+	// The last block isn't in either, since it can't match a full window.
+	MOpenHashMap<u32, u32> RollingHashToBlock;
+	std::vector<u32> NextBlockWithSameHash;
+
+	RollingHashFilter Filter;
 
 	// The total size of the remote file.
 	u64 Size;
@@ -157,14 +180,6 @@ struct RemoteFile
 	u64 UnmatchingSize;
 
 	LastRemoteBlock LastBlock;
-
-	RemoteBlock& MapValueToBlock(size_t Index)
-	{
-		if (Index == size_t(-1))
-			return LastBlock;
-
-		return RemoteBlocks[Index];
-	}
 };
 
 // Same as ceil(float(a) / b), except without involving floats.
@@ -196,17 +211,10 @@ static bool DownloadSyncFile(RemoteFile& Remote, const char* SyncFileURL,
 	auto AddRemoteBlock = [&](const u8* Begin)
 	{
 		RemoteBlock* NewBlock;
-		size_t MapValue;
 		if (!Remote.LastBlock.Empty && EntriesProcessed == NumEntries - 1)
-		{
 			NewBlock = &Remote.LastBlock;
-			MapValue = size_t(-1);
-		}
 		else
-		{
 			NewBlock = &emplace_back(Remote.RemoteBlocks);
-			MapValue = NewBlock - Remote.RemoteBlocks.data();
-		}
 
 		const auto RollingHashSrc = Begin;
 		memcpy(&NewBlock->RollingHash.Value, RollingHashSrc, sizeof(NewBlock->RollingHash.Value));
@@ -214,8 +222,6 @@ static bool DownloadSyncFile(RemoteFile& Remote, const char* SyncFileURL,
 		const auto StrongHashSrc = RollingHashSrc + Hash::Rolling::Size;
 		memcpy(&NewBlock->StrongHash.Value, StrongHashSrc, sizeof(NewBlock->StrongHash.Value));
 
-		Remote.RollingHashToBlockMap.emplace(NewBlock->RollingHash, MapValue);
-
 		NewBlock->LocalFileOffset = -1;
 
 		++EntriesProcessed;
@@ -278,384 +284,303 @@ static bool DownloadSyncFile(RemoteFile& Remote, const char* SyncFileURL,
 	return ret;
 }
 
-// Calculates the relation between a local file and a remote file,
-// filling out a list of Blocks with the result.
-static bool CalculateBlocks(Memory& memory, RemoteFile& Remote, BlockCounts& Counts,
-	const char* LocalFilePath,
-	function_view<ProgressCallbackType> ProgressCallback)
+// Builds the lookup structures for the blocks DownloadSyncFile read in.
+static void IndexRemoteBlocks(RemoteFile& Remote)
 {
-	using namespace detail;
-
-	if (ProgressCallback)
-		ProgressCallback(StatusType::CalculatingBlocks, 0, 0);
-
-	MFile::File LocalFile{ LocalFilePath };
-	if (LocalFile.error())
-	{
-		Log(LogLevel::Error, "Failed to open file %s\n", LocalFilePath);
-		return false;
-	}
+	const auto NumBlocks = Remote.RemoteBlocks.size();
 
-	const auto LocalFileSize = LocalFile.size();
-	assert(!LocalFile.error());
+	Remote.RollingHashToBlock.reserve(NumBlocks);
+	Remote.NextBlockWithSameHash.assign(NumBlocks, NoBlock);
+	Remote.Filter.Create(NumBlocks);
 
-	if (LocalFileSize == 0)
+	// Going backwards leaves each list in order of position in the remote file.
+	for (auto i = NumBlocks; i-- > 0;)
 	{
-		Counts.UnmatchingBlocks = Remote.RemoteBlocks.size() + size_t(!Remote.LastBlock.Empty);
-		Counts.MatchingBlocks = 0;
-		Remote.UnmatchingSize = Remote.Size;
-		return true;
+		const auto& Block = Remote.RemoteBlocks[i];
+		const auto Inserted = Remote.RollingHashToBlock.insert(Block.RollingHash.Value, u32(i));
+		if (!Inserted.second)
+		{
+			Remote.NextBlockWithSameHash[i] = *Inserted.first;
+			*Inserted.first = u32(i);
+		}
+		Remote.Filter.Add(Block.RollingHash);
 	}
+}
 
-	// This is used as a circular buffer, so arithmetic on indices into it should be wrapped with
-	// Wrap.
-	constexpr auto FileBufferSize = Memory::FileBufferSize;
-	const auto FileBuffer = memory.FileBuffer.get();
+// The local file offsets of the remote blocks, shared between the threads scanning the local file.
+// Each one starts out as -1, and is set by the first thread to find the block.
+using FoundOffsetArray = std::unique_ptr<std::atomic<u64>[]>;
 
-	// Wraps an index a such that it fits within the bounds of FileData.
-	auto Wrap = [&](int a) {
-		return mod(a, FileBufferSize);
-	};
-
-	const auto InitialReadSize = size_t(std::min(LocalFileSize, u64(FileBufferSize)));
-	const auto BytesRead = LocalFile.read(FileBuffer, InitialReadSize);
-	if (BytesRead != InitialReadSize)
-	{
-		Log(LogLevel::Error, "Failed to read bytes 0 to %zu from file %s\n",
-			InitialReadSize, LocalFilePath);
+// Checks the window at Offset in the local file against the remote blocks with the same rolling
+// hash, and marks the ones that match it.
+// Returns true if it matched any.
+static bool MatchWindow(const RemoteFile& Remote, std::atomic<u64>* FoundOffsets,
+	Hash::Rolling RollingHash, const u8* Window, u64 Offset)
+{
+	const auto* FirstIndex = Remote.RollingHashToBlock.find(RollingHash.Value);
+	if (!FirstIndex)
 		return false;
-	}
-
-	// Most types from here on just use int for index and size types, which is ok because the
-	// FileData buffer couldn't reasonably be larger than that.
-
-	// The index of the start of the window relative to FileBuffer.
-	// The window is BlockSize bytes large, so the end index is Wrap(WindowStartIndex + BlockSize).
-	int WindowStartIndex = 0;
-
-	// The index of the start of the window relative to the file.
-	u64 WindowStartFileIndex = 0;
 
-	// The number of bytes skipped over by the window, that haven't yet been consumed.
-	int SkippedBytes = 0;
-
-	// Stores the last index at which data was loaded from the file.
-	int LastLoadEndIndex = InitialReadSize - 1;
+	bool StrongHashed = false;
+	Hash::Strong StrongHash;
 
-	size_t NumFoundBlocks = 0;
+	bool Found = false;
 
-	// Attempts to read new data into the range given.
-	// If the indices are the same, it refreshes the entire buffer.
-	// Returns the actual number of bytes read.
-	// Only used in AdvanceWindow.
-	auto Read = [&](int StartIndex, int OnePastEndIndex)
+	for (auto Index = *FirstIndex; Index != NoBlock; Index = Remote.NextBlockWithSameHash[Index])
 	{
-		LOG_DEBUG(4, "Reading %d-%d, LocalFile.tell() = %llu\n",
-			StartIndex, OnePastEndIndex, LocalFile.tell());
-
-		assert(StartIndex >= 0 && StartIndex < FileBufferSize);
-		assert(OnePastEndIndex >= 0 && OnePastEndIndex <= FileBufferSize);
+		if (FoundOffsets[Index].load(std::memory_order_relaxed) != u64(-1))
+			continue;
 
-		const auto Size = StartIndex == OnePastEndIndex ? FileBufferSize : Wrap(OnePastEndIndex - StartIndex);
-
-		const auto FirstReadSize = min(Size, int(FileBufferSize) - StartIndex);
-		const auto ActualFirstReadSize = LocalFile.read(&FileBuffer[StartIndex], FirstReadSize);
-		if (ActualFirstReadSize != FirstReadSize)
+		if (!StrongHashed)
 		{
-			if (LocalFile.error())
-			{
-				Log.Error("CalculateBlocks -- File IO error on %s\n", LocalFilePath);
-			}
-
-			LastLoadEndIndex = Wrap(StartIndex + (ActualFirstReadSize - 1));
-
-			LOG_DEBUG(4,
-				"FirstReadSize = %d\n"
-				"ActualFirstReadSize = %d\n"
-				"LastLoadEndIndex = %d\n",
-				FirstReadSize,
-				ActualFirstReadSize,
-				LastLoadEndIndex);
-
-			return int(ActualFirstReadSize);
-		} 
-
-		auto ret = FirstReadSize;
-
-		const auto SecondReadSize = int(Size) - (int(FileBufferSize) - StartIndex);
-		if (SecondReadSize > 0)
-		{
-			const auto ActualSecondReadSize = LocalFile.read(&FileBuffer[0], SecondReadSize);
-			ret += ActualSecondReadSize;
-			if (ActualSecondReadSize != SecondReadSize)
-			{
-				if (LocalFile.error())
-				{
-					Log.Error("CalculateBlocks -- File IO error on %s\n", LocalFilePath);
-				}
+			StrongHash.HashMemory(Window, BlockSize);
+			StrongHashed = true;
+		}
 
-				LastLoadEndIndex = Wrap(0 + (ActualSecondReadSize - 1));
+		if (Remote.RemoteBlocks[Index].StrongHash != StrongHash)
+			continue;
 
-				LOG_DEBUG(4,
-					"SecondReadSize = %d\n"
-					"ActualSecondReadSize = %d\n"
-					"ret = %d\n",
-					"LastLoadEndIndex = %d\n",
-					SecondReadSize,
-					ActualSecondReadSize,
-					ret,
-					LastLoadEndIndex);
+		// If another thread got here first, its offset is just as good.
+		auto Expected = u64(-1);
+		FoundOffsets[Index].compare_exchange_strong(Expected, Offset, std::memory_order_relaxed);
 
-				return ret;
-			}
-		}
+		LOG_DEBUG(4, "Block value %u found at local file offset %llu\n", Index, Offset);
 
-		LastLoadEndIndex = Wrap(OnePastEndIndex - 1);
+		Found = true;
+	}
 
-		LOG_DEBUG(4,
-			"ret = %d\n"
-			"LastLoadEndIndex = %d\n",
-			ret,
-			LastLoadEndIndex);
+	if (!Found)
+		LOG_DEBUG(4, "False positive\n");
 
-		return ret;
-	};
+	return Found;
+}
 
-	// Attempts to advance the window by AdvanceOffset bytes, reading in more data if necessary.
-	// Returns the actual number of bytes advanced by, which is less than requested if the end of
-	// the file was reached or if there was an IO error.
-	// If this happens, we can't advance again.
-	auto AdvanceWindow = [&](int AdvanceOffset)
-	{
-		// Visual for BlockSize = 4, OldWindowStartIndex = 0,
-		// LastLoadEndIndex = 5, AdvanceOffset = 2.
-		//
-		// [ x | x | - | - | - | - | x | x ]
-		//       ^   ^       ^   ^   ^
-		//       |   |       |   |   WindowEndIndex
-		//       |   |       |   LastLoadEndIndex
-		//       |   |       OldWindowEndIndex
-		//       |   WindowStartIndex
-		//       LastLoadStartIndex
-		//
-		// Bytes marked x should be updated.
-
-		assert(AdvanceOffset > 0 && AdvanceOffset <= BlockSize);
-
-		const auto OldWindowStartIndex = WindowStartIndex;
-		WindowStartIndex = Wrap(WindowStartIndex + AdvanceOffset);
-
-		const auto OldWindowEndIndex = Wrap(OldWindowStartIndex + BlockSize - 1);
-		const auto WindowEndIndex = Wrap(WindowStartIndex + BlockSize - 1);
-
-		// We want to read new data in if the window end moved past the last load end.
-		// That is, if the old window end was behind or equal to the last load end, and the new
-		// window end is ahead of it.
-
-		// Move LoadEnd and WindowEnd so that they're relative to OldWindowEnd.
-		const auto OldWindowEndToLoadEnd = Wrap(LastLoadEndIndex - OldWindowEndIndex);
-		const auto WindowEndToOldWindowEnd = AdvanceOffset;
-
-		int ret;
-
-		if (OldWindowEndToLoadEnd >= 0 && OldWindowEndToLoadEnd < WindowEndToOldWindowEnd)
-		{
-			LOG_DEBUG(4, "AdvanceWindow -- Reading\n"
-				"OldWindowStartIndex = %d, WindowStartIndex = %d\n"
-				"OldWindowEndIndex = %d, WindowEndIndex = %d\n"
-				"OldWindowEndToLoadEnd = %d, WindowEndToOldWindowEnd = %d\n"
-				"LastLoadEndIndex = %d\n",
-				OldWindowStartIndex, WindowStartIndex,
-				OldWindowEndIndex, WindowEndIndex,
-				OldWindowEndToLoadEnd, WindowEndToOldWindowEnd,
-				LastLoadEndIndex);
-
-			const auto NumBytesRead = Read(Wrap(LastLoadEndIndex + 1), WindowStartIndex);
-			const auto MaxAdvance = NumBytesRead + OldWindowEndToLoadEnd;
-			const auto ActualAdvance = min(AdvanceOffset, MaxAdvance);
-
-			LOG_DEBUG(4, "NumBytesRead = %d\n"
-				"MaxAdvance = %d\n"
-				"ActualAdvance = %d\n",
-				NumBytesRead,
-				MaxAdvance,
-				ActualAdvance);
-
-			ret = ActualAdvance;
-			if (ret < AdvanceOffset)
-				WindowStartIndex -= AdvanceOffset - ret;
-
-			if (ProgressCallback)
-			{
-				ProgressCallback(Sync::CalculatingBlocks, LocalFileSize,
-					WindowStartFileIndex + ret);
-			}
-		}
-		else
-		{
-			ret = AdvanceOffset;
-		}
+// Checks the windows starting at [Begin, End) in the local file against the remote blocks.
+// Buffer must be Memory::ScanBufferSize bytes large.
+// Returns false on an IO error.
+static bool ScanSegment(MFile::File& LocalFile, u64 LocalFileSize,
+	const RemoteFile& Remote, std::atomic<u64>* FoundOffsets,
+	u64 Begin, u64 End, u8* Buffer)
+{
+	// The last window needs the BlockSize - 1 bytes after End too.
+	const auto ReadEnd = min(LocalFileSize, End + BlockSize - 1);
 
-		WindowStartFileIndex += ret;
+	// The part of the file that's in Buffer.
+	u64 BufferStart = Begin;
+	size_t BufferSize = 0;
 
-		return ret;
-	};
+	if (!LocalFile.seek(Begin, MFile::Seek::Begin))
+		return false;
 
-	auto HashBlock = [&](auto&& Stream, auto&& HashOutput, int StartIndex, int Size)
+	// Makes sure the bytes [Offset, Offset + Size) are in the buffer. If they aren't, it moves
+	// the ones from Offset on to the front of the buffer, and fills the rest of it from the file.
+	// Offset can't be before the buffer or past the end of it.
+	auto Load = [&](u64 Offset, size_t Size)
 	{
-		const auto EndIndex = Wrap(StartIndex + BlockSize);
-
-		const auto FirstSrc = &FileBuffer[StartIndex];
-		const auto FirstSize = min(Size, int(FileBufferSize) - StartIndex);
-		Stream.Update(FirstSrc, FirstSize);
+		if (Offset + Size <= BufferStart + BufferSize)
+			return true;
 
-		const auto SecondSrc = &FileBuffer[0];
-		const auto SecondSize = Size - (int(FileBufferSize) - StartIndex);
-		if (SecondSize > 0)
-			Stream.Update(SecondSrc, SecondSize);
+		const auto Kept = size_t(BufferStart + BufferSize - Offset);
+		memmove(Buffer, Buffer + (Offset - BufferStart), Kept);
+		BufferStart = Offset;
+		BufferSize = Kept;
 
-		Stream.Final(HashOutput);
-	};
+		const auto ReadSize = size_t(min(u64(Memory::ScanBufferSize - BufferSize),
+			ReadEnd - (BufferStart + BufferSize)));
+		BufferSize += LocalFile.read(Buffer + BufferSize, ReadSize);
 
-	auto RollingHashBlock = [&](auto&& HashOutput, int StartIndex, int Size = BlockSize) {
-		 HashBlock(Hash::Rolling::Stream{}, HashOutput, StartIndex, Size);
+		return Offset + Size <= BufferStart + BufferSize;
 	};
 
-	auto StrongHashBlock = [&](auto&& HashOutput, int StartIndex, int Size = BlockSize) {
-		HashBlock(Hash::Strong::Stream{}, HashOutput, StartIndex, Size);
-	};
+	Hash::Rolling RollingHash;
+	bool Rehash = true;
 
-	// Adds the final block when the end of the file has been reached.
-	auto OnReachedEnd = [&]
+	auto WindowStart = Begin;
+	while (WindowStart < End)
 	{
-		if (Remote.LastBlock.Empty)
-			return;
+		if (!Load(WindowStart, BlockSize))
+			break;
 
-		const auto LastBlockStartIndex = LastLoadEndIndex + 1 - Remote.LastBlock.Size;
+		auto Window = Buffer + (WindowStart - BufferStart);
+		if (Rehash)
+		{
+			RollingHash.HashMemory(Window, BlockSize);
+			Rehash = false;
+		}
 
-		Hash::Strong StrongHash;
-		StrongHashBlock(StrongHash, LastBlockStartIndex, Remote.LastBlock.Size);
+		if (Remote.Filter.MayContain(RollingHash) &&
+			MatchWindow(Remote, FoundOffsets, RollingHash, Window, WindowStart))
+		{
+			// Jump ahead by one block on match, since we probably won't be able to find new
+			// matches inside it.
+			WindowStart += BlockSize;
+			Rehash = true;
+			continue;
+		}
 
-		if (StrongHash != Remote.LastBlock.StrongHash)
-			return;
+		if (WindowStart + 1 >= End)
+			break;
 
-		Remote.LastBlock.LocalFileOffset = LocalFileSize - Remote.LastBlock.Size;
+		// Advance the window, which needs the byte after it.
+		if (!Load(WindowStart, BlockSize + 1))
+			break;
 
-		LOG_DEBUG(4, "Last block found at local file offset %llu\n", Remote.LastBlock.LocalFileOffset);
-	};
+		Window = Buffer + (WindowStart - BufferStart);
+		RollingHash.Move(Window[0], Window[BlockSize], BlockSize);
+		++WindowStart;
+	}
 
-	auto SetCounts = [&]
+	if (LocalFile.error())
 	{
-		bool LastBlockFound = Remote.LastBlock.LocalFileOffset != -1;
+		Log.Error("CalculateBlocks -- File IO error at offset %llu\n", BufferStart + BufferSize);
+		return false;
+	}
 
-		if (!LastBlockFound)
-			LOG_DEBUG(4, "Last block was not found\n");
+	return true;
+}
 
-		Counts.MatchingBlocks = NumFoundBlocks +
-			size_t(LastBlockFound && !Remote.LastBlock.Empty);
-		Counts.UnmatchingBlocks = Remote.RemoteBlocks.size() - NumFoundBlocks + 
-			size_t(!LastBlockFound && !Remote.LastBlock.Empty);
-		Remote.UnmatchingSize = (Remote.RemoteBlocks.size() - NumFoundBlocks) * BlockSize +
-			(LastBlockFound ? 0 : Remote.LastBlock.Size);
-	};
+// Calculates the relation between a local file and a remote file,
+// filling out a list of Blocks with the result.
+static bool CalculateBlocks(Memory& memory, RemoteFile& Remote, BlockCounts& Counts,
+	const char* LocalFilePath,
+	function_view<ProgressCallbackType> ProgressCallback)
+{
+	using namespace detail;
 
-	Hash::Rolling RollingHash;
+	if (ProgressCallback)
+		ProgressCallback(StatusType::CalculatingBlocks, 0, 0);
 
-	if (InitialReadSize < BlockSize)
+	MFile::File LocalFile{ LocalFilePath };
+	if (LocalFile.error())
 	{
-		if (InitialReadSize >= Remote.LastBlock.Size)
-			OnReachedEnd();
-		SetCounts();
-		return true;
+		Log(LogLevel::Error, "Failed to open file %s\n", LocalFilePath);
+		return false;
 	}
 
-	RollingHash.HashMemory(FileBuffer, BlockSize);
+	const auto LocalFileSize = LocalFile.size();
+	assert(!LocalFile.error());
+
+	const auto NumBlocks = Remote.RemoteBlocks.size();
+	FoundOffsetArray FoundOffsets{ new std::atomic<u64>[NumBlocks] };
+	for (size_t i = 0; i < NumBlocks; ++i)
+		FoundOffsets[i].store(u64(-1), std::memory_order_relaxed);
 
-	while (true)
+	if (LocalFileSize >= BlockSize && NumBlocks > 0)
 	{
-#ifdef _DEBUG
-		char RollingString[Hash::Rolling::MinimumStringSize];
-		RollingHash.ToString(RollingString);
-		Log.Debug(5, "WindowStartIndex = %llu -- Rolling = %s\n",
-			WindowStartFileIndex, RollingString);
-#endif
+		// The window positions, split into segments that threads take one at a time.
+		const auto NumWindows = LocalFileSize - BlockSize + 1;
+		const auto NumSegments = ceildiv(NumWindows, ScanSegmentSize);
+		const auto NumThreads = size_t(min(NumSegments,
+			u64(max(1u, std::thread::hardware_concurrency()))));
 
-		// Check if the hash from the current window matches a block in the remote file.
-		auto&& Map = Remote.RollingHashToBlockMap;
-		auto Range = MakeRange(Map.equal_range(RollingHash));
-		if (Range.first != Map.end())
-		{
-			LOG_DEBUG("Rolling hash matches a block\n");
+		Log.Debug("Scanning %llu windows in %llu segments on %zu threads\n",
+			NumWindows, NumSegments, NumThreads);
 
-			bool StrongHashed = false;
-			Hash::Strong StrongHash;
+		memory.ReserveScanBuffers(NumThreads);
 
-			bool Found = false;
+		std::atomic<u64> NextSegment{ 0 };
+		std::atomic<u64> NumScannedWindows{ 0 };
+		std::atomic<bool> Failed{ false };
 
-			for (auto&& Pair : Range)
-			{
-				auto&& Block = Remote.MapValueToBlock(Pair.second);
-				if (Block.LocalFileOffset != -1)
-					continue;
+		// Also run on the calling thread, which reports the progress between its segments since
+		// the callback isn't expected to be called from elsewhere.
+		auto Worker = [&](size_t ThreadIndex)
+		{
+			const auto IsCallingThread = ThreadIndex == 0;
 
-				if (!StrongHashed)
+			MFile::File* File = &LocalFile;
+			MFile::File ThreadFile;
+			if (!IsCallingThread)
+			{
+				if (!ThreadFile.open(LocalFilePath))
 				{
-					StrongHashBlock(StrongHash, WindowStartIndex);
-					StrongHashed = true;
+					Log.Error("CalculateBlocks -- Failed to open file %s\n", LocalFilePath);
+					Failed = true;
+					return;
 				}
-
-				if (Block.StrongHash != StrongHash)
-					continue;
-
-				++NumFoundBlocks;
-
-				Block.LocalFileOffset = WindowStartFileIndex;
-
-				LOG_DEBUG(4, "Block value %zu found at local file offset %llu\n",
-					Pair.second, Block.LocalFileOffset);
-
-				Found = true;
+				File = &ThreadFile;
 			}
 
-			if (Found)
+			while (!Failed.load(std::memory_order_relaxed))
 			{
-				// Jump ahead by one block on match, since we probably won't be able to find new
-				// matches inside it.
-				const auto Advanced = AdvanceWindow(BlockSize);
-				if (Advanced != BlockSize)
+				const auto Segment = NextSegment++;
+				if (Segment >= NumSegments)
+					break;
+
+				const auto Begin = Segment * ScanSegmentSize;
+				const auto End = min(Begin + ScanSegmentSize, NumWindows);
+				if (!ScanSegment(*File, LocalFileSize, Remote, FoundOffsets.get(), Begin, End,
+					memory.ScanBuffers[ThreadIndex].get()))
 				{
-					OnReachedEnd();
+					Failed = true;
 					break;
 				}
-				SkippedBytes = 0;
 
-				RollingHashBlock(RollingHash, WindowStartIndex);
-
-				continue;
-			}
-			else
-			{
-				LOG_DEBUG(4, "False positive\n");
+				NumScannedWindows += End - Begin;
+				if (IsCallingThread && ProgressCallback)
+				{
+					ProgressCallback(Sync::CalculatingBlocks, NumWindows,
+						NumScannedWindows.load(std::memory_order_relaxed));
+				}
 			}
-		}
+		};
 
-		// Advance the window.
-		const auto OldByte = FileBuffer[WindowStartIndex];
+		std::vector<std::thread> Threads;
+		for (size_t i = 1; i < NumThreads; ++i)
+			Threads.emplace_back(Worker, i);
+		Worker(0);
+		for (auto&& Thread : Threads)
+			Thread.join();
 
-		const auto Advanced = AdvanceWindow(1);
-		if (Advanced != 1)
+		if (Failed)
 		{
-			OnReachedEnd();
-			break;
+			Log.Error("CalculateBlocks -- Failed to scan file %s\n", LocalFilePath);
+			return false;
 		}
+	}
 
-		const auto WindowEndIndex = Wrap(WindowStartIndex + BlockSize - 1);
-		const auto NewByte = FileBuffer[WindowEndIndex];
+	size_t NumFoundBlocks = 0;
+	for (size_t i = 0; i < NumBlocks; ++i)
+	{
+		Remote.RemoteBlocks[i].LocalFileOffset = FoundOffsets[i].load(std::memory_order_relaxed);
+		if (Remote.RemoteBlocks[i].LocalFileOffset != -1)
+			++NumFoundBlocks;
+	}
 
-		RollingHash.Move(OldByte, NewByte, BlockSize);
+	// The last block can only be at the end of the local file.
+	if (!Remote.LastBlock.Empty && LocalFileSize >= Remote.LastBlock.Size)
+	{
+		const auto Offset = LocalFileSize - Remote.LastBlock.Size;
+
+		u8 LastBlockData[BlockSize];
+		if (!LocalFile.seek(Offset, MFile::Seek::Begin) ||
+			LocalFile.read(LastBlockData, Remote.LastBlock.Size) != Remote.LastBlock.Size)
+		{
+			Log.Error("CalculateBlocks -- Failed to read the last %u bytes of file %s\n",
+				Remote.LastBlock.Size, LocalFilePath);
+			return false;
+		}
+
+		Hash::Strong StrongHash;
+		StrongHash.HashMemory(LastBlockData, Remote.LastBlock.Size);
+		if (StrongHash == Remote.LastBlock.StrongHash)
+		{
+			Remote.LastBlock.LocalFileOffset = Offset;
+			LOG_DEBUG(4, "Last block found at local file offset %llu\n", Offset);
+		}
 	}
 
-	SetCounts();
+	const bool LastBlockFound = Remote.LastBlock.LocalFileOffset != -1;
+
+	if (!LastBlockFound)
+		LOG_DEBUG(4, "Last block was not found\n");
+
+	Counts.MatchingBlocks = NumFoundBlocks +
+		size_t(LastBlockFound && !Remote.LastBlock.Empty);
+	Counts.UnmatchingBlocks = NumBlocks - NumFoundBlocks +
+		size_t(!LastBlockFound && !Remote.LastBlock.Empty);
+	Remote.UnmatchingSize = (NumBlocks - NumFoundBlocks) * BlockSize +
+		(LastBlockFound ? 0 : Remote.LastBlock.Size);
 
 	return true;
 }
@@ -694,167 +619,197 @@ static bool CreateNewFile(const char* LocalFilePath,
 		return false;
 	}
 
-	Hash::Strong::Stream Hash;
-
 	if (SizeOutput)
 		*SizeOutput = 0;
 
 	Log.Debug("Blocks.size() = %zu, Remote.LastBlock.Empty = %d\n",
 		Remote.RemoteBlocks.size(), Remote.LastBlock.Empty);
 
-	const u64 DLTotal = Remote.UnmatchingSize;
-	u64 DLedSoFar = 0;
-	u64 TotalSize = 0;
+	const auto NumBlocks = Remote.RemoteBlocks.size() + size_t(!Remote.LastBlock.Empty);
 
-	auto HandleBlock = [&](const RemoteBlock& Block, size_t ThisBlockSize,
-		u64 OutputOffset) // The offset in the remote/new file.
+	// The last block is at NumBlocks - 1 if it isn't empty.
+	auto GetBlock = [&](size_t Index) -> const RemoteBlock& {
+		return Index < Remote.RemoteBlocks.size() ? Remote.RemoteBlocks[Index] : Remote.LastBlock;
+	};
+	auto GetBlockSize = [&](size_t Index) -> size_t {
+		return Index < Remote.RemoteBlocks.size() ? BlockSize : Remote.LastBlock.Size;
+	};
+
+	// Where the next write to OutputFile goes, so that it only seeks when it has to.
+	u64 OutputOffset = 0;
+	auto Write = [&](u64 Offset, const void* Buffer, size_t Size)
 	{
-#ifdef _DEBUG
-		char RollingHashString[Hash::Rolling::MinimumStringSize];
-		Block.RollingHash.ToString(RollingHashString);
-		char StrongHashString[Hash::Strong::MinimumStringSize];
-		Block.StrongHash.ToString(StrongHashString);
-
-		Log.Debug(4, "Handling block\n"
-			"RollingHash = %s\n"
-			"StrongHash = %s\n"
-			"LocalFileOffset = %llu\n"
-			"Size = %zu\n",
-			RollingHashString,
-			StrongHashString,
-			Block.LocalFileOffset,
-			ThisBlockSize);
-#endif
+		if (Offset != OutputOffset && !OutputFile.seek(Offset, MFile::Seek::Begin))
+			return false;
 
-		if (Block.LocalFileOffset != -1)
+		const auto NumBytesWritten = OutputFile.write(Buffer, Size);
+		OutputOffset = Offset + NumBytesWritten;
+		if (NumBytesWritten != Size)
 		{
-			InputFile.seek(Block.LocalFileOffset, MFile::Seek::Begin);
-
-			char InputBuffer[BlockSize];
-			const auto NumBytesRead = InputFile.read(InputBuffer, ThisBlockSize);
+			Log.Error("Sync::SynchronizeFile -- Failed to write %zu bytes to file %s\n",
+				Size, SynchronizedFilePath);
+			return false;
+		}
 
-			OutputFile.write(InputBuffer, NumBytesRead);
+		return true;
+	};
 
-			if (HashOutput)
-				Hash.Update(InputBuffer, NumBytesRead);
+	// Copy the blocks that were found locally, and collect the runs of ones that weren't into
+	// ranges to download.
+	std::vector<DownloadRange> Ranges;
+	std::vector<size_t> RangeFirstBlocks;
+	for (size_t i = 0; i < NumBlocks; ++i)
+	{
+		auto&& Block = GetBlock(i);
+		const auto ThisBlockSize = GetBlockSize(i);
+		const auto Offset = u64(i) * BlockSize;
 
-			if (InputFile.error())
+		if (Block.LocalFileOffset == -1)
+		{
+			const auto Last = Offset + ThisBlockSize - 1;
+			const auto Extends = !Ranges.empty() && Ranges.back().Last + 1 == Offset &&
+				i - RangeFirstBlocks.back() < MaxBlocksPerRange;
+			if (Extends)
 			{
-				Log.Error("Sync::SynchronizeFile -- Failed to read %llu bytes from file %s\n",
-					ThisBlockSize, LocalFilePath);
-				return false;
+				Ranges.back().Last = Last;
 			}
-		}
-		else
-		{
-			size_t DownloadedBlockSize = 0;
-			Hash::Strong::Stream DownloadedBlockHashStream;
-
-			auto Callback = [&](const void* Buffer, size_t Size, DownloadInfo& Info)
+			else
 			{
-				Log.Debug(4, "CreateNewFile -- Callback invoked with Buffer = %p, Size = %zu\n",
-					Buffer, Size);
-
-				if (!Info.IsRange())
-				{
-					assert(false);
-					return false;
-				}
-
-				DownloadedBlockSize += Size;
-				DownloadedBlockHashStream.Update(Buffer, Size);
+				Ranges.push_back({ Offset, Last });
+				RangeFirstBlocks.push_back(i);
+			}
+			continue;
+		}
 
-				if (HashOutput)
-					Hash.Update(Buffer, Size);
+		u8 InputBuffer[BlockSize];
+		if (!InputFile.seek(Block.LocalFileOffset, MFile::Seek::Begin) ||
+			InputFile.read(InputBuffer, ThisBlockSize) != ThisBlockSize)
+		{
+			Log.Error("Sync::SynchronizeFile -- Failed to read %zu bytes from file %s\n",
+				ThisBlockSize, LocalFilePath);
+			return false;
+		}
 
-				OutputFile.write(Buffer, Size);
+		if (!Write(Offset, InputBuffer, ThisBlockSize))
+			return false;
+	}
 
-				return true;
-			};
+	Log.Debug("Downloading %zu blocks in %zu ranges\n",
+		Remote.UnmatchingSize / BlockSize, Ranges.size());
 
-			auto ProgressCallbackWrapper = [&](size_t BlockDLTotal, size_t BlockDLNow)
-			{
-				ProgressCallback(StatusType::DownloadingFile, DLTotal, DLedSoFar + BlockDLNow);
-			};
+	// How far into each range the download has gotten, and the hash of the block it's in.
+	struct RangeState
+	{
+		u64 Received = 0;
+		Hash::Strong::Stream BlockHash;
+	};
+	std::vector<RangeState> States(Ranges.size());
 
-			const auto StartOffset = OutputOffset;
-			// The range is inclusive so we need to subtract one.
-			const auto EndOffset = StartOffset + ThisBlockSize - 1;
+	auto Callback = [&](size_t RangeIndex, const u8* Buffer, size_t Size, DownloadInfo& Info)
+	{
+		Log.Debug(4, "CreateNewFile -- Callback invoked with RangeIndex = %zu, Buffer = %p, "
+			"Size = %zu\n", RangeIndex, Buffer, Size);
 
-			char Range[64];
-			sprintf_safe(Range, "%llu-%llu", StartOffset, EndOffset);
+		if (!Info.IsRange())
+		{
+			assert(false);
+			return false;
+		}
 
-			Log.Debug(3, "CreateNewFile -- Calling DownloadFile with URL = %s, "
-				"Port = %d, Range = %s\n",
-				RemoteFileURL,
-				LauncherConfig::PatchPort, Range);
+		auto&& Range = Ranges[RangeIndex];
+		auto&& State = States[RangeIndex];
+		if (State.Received + Size > Range.size())
+		{
+			Log.Error("Got more than the %llu bytes of range %llu-%llu\n",
+				Range.size(), Range.First, Range.Last);
+			return false;
+		}
 
-			function_view<::ProgressCallbackType> ProgressCallbackArg;
-			if (ProgressCallback)
-				ProgressCallbackArg = ProgressCallbackWrapper;
+		if (!Write(Range.First + State.Received, Buffer, Size))
+			return false;
 
-			DownloadFile(DownloadManager, RemoteFileURL, LauncherConfig::PatchPort,
-				std::ref(Callback), ProgressCallbackArg, Range);
+		// Check each block as soon as all of it is in.
+		while (Size > 0)
+		{
+			// Ranges start at the start of a block.
+			const auto BlockIndex = RangeFirstBlocks[RangeIndex] + size_t(State.Received / BlockSize);
+			const auto ThisBlockSize = GetBlockSize(BlockIndex);
+			const auto OffsetInBlock = size_t(State.Received % BlockSize);
+			const auto Consumed = min(Size, ThisBlockSize - OffsetInBlock);
+
+			State.BlockHash.Update(Buffer, Consumed);
+			State.Received += Consumed;
+			Buffer += Consumed;
+			Size -= Consumed;
+
+			if (OffsetInBlock + Consumed != ThisBlockSize)
+				continue;
 
 			Hash::Strong DownloadedBlockHash;
-			DownloadedBlockHashStream.Final(DownloadedBlockHash);
+			State.BlockHash.Final(DownloadedBlockHash);
+			State.BlockHash = Hash::Strong::Stream{};
 
-			const auto WrongSize = DownloadedBlockSize != ThisBlockSize;
-			const auto WrongHash = DownloadedBlockHash != Block.StrongHash;
-			if (WrongSize || WrongHash)
+			auto&& ExpectedHash = GetBlock(BlockIndex).StrongHash;
+			if (DownloadedBlockHash != ExpectedHash)
 			{
-				Log.Error("Downloaded block integrity fail\n");
-
-				if (WrongSize)
-				{
-					Log.Error("Expected size %zu, got %zu\n", ThisBlockSize, DownloadedBlockSize);
-				}
-				if (WrongHash)
-				{
-					char ExpectedHashString[Hash::Strong::MinimumStringSize];
-					Block.StrongHash.ToString(ExpectedHashString);
-					char ActualHashString[Hash::Strong::MinimumStringSize];
-					DownloadedBlockHash.ToString(ActualHashString);
-
-					Log.Error("Expected hash %s, got %s\n", ExpectedHashString, ActualHashString);
-				}
-
+				char ExpectedHashString[Hash::Strong::MinimumStringSize];
+				ExpectedHash.ToString(ExpectedHashString);
+				char ActualHashString[Hash::Strong::MinimumStringSize];
+				DownloadedBlockHash.ToString(ActualHashString);
+
+				Log.Error("Downloaded block integrity fail\n"
+					"Block %zu: Expected hash %s, got %s\n",
+					BlockIndex, ExpectedHashString, ActualHashString);
 				return false;
 			}
-
-			DLedSoFar += ThisBlockSize;
 		}
 
-		TotalSize += ThisBlockSize;
-
 		return true;
 	};
 
-	for (size_t i = 0; i < Remote.RemoteBlocks.size(); ++i)
+	auto ProgressCallbackWrapper = [&](size_t DLTotal, size_t DLNow)
 	{
-		auto&& Block = Remote.RemoteBlocks[i];
+		ProgressCallback(StatusType::DownloadingFile, Remote.UnmatchingSize, DLNow);
+	};
 
-		const auto OutputOffset = i * BlockSize;
-		if (!HandleBlock(Block, BlockSize, OutputOffset))
-		{
-			return false;
-		}
+	function_view<::ProgressCallbackType> ProgressCallbackArg;
+	if (ProgressCallback)
+		ProgressCallbackArg = ProgressCallbackWrapper;
+
+	DownloadError Error;
+	if (!DownloadRanges(DownloadManager, RemoteFileURL, LauncherConfig::PatchPort,
+		Ranges, LauncherConfig::MaxConcurrentDownloads,
+		std::ref(Callback), ProgressCallbackArg, &Error))
+	{
+		Log.Error("Sync::SynchronizeFile -- Failed to download blocks from %s: %s\n",
+			RemoteFileURL, Error.String);
+		return false;
 	}
 
-	if (!Remote.LastBlock.Empty)
+	for (size_t i = 0; i < Ranges.size(); ++i)
 	{
-		if (!HandleBlock(Remote.LastBlock, Remote.LastBlock.Size,
-			u64(Remote.RemoteBlocks.size()) * BlockSize))
+		if (States[i].Received != Ranges[i].size())
 		{
+			Log.Error("Downloaded block integrity fail\n"
+				"Expected size %llu for range %llu-%llu, got %llu\n",
+				Ranges[i].size(), Ranges[i].First, Ranges[i].Last, States[i].Received);
 			return false;
 		}
 	}
 
-	if (HashOutput)
-		Hash.Final(*HashOutput);
+	OutputFile.close();
+	if (OutputFile.error())
+	{
+		Log.Error("Sync::SynchronizeFile -- Failed to close file %s\n", SynchronizedFilePath);
+		return false;
+	}
+
+	// The blocks were written out of order, so the file is hashed again once it's complete.
+	if (HashOutput && !HashOutput->HashFile(SynchronizedFilePath))
+		return false;
 
 	if (SizeOutput)
-		*SizeOutput = TotalSize;
+		*SizeOutput = Remote.Size;
 
 	return true;
 }
@@ -977,25 +932,12 @@ SyncResult SynchronizeFile(Memory& memory,
 		Log.Debug(4, "Block %zu: Rolling = %s, Strong = %s\n",
 			i, RollingString, StrongString);
 	}
-
-	int i = 0;
-	for (auto&& Pair : Remote.RollingHashToBlockMap)
-	{
-		auto&& Key = Pair.first;
-		auto&& Value = Pair.second;
-		auto&& Block = Remote.MapValueToBlock(Value);
-		char KeyString[Hash::Rolling::MinimumStringSize];
-		Key.ToString(KeyString);
-		char RollingString[Hash::Rolling::MinimumStringSize];
-		Block.RollingHash.ToString(RollingString);
-		char StrongString[Hash::Strong::MinimumStringSize];
-		Block.StrongHash.ToString(StrongString);
-		Log.Debug(4, "Map block %d: Key = %s, Rolling = %s, Strong = %s\n",
-			i, KeyString, RollingString, StrongString);
-		++i;
-	}
 #endif
 
+	IndexRemoteBlocks(Remote);
+
+	Log.Debug("%zu distinct rolling hashes\n", Remote.RollingHashToBlock.size());
+
 	Log.Debug("Calculating blocks\n");
 
 	BlockCounts Counts;
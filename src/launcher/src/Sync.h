@@ -2,6 +2,7 @@
 
 #include <string>
 #include <memory>
+#include <vector>
 #include "GlobalTypes.h"
 #include "Download.h"
 #include "LauncherConfig.h"
@@ -36,10 +37,17 @@ struct SyncResult
 	std::string ErrorMessage;
 };
 
+// Buffers kept between calls to SynchronizeFile, one for each thread that scans the local file.
 struct Memory
 {
-	static constexpr auto FileBufferSize = int(4 * LauncherConfig::BlockSize);
-	std::unique_ptr<u8[]> FileBuffer{new u8[FileBufferSize]};
+	static constexpr auto ScanBufferSize = int(8 * LauncherConfig::BlockSize);
+	std::vector<std::unique_ptr<u8[]>> ScanBuffers;
+
+	void ReserveScanBuffers(size_t Count)
+	{
+		while (ScanBuffers.size() < Count)
+			ScanBuffers.emplace_back(new u8[ScanBufferSize]);
+	}
 };
 
 SyncResult SynchronizeFile(Memory&,